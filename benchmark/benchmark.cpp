@@ -1,6 +1,47 @@
 #include <random>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <cstring>
+#include <numeric>
+#include <unordered_map>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#if !defined(_WIN32)
+ #include <sys/resource.h>
+ #include <sys/wait.h>
+ #include <unistd.h>
+#endif
 #include <benchmark/benchmark.h>
 #include "cclib.h"
+#include "ccsimd.h"
+#include "ccparallel.h"
+#include "ccexpr.h"
+#include "cctransform.h"
+#include "ccimage.h"
+#include "ccresample.h"
+#include "ccbc.h"
+#include "ccsort.h"
+#include "ccspatial.h"
+#include "ccbounds.h"
+#include "ccskin.h"
+#include "ccblur.h"
+#include "ccmeshio.h"
+#include "ccpool.h"
+#include "cchash.h"
+#include "ccmeshopt.h"
+#include "ccqueue.h"
+#include "ccnoise.h"
+#include "ccexposure.h"
+#include "ccsh.h"
+#include "ccvmem.h"
+#include "ccbitvector.h"
+
+#define CC_PROF_ENABLED
+#include "ccprof.h"
 
 class Benchmark : public benchmark::Fixture
 {
@@ -100,11 +141,2239 @@ BENCHMARK_DEFINE_F(Benchmark, CC_ATAN2)(benchmark::State& st)
 	}
 }
 
+class SimdBenchmark : public benchmark::Fixture
+{
+public:
+	void SetUp(const ::benchmark::State& state)
+	{
+		std::random_device rd;
+		std::mt19937 mt(rd());
+		std::uniform_real_distribution<float> dist(0.0, 1.0);
+		for (int i = 0; i < TESTNUM; ++i)
+		{
+			vectors[i] = cc::math::vec4(dist(mt), dist(mt), dist(mt), 1.f);
+			values[i] = dist(mt);
+		}
+		matrix = cc::math::perspective(1.05f, 1.33f, .1f, 1000.f) * cc::math::lookAt(cc::math::vec3(2.f, 5.f, 10.f), cc::math::vec3(), cc::math::vec3(0.f, 1.f, 0.f));
+		level = cc::simd::level();
+	}
+
+	void TearDown(const ::benchmark::State& state)
+	{
+		cc::simd::force(level);
+	}
+
+	static constexpr int TESTNUM = 16384;
+	cc::math::vec4 vectors[TESTNUM];
+	cc::math::vec4 results[TESTNUM];
+	float values[TESTNUM];
+	float fresults[TESTNUM];
+	cc::math::mat4 matrix;
+	cc::simd::Level level;
+};
+
+BENCHMARK_DEFINE_F(SimdBenchmark, LOOP_TRANSFORM)(benchmark::State& st)
+{
+	for (auto _ : st)
+	{
+		for (int i = 0; i < TESTNUM; ++i)
+		{
+			results[i] = matrix * vectors[i];
+		}
+		benchmark::ClobberMemory();
+	}
+	st.SetItemsProcessed(st.iterations() * TESTNUM);
+}
+
+BENCHMARK_DEFINE_F(SimdBenchmark, CC_TRANSFORM)(benchmark::State& st)
+{
+	st.SetLabel(cc::simd::level_name(cc::simd::force(cc::simd::Level(st.range(0)))));
+	for (auto _ : st)
+	{
+		cc::simd::transform(matrix, vectors, results, TESTNUM);
+		benchmark::ClobberMemory();
+	}
+	st.SetItemsProcessed(st.iterations() * TESTNUM);
+}
+
+BENCHMARK_DEFINE_F(SimdBenchmark, CC_SRGB)(benchmark::State& st)
+{
+	st.SetLabel(cc::simd::level_name(cc::simd::force(cc::simd::Level(st.range(0)))));
+	for (auto _ : st)
+	{
+		cc::simd::srgb(values, fresults, TESTNUM);
+		benchmark::ClobberMemory();
+	}
+	st.SetItemsProcessed(st.iterations() * TESTNUM);
+}
+
+// same sse2 kernel on 4 vectors, called directly and through the dispatch table
+BENCHMARK_DEFINE_F(SimdBenchmark, DIRECT_CALL)(benchmark::State& st)
+{
+	for (auto _ : st)
+	{
+		cc::simd::sse2::transform(matrix, vectors, results, 4);
+		benchmark::ClobberMemory();
+	}
+}
+
+BENCHMARK_DEFINE_F(SimdBenchmark, DISPATCHED_CALL)(benchmark::State& st)
+{
+	cc::simd::force(cc::simd::Level::SSE2);
+	for (auto _ : st)
+	{
+		cc::simd::transform(matrix, vectors, results, 4);
+		benchmark::ClobberMemory();
+	}
+}
+
+class InverseBenchmark : public benchmark::Fixture
+{
+public:
+	void SetUp(const ::benchmark::State& state)
+	{
+		std::random_device rd;
+		std::mt19937 mt(rd());
+		std::uniform_real_distribution<float> dist(-1.0, 1.0);
+		for (int i = 0; i < TESTNUM; ++i)
+		{
+			matrices[i] = cc::math::rotate(cc::math::translate(cc::math::mat4(1.f), cc::math::vec3(dist(mt), dist(mt), dist(mt))), dist(mt), cc::math::vec3(dist(mt), dist(mt), 1.f));
+		}
+		level = cc::simd::level();
+	}
+
+	void TearDown(const ::benchmark::State& state)
+	{
+		cc::simd::force(level);
+	}
+
+	static constexpr int TESTNUM = 4096;
+	cc::math::mat4 matrices[TESTNUM];
+	cc::math::mat4 results[TESTNUM];
+	cc::simd::Level level;
+};
+
+BENCHMARK_DEFINE_F(InverseBenchmark, LOOP_INVERSE)(benchmark::State& st)
+{
+	for (auto _ : st)
+	{
+		for (int i = 0; i < TESTNUM; ++i)
+		{
+			results[i] = cc::math::inverse(matrices[i]);
+		}
+		benchmark::ClobberMemory();
+	}
+	st.SetItemsProcessed(st.iterations() * TESTNUM);
+}
+
+BENCHMARK_DEFINE_F(InverseBenchmark, CC_INVERSE)(benchmark::State& st)
+{
+	st.SetLabel(cc::simd::level_name(cc::simd::force(cc::simd::Level(st.range(0)))));
+	for (auto _ : st)
+	{
+		cc::simd::inverse(matrices, results, TESTNUM);
+		benchmark::ClobberMemory();
+	}
+	st.SetItemsProcessed(st.iterations() * TESTNUM);
+}
+
+BENCHMARK_DEFINE_F(InverseBenchmark, LOOP_NORMAL_MATRIX)(benchmark::State& st)
+{
+	for (auto _ : st)
+	{
+		for (int i = 0; i < TESTNUM; ++i)
+		{
+			results[i] = cc::math::transpose(cc::math::inverse(matrices[i]));
+		}
+		benchmark::ClobberMemory();
+	}
+	st.SetItemsProcessed(st.iterations() * TESTNUM);
+}
+
+BENCHMARK_DEFINE_F(InverseBenchmark, CC_NORMAL_MATRIX)(benchmark::State& st)
+{
+	st.SetLabel(cc::simd::level_name(cc::simd::force(cc::simd::Level(st.range(0)))));
+	for (auto _ : st)
+	{
+		cc::simd::inverse_transpose(matrices, results, TESTNUM);
+		benchmark::ClobberMemory();
+	}
+	st.SetItemsProcessed(st.iterations() * TESTNUM);
+}
+
+class ImageBenchmark : public benchmark::Fixture
+{
+public:
+	void SetUp(const ::benchmark::State& state)
+	{
+		const cc::ImageLayout layout = cc::ImageLayout(state.range(0));
+		image.reset(new cc::Image<cc::math::vec4>(SIZE, SIZE, layout));
+		filtered.reset(new cc::Image<cc::math::vec4>(SIZE, SIZE, layout));
+
+		std::mt19937 mt(42);
+		std::uniform_int_distribution<uint32_t> dist(1, SIZE - 2);
+		for (uint32_t y = 0; y < SIZE; ++y)
+			for (uint32_t x = 0; x < SIZE; ++x)
+				(*image)(x, y) = cc::math::vec4(float(x), float(y), 0.f, 1.f);
+
+		for (int i = 0; i < SAMPLES; ++i)
+		{
+			samples[i][0] = dist(mt);
+			samples[i][1] = dist(mt);
+		}
+	}
+
+	static constexpr uint32_t SIZE = 1024;
+	static constexpr int SAMPLES = 65536;
+	std::unique_ptr<cc::Image<cc::math::vec4>> image;
+	std::unique_ptr<cc::Image<cc::math::vec4>> filtered;
+	uint32_t samples[SAMPLES][2];
+};
+
+// 3x3 box filter, tile by tile
+BENCHMARK_DEFINE_F(ImageBenchmark, FILTER_3X3)(benchmark::State& st)
+{
+	const cc::Image<cc::math::vec4>& src = *image;
+	cc::Image<cc::math::vec4>& dst = *filtered;
+	st.SetLabel(cc::layout_name(src.layout()));
+	for (auto _ : st)
+	{
+		src.for_each_tile([&](const cc::Image<cc::math::vec4>::Tile& t)
+		{
+			for (uint32_t y = cc::math::max(t.y, 1u); y < cc::math::min(t.y + t.height, SIZE - 1); ++y)
+				for (uint32_t x = cc::math::max(t.x, 1u); x < cc::math::min(t.x + t.width, SIZE - 1); ++x)
+				{
+					cc::math::vec4 sum;
+					for (uint32_t j = y - 1; j <= y + 1; ++j)
+						for (uint32_t i = x - 1; i <= x + 1; ++i)
+							sum += src(i, j);
+					dst(x, y) = sum * (1.f / 9.f);
+				}
+		});
+		benchmark::ClobberMemory();
+	}
+	st.SetItemsProcessed(st.iterations() * SIZE * SIZE);
+}
+
+// column-major walk, the worst case for scanlines
+BENCHMARK_DEFINE_F(ImageBenchmark, COLUMN_WALK)(benchmark::State& st)
+{
+	const cc::Image<cc::math::vec4>& src = *image;
+	st.SetLabel(cc::layout_name(src.layout()));
+	for (auto _ : st)
+	{
+		cc::math::vec4 sum;
+		for (uint32_t x = 0; x < SIZE; ++x)
+			for (uint32_t y = 0; y < SIZE; ++y)
+				sum += src(x, y);
+		benchmark::DoNotOptimize(sum);
+	}
+	st.SetItemsProcessed(st.iterations() * SIZE * SIZE);
+}
+
+// random 3x3 neighbourhoods, like texture taps
+BENCHMARK_DEFINE_F(ImageBenchmark, RANDOM_3X3)(benchmark::State& st)
+{
+	const cc::Image<cc::math::vec4>& src = *image;
+	st.SetLabel(cc::layout_name(src.layout()));
+	for (auto _ : st)
+	{
+		cc::math::vec4 sum;
+		for (int s = 0; s < SAMPLES; ++s)
+			for (uint32_t j = samples[s][1] - 1; j <= samples[s][1] + 1; ++j)
+				for (uint32_t i = samples[s][0] - 1; i <= samples[s][0] + 1; ++i)
+					sum += src(i, j);
+		benchmark::DoNotOptimize(sum);
+	}
+	st.SetItemsProcessed(st.iterations() * SAMPLES);
+}
+
+class ResampleBenchmark : public benchmark::Fixture
+{
+public:
+	void SetUp(const ::benchmark::State& state)
+	{
+		std::mt19937 mt(42);
+		std::uniform_int_distribution<int> dist(0, 255);
+		texture.reset(new cc::Image<cc::gfx::rgba8>(SIZE, SIZE));
+		hdr.reset(new cc::Image<cc::math::vec4>(SIZE, SIZE));
+		for (uint32_t y = 0; y < SIZE; ++y)
+			for (uint32_t x = 0; x < SIZE; ++x)
+			{
+				const cc::gfx::rgba8 p{ uint8_t(dist(mt)), uint8_t(dist(mt)), uint8_t(dist(mt)), 255 };
+				(*texture)(x, y) = p;
+				(*hdr)(x, y) = cc::gfx::linear(cc::gfx::to_vec4(p));
+			}
+	}
+
+	static constexpr uint32_t SIZE = 1024;
+	std::unique_ptr<cc::Image<cc::gfx::rgba8>> texture;
+	std::unique_ptr<cc::Image<cc::math::vec4>> hdr;
+};
+
+BENCHMARK_DEFINE_F(ResampleBenchmark, RESIZE_VEC4)(benchmark::State& st)
+{
+	const cc::resample::Filter filter = cc::resample::Filter(st.range(0));
+	cc::Image<cc::math::vec4> half(SIZE / 2, SIZE / 2);
+	st.SetLabel(cc::resample::filter_name(filter));
+	for (auto _ : st)
+	{
+		cc::resample::resize(*hdr, half, filter);
+		benchmark::ClobberMemory();
+	}
+	st.SetItemsProcessed(st.iterations() * SIZE * SIZE);
+}
+
+BENCHMARK_DEFINE_F(ResampleBenchmark, RESIZE_RGBA8)(benchmark::State& st)
+{
+	const cc::resample::Filter filter = cc::resample::Filter(st.range(0));
+	cc::Image<cc::gfx::rgba8> half(SIZE / 2, SIZE / 2);
+	st.SetLabel(cc::resample::filter_name(filter));
+	for (auto _ : st)
+	{
+		cc::resample::resize(*texture, half, filter);
+		benchmark::ClobberMemory();
+	}
+	st.SetItemsProcessed(st.iterations() * SIZE * SIZE);
+}
+
+BENCHMARK_DEFINE_F(ResampleBenchmark, MIP_CHAIN_RGBA8)(benchmark::State& st)
+{
+	const cc::resample::Filter filter = cc::resample::Filter(st.range(0));
+	st.SetLabel(cc::resample::filter_name(filter));
+	for (auto _ : st)
+	{
+		benchmark::DoNotOptimize(cc::resample::mip_chain(*texture, filter));
+	}
+	st.SetItemsProcessed(st.iterations() * SIZE * SIZE);
+}
+
+// the usual per-pixel 2x2 box from the previous 8-bit level, srgb decoded and encoded per tap
+BENCHMARK_DEFINE_F(ResampleBenchmark, MIP_CHAIN_NAIVE)(benchmark::State& st)
+{
+	for (auto _ : st)
+	{
+		cc::Vector<cc::Image<cc::gfx::rgba8>> levels;
+		levels.emplace_back(*texture);
+		while (levels.back().width() > 1)
+		{
+			const cc::Image<cc::gfx::rgba8>& prev = levels.back();
+			cc::Image<cc::gfx::rgba8> next(prev.width() / 2, prev.height() / 2);
+			for (uint32_t y = 0; y < next.height(); ++y)
+				for (uint32_t x = 0; x < next.width(); ++x)
+				{
+					const cc::math::vec4 sum = cc::gfx::linear(cc::gfx::to_vec4(prev(2 * x, 2 * y))) + cc::gfx::linear(cc::gfx::to_vec4(prev(2 * x + 1, 2 * y))) +
+					                           cc::gfx::linear(cc::gfx::to_vec4(prev(2 * x, 2 * y + 1))) + cc::gfx::linear(cc::gfx::to_vec4(prev(2 * x + 1, 2 * y + 1)));
+					next(x, y) = cc::gfx::to_rgba8(cc::gfx::srgb(sum * .25f));
+				}
+			levels.emplace_back(std::move(next));
+		}
+		benchmark::DoNotOptimize(levels);
+	}
+	st.SetItemsProcessed(st.iterations() * SIZE * SIZE);
+}
+
+class BlockCompressionBenchmark : public benchmark::Fixture
+{
+public:
+	void SetUp(const ::benchmark::State& state)
+	{
+		std::mt19937 mt(42);
+		std::uniform_int_distribution<int> noise(-6, 6);
+		texture.reset(new cc::Image<cc::gfx::rgba8>(SIZE, SIZE));
+		for (uint32_t y = 0; y < SIZE; ++y)
+			for (uint32_t x = 0; x < SIZE; ++x)
+			{
+				const int edge = ((x / 37 + y / 23) & 1)? 90 : 0;
+				(*texture)(x, y) = cc::gfx::rgba8{ uint8_t(cc::math::clamp(int(x / 2) + noise(mt), 0, 255)),
+				                                   uint8_t(cc::math::clamp(int(y / 3) + edge, 0, 255)),
+				                                   uint8_t(cc::math::clamp(160 - edge + noise(mt), 0, 255)),
+				                                   uint8_t((x + y) / 4) };
+			}
+	}
+
+	static constexpr uint32_t SIZE = 512;
+	std::unique_ptr<cc::Image<cc::gfx::rgba8>> texture;
+};
+
+// args: format, quality. psnr is reported next to the throughput
+BENCHMARK_DEFINE_F(BlockCompressionBenchmark, ENCODE)(benchmark::State& st)
+{
+	const cc::bc::Format format = cc::bc::Format(st.range(0));
+	const cc::bc::Quality quality = cc::bc::Quality(st.range(1));
+	cc::Vector<uint8_t> blocks(cc::bc::compressed_size(format, SIZE, SIZE));
+	st.SetLabel(std::string(cc::bc::format_name(format)) + "/" + cc::bc::quality_name(quality));
+	for (auto _ : st)
+	{
+		cc::bc::compress(*texture, format, quality, blocks.data());
+		benchmark::ClobberMemory();
+	}
+	st.SetItemsProcessed(st.iterations() * SIZE * SIZE);
+
+	const uint32_t channels[] = { 3, 4, 1, 2, 4 };
+	st.counters["psnr"] = cc::bc::psnr(*texture, cc::bc::decompress(blocks.data(), SIZE, SIZE, format), channels[st.range(0)]);
+}
+
+BENCHMARK_DEFINE_F(BlockCompressionBenchmark, DECODE)(benchmark::State& st)
+{
+	const cc::bc::Format format = cc::bc::Format(st.range(0));
+	const cc::Vector<uint8_t> blocks = cc::bc::compress(*texture, format);
+	st.SetLabel(cc::bc::format_name(format));
+	for (auto _ : st)
+	{
+		benchmark::DoNotOptimize(cc::bc::decompress(blocks.data(), SIZE, SIZE, format));
+	}
+	st.SetItemsProcessed(st.iterations() * SIZE * SIZE);
+}
+
+class SpatialBenchmark : public benchmark::Fixture
+{
+public:
+	void SetUp(const ::benchmark::State& state)
+	{
+		std::mt19937 mt(42);
+		std::uniform_real_distribution<float> dist(-100.f, 100.f);
+		points.reset(new cc::Vector<cc::math::vec3>(size_t(state.range(0))));
+		for (cc::math::vec3& p : *points)
+		{
+			p = cc::math::vec3(dist(mt), dist(mt), dist(mt));
+		}
+		box = cc::spatial::bounds(points->data(), points->size());
+	}
+
+	void TearDown(const ::benchmark::State& state)
+	{
+		points.reset();
+	}
+
+	std::unique_ptr<cc::Vector<cc::math::vec3>> points;
+	cc::spatial::Bounds box;
+};
+
+BENCHMARK_DEFINE_F(SpatialBenchmark, KEYS)(benchmark::State& st)
+{
+	const cc::spatial::Curve curve = cc::spatial::Curve(st.range(1));
+	cc::Vector<uint64_t> keys(points->size());
+	st.SetLabel(cc::spatial::curve_name(curve));
+	for (auto _ : st)
+	{
+		cc::spatial::compute_keys(points->data(), points->size(), box, keys.data(), curve);
+		benchmark::ClobberMemory();
+	}
+	st.SetItemsProcessed(st.iterations() * points->size());
+}
+
+BENCHMARK_DEFINE_F(SpatialBenchmark, RADIX_SORT)(benchmark::State& st)
+{
+	cc::Vector<uint64_t> keys(points->size());
+	cc::spatial::compute_keys(points->data(), points->size(), box, keys.data());
+	for (auto _ : st)
+	{
+		st.PauseTiming();
+		cc::Vector<uint64_t> sorted(keys);
+		cc::Vector<uint32_t> indices(keys.size());
+		for (size_t i = 0; i < indices.size(); ++i) indices[i] = uint32_t(i);
+		st.ResumeTiming();
+
+		cc::radix_sort(sorted, indices);
+		benchmark::DoNotOptimize(indices.data());
+	}
+	st.SetItemsProcessed(st.iterations() * points->size());
+}
+
+BENCHMARK_DEFINE_F(SpatialBenchmark, STD_SORT)(benchmark::State& st)
+{
+	cc::Vector<uint64_t> keys(points->size());
+	cc::spatial::compute_keys(points->data(), points->size(), box, keys.data());
+	for (auto _ : st)
+	{
+		st.PauseTiming();
+		std::vector<std::pair<uint64_t, uint32_t>> pairs(keys.size());
+		for (size_t i = 0; i < pairs.size(); ++i) pairs[i] = std::make_pair(keys[i], uint32_t(i));
+		st.ResumeTiming();
+
+		std::sort(pairs.begin(), pairs.end());
+		benchmark::DoNotOptimize(pairs.data());
+	}
+	st.SetItemsProcessed(st.iterations() * points->size());
+}
+
+// bounds + keys + sort
+BENCHMARK_DEFINE_F(SpatialBenchmark, SORTED_ORDER)(benchmark::State& st)
+{
+	const cc::spatial::Curve curve = cc::spatial::Curve(st.range(1));
+	st.SetLabel(cc::spatial::curve_name(curve));
+	for (auto _ : st)
+	{
+		benchmark::DoNotOptimize(cc::spatial::sorted_order(points->data(), points->size(), curve));
+	}
+	st.SetItemsProcessed(st.iterations() * points->size());
+}
+
+class MeshLoadBenchmark : public benchmark::Fixture
+{
+public:
+	// a SIDE x SIDE grid with uvs and normals, as obj, ascii ply and binary ply
+	void SetUp(const ::benchmark::State& state)
+	{
+		std::mt19937 mt(42);
+		std::uniform_real_distribution<float> dist(-1.f, 1.f);
+		obj.reset(new std::string);
+		ply_ascii.reset(new std::string);
+		ply_binary.reset(new std::string);
+
+		const char* header = "element vertex %u\nproperty float x\nproperty float y\nproperty float z\nproperty float nx\nproperty float ny\nproperty float nz\n"
+		                     "property float u\nproperty float v\nelement face %u\nproperty list uchar int vertex_indices\nend_header\n";
+		char line[256];
+		snprintf(line, sizeof(line), "ply\nformat ascii 1.0\n");
+		*ply_ascii += line;
+		snprintf(line, sizeof(line), header, SIDE * SIDE, 2 * (SIDE - 1) * (SIDE - 1));
+		*ply_ascii += line;
+		*ply_binary = "ply\nformat binary_little_endian 1.0\n" + std::string(line);
+
+		for (uint32_t y = 0; y < SIDE; ++y)
+			for (uint32_t x = 0; x < SIDE; ++x)
+			{
+				const float v[8] = { x * .01f, y * .01f, dist(mt), dist(mt), dist(mt), 1.f, x / float(SIDE), y / float(SIDE) };
+				snprintf(line, sizeof(line), "v %f %f %f\nvt %f %f\nvn %f %f %f\n", v[0], v[1], v[2], v[6], v[7], v[3], v[4], v[5]);
+				*obj += line;
+				snprintf(line, sizeof(line), "%f %f %f %f %f %f %f %f\n", v[0], v[1], v[2], v[3], v[4], v[5], v[6], v[7]);
+				*ply_ascii += line;
+				ply_binary->append(reinterpret_cast<const char*>(v), sizeof(v));
+			}
+
+		for (uint32_t y = 0; y + 1 < SIDE; ++y)
+			for (uint32_t x = 0; x + 1 < SIDE; ++x)
+			{
+				const int32_t a = y * SIDE + x, b = a + 1, c = a + SIDE, d = c + 1;
+				snprintf(line, sizeof(line), "f %d/%d/%d %d/%d/%d %d/%d/%d\nf %d/%d/%d %d/%d/%d %d/%d/%d\n", a + 1, a + 1, a + 1, b + 1, b + 1, b + 1, d + 1, d + 1, d + 1,
+				         a + 1, a + 1, a + 1, d + 1, d + 1, d + 1, c + 1, c + 1, c + 1);
+				*obj += line;
+				snprintf(line, sizeof(line), "3 %d %d %d\n3 %d %d %d\n", a, b, d, a, d, c);
+				*ply_ascii += line;
+				const int32_t tris[2][3] = { { a, b, d }, { a, d, c } };
+				for (const auto& t : tris)
+				{
+					ply_binary->push_back(3);
+					ply_binary->append(reinterpret_cast<const char*>(t), sizeof(t));
+				}
+			}
+	}
+
+	void TearDown(const ::benchmark::State& state)
+	{
+		obj.reset();
+		ply_ascii.reset();
+		ply_binary.reset();
+	}
+
+	static constexpr uint32_t SIDE = 512;
+	std::unique_ptr<std::string> obj;
+	std::unique_ptr<std::string> ply_ascii;
+	std::unique_ptr<std::string> ply_binary;
+};
+
+BENCHMARK_DEFINE_F(MeshLoadBenchmark, OBJ)(benchmark::State& st)
+{
+	for (auto _ : st)
+	{
+		cc::mesh::Mesh mesh;
+		cc::mesh::parse_obj(obj->data(), obj->size(), mesh);
+		benchmark::DoNotOptimize(mesh.indices.data());
+	}
+	st.SetBytesProcessed(st.iterations() * obj->size());
+}
+
+// the iostream loop this replaces
+BENCHMARK_DEFINE_F(MeshLoadBenchmark, OBJ_IOSTREAM)(benchmark::State& st)
+{
+	for (auto _ : st)
+	{
+		cc::mesh::Mesh mesh;
+		std::istringstream in(*obj);
+		std::string tag;
+		while (in >> tag)
+		{
+			if (tag == "v")
+			{
+				cc::math::vec3 p;
+				in >> p.x >> p.y >> p.z;
+				mesh.positions.push_back(p);
+			}
+			else if (tag == "vt")
+			{
+				cc::math::vec2 t;
+				in >> t.x >> t.y;
+				mesh.uvs.push_back(t);
+			}
+			else if (tag == "vn")
+			{
+				cc::math::vec3 n;
+				in >> n.x >> n.y >> n.z;
+				mesh.normals.push_back(n);
+			}
+			else if (tag == "f")
+			{
+				for (int k = 0; k < 3; ++k)
+				{
+					uint32_t v, t, n;
+					char slash;
+					in >> v >> slash >> t >> slash >> n;
+					mesh.indices.push_back(v - 1);
+					mesh.uv_indices.push_back(t - 1);
+					mesh.normal_indices.push_back(n - 1);
+				}
+			}
+		}
+		benchmark::DoNotOptimize(mesh.indices.data());
+	}
+	st.SetBytesProcessed(st.iterations() * obj->size());
+}
+
+BENCHMARK_DEFINE_F(MeshLoadBenchmark, PLY_ASCII)(benchmark::State& st)
+{
+	for (auto _ : st)
+	{
+		cc::mesh::Mesh mesh;
+		cc::mesh::parse_ply(ply_ascii->data(), ply_ascii->size(), mesh);
+		benchmark::DoNotOptimize(mesh.indices.data());
+	}
+	st.SetBytesProcessed(st.iterations() * ply_ascii->size());
+}
+
+BENCHMARK_DEFINE_F(MeshLoadBenchmark, PLY_BINARY)(benchmark::State& st)
+{
+	for (auto _ : st)
+	{
+		cc::mesh::Mesh mesh;
+		cc::mesh::parse_ply(ply_binary->data(), ply_binary->size(), mesh);
+		benchmark::DoNotOptimize(mesh.indices.data());
+	}
+	st.SetBytesProcessed(st.iterations() * ply_binary->size());
+}
+
+class PoolBenchmark : public benchmark::Fixture
+{
+public:
+	struct Particle
+	{
+		cc::math::vec3 position;
+		cc::math::vec3 velocity;
+		float life;
+	};
+
+	// COUNT live particles after a round of random frees, the usual fragmentation pattern
+	void SetUp(const ::benchmark::State& state)
+	{
+		std::mt19937 mt(42);
+		pool.reset(new cc::Pool<Particle>);
+		heap.reset(new std::vector<std::unique_ptr<Particle>>);
+		std::vector<cc::Handle32> handles;
+		for (uint32_t i = 0; i < 2 * COUNT; ++i)
+		{
+			const Particle p{ cc::math::vec3(float(i)), cc::math::vec3(1.f), 1.f };
+			handles.push_back(pool->create(p));
+			heap->emplace_back(new Particle(p));
+		}
+		std::vector<uint32_t> order(2 * COUNT);
+		std::iota(order.begin(), order.end(), 0);
+		std::shuffle(order.begin(), order.end(), mt);
+		std::shuffle(heap->begin(), heap->end(), mt);
+		for (uint32_t i = 0; i < COUNT; ++i)
+		{
+			pool->destroy(handles[order[i]]);
+		}
+		heap->resize(COUNT);
+	}
+
+	void TearDown(const ::benchmark::State& state)
+	{
+		pool.reset();
+		heap.reset();
+	}
+
+	static constexpr uint32_t COUNT = 1 << 18;
+	std::unique_ptr<cc::Pool<Particle>> pool;
+	std::unique_ptr<std::vector<std::unique_ptr<Particle>>> heap;
+};
+
+BENCHMARK_DEFINE_F(PoolBenchmark, CHURN_POOL)(benchmark::State& st)
+{
+	std::vector<cc::Handle32> live(1024);
+	for (auto _ : st)
+	{
+		for (cc::Handle32& h : live) h = pool->create(Particle{});
+		for (cc::Handle32 h : live) pool->destroy(h);
+	}
+	st.SetItemsProcessed(st.iterations() * live.size());
+}
+
+BENCHMARK_DEFINE_F(PoolBenchmark, CHURN_NEW)(benchmark::State& st)
+{
+	std::vector<Particle*> live(1024);
+	for (auto _ : st)
+	{
+		for (Particle*& p : live) p = new Particle{};
+		benchmark::DoNotOptimize(live.data());
+		for (Particle* p : live) delete p;
+	}
+	st.SetItemsProcessed(st.iterations() * live.size());
+}
+
+BENCHMARK_DEFINE_F(PoolBenchmark, UPDATE_POOL)(benchmark::State& st)
+{
+	const float dt = 1.f / 60.f;
+	for (auto _ : st)
+	{
+		pool->for_each_span([dt](Particle* first, Particle* last)
+		{
+			const size_t n = last - first;
+			CC_SIMD_LOOP
+			for (size_t i = 0; i < n; ++i)
+			{
+				first[i].position = first[i].position + first[i].velocity * dt;
+				first[i].life -= dt;
+			}
+		});
+		benchmark::ClobberMemory();
+	}
+	st.SetItemsProcessed(st.iterations() * pool->size());
+}
+
+BENCHMARK_DEFINE_F(PoolBenchmark, UPDATE_HEAP)(benchmark::State& st)
+{
+	const float dt = 1.f / 60.f;
+	for (auto _ : st)
+	{
+		for (const std::unique_ptr<Particle>& p : *heap)
+		{
+			p->position = p->position + p->velocity * dt;
+			p->life -= dt;
+		}
+		benchmark::ClobberMemory();
+	}
+	st.SetItemsProcessed(st.iterations() * heap->size());
+}
+
+class HashMapBenchmark : public benchmark::Fixture
+{
+public:
+	// random keys, half of them looked up as hits and half as misses
+	void SetUp(const ::benchmark::State& state)
+	{
+		std::mt19937_64 mt(42);
+		const size_t count = size_t(state.range(0));
+		keys.reset(new std::vector<uint64_t>(count));
+		queries.reset(new std::vector<uint64_t>(count));
+		for (size_t i = 0; i < count; ++i)
+		{
+			(*keys)[i] = mt();
+			(*queries)[i] = (i & 1)? (*keys)[i] : mt();
+		}
+		std::shuffle(queries->begin(), queries->end(), mt);
+
+		// a welded-mesh-like vertex stream: every position appears ~6 times
+		vertices.reset(new std::vector<cc::math::vec3>(count));
+		std::uniform_int_distribution<uint32_t> pick(0, uint32_t(count / 6));
+		for (size_t i = 0; i < count; ++i)
+		{
+			const uint32_t v = pick(mt);
+			(*vertices)[i] = cc::math::vec3(float(v % 1024), float(v / 1024), .5f);
+		}
+	}
+
+	void TearDown(const ::benchmark::State& state)
+	{
+		keys.reset();
+		queries.reset();
+		vertices.reset();
+	}
+
+	struct StdVec3Hash
+	{
+		size_t operator()(const cc::math::vec3& v) const { return size_t(cc::Hash<cc::math::vec3>()(v)); }
+	};
+
+	struct StdVec3Equal
+	{
+		bool operator()(const cc::math::vec3& a, const cc::math::vec3& b) const { return cc::Hash<cc::math::vec3>().equal(a, b); }
+	};
+
+	std::unique_ptr<std::vector<uint64_t>> keys;
+	std::unique_ptr<std::vector<uint64_t>> queries;
+	std::unique_ptr<std::vector<cc::math::vec3>> vertices;
+};
+
+BENCHMARK_DEFINE_F(HashMapBenchmark, INSERT_CC)(benchmark::State& st)
+{
+	for (auto _ : st)
+	{
+		cc::HashMap<uint64_t, uint32_t> map;
+		for (size_t i = 0; i < keys->size(); ++i) map.insert((*keys)[i], uint32_t(i));
+		benchmark::DoNotOptimize(map.size());
+	}
+	st.SetItemsProcessed(st.iterations() * keys->size());
+}
+
+BENCHMARK_DEFINE_F(HashMapBenchmark, INSERT_STD)(benchmark::State& st)
+{
+	for (auto _ : st)
+	{
+		std::unordered_map<uint64_t, uint32_t> map;
+		for (size_t i = 0; i < keys->size(); ++i) map.emplace((*keys)[i], uint32_t(i));
+		benchmark::DoNotOptimize(map.size());
+	}
+	st.SetItemsProcessed(st.iterations() * keys->size());
+}
+
+BENCHMARK_DEFINE_F(HashMapBenchmark, FIND_CC)(benchmark::State& st)
+{
+	cc::HashMap<uint64_t, uint32_t> map;
+	for (size_t i = 0; i < keys->size(); ++i) map.insert((*keys)[i], uint32_t(i));
+	for (auto _ : st)
+	{
+		uint32_t hits = 0;
+		for (uint64_t key : *queries) hits += map.contains(key)? 1 : 0;
+		benchmark::DoNotOptimize(hits);
+	}
+	st.SetItemsProcessed(st.iterations() * queries->size());
+}
+
+BENCHMARK_DEFINE_F(HashMapBenchmark, FIND_STD)(benchmark::State& st)
+{
+	std::unordered_map<uint64_t, uint32_t> map;
+	for (size_t i = 0; i < keys->size(); ++i) map.emplace((*keys)[i], uint32_t(i));
+	for (auto _ : st)
+	{
+		uint32_t hits = 0;
+		for (uint64_t key : *queries) hits += (map.find(key) != map.end())? 1 : 0;
+		benchmark::DoNotOptimize(hits);
+	}
+	st.SetItemsProcessed(st.iterations() * queries->size());
+}
+
+// vertex dedup: position -> first index
+BENCHMARK_DEFINE_F(HashMapBenchmark, DEDUP_VEC3_CC)(benchmark::State& st)
+{
+	for (auto _ : st)
+	{
+		cc::HashMap<cc::math::vec3, uint32_t> map;
+		for (size_t i = 0; i < vertices->size(); ++i) map.try_emplace((*vertices)[i], uint32_t(i));
+		benchmark::DoNotOptimize(map.size());
+	}
+	st.SetItemsProcessed(st.iterations() * vertices->size());
+}
+
+BENCHMARK_DEFINE_F(HashMapBenchmark, DEDUP_VEC3_STD)(benchmark::State& st)
+{
+	for (auto _ : st)
+	{
+		std::unordered_map<cc::math::vec3, uint32_t, StdVec3Hash, StdVec3Equal> map;
+		for (size_t i = 0; i < vertices->size(); ++i) map.emplace((*vertices)[i], uint32_t(i));
+		benchmark::DoNotOptimize(map.size());
+	}
+	st.SetItemsProcessed(st.iterations() * vertices->size());
+}
+
+class MeshOptimizationBenchmark : public benchmark::Fixture
+{
+public:
+	// a SIDE x SIDE grid as a triangle soup in random triangle order, and its welded version
+	void SetUp(const ::benchmark::State& state)
+	{
+		std::mt19937 mt(42);
+		std::vector<uint32_t> order(2 * (SIDE - 1) * (SIDE - 1));
+		std::iota(order.begin(), order.end(), 0);
+		std::shuffle(order.begin(), order.end(), mt);
+
+		soup.reset(new cc::mesh::Mesh);
+		for (uint32_t q : order)
+		{
+			const uint32_t x = (q / 2) % (SIDE - 1), y = (q / 2) / (SIDE - 1);
+			const uint32_t tri[2][3][2] = { { { 0, 0 }, { 1, 0 }, { 1, 1 } }, { { 0, 0 }, { 1, 1 }, { 0, 1 } } };
+			for (const auto& corner : tri[q & 1])
+			{
+				soup->positions.push_back(cc::math::vec3(float(x + corner[0]), float(y + corner[1]), 0.f));
+			}
+		}
+
+		indexed.reset(new cc::mesh::Mesh(*soup));
+		cc::mesh::weld(*indexed);
+	}
+
+	void TearDown(const ::benchmark::State& state)
+	{
+		soup.reset();
+		indexed.reset();
+	}
+
+	static constexpr uint32_t SIDE = 512;
+	std::unique_ptr<cc::mesh::Mesh> soup;
+	std::unique_ptr<cc::mesh::Mesh> indexed;
+};
+
+BENCHMARK_DEFINE_F(MeshOptimizationBenchmark, WELD)(benchmark::State& st)
+{
+	for (auto _ : st)
+	{
+		cc::mesh::Mesh mesh(*soup);
+		cc::mesh::weld(mesh, st.range(0)? 1.e-3f : 0.f);
+		benchmark::DoNotOptimize(mesh.indices.data());
+	}
+	st.SetItemsProcessed(st.iterations() * soup->positions.size());
+}
+
+// arg: optimizer, reports acmr/atvr before and after (16 entry FIFO)
+BENCHMARK_DEFINE_F(MeshOptimizationBenchmark, VERTEX_CACHE)(benchmark::State& st)
+{
+	const cc::mesh::CacheOptimizer optimizer = cc::mesh::CacheOptimizer(st.range(0));
+	cc::Vector<uint32_t> indices;
+	for (auto _ : st)
+	{
+		st.PauseTiming();
+		indices = cc::Vector<uint32_t>(indexed->indices);
+		st.ResumeTiming();
+		cc::mesh::optimize_vertex_cache(indices.data(), indices.size(), indexed->positions.size(), optimizer);
+	}
+	const cc::mesh::CacheStats before = cc::mesh::analyze_vertex_cache(*indexed);
+	const cc::mesh::CacheStats after = cc::mesh::analyze_vertex_cache(indices.data(), indices.size(), indexed->positions.size());
+	st.counters["acmr_in"] = before.acmr;
+	st.counters["acmr"] = after.acmr;
+	st.counters["atvr"] = after.atvr;
+	st.SetItemsProcessed(st.iterations() * indexed->triangle_count());
+	st.SetLabel(cc::mesh::cache_optimizer_name(optimizer));
+}
+
+BENCHMARK_DEFINE_F(MeshOptimizationBenchmark, VERTEX_FETCH)(benchmark::State& st)
+{
+	cc::Vector<uint32_t> indices;
+	for (auto _ : st)
+	{
+		st.PauseTiming();
+		indices = cc::Vector<uint32_t>(indexed->indices);
+		st.ResumeTiming();
+		const cc::Vector<uint32_t> remap = cc::mesh::optimize_vertex_fetch(indices.data(), indices.size(), indexed->positions.size());
+		benchmark::DoNotOptimize(remap.data());
+	}
+	st.SetItemsProcessed(st.iterations() * indexed->indices.size());
+}
+
+class QueueBenchmark : public benchmark::Fixture
+{
+public:
+	static constexpr uint32_t ITEMS = 1 << 18;
+	static constexpr uint32_t CAPACITY = 1024;
+	static constexpr uint32_t BATCH = 32;
+
+	// what the pipeline stages used before: a deque behind a mutex
+	class LockedQueue
+	{
+	public:
+		bool push(uint32_t item)
+		{
+			std::unique_lock<std::mutex> guard(lock_);
+			not_full_.wait(guard, [this] { return items_.size() < CAPACITY; });
+			items_.push_back(item);
+			not_empty_.notify_one();
+			return true;
+		}
+
+		bool pop(uint32_t& item)
+		{
+			std::unique_lock<std::mutex> guard(lock_);
+			not_empty_.wait(guard, [this] { return !items_.empty() || closed_; });
+			if (items_.empty())
+			{
+				return false;
+			}
+			item = items_.front();
+			items_.pop_front();
+			not_full_.notify_one();
+			return true;
+		}
+
+		void close()
+		{
+			std::lock_guard<std::mutex> guard(lock_);
+			closed_ = true;
+			not_empty_.notify_all();
+		}
+
+	private:
+		std::mutex lock_;
+		std::condition_variable not_empty_;
+		std::condition_variable not_full_;
+		std::deque<uint32_t> items_;
+		bool closed_ = false;
+	};
+
+	// ITEMS split between producers, consumers drain until close. batch > 1 uses the batch calls
+	template<typename Queue>
+	static uint64_t run(Queue& queue, uint32_t producers, uint32_t consumers, uint32_t batch)
+	{
+		std::atomic<uint32_t> producing(producers);
+		std::atomic<uint64_t> sum(0);
+		std::vector<std::thread> threads;
+		for (uint32_t p = 0; p < producers; ++p)
+		{
+			threads.emplace_back([&, p]
+			{
+				uint32_t items[BATCH];
+				for (uint32_t i = p; i < ITEMS; i += producers * batch)
+				{
+					if (batch == 1)
+					{
+						queue.push(i);
+						continue;
+					}
+					uint32_t n = 0;
+					for (uint32_t k = 0; k < batch && i + k * producers < ITEMS; ++k) items[n++] = i + k * producers;
+					push_batch(queue, items, n);
+				}
+				if (producing.fetch_sub(1) == 1) queue.close();
+			});
+		}
+		for (uint32_t c = 0; c < consumers; ++c)
+		{
+			threads.emplace_back([&]
+			{
+				uint32_t items[BATCH];
+				uint64_t local = 0;
+				for (size_t n; (n = pop_batch(queue, items, batch)) > 0;)
+				{
+					for (size_t k = 0; k < n; ++k) local += items[k];
+				}
+				sum.fetch_add(local);
+			});
+		}
+		for (std::thread& thread : threads) thread.join();
+		return sum.load();
+	}
+
+	template<typename Queue>
+	static void push_batch(Queue& queue, const uint32_t* items, uint32_t count)	{ queue.push_batch(items, count); }
+
+	static void push_batch(LockedQueue& queue, const uint32_t* items, uint32_t count)	{ for (uint32_t i = 0; i < count; ++i) queue.push(items[i]); }
+
+	template<typename Queue>
+	static size_t pop_batch(Queue& queue, uint32_t* items, uint32_t count)	{ return (count == 1)? (queue.pop(items[0])? 1 : 0) : queue.pop_batch(items, count); }
+
+	static size_t pop_batch(LockedQueue& queue, uint32_t* items, uint32_t)	{ return queue.pop(items[0])? 1 : 0; }
+};
+
+// args: batch
+BENCHMARK_DEFINE_F(QueueBenchmark, SPSC)(benchmark::State& st)
+{
+	for (auto _ : st)
+	{
+		cc::SpscQueue<uint32_t> queue(CAPACITY);
+		benchmark::DoNotOptimize(run(queue, 1, 1, uint32_t(st.range(0))));
+	}
+	st.SetItemsProcessed(st.iterations() * ITEMS);
+}
+
+// args: producers, consumers, batch
+BENCHMARK_DEFINE_F(QueueBenchmark, MPMC)(benchmark::State& st)
+{
+	for (auto _ : st)
+	{
+		cc::MpmcQueue<uint32_t> queue(CAPACITY);
+		benchmark::DoNotOptimize(run(queue, uint32_t(st.range(0)), uint32_t(st.range(1)), uint32_t(st.range(2))));
+	}
+	st.SetItemsProcessed(st.iterations() * ITEMS);
+}
+
+BENCHMARK_DEFINE_F(QueueBenchmark, LOCKED_DEQUE)(benchmark::State& st)
+{
+	for (auto _ : st)
+	{
+		LockedQueue queue;
+		benchmark::DoNotOptimize(run(queue, uint32_t(st.range(0)), uint32_t(st.range(1)), 1));
+	}
+	st.SetItemsProcessed(st.iterations() * ITEMS);
+}
+
+// round trip of one item between two threads through a pair of queues
+BENCHMARK_DEFINE_F(QueueBenchmark, PING_PONG)(benchmark::State& st)
+{
+	cc::SpscQueue<uint32_t> ping(16), pong(16);
+	std::thread echo([&]
+	{
+		for (uint32_t item; ping.pop(item);) pong.push(item);
+	});
+	uint32_t item = 0;
+	for (auto _ : st)
+	{
+		ping.push(item);
+		pong.pop(item);
+	}
+	ping.close();
+	echo.join();
+}
+
+class NoiseBenchmark : public benchmark::Fixture
+{
+public:
+	static constexpr uint32_t SIDE = 256;
+
+	void SetUp(const ::benchmark::State& state)
+	{
+		fractal.octaves = 4;
+		fractal.frequency = 8.f;
+	}
+
+	cc::noise::Fractal fractal;
+};
+
+// args: type. one scalar call per sample
+BENCHMARK_DEFINE_F(NoiseBenchmark, SCALAR_2D)(benchmark::State& st)
+{
+	const cc::noise::Type type = cc::noise::Type(st.range(0));
+	cc::Vector<float> out(SIDE * SIDE);
+	for (auto _ : st)
+	{
+		for (uint32_t y = 0; y < SIDE; ++y)
+		{
+			for (uint32_t x = 0; x < SIDE; ++x)
+			{
+				out[y * SIDE + x] = cc::noise::fractal(type, cc::math::vec2((x + .5f) / SIDE, (y + .5f) / SIDE), fractal, 1);
+			}
+		}
+		benchmark::DoNotOptimize(out.data());
+	}
+	st.SetItemsProcessed(st.iterations() * SIDE * SIDE);
+	st.SetLabel(cc::noise::type_name(type));
+}
+
+// args: type. same samples, 8 lanes at a time
+BENCHMARK_DEFINE_F(NoiseBenchmark, LANES_2D)(benchmark::State& st)
+{
+	const cc::noise::Type type = cc::noise::Type(st.range(0));
+	cc::Vector<float> out(SIDE * SIDE);
+	for (auto _ : st)
+	{
+		for (uint32_t y = 0; y < SIDE; ++y)
+		{
+			float px[cc::noise::LANES], py[cc::noise::LANES];
+			for (uint32_t x = 0; x < SIDE; x += cc::noise::LANES)
+			{
+				for (uint32_t l = 0; l < cc::noise::LANES; ++l)
+				{
+					px[l] = (x + l + .5f) / SIDE;
+					py[l] = (y + .5f) / SIDE;
+				}
+				cc::noise::fractal8(type, px, py, fractal, &out[y * SIDE + x], 1);
+			}
+		}
+		benchmark::DoNotOptimize(out.data());
+	}
+	st.SetItemsProcessed(st.iterations() * SIDE * SIDE);
+	st.SetLabel(cc::noise::type_name(type));
+}
+
+// args: type, threads. whole image, widest simd kernel
+BENCHMARK_DEFINE_F(NoiseBenchmark, FILL_2D)(benchmark::State& st)
+{
+	const cc::noise::Type type = cc::noise::Type(st.range(0));
+	cc::ThreadPool pool(size_t(st.range(1)));
+	cc::Image<float> image(SIDE, SIDE);
+	for (auto _ : st)
+	{
+		cc::noise::fill(image, type, fractal, 1, pool);
+		benchmark::DoNotOptimize(image.row(0));
+	}
+	st.SetItemsProcessed(st.iterations() * SIDE * SIDE);
+	st.SetLabel(cc::noise::type_name(type));
+}
+
+// args: type
+BENCHMARK_DEFINE_F(NoiseBenchmark, SCALAR_3D)(benchmark::State& st)
+{
+	constexpr uint32_t DEPTH = 16;
+	const cc::noise::Type type = cc::noise::Type(st.range(0));
+	cc::Vector<float> out(SIDE * SIDE * DEPTH);
+	for (auto _ : st)
+	{
+		for (uint32_t z = 0; z < DEPTH; ++z)
+		{
+			for (uint32_t y = 0; y < SIDE; ++y)
+			{
+				for (uint32_t x = 0; x < SIDE; ++x)
+				{
+					const cc::math::vec3 p((x + .5f) / SIDE, (y + .5f) / SIDE, (z + .5f) / SIDE);
+					out[(z * SIDE + y) * SIDE + x] = cc::noise::fractal(type, p, fractal, 1);
+				}
+			}
+		}
+		benchmark::DoNotOptimize(out.data());
+	}
+	st.SetItemsProcessed(st.iterations() * SIDE * SIDE * DEPTH);
+	st.SetLabel(cc::noise::type_name(type));
+}
+
+// args: type, threads
+BENCHMARK_DEFINE_F(NoiseBenchmark, FILL_3D)(benchmark::State& st)
+{
+	constexpr uint32_t DEPTH = 16;
+	const cc::noise::Type type = cc::noise::Type(st.range(0));
+	cc::ThreadPool pool(size_t(st.range(1)));
+	cc::Vector<float> out(SIDE * SIDE * DEPTH);
+	for (auto _ : st)
+	{
+		cc::noise::fill(out.data(), SIDE, SIDE, DEPTH, type, fractal, 1, pool);
+		benchmark::DoNotOptimize(out.data());
+	}
+	st.SetItemsProcessed(st.iterations() * SIDE * SIDE * DEPTH);
+	st.SetLabel(cc::noise::type_name(type));
+}
+
+class ExposureBenchmark : public benchmark::Fixture
+{
+public:
+	static constexpr uint32_t WIDTH = 1920;
+	static constexpr uint32_t HEIGHT = 1080;
+
+	void SetUp(const ::benchmark::State& state)
+	{
+		if (hdr.width() == 0)
+		{
+			std::mt19937 rng(42);
+			std::uniform_real_distribution<float> ev(-10.f, 10.f);
+			hdr = cc::Image<cc::math::vec4>(WIDTH, HEIGHT);
+			for (uint32_t y = 0; y < HEIGHT; ++y)
+			{
+				for (uint32_t x = 0; x < WIDTH; ++x)
+				{
+					hdr.at(x, y) = cc::math::vec4(std::exp2(ev(rng)), std::exp2(ev(rng)), std::exp2(ev(rng)), 1.f);
+				}
+			}
+		}
+	}
+
+	cc::Image<cc::math::vec4> hdr;
+};
+
+// the straightforward serial pass: std::log2 per pixel
+BENCHMARK_DEFINE_F(ExposureBenchmark, SERIAL)(benchmark::State& st)
+{
+	const cc::exposure::Settings settings;
+	for (auto _ : st)
+	{
+		uint32_t bins[cc::exposure::BINS] = {};
+		double log_sum = 0.;
+		const cc::math::vec4* pixels = hdr.data();
+		for (size_t i = 0; i < size_t(WIDTH) * HEIGHT; ++i)
+		{
+			const float y = .2126f * pixels[i].x + .7152f * pixels[i].y + .0722f * pixels[i].z;
+			const float ev = cc::math::clamp(std::log2(y), settings.min_ev, settings.max_ev);
+			++bins[cc::math::min(uint32_t((ev - settings.min_ev) * cc::exposure::BINS / (settings.max_ev - settings.min_ev)), cc::exposure::BINS - 1)];
+			log_sum += ev;
+		}
+		benchmark::DoNotOptimize(bins);
+		benchmark::DoNotOptimize(log_sum);
+	}
+	st.SetItemsProcessed(st.iterations() * WIDTH * HEIGHT);
+}
+
+// args: threads
+BENCHMARK_DEFINE_F(ExposureBenchmark, HISTOGRAM)(benchmark::State& st)
+{
+	cc::ThreadPool pool(size_t(st.range(0)));
+	for (auto _ : st)
+	{
+		const cc::exposure::Histogram histogram = cc::exposure::histogram(hdr, cc::exposure::Settings(), pool);
+		benchmark::DoNotOptimize(cc::exposure::auto_exposure(histogram));
+	}
+	st.SetItemsProcessed(st.iterations() * WIDTH * HEIGHT);
+}
+
+class SHBenchmark : public benchmark::Fixture
+{
+public:
+	static constexpr uint32_t WIDTH = 1024;
+	static constexpr uint32_t HEIGHT = 512;
+	static constexpr uint32_t FACE = 256;
+	static constexpr uint32_t NORMALS = 1 << 16;
+
+	void SetUp(const ::benchmark::State& state)
+	{
+		if (equirect.width() == 0)
+		{
+			std::mt19937 rng(43);
+			std::uniform_real_distribution<float> value(0.f, 4.f);
+			equirect = cc::Image<cc::math::vec4>(WIDTH, HEIGHT);
+			for (uint32_t y = 0; y < HEIGHT; ++y)
+			{
+				for (uint32_t x = 0; x < WIDTH; ++x) equirect.at(x, y) = cc::math::vec4(value(rng), value(rng), value(rng), 1.f);
+			}
+			for (cc::Image<cc::math::vec4>& face : faces)
+			{
+				face = cc::Image<cc::math::vec4>(FACE, FACE);
+				for (uint32_t y = 0; y < FACE; ++y)
+				{
+					for (uint32_t x = 0; x < FACE; ++x) face.at(x, y) = cc::math::vec4(value(rng), value(rng), value(rng), 1.f);
+				}
+			}
+			std::uniform_real_distribution<float> unit(-1.f, 1.f);
+			normals.resize(NORMALS);
+			for (cc::math::vec3& n : normals) n = cc::math::normalize(cc::math::vec3(unit(rng), unit(rng), unit(rng)));
+			for (cc::math::vec3& c : sh.c) c = cc::math::vec3(unit(rng), unit(rng), unit(rng));
+		}
+	}
+
+	cc::Image<cc::math::vec4> equirect;
+	cc::Image<cc::math::vec4> faces[6];
+	std::vector<cc::math::vec3> normals;
+	cc::sh::SH3 sh{};
+};
+
+// per texel: direction, solid angle, basis, accumulate
+BENCHMARK_DEFINE_F(SHBenchmark, PROJECT_SCALAR)(benchmark::State& st)
+{
+	for (auto _ : st)
+	{
+		cc::sh::SH3 result{};
+		for (uint32_t y = 0; y < HEIGHT; ++y)
+		{
+			const float solid_angle = 2.f * cc::math::PI / WIDTH * (std::cos(cc::math::PI * y / HEIGHT) - std::cos(cc::math::PI * (y + 1) / HEIGHT));
+			for (uint32_t x = 0; x < WIDTH; ++x)
+			{
+				const cc::math::vec4& texel = equirect.at(x, y);
+				cc::sh::add(result, cc::sh::equirect_direction(x, y, WIDTH, HEIGHT), cc::math::vec3(texel.x, texel.y, texel.z), solid_angle);
+			}
+		}
+		benchmark::DoNotOptimize(result);
+	}
+	st.SetItemsProcessed(st.iterations() * WIDTH * HEIGHT);
+}
+
+// args: threads
+BENCHMARK_DEFINE_F(SHBenchmark, PROJECT_EQUIRECT)(benchmark::State& st)
+{
+	cc::ThreadPool pool(size_t(st.range(0)));
+	for (auto _ : st)
+	{
+		benchmark::DoNotOptimize(cc::sh::project_equirect<3>(equirect, pool));
+	}
+	st.SetItemsProcessed(st.iterations() * WIDTH * HEIGHT);
+}
+
+// args: threads
+BENCHMARK_DEFINE_F(SHBenchmark, PROJECT_CUBEMAP)(benchmark::State& st)
+{
+	cc::ThreadPool pool(size_t(st.range(0)));
+	for (auto _ : st)
+	{
+		benchmark::DoNotOptimize(cc::sh::project_cubemap<3>(faces, pool));
+	}
+	st.SetItemsProcessed(st.iterations() * 6 * FACE * FACE);
+}
+
+BENCHMARK_DEFINE_F(SHBenchmark, EVALUATE_SCALAR)(benchmark::State& st)
+{
+	std::vector<cc::math::vec3> out(NORMALS);
+	for (auto _ : st)
+	{
+		for (uint32_t i = 0; i < NORMALS; ++i) out[i] = cc::sh::evaluate(sh, normals[i]);
+		benchmark::DoNotOptimize(out.data());
+	}
+	st.SetItemsProcessed(st.iterations() * NORMALS);
+}
+
+BENCHMARK_DEFINE_F(SHBenchmark, EVALUATE_BATCH)(benchmark::State& st)
+{
+	std::vector<cc::math::vec3> out(NORMALS);
+	for (auto _ : st)
+	{
+		cc::sh::evaluate(sh, normals.data(), out.data(), NORMALS);
+		benchmark::DoNotOptimize(out.data());
+	}
+	st.SetItemsProcessed(st.iterations() * NORMALS);
+}
+
+class VectorBenchmark : public benchmark::Fixture
+{
+public:
+	static constexpr size_t BYTES = size_t(64) << 20;
+	static constexpr size_t CHUNK = 4096;
+};
+
+// reused decode target: sized, then fully overwritten
+BENCHMARK_DEFINE_F(VectorBenchmark, RESIZE)(benchmark::State& st)
+{
+	cc::Vector<uint8_t> buffer;
+	buffer.reserve(BYTES);
+	for (auto _ : st)
+	{
+		buffer.clear();
+		buffer.resize(BYTES);
+		std::memset(buffer.data(), 0x5a, BYTES);
+		benchmark::DoNotOptimize(buffer.data());
+	}
+	st.SetBytesProcessed(int64_t(st.iterations()) * int64_t(BYTES));
+}
+
+BENCHMARK_DEFINE_F(VectorBenchmark, RESIZE_UNINITIALIZED)(benchmark::State& st)
+{
+	cc::Vector<uint8_t> buffer;
+	buffer.reserve(BYTES);
+	for (auto _ : st)
+	{
+		buffer.clear();
+		buffer.resize_uninitialized(BYTES);
+		std::memset(buffer.data(), 0x5a, BYTES);
+		benchmark::DoNotOptimize(buffer.data());
+	}
+	st.SetBytesProcessed(int64_t(st.iterations()) * int64_t(BYTES));
+}
+
+// the same stream of chunks appended element by element or as ranges
+BENCHMARK_DEFINE_F(VectorBenchmark, APPEND_PUSH_BACK)(benchmark::State& st)
+{
+	cc::Vector<uint32_t> chunk(CHUNK, 7u);
+	for (auto _ : st)
+	{
+		cc::Vector<uint32_t> out;
+		for (size_t i = 0; i < BYTES / sizeof(uint32_t); i += CHUNK)
+		{
+			for (uint32_t value : chunk) out.push_back(value);
+		}
+		benchmark::DoNotOptimize(out.data());
+	}
+	st.SetBytesProcessed(int64_t(st.iterations()) * int64_t(BYTES));
+}
+
+BENCHMARK_DEFINE_F(VectorBenchmark, APPEND)(benchmark::State& st)
+{
+	cc::Vector<uint32_t> chunk(CHUNK, 7u);
+	for (auto _ : st)
+	{
+		cc::Vector<uint32_t> out;
+		for (size_t i = 0; i < BYTES / sizeof(uint32_t); i += CHUNK)
+		{
+			out.append(chunk.begin(), chunk.end());
+		}
+		benchmark::DoNotOptimize(out.data());
+	}
+	st.SetBytesProcessed(int64_t(st.iterations()) * int64_t(BYTES));
+}
+
+// a chunk in and out of the middle of a 1M elements array
+BENCHMARK_DEFINE_F(VectorBenchmark, INSERT_ERASE)(benchmark::State& st)
+{
+	cc::Vector<uint32_t> chunk(CHUNK, 7u);
+	cc::Vector<uint32_t> values(size_t(1) << 20, 1u);
+	for (auto _ : st)
+	{
+		uint32_t* at = values.insert(values.begin() + values.size() / 2, chunk.begin(), chunk.end());
+		values.erase(at, at + CHUNK);
+		benchmark::DoNotOptimize(values.data());
+	}
+	st.SetItemsProcessed(int64_t(st.iterations()) * int64_t(CHUNK));
+}
+
+class VirtualVectorBenchmark : public benchmark::Fixture
+{
+public:
+	static constexpr size_t COUNT = size_t(3) << 23;        // 192 MB of uint64_t, between two doublings
+
+	template<typename Container>
+	static void push(Container& values)
+	{
+		for (size_t i = 0; i < COUNT; ++i)
+		{
+			values.push_back(uint64_t(i));
+		}
+		benchmark::DoNotOptimize(values.data());
+	}
+
+	// peak resident set (MB) of a child process that fills a Container, over the one of an idle child
+	template<typename Container>
+	static double peak_rss()
+	{
+#if !defined(_WIN32)
+		auto child = [](bool fill)
+		{
+			const pid_t pid = fork();
+			if (pid == 0)
+			{
+				if (fill)
+				{
+					Container values;
+					push(values);
+				}
+				_exit(0);
+			}
+			int status;
+			struct rusage usage;
+			wait4(pid, &status, 0, &usage);
+			return double(usage.ru_maxrss) / 1024.;
+		};
+		return child(true) - child(false);
+#else
+		return 0.;
+#endif
+	}
+
+	template<typename Container>
+	static void run(benchmark::State& st)
+	{
+		st.counters["peak_MB"] = peak_rss<Container>();
+		for (auto _ : st)
+		{
+			Container values;
+			push(values);
+		}
+		st.SetItemsProcessed(int64_t(st.iterations()) * int64_t(COUNT));
+	}
+};
+
+BENCHMARK_DEFINE_F(VirtualVectorBenchmark, PUSH_STD)(benchmark::State& st)
+{
+	run<std::vector<uint64_t>>(st);
+}
+
+BENCHMARK_DEFINE_F(VirtualVectorBenchmark, PUSH_VECTOR)(benchmark::State& st)
+{
+	run<cc::Vector<uint64_t>>(st);
+}
+
+BENCHMARK_DEFINE_F(VirtualVectorBenchmark, PUSH_VIRTUAL)(benchmark::State& st)
+{
+	run<cc::VirtualVector<uint64_t>>(st);
+}
+
+class BitVectorBenchmark : public benchmark::Fixture
+{
+public:
+	static constexpr size_t COUNT = size_t(1) << 24;
+
+	void SetUp(const ::benchmark::State& state)
+	{
+		// state.range(0): percent of set flags
+		std::mt19937 rng(7);
+		flags.reset(new cc::Vector<uint8_t>(COUNT));
+		for (size_t i = 0; i < COUNT; ++i)
+		{
+			(*flags)[i] = uint8_t(int64_t(rng() % 100) < state.range(0));
+		}
+		bits.pack(flags->data(), COUNT);
+	}
+
+	void TearDown(const ::benchmark::State&)
+	{
+		flags.reset();
+	}
+
+	std::unique_ptr<cc::Vector<uint8_t>> flags;
+	cc::BitVector bits;
+};
+
+// byte per flag baseline
+BENCHMARK_DEFINE_F(BitVectorBenchmark, COUNT_BYTES)(benchmark::State& st)
+{
+	for (auto _ : st)
+	{
+		size_t count = 0;
+		for (size_t i = 0; i < COUNT; ++i) count += (*flags)[i];
+		benchmark::DoNotOptimize(count);
+	}
+	st.SetItemsProcessed(int64_t(st.iterations()) * int64_t(COUNT));
+}
+
+BENCHMARK_DEFINE_F(BitVectorBenchmark, COUNT)(benchmark::State& st)
+{
+	for (auto _ : st)
+	{
+		benchmark::DoNotOptimize(bits.count());
+	}
+	st.SetItemsProcessed(int64_t(st.iterations()) * int64_t(COUNT));
+}
+
+BENCHMARK_DEFINE_F(BitVectorBenchmark, INDICES_BYTES)(benchmark::State& st)
+{
+	cc::Vector<uint32_t> out;
+	for (auto _ : st)
+	{
+		out.clear();
+		for (size_t i = 0; i < COUNT; ++i)
+		{
+			if ((*flags)[i]) out.push_back(uint32_t(i));
+		}
+		benchmark::DoNotOptimize(out.data());
+	}
+	st.SetItemsProcessed(int64_t(st.iterations()) * int64_t(COUNT));
+}
+
+BENCHMARK_DEFINE_F(BitVectorBenchmark, INDICES)(benchmark::State& st)
+{
+	cc::ThreadPool pool(uint32_t(st.range(1)));
+	cc::Vector<uint32_t> out;
+	for (auto _ : st)
+	{
+		bits.indices(out, pool);
+		benchmark::DoNotOptimize(out.data());
+	}
+	st.SetItemsProcessed(int64_t(st.iterations()) * int64_t(COUNT));
+}
+
+BENCHMARK_DEFINE_F(BitVectorBenchmark, AND_BYTES)(benchmark::State& st)
+{
+	cc::Vector<uint8_t> other(*flags);
+	for (auto _ : st)
+	{
+		uint8_t* a = other.data();
+		const uint8_t* b = flags->data();
+		for (size_t i = 0; i < COUNT; ++i) a[i] &= b[i];
+		benchmark::DoNotOptimize(other.data());
+	}
+	st.SetItemsProcessed(int64_t(st.iterations()) * int64_t(COUNT));
+}
+
+BENCHMARK_DEFINE_F(BitVectorBenchmark, AND)(benchmark::State& st)
+{
+	cc::BitVector other(bits);
+	for (auto _ : st)
+	{
+		other &= bits;
+		benchmark::DoNotOptimize(other.words());
+	}
+	st.SetItemsProcessed(int64_t(st.iterations()) * int64_t(COUNT));
+}
+
+class BoundsBenchmark : public benchmark::Fixture
+{
+public:
+	static constexpr size_t COUNT = size_t(1) << 24;
+
+	void SetUp(const ::benchmark::State&)
+	{
+		std::mt19937 rng(3);
+		std::uniform_real_distribution<float> dist(-100.f, 100.f);
+		points.reset(new cc::Vector<cc::math::vec3>(COUNT));
+		for (cc::math::vec3& p : *points)
+		{
+			p = cc::math::vec3(dist(rng), dist(rng) * .5f, dist(rng) * .1f);
+		}
+	}
+
+	void TearDown(const ::benchmark::State&)
+	{
+		points.reset();
+	}
+
+	std::unique_ptr<cc::Vector<cc::math::vec3>> points;
+};
+
+// serial pmin / pmax fold and double precision moments, the baselines
+BENCHMARK_DEFINE_F(BoundsBenchmark, AABB_SERIAL)(benchmark::State& st)
+{
+	for (auto _ : st)
+	{
+		cc::math::vec3 lo(FLT_MAX), hi(-FLT_MAX);
+		for (const cc::math::vec3& p : *points)
+		{
+			lo = pmin(lo, p);
+			hi = pmax(hi, p);
+		}
+		benchmark::DoNotOptimize(lo);
+		benchmark::DoNotOptimize(hi);
+	}
+	st.SetItemsProcessed(int64_t(st.iterations()) * int64_t(COUNT));
+}
+
+BENCHMARK_DEFINE_F(BoundsBenchmark, AABB)(benchmark::State& st)
+{
+	cc::ThreadPool pool(uint32_t(st.range(0)));
+	for (auto _ : st)
+	{
+		benchmark::DoNotOptimize(cc::spatial::bounds(*points, pool));
+	}
+	st.SetItemsProcessed(int64_t(st.iterations()) * int64_t(COUNT));
+}
+
+BENCHMARK_DEFINE_F(BoundsBenchmark, MOMENTS_SERIAL)(benchmark::State& st)
+{
+	for (auto _ : st)
+	{
+		double s[9] = {};
+		for (const cc::math::vec3& p : *points)
+		{
+			s[0] += p.x; s[1] += p.y; s[2] += p.z;
+			s[3] += double(p.x) * p.x; s[4] += double(p.y) * p.y; s[5] += double(p.z) * p.z;
+			s[6] += double(p.x) * p.y; s[7] += double(p.x) * p.z; s[8] += double(p.y) * p.z;
+		}
+		benchmark::DoNotOptimize(s);
+	}
+	st.SetItemsProcessed(int64_t(st.iterations()) * int64_t(COUNT));
+}
+
+BENCHMARK_DEFINE_F(BoundsBenchmark, MOMENTS)(benchmark::State& st)
+{
+	cc::ThreadPool pool(uint32_t(st.range(0)));
+	for (auto _ : st)
+	{
+		benchmark::DoNotOptimize(cc::spatial::moments(*points, pool));
+	}
+	st.SetItemsProcessed(int64_t(st.iterations()) * int64_t(COUNT));
+}
+
+BENCHMARK_DEFINE_F(BoundsBenchmark, SPHERE)(benchmark::State& st)
+{
+	cc::ThreadPool pool(uint32_t(st.range(0)));
+	for (auto _ : st)
+	{
+		benchmark::DoNotOptimize(cc::spatial::bounding_sphere(*points, pool));
+	}
+	st.SetItemsProcessed(int64_t(st.iterations()) * int64_t(COUNT));
+}
+
+// moments, jacobi and the projected min / max pass
+BENCHMARK_DEFINE_F(BoundsBenchmark, OBB)(benchmark::State& st)
+{
+	cc::ThreadPool pool(uint32_t(st.range(0)));
+	for (auto _ : st)
+	{
+		benchmark::DoNotOptimize(cc::spatial::obb(*points, pool));
+	}
+	st.SetItemsProcessed(int64_t(st.iterations()) * int64_t(COUNT));
+}
+
+class SkinningBenchmark : public benchmark::Fixture
+{
+public:
+	static constexpr size_t COUNT = size_t(1) << 20;
+	static constexpr uint32_t BONES = 128;
+
+	void SetUp(const ::benchmark::State&)
+	{
+		std::mt19937 rng(7);
+		std::uniform_real_distribution<float> dist(-1.f, 1.f);
+
+		palette.reset(new cc::Vector<cc::math::mat4>(BONES));
+		for (cc::math::mat4& bone : *palette)
+		{
+			bone = cc::math::rotate(cc::math::mat4(1.f), 3.f * dist(rng), cc::math::vec3(dist(rng), dist(rng), 1.f));
+			bone[3] = cc::math::vec4(dist(rng), dist(rng), dist(rng), 1.f);
+		}
+		dq.reset(new cc::Vector<cc::skin::DualQuat>(BONES));
+		cc::skin::dual_quats(palette->data(), dq->data(), BONES);
+
+		positions.reset(new cc::Vector<cc::math::vec3>(COUNT));
+		normals.reset(new cc::Vector<cc::math::vec3>(COUNT));
+		joints.reset(new cc::Vector<cc::skin::Joints>(COUNT));
+		weights.reset(new cc::Vector<cc::math::vec4>(COUNT));
+		out_positions.reset(new cc::Vector<cc::math::vec3>(COUNT));
+		out_normals.reset(new cc::Vector<cc::math::vec3>(COUNT));
+		for (size_t i = 0; i < COUNT; ++i)
+		{
+			(*positions)[i] = cc::math::vec3(dist(rng), dist(rng), dist(rng));
+			(*normals)[i] = cc::math::normalize(cc::math::vec3(dist(rng), dist(rng), 1.f));
+			for (int j = 0; j < 4; ++j) (*joints)[i].index[j] = uint16_t(rng() % BONES);
+			const cc::math::vec4 w(cc::math::abs(dist(rng)), cc::math::abs(dist(rng)), cc::math::abs(dist(rng)), cc::math::abs(dist(rng)));
+			(*weights)[i] = w / (w.x + w.y + w.z + w.w);
+		}
+	}
+
+	void TearDown(const ::benchmark::State&)
+	{
+		palette.reset();
+		dq.reset();
+		positions.reset();
+		normals.reset();
+		joints.reset();
+		weights.reset();
+		out_positions.reset();
+		out_normals.reset();
+	}
+
+	cc::skin::Mesh mesh() const
+	{
+		return cc::skin::Mesh{ positions->data(), normals->data(), joints->data(), weights->data(), COUNT };
+	}
+
+	std::unique_ptr<cc::Vector<cc::math::mat4>> palette;
+	std::unique_ptr<cc::Vector<cc::skin::DualQuat>> dq;
+	std::unique_ptr<cc::Vector<cc::math::vec3>> positions;
+	std::unique_ptr<cc::Vector<cc::math::vec3>> normals;
+	std::unique_ptr<cc::Vector<cc::skin::Joints>> joints;
+	std::unique_ptr<cc::Vector<cc::math::vec4>> weights;
+	std::unique_ptr<cc::Vector<cc::math::vec3>> out_positions;
+	std::unique_ptr<cc::Vector<cc::math::vec3>> out_normals;
+};
+
+// vertex by vertex: blended mat4, mat4 * vec4 and mat3 * normal
+BENCHMARK_DEFINE_F(SkinningBenchmark, LINEAR_BLEND_SCALAR)(benchmark::State& st)
+{
+	for (auto _ : st)
+	{
+		for (size_t i = 0; i < COUNT; ++i)
+		{
+			cc::math::mat4 m;
+			for (int j = 0; j < 4; ++j)
+			{
+				const cc::math::mat4& bone = (*palette)[(*joints)[i].index[j]];
+				const float w = (*weights)[i][j];
+				for (int c = 0; c < 4; ++c) m[c] += bone[c] * w;
+			}
+			const cc::math::vec4 p = m * cc::math::vec4((*positions)[i], 1.f);
+			(*out_positions)[i] = cc::math::vec3(p.x, p.y, p.z);
+			(*out_normals)[i] = cc::math::normalize(cc::math::mat3(m) * (*normals)[i]);
+		}
+		benchmark::ClobberMemory();
+	}
+	st.SetItemsProcessed(int64_t(st.iterations()) * int64_t(COUNT));
+}
+
+BENCHMARK_DEFINE_F(SkinningBenchmark, LINEAR_BLEND)(benchmark::State& st)
+{
+	cc::ThreadPool pool(uint32_t(st.range(0)));
+	const cc::skin::Mesh input = mesh();
+	for (auto _ : st)
+	{
+		cc::skin::linear_blend(input, palette->data(), out_positions->data(), out_normals->data(), pool);
+		benchmark::ClobberMemory();
+	}
+	st.SetItemsProcessed(int64_t(st.iterations()) * int64_t(COUNT));
+}
+
+// vertex by vertex: shortest path blend, normalize, rotate and translate
+BENCHMARK_DEFINE_F(SkinningBenchmark, DUAL_QUATERNION_SCALAR)(benchmark::State& st)
+{
+	for (auto _ : st)
+	{
+		for (size_t i = 0; i < COUNT; ++i)
+		{
+			const cc::skin::DualQuat& first = (*dq)[(*joints)[i].index[0]];
+			cc::math::vec4 real, dual;
+			for (int j = 0; j < 4; ++j)
+			{
+				const cc::skin::DualQuat& bone = (*dq)[(*joints)[i].index[j]];
+				const cc::math::vec4 d = first.real * bone.real;
+				const float w = (d.x + d.y + d.z + d.w < 0.f)? -(*weights)[i][j] : (*weights)[i][j];
+				real += bone.real * w;
+				dual += bone.dual * w;
+			}
+			const float len = std::sqrt(real.x * real.x + real.y * real.y + real.z * real.z + real.w * real.w);
+			real = real / len;
+			dual = dual / len;
+
+			const cc::math::vec3 r(real.x, real.y, real.z), d(dual.x, dual.y, dual.z);
+			const cc::math::vec3 t = 2.f * (real.w * d - dual.w * r + cross(r, d));
+			const cc::math::vec3& p = (*positions)[i];
+			const cc::math::vec3& n = (*normals)[i];
+			(*out_positions)[i] = p + 2.f * cross(r, cross(r, p) + real.w * p) + t;
+			(*out_normals)[i] = n + 2.f * cross(r, cross(r, n) + real.w * n);
+		}
+		benchmark::ClobberMemory();
+	}
+	st.SetItemsProcessed(int64_t(st.iterations()) * int64_t(COUNT));
+}
+
+BENCHMARK_DEFINE_F(SkinningBenchmark, DUAL_QUATERNION)(benchmark::State& st)
+{
+	cc::ThreadPool pool(uint32_t(st.range(0)));
+	const cc::skin::Mesh input = mesh();
+	for (auto _ : st)
+	{
+		cc::skin::dual_quaternion(input, dq->data(), out_positions->data(), out_normals->data(), pool);
+		benchmark::ClobberMemory();
+	}
+	st.SetItemsProcessed(int64_t(st.iterations()) * int64_t(COUNT));
+}
+
+class BlurBenchmark : public benchmark::Fixture
+{
+public:
+	static constexpr uint32_t WIDTH = 3840;
+	static constexpr uint32_t HEIGHT = 2160;
+
+	void SetUp(const ::benchmark::State&)
+	{
+		std::mt19937 rng(9);
+		std::uniform_real_distribution<float> dist(0.f, 16.f);
+
+		src.reset(new cc::Image<cc::math::vec4>(WIDTH, HEIGHT));
+		dst.reset(new cc::Image<cc::math::vec4>(WIDTH, HEIGHT));
+		for (uint32_t y = 0; y < HEIGHT; ++y)
+			for (uint32_t x = 0; x < WIDTH; ++x)
+				(*src)(x, y) = cc::math::vec4(dist(rng), dist(rng), dist(rng), 1.f);
+	}
+
+	void TearDown(const ::benchmark::State&)
+	{
+		src.reset();
+		dst.reset();
+	}
+
+	std::unique_ptr<cc::Image<cc::math::vec4>> src;
+	std::unique_ptr<cc::Image<cc::math::vec4>> dst;
+};
+
+// sigma 4 (25 taps), pixel by pixel vec4 math with clamped taps in both passes
+BENCHMARK_DEFINE_F(BlurBenchmark, GAUSSIAN_SCALAR)(benchmark::State& st)
+{
+	const cc::blur::Kernel kernel = cc::blur::gaussian_kernel(4.f);
+	const int32_t radius = int32_t(kernel.radius());
+	cc::Image<cc::math::vec4> tmp(WIDTH, HEIGHT);
+	for (auto _ : st)
+	{
+		for (uint32_t y = 0; y < HEIGHT; ++y)
+			for (uint32_t x = 0; x < WIDTH; ++x)
+			{
+				cc::math::vec4 sum;
+				for (int32_t k = -radius; k <= radius; ++k)
+					sum += (*src)(uint32_t(cc::math::clamp(int32_t(x) + k, 0, int32_t(WIDTH) - 1)), y) * kernel.weights[k + radius];
+				tmp(x, y) = sum;
+			}
+
+		for (uint32_t y = 0; y < HEIGHT; ++y)
+			for (uint32_t x = 0; x < WIDTH; ++x)
+			{
+				cc::math::vec4 sum;
+				for (int32_t k = -radius; k <= radius; ++k)
+					sum += tmp(x, uint32_t(cc::math::clamp(int32_t(y) + k, 0, int32_t(HEIGHT) - 1))) * kernel.weights[k + radius];
+				(*dst)(x, y) = sum;
+			}
+		benchmark::ClobberMemory();
+	}
+	st.SetItemsProcessed(int64_t(st.iterations()) * int64_t(WIDTH) * HEIGHT);
+}
+
+BENCHMARK_DEFINE_F(BlurBenchmark, GAUSSIAN)(benchmark::State& st)
+{
+	cc::ThreadPool pool(uint32_t(st.range(0)));
+	for (auto _ : st)
+	{
+		cc::blur::gaussian(*src, *dst, 4.f, cc::blur::Edge::Clamp, pool);
+		benchmark::ClobberMemory();
+	}
+	st.SetItemsProcessed(int64_t(st.iterations()) * int64_t(WIDTH) * HEIGHT);
+}
+
+// radius 16 box, same cost at any radius
+BENCHMARK_DEFINE_F(BlurBenchmark, BOX)(benchmark::State& st)
+{
+	cc::ThreadPool pool(uint32_t(st.range(0)));
+	for (auto _ : st)
+	{
+		cc::blur::box(*src, *dst, 16, cc::blur::Edge::Mirror, pool);
+		benchmark::ClobberMemory();
+	}
+	st.SetItemsProcessed(int64_t(st.iterations()) * int64_t(WIDTH) * HEIGHT);
+}
+
+class ParallelBenchmark : public benchmark::Fixture
+{
+public:
+	void SetUp(const ::benchmark::State& state)
+	{
+		std::mt19937 mt(42);
+		std::uniform_real_distribution<float> dist(0.0, 4.0);
+		pixels.resize(TESTNUM);
+		results.resize(TESTNUM);
+		for (int i = 0; i < TESTNUM; ++i)
+		{
+			pixels[i] = cc::math::vec4(dist(mt), dist(mt), dist(mt), 1.f);
+		}
+		matrix = cc::math::rotate(cc::math::mat4(1.f), .5f, cc::math::vec3(1.f, 1.f, 0.f));
+	}
+
+	static constexpr int TESTNUM = 1 << 20;
+	cc::Vector<cc::math::vec4> pixels;
+	cc::Vector<cc::math::vec4> results;
+	cc::math::mat4 matrix;
+};
+
+BENCHMARK_DEFINE_F(ParallelBenchmark, TRANSFORM)(benchmark::State& st)
+{
+	cc::ThreadPool pool(st.range(0));
+	for (auto _ : st)
+	{
+		pool.parallel_for(0, TESTNUM, [&](size_t first, size_t last)
+		{
+			cc::simd::transform(matrix, &pixels[first], &results[first], last - first);
+		});
+		benchmark::ClobberMemory();
+	}
+	st.SetItemsProcessed(st.iterations() * TESTNUM);
+}
+
+BENCHMARK_DEFINE_F(ParallelBenchmark, TONEMAP)(benchmark::State& st)
+{
+	cc::ThreadPool pool(st.range(0));
+	for (auto _ : st)
+	{
+		pool.parallel_for(0, TESTNUM, [&](size_t first, size_t last)
+		{
+			for (size_t i = first; i < last; ++i)
+			{
+				results[i] = cc::gfx::srgb(cc::gfx::aces(pixels[i]));
+			}
+		});
+		benchmark::ClobberMemory();
+	}
+	st.SetItemsProcessed(st.iterations() * TESTNUM);
+}
+
+BENCHMARK_DEFINE_F(ParallelBenchmark, LUMINANCE_SUM)(benchmark::State& st)
+{
+	cc::ThreadPool pool(st.range(0));
+	for (auto _ : st)
+	{
+		benchmark::DoNotOptimize(pool.parallel_reduce(size_t(0), size_t(TESTNUM), 0.0,
+			[&](size_t first, size_t last)
+			{
+				double sum = 0.0;
+				for (size_t i = first; i < last; ++i)
+				{
+					sum += cc::math::dot(cc::math::vec3(pixels[i].rgb), cc::math::vec3(.2126f, .7152f, .0722f));
+				}
+				return sum;
+			},
+			[](double a, double b) { return a + b; }));
+	}
+	st.SetItemsProcessed(st.iterations() * TESTNUM);
+}
+
+// out = saturate(a * s + b): one pass per operator vs a single fused pass
+BENCHMARK_DEFINE_F(ParallelBenchmark, EXPR_TEMPORARIES)(benchmark::State& st)
+{
+	cc::Vector<cc::math::vec4> scaled(TESTNUM), biased(TESTNUM);
+	for (auto _ : st)
+	{
+		for (int i = 0; i < TESTNUM; ++i) scaled[i] = pixels[i] * .5f;
+		for (int i = 0; i < TESTNUM; ++i) biased[i] = scaled[i] + pixels[i];
+		for (int i = 0; i < TESTNUM; ++i) results[i] = cc::math::saturate(biased[i]);
+		benchmark::ClobberMemory();
+	}
+	st.SetItemsProcessed(st.iterations() * TESTNUM);
+}
+
+BENCHMARK_DEFINE_F(ParallelBenchmark, EXPR_FUSED)(benchmark::State& st)
+{
+	using namespace cc::expr;
+	for (auto _ : st)
+	{
+		lazy(results) = cc::expr::saturate(lazy(pixels) * .5f + lazy(pixels));
+		benchmark::ClobberMemory();
+	}
+	st.SetItemsProcessed(st.iterations() * TESTNUM);
+}
+
+BENCHMARK_DEFINE_F(ParallelBenchmark, EXPR_FUSED_PARALLEL)(benchmark::State& st)
+{
+	using namespace cc::expr;
+	cc::ThreadPool pool(st.range(0));
+	for (auto _ : st)
+	{
+		eval(results, cc::expr::saturate(lazy(pixels) * .5f + lazy(pixels)), pool);
+		benchmark::ClobberMemory();
+	}
+	st.SetItemsProcessed(st.iterations() * TESTNUM);
+}
+
+class TransformBenchmark : public benchmark::Fixture
+{
+public:
+	void SetUp(const ::benchmark::State& state)
+	{
+		std::mt19937 mt(42);
+		std::uniform_real_distribution<float> dist(-1.0, 1.0);
+		hierarchy.reset(new cc::TransformHierarchy);
+		hierarchy->reserve(NODES);
+		for (uint32_t i = 0; i < NODES; ++i)
+		{
+			const uint32_t parent = i? (i - 1) / 4 : cc::TransformHierarchy::NO_PARENT;
+			hierarchy->add(parent, cc::math::rotate(cc::math::translate(cc::math::mat4(1.f), cc::math::vec3(dist(mt), dist(mt), dist(mt))), dist(mt), cc::math::vec3(0.f, 1.f, 0.f)));
+		}
+		hierarchy->update();
+	}
+
+	static constexpr uint32_t NODES = 50000;
+	std::unique_ptr<cc::TransformHierarchy> hierarchy;
+};
+
+// range(0): percentage of nodes touched each frame
+BENCHMARK_DEFINE_F(TransformBenchmark, HIERARCHY_UPDATE)(benchmark::State& st)
+{
+	const uint32_t step = 100 / uint32_t(st.range(0));
+	uint32_t offset = 0;
+	for (auto _ : st)
+	{
+		for (uint32_t i = offset++ % step; i < NODES; i += step)
+		{
+			hierarchy->set_local(i, hierarchy->local(i));
+		}
+		hierarchy->update();
+		benchmark::ClobberMemory();
+	}
+	st.SetItemsProcessed(st.iterations() * NODES);
+}
+
+BENCHMARK_DEFINE_F(TransformBenchmark, HIERARCHY_UPDATE_PARALLEL)(benchmark::State& st)
+{
+	cc::ThreadPool pool;
+	const uint32_t step = 100 / uint32_t(st.range(0));
+	uint32_t offset = 0;
+	for (auto _ : st)
+	{
+		for (uint32_t i = offset++ % step; i < NODES; i += step)
+		{
+			hierarchy->set_local(i, hierarchy->local(i));
+		}
+		hierarchy->update(pool);
+		benchmark::ClobberMemory();
+	}
+	st.SetItemsProcessed(st.iterations() * NODES);
+}
+
+// every world matrix recomputed every frame, no flags
+BENCHMARK_DEFINE_F(TransformBenchmark, HIERARCHY_NAIVE)(benchmark::State& st)
+{
+	cc::Vector<cc::math::mat4> world(NODES);
+	for (auto _ : st)
+	{
+		world[0] = hierarchy->local(0);
+		for (uint32_t i = 1; i < NODES; ++i)
+		{
+			world[i] = world[hierarchy->parent(i)] * hierarchy->local(i);
+		}
+		benchmark::ClobberMemory();
+	}
+	st.SetItemsProcessed(st.iterations() * NODES);
+}
+
+// reference: a zone can't be cheaper than two of these
+static void PROF_RDTSC(benchmark::State& st)
+{
+	for (auto _ : st)
+	{
+		benchmark::DoNotOptimize(cc::prof::now());
+	}
+}
+
+// cost of one empty instrumented zone (two rdtsc + ring buffer store)
+static void PROF_ZONE(benchmark::State& st)
+{
+	for (auto _ : st)
+	{
+		CC_PROF_ZONE("bench");
+		benchmark::ClobberMemory();
+	}
+	cc::prof::reset();
+}
+
+static void PROF_COUNTER(benchmark::State& st)
+{
+	int64_t i = 0;
+	for (auto _ : st)
+	{
+		CC_PROF_COUNTER("bench", ++i);
+	}
+	cc::prof::reset();
+}
+
 BENCHMARK_REGISTER_F(Benchmark, STD_RSQRT);
 BENCHMARK_REGISTER_F(Benchmark, CC_RSQRT);
 BENCHMARK_REGISTER_F(Benchmark, STD_SINCOS);
 BENCHMARK_REGISTER_F(Benchmark, CC_SINCOS);
 BENCHMARK_REGISTER_F(Benchmark, STD_ATAN2);
 BENCHMARK_REGISTER_F(Benchmark, CC_ATAN2);
+BENCHMARK_REGISTER_F(SimdBenchmark, LOOP_TRANSFORM);
+BENCHMARK_REGISTER_F(SimdBenchmark, CC_TRANSFORM)->DenseRange(0, int(cc::simd::Level::Count) - 1);
+BENCHMARK_REGISTER_F(SimdBenchmark, CC_SRGB)->DenseRange(0, int(cc::simd::Level::Count) - 1);
+BENCHMARK_REGISTER_F(SimdBenchmark, DIRECT_CALL);
+BENCHMARK_REGISTER_F(SimdBenchmark, DISPATCHED_CALL);
+BENCHMARK_REGISTER_F(InverseBenchmark, LOOP_INVERSE);
+BENCHMARK_REGISTER_F(InverseBenchmark, CC_INVERSE)->DenseRange(0, int(cc::simd::Level::Count) - 1);
+BENCHMARK_REGISTER_F(InverseBenchmark, LOOP_NORMAL_MATRIX);
+BENCHMARK_REGISTER_F(InverseBenchmark, CC_NORMAL_MATRIX)->DenseRange(0, int(cc::simd::Level::Count) - 1);
+BENCHMARK_REGISTER_F(ParallelBenchmark, TRANSFORM)->DenseRange(1, std::thread::hardware_concurrency())->UseRealTime();
+BENCHMARK_REGISTER_F(ParallelBenchmark, TONEMAP)->DenseRange(1, std::thread::hardware_concurrency())->UseRealTime();
+BENCHMARK_REGISTER_F(ParallelBenchmark, LUMINANCE_SUM)->DenseRange(1, std::thread::hardware_concurrency())->UseRealTime();
+BENCHMARK_REGISTER_F(ParallelBenchmark, EXPR_TEMPORARIES);
+BENCHMARK_REGISTER_F(ParallelBenchmark, EXPR_FUSED);
+BENCHMARK_REGISTER_F(ParallelBenchmark, EXPR_FUSED_PARALLEL)->DenseRange(1, std::thread::hardware_concurrency())->UseRealTime();
+BENCHMARK_REGISTER_F(TransformBenchmark, HIERARCHY_UPDATE)->Arg(1)->Arg(100);
+BENCHMARK_REGISTER_F(TransformBenchmark, HIERARCHY_UPDATE_PARALLEL)->Arg(1)->Arg(100)->UseRealTime();
+BENCHMARK_REGISTER_F(TransformBenchmark, HIERARCHY_NAIVE);
+BENCHMARK(PROF_RDTSC);
+BENCHMARK(PROF_ZONE);
+BENCHMARK(PROF_ZONE)->Threads(4);
+BENCHMARK(PROF_COUNTER);
+BENCHMARK_REGISTER_F(ImageBenchmark, FILTER_3X3)->DenseRange(0, int(cc::ImageLayout::Count) - 1);
+BENCHMARK_REGISTER_F(ImageBenchmark, COLUMN_WALK)->DenseRange(0, int(cc::ImageLayout::Count) - 1);
+BENCHMARK_REGISTER_F(ImageBenchmark, RANDOM_3X3)->DenseRange(0, int(cc::ImageLayout::Count) - 1);
+BENCHMARK_REGISTER_F(ResampleBenchmark, RESIZE_VEC4)->DenseRange(0, int(cc::resample::Filter::Count) - 1);
+BENCHMARK_REGISTER_F(ResampleBenchmark, RESIZE_RGBA8)->DenseRange(0, int(cc::resample::Filter::Count) - 1);
+BENCHMARK_REGISTER_F(ResampleBenchmark, MIP_CHAIN_RGBA8)->DenseRange(0, int(cc::resample::Filter::Count) - 1);
+BENCHMARK_REGISTER_F(ResampleBenchmark, MIP_CHAIN_NAIVE);
+BENCHMARK_REGISTER_F(BlockCompressionBenchmark, ENCODE)->ArgsProduct({ benchmark::CreateDenseRange(0, int(cc::bc::Format::Count) - 1, 1), benchmark::CreateDenseRange(0, int(cc::bc::Quality::Count) - 1, 1) })->UseRealTime();
+BENCHMARK_REGISTER_F(BlockCompressionBenchmark, DECODE)->DenseRange(0, int(cc::bc::Format::Count) - 1)->UseRealTime();
+BENCHMARK_REGISTER_F(SpatialBenchmark, KEYS)->ArgsProduct({ { 1 << 20, 10000000 }, { 0, 1 } })->UseRealTime();
+BENCHMARK_REGISTER_F(SpatialBenchmark, RADIX_SORT)->Arg(1 << 20)->Arg(10000000)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_REGISTER_F(SpatialBenchmark, STD_SORT)->Arg(1 << 20)->Arg(10000000)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_REGISTER_F(SpatialBenchmark, SORTED_ORDER)->ArgsProduct({ { 1 << 20, 10000000 }, { 0, 1 } })->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_REGISTER_F(MeshLoadBenchmark, OBJ)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_REGISTER_F(MeshLoadBenchmark, OBJ_IOSTREAM)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_REGISTER_F(MeshLoadBenchmark, PLY_ASCII)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_REGISTER_F(MeshLoadBenchmark, PLY_BINARY)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_REGISTER_F(PoolBenchmark, CHURN_POOL);
+BENCHMARK_REGISTER_F(PoolBenchmark, CHURN_NEW);
+BENCHMARK_REGISTER_F(PoolBenchmark, UPDATE_POOL);
+BENCHMARK_REGISTER_F(PoolBenchmark, UPDATE_HEAP);
+BENCHMARK_REGISTER_F(HashMapBenchmark, INSERT_CC)->Arg(1 << 12)->Arg(1 << 20);
+BENCHMARK_REGISTER_F(HashMapBenchmark, INSERT_STD)->Arg(1 << 12)->Arg(1 << 20);
+BENCHMARK_REGISTER_F(HashMapBenchmark, FIND_CC)->Arg(1 << 12)->Arg(1 << 20);
+BENCHMARK_REGISTER_F(HashMapBenchmark, FIND_STD)->Arg(1 << 12)->Arg(1 << 20);
+BENCHMARK_REGISTER_F(HashMapBenchmark, DEDUP_VEC3_CC)->Arg(1 << 12)->Arg(1 << 20);
+BENCHMARK_REGISTER_F(HashMapBenchmark, DEDUP_VEC3_STD)->Arg(1 << 12)->Arg(1 << 20);
+BENCHMARK_REGISTER_F(MeshOptimizationBenchmark, WELD)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+BENCHMARK_REGISTER_F(MeshOptimizationBenchmark, VERTEX_CACHE)->DenseRange(0, int(cc::mesh::CacheOptimizer::Count) - 1)->Unit(benchmark::kMillisecond);
+BENCHMARK_REGISTER_F(MeshOptimizationBenchmark, VERTEX_FETCH)->Unit(benchmark::kMillisecond);
+BENCHMARK_REGISTER_F(QueueBenchmark, SPSC)->Arg(1)->Arg(32)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_REGISTER_F(QueueBenchmark, MPMC)->ArgsProduct({ { 1, 2, 4 }, { 1, 2, 4 }, { 1, 32 } })->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_REGISTER_F(QueueBenchmark, LOCKED_DEQUE)->ArgsProduct({ { 1, 2, 4 }, { 1, 2, 4 } })->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_REGISTER_F(QueueBenchmark, PING_PONG)->UseRealTime();
+BENCHMARK_REGISTER_F(NoiseBenchmark, SCALAR_2D)->DenseRange(0, int(cc::noise::Type::Count) - 1)->Unit(benchmark::kMillisecond);
+BENCHMARK_REGISTER_F(NoiseBenchmark, LANES_2D)->DenseRange(0, int(cc::noise::Type::Count) - 1)->Unit(benchmark::kMillisecond);
+BENCHMARK_REGISTER_F(NoiseBenchmark, FILL_2D)->ArgsProduct({ { 0, 1 }, { 1, 4 } })->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_REGISTER_F(NoiseBenchmark, SCALAR_3D)->DenseRange(0, int(cc::noise::Type::Count) - 1)->Unit(benchmark::kMillisecond);
+BENCHMARK_REGISTER_F(NoiseBenchmark, FILL_3D)->ArgsProduct({ { 0, 1 }, { 1, 4 } })->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_REGISTER_F(ExposureBenchmark, SERIAL)->Unit(benchmark::kMillisecond);
+BENCHMARK_REGISTER_F(ExposureBenchmark, HISTOGRAM)->Arg(1)->Arg(4)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_REGISTER_F(SHBenchmark, PROJECT_SCALAR)->Unit(benchmark::kMillisecond);
+BENCHMARK_REGISTER_F(SHBenchmark, PROJECT_EQUIRECT)->Arg(1)->Arg(4)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_REGISTER_F(SHBenchmark, PROJECT_CUBEMAP)->Arg(1)->Arg(4)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_REGISTER_F(SHBenchmark, EVALUATE_SCALAR);
+BENCHMARK_REGISTER_F(SHBenchmark, EVALUATE_BATCH);
+BENCHMARK_REGISTER_F(VectorBenchmark, RESIZE)->Unit(benchmark::kMillisecond);
+BENCHMARK_REGISTER_F(VectorBenchmark, RESIZE_UNINITIALIZED)->Unit(benchmark::kMillisecond);
+BENCHMARK_REGISTER_F(VectorBenchmark, APPEND_PUSH_BACK)->Unit(benchmark::kMillisecond);
+BENCHMARK_REGISTER_F(VectorBenchmark, APPEND)->Unit(benchmark::kMillisecond);
+BENCHMARK_REGISTER_F(VectorBenchmark, INSERT_ERASE);
+BENCHMARK_REGISTER_F(VirtualVectorBenchmark, PUSH_STD)->Unit(benchmark::kMillisecond);
+BENCHMARK_REGISTER_F(VirtualVectorBenchmark, PUSH_VECTOR)->Unit(benchmark::kMillisecond);
+BENCHMARK_REGISTER_F(VirtualVectorBenchmark, PUSH_VIRTUAL)->Unit(benchmark::kMillisecond);
+BENCHMARK_REGISTER_F(BitVectorBenchmark, COUNT_BYTES)->Arg(50)->Unit(benchmark::kMicrosecond);
+BENCHMARK_REGISTER_F(BitVectorBenchmark, COUNT)->Arg(50)->Unit(benchmark::kMicrosecond);
+BENCHMARK_REGISTER_F(BitVectorBenchmark, INDICES_BYTES)->Arg(1)->Arg(50)->Unit(benchmark::kMicrosecond);
+BENCHMARK_REGISTER_F(BitVectorBenchmark, INDICES)->Args({1, 1})->Args({50, 1})->Args({50, 4})->UseRealTime()->Unit(benchmark::kMicrosecond);
+BENCHMARK_REGISTER_F(BitVectorBenchmark, AND_BYTES)->Arg(50)->Unit(benchmark::kMicrosecond);
+BENCHMARK_REGISTER_F(BitVectorBenchmark, AND)->Arg(50)->Unit(benchmark::kMicrosecond);
+BENCHMARK_REGISTER_F(BoundsBenchmark, AABB_SERIAL)->Unit(benchmark::kMillisecond);
+BENCHMARK_REGISTER_F(BoundsBenchmark, AABB)->Arg(1)->Arg(2)->Arg(4)->Arg(8)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_REGISTER_F(BoundsBenchmark, MOMENTS_SERIAL)->Unit(benchmark::kMillisecond);
+BENCHMARK_REGISTER_F(BoundsBenchmark, MOMENTS)->Arg(1)->Arg(2)->Arg(4)->Arg(8)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_REGISTER_F(BoundsBenchmark, SPHERE)->Arg(1)->Arg(4)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_REGISTER_F(BoundsBenchmark, OBB)->Arg(1)->Arg(4)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_REGISTER_F(SkinningBenchmark, LINEAR_BLEND_SCALAR)->Unit(benchmark::kMillisecond);
+BENCHMARK_REGISTER_F(SkinningBenchmark, LINEAR_BLEND)->Arg(1)->Arg(4)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_REGISTER_F(SkinningBenchmark, DUAL_QUATERNION_SCALAR)->Unit(benchmark::kMillisecond);
+BENCHMARK_REGISTER_F(SkinningBenchmark, DUAL_QUATERNION)->Arg(1)->Arg(4)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_REGISTER_F(BlurBenchmark, GAUSSIAN_SCALAR)->Unit(benchmark::kMillisecond);
+BENCHMARK_REGISTER_F(BlurBenchmark, GAUSSIAN)->Arg(1)->Arg(4)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_REGISTER_F(BlurBenchmark, BOX)->Arg(1)->Arg(4)->UseRealTime()->Unit(benchmark::kMillisecond);
 
 BENCHMARK_MAIN();
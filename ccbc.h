@@ -0,0 +1,952 @@
+/*
+ * CCLib
+ *
+ * collection of utils i use in most projects.
+ * maybe it will evolve in a framework, maybe not
+ *
+ * (c) 2018 Carlo Casta <carlo.casta at gmail.com>
+ */
+#pragma once
+
+//
+// CPU block compression for 4x4 texel blocks:
+//
+//   auto blocks = cc::bc::compress(texture, cc::bc::Format::BC1, cc::bc::Quality::Normal);
+//   auto decoded = cc::bc::decompress(blocks.data(), texture.width(), texture.height(), cc::bc::Format::BC1);
+//   float db = cc::bc::psnr(texture, decoded);
+//
+// BC1 (rgb), BC3 (rgb + alpha), BC4 (r), BC5 (rg) and BC7 (rgba, mode 6 only).
+// every block works on 16 texels in SoA form so that the per-texel loops vectorize,
+// images are split in rows of blocks across a ThreadPool. border blocks clamp to the edge.
+//
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include "cclib.h"
+#include "ccvector.h"
+#include "ccparallel.h"
+#include "ccimage.h"
+#include "ccsimd.h"
+
+namespace cc
+{
+namespace bc
+{
+    using math::vec3;
+    using gfx::rgba8;
+
+    enum class Format : uint32_t
+    {
+        BC1,
+        BC3,
+        BC4,
+        BC5,
+        BC7,
+        Count
+    };
+
+    //
+    // Fast:   bounding box endpoints
+    // Normal: principal axis endpoints
+    // High:   principal axis + least squares refinement, extra mode/p-bit trials
+    //
+    enum class Quality : uint32_t
+    {
+        Fast,
+        Normal,
+        High,
+        Count
+    };
+
+    inline const char* format_name(Format format)
+    {
+        constexpr const char* names[] = { "bc1", "bc3", "bc4", "bc5", "bc7" };
+        return (format < Format::Count)? names[uint32_t(format)] : "unknown";
+    }
+
+    inline const char* quality_name(Quality quality)
+    {
+        constexpr const char* names[] = { "fast", "normal", "high" };
+        return (quality < Quality::Count)? names[uint32_t(quality)] : "unknown";
+    }
+
+    constexpr inline uint32_t block_bytes(Format format)
+    {
+        return (format == Format::BC1 || format == Format::BC4)? 8 : 16;
+    }
+
+    constexpr inline size_t compressed_size(Format format, uint32_t width, uint32_t height)
+    {
+        return size_t((width + 3) / 4) * ((height + 3) / 4) * block_bytes(format);
+    }
+
+namespace detail
+{
+    // texels as floats in [0, 255], one array per channel
+    struct Block
+    {
+        float c[4][16];
+    };
+
+    inline void load_block(const rgba8* texels, Block& block)
+    {
+        for (int i = 0; i < 16; ++i)
+        {
+            block.c[0][i] = texels[i].r;
+            block.c[1][i] = texels[i].g;
+            block.c[2][i] = texels[i].b;
+            block.c[3][i] = texels[i].a;
+        }
+    }
+
+    inline int quantize(float value, int max)
+    {
+        return math::clamp(int(value * max / 255.f + .5f), 0, max);
+    }
+
+    //
+    // mean and dominant direction of the first n channels: power iteration on the
+    // covariance matrix, starting from the bounding box diagonal
+    //
+    inline void principal_axis(const Block& block, int n, float* mean, float* axis)
+    {
+        float lo[4], hi[4];
+        for (int k = 0; k < n; ++k)
+        {
+            float sum = 0.f;
+            lo[k] = hi[k] = block.c[k][0];
+            for (int i = 0; i < 16; ++i)
+            {
+                sum += block.c[k][i];
+                lo[k] = math::min(lo[k], block.c[k][i]);
+                hi[k] = math::max(hi[k], block.c[k][i]);
+            }
+            mean[k] = sum / 16.f;
+            axis[k] = hi[k] - lo[k];
+        }
+
+        float cov[4][4];
+        for (int j = 0; j < n; ++j)
+        {
+            for (int k = j; k < n; ++k)
+            {
+                float sum = 0.f;
+                CC_SIMD_LOOP
+                for (int i = 0; i < 16; ++i)
+                {
+                    sum += (block.c[j][i] - mean[j]) * (block.c[k][i] - mean[k]);
+                }
+                cov[j][k] = cov[k][j] = sum;
+            }
+        }
+
+        for (int iteration = 0; iteration < 8; ++iteration)
+        {
+            float next[4];
+            float largest = 0.f;
+            for (int j = 0; j < n; ++j)
+            {
+                next[j] = 0.f;
+                for (int k = 0; k < n; ++k) next[j] += cov[j][k] * axis[k];
+                largest = math::max(largest, math::abs(next[j]));
+            }
+
+            // flat block, keep the bounding box diagonal
+            if (largest < 1.e-6f)
+            {
+                break;
+            }
+            for (int j = 0; j < n; ++j) axis[j] = next[j] / largest;
+        }
+    }
+
+    // endpoints at the extreme projections of the block on its principal axis
+    inline void axis_endpoints(const Block& block, int n, float* e0, float* e1)
+    {
+        float mean[4], axis[4];
+        principal_axis(block, n, mean, axis);
+
+        float length2 = 0.f;
+        for (int k = 0; k < n; ++k) length2 += axis[k] * axis[k];
+        if (length2 < 1.e-12f)
+        {
+            for (int k = 0; k < n; ++k) e0[k] = e1[k] = mean[k];
+            return;
+        }
+
+        float tmin = 1.e30f, tmax = -1.e30f;
+        for (int i = 0; i < 16; ++i)
+        {
+            float t = 0.f;
+            for (int k = 0; k < n; ++k) t += (block.c[k][i] - mean[k]) * axis[k];
+            tmin = math::min(tmin, t);
+            tmax = math::max(tmax, t);
+        }
+
+        for (int k = 0; k < n; ++k)
+        {
+            e0[k] = math::clamp(mean[k] + axis[k] * tmax / length2, 0.f, 255.f);
+            e1[k] = math::clamp(mean[k] + axis[k] * tmin / length2, 0.f, 255.f);
+        }
+    }
+
+    //
+    // least squares endpoints for fixed indices: every texel is w * e0 + (1 - w) * e1,
+    // solve the 2x2 normal equations per channel. false if the weights are degenerate
+    //
+    inline bool refine_endpoints(const Block& block, int n, const float* weights, float* e0, float* e1)
+    {
+        float aa = 0.f, ab = 0.f, bb = 0.f;
+        float ax[4] = {}, bx[4] = {};
+        for (int i = 0; i < 16; ++i)
+        {
+            const float a = weights[i];
+            const float b = 1.f - a;
+            aa += a * a;
+            ab += a * b;
+            bb += b * b;
+            for (int k = 0; k < n; ++k)
+            {
+                ax[k] += a * block.c[k][i];
+                bx[k] += b * block.c[k][i];
+            }
+        }
+
+        const float det = aa * bb - ab * ab;
+        if (math::abs(det) < 1.e-6f)
+        {
+            return false;
+        }
+
+        const float rdet = 1.f / det;
+        for (int k = 0; k < n; ++k)
+        {
+            e0[k] = math::clamp((ax[k] * bb - bx[k] * ab) * rdet, 0.f, 255.f);
+            e1[k] = math::clamp((bx[k] * aa - ax[k] * ab) * rdet, 0.f, 255.f);
+        }
+        return true;
+    }
+
+    //
+    // BC1 color block: two rgb565 endpoints, 2-bit indices. with color0 > color1 the
+    // palette is c0, c1, 2/3 c0 + 1/3 c1, 1/3 c0 + 2/3 c1
+    //
+    inline uint16_t pack565(const float* c)
+    {
+        return uint16_t((quantize(c[0], 31) << 11) | (quantize(c[1], 63) << 5) | quantize(c[2], 31));
+    }
+
+    inline void unpack565(uint16_t c, int* rgb)
+    {
+        const int r = (c >> 11) & 31, g = (c >> 5) & 63, b = c & 31;
+        rgb[0] = (r << 3) | (r >> 2);
+        rgb[1] = (g << 2) | (g >> 4);
+        rgb[2] = (b << 3) | (b >> 2);
+    }
+
+    inline void bc1_palette(uint16_t c0, uint16_t c1, int (&palette)[4][4])
+    {
+        unpack565(c0, palette[0]);
+        unpack565(c1, palette[1]);
+        for (int k = 0; k < 3; ++k)
+        {
+            if (c0 > c1)
+            {
+                palette[2][k] = (2 * palette[0][k] + palette[1][k]) / 3;
+                palette[3][k] = (palette[0][k] + 2 * palette[1][k]) / 3;
+            }
+            else
+            {
+                palette[2][k] = (palette[0][k] + palette[1][k]) / 2;
+                palette[3][k] = 0;
+            }
+        }
+        palette[0][3] = palette[1][3] = palette[2][3] = 255;
+        palette[3][3] = (c0 > c1)? 255 : 0;
+    }
+
+    // nearest palette entry for every texel, returns the squared error of the block
+    inline float bc1_indices(const Block& block, uint16_t c0, uint16_t c1, uint32_t (&indices)[16])
+    {
+        int ipalette[4][4];
+        bc1_palette(c0, c1, ipalette);
+
+        float palette[4][3];
+        for (int j = 0; j < 4; ++j)
+            for (int k = 0; k < 3; ++k)
+                palette[j][k] = float(ipalette[j][k]);
+
+        float error = 0.f;
+        CC_SIMD_LOOP
+        for (int i = 0; i < 16; ++i)
+        {
+            uint32_t best_index = 0;
+            float best = 1.e30f;
+            for (int j = 0; j < 4; ++j)
+            {
+                const float dr = block.c[0][i] - palette[j][0];
+                const float dg = block.c[1][i] - palette[j][1];
+                const float db = block.c[2][i] - palette[j][2];
+                const float d = dr * dr + dg * dg + db * db;
+                best_index = (d < best)? uint32_t(j) : best_index;
+                best = math::min(best, d);
+            }
+            indices[i] = best_index;
+            error += best;
+        }
+        return error;
+    }
+
+    struct Bc1Candidate
+    {
+        uint16_t c0, c1;
+        uint32_t indices[16];
+        float error;
+    };
+
+    // quantize the endpoints and pick indices, always in 4-color mode
+    inline void bc1_evaluate(const Block& block, const float* e0, const float* e1, Bc1Candidate& out)
+    {
+        uint16_t c0 = pack565(e0);
+        uint16_t c1 = pack565(e1);
+        if (c0 < c1)
+        {
+            const uint16_t t = c0; c0 = c1; c1 = t;
+        }
+
+        // a single 565 color: 3-color mode palette, index 0 is exact anyway
+        if (c0 == c1)
+        {
+            out.c0 = out.c1 = c0;
+            int rgb[3];
+            unpack565(c0, rgb);
+            out.error = 0.f;
+            for (int i = 0; i < 16; ++i)
+            {
+                out.indices[i] = 0;
+                for (int k = 0; k < 3; ++k) out.error += (block.c[k][i] - rgb[k]) * (block.c[k][i] - rgb[k]);
+            }
+            return;
+        }
+
+        out.c0 = c0;
+        out.c1 = c1;
+        out.error = bc1_indices(block, c0, c1, out.indices);
+    }
+
+    //
+    // bounding box of the first n channels, taking the diagonal that follows the sign of
+    // each channel's covariance with the widest one, inset by half an interpolation step
+    //
+    inline void box_endpoints(const Block& block, int n, float* e0, float* e1)
+    {
+        float mean[4];
+        int widest = 0;
+        for (int k = 0; k < n; ++k)
+        {
+            float sum = 0.f;
+            e0[k] = e1[k] = block.c[k][0];
+            for (int i = 0; i < 16; ++i)
+            {
+                sum += block.c[k][i];
+                e0[k] = math::max(e0[k], block.c[k][i]);
+                e1[k] = math::min(e1[k], block.c[k][i]);
+            }
+            mean[k] = sum / 16.f;
+            widest = (e0[k] - e1[k] > e0[widest] - e1[widest])? k : widest;
+        }
+
+        for (int k = 0; k < n; ++k)
+        {
+            float cov = 0.f;
+            for (int i = 0; i < 16; ++i) cov += (block.c[k][i] - mean[k]) * (block.c[widest][i] - mean[widest]);
+            if (cov < 0.f)
+            {
+                const float t = e0[k]; e0[k] = e1[k]; e1[k] = t;
+            }
+
+            const float inset = (e0[k] - e1[k]) / 16.f;
+            e0[k] -= inset;
+            e1[k] += inset;
+        }
+    }
+
+    inline void encode_bc1(const Block& block, uint8_t* out, Quality quality)
+    {
+        float e0[4], e1[4];
+        if (quality == Quality::Fast)
+        {
+            box_endpoints(block, 3, e0, e1);
+        }
+        else
+        {
+            axis_endpoints(block, 3, e0, e1);
+        }
+
+        Bc1Candidate best;
+        bc1_evaluate(block, e0, e1, best);
+
+        if (quality == Quality::High)
+        {
+            constexpr float index_weight[4] = { 1.f, 0.f, 2.f / 3.f, 1.f / 3.f };
+            for (int iteration = 0; iteration < 2 && best.error > 0.f && best.c0 != best.c1; ++iteration)
+            {
+                float weights[16];
+                for (int i = 0; i < 16; ++i) weights[i] = index_weight[best.indices[i]];
+                if (!refine_endpoints(block, 3, weights, e0, e1))
+                {
+                    break;
+                }
+
+                Bc1Candidate candidate;
+                bc1_evaluate(block, e0, e1, candidate);
+                if (candidate.error >= best.error)
+                {
+                    break;
+                }
+                best = candidate;
+            }
+        }
+
+        uint32_t bits = 0;
+        for (int i = 0; i < 16; ++i) bits |= best.indices[i] << (2 * i);
+
+        out[0] = uint8_t(best.c0);
+        out[1] = uint8_t(best.c0 >> 8);
+        out[2] = uint8_t(best.c1);
+        out[3] = uint8_t(best.c1 >> 8);
+        std::memcpy(out + 4, &bits, 4);
+    }
+
+    inline void decode_bc1(const uint8_t* in, rgba8* texels)
+    {
+        const uint16_t c0 = uint16_t(in[0] | (in[1] << 8));
+        const uint16_t c1 = uint16_t(in[2] | (in[3] << 8));
+        uint32_t bits;
+        std::memcpy(&bits, in + 4, 4);
+
+        int palette[4][4];
+        bc1_palette(c0, c1, palette);
+        for (int i = 0; i < 16; ++i)
+        {
+            const int* p = palette[(bits >> (2 * i)) & 3];
+            texels[i] = rgba8{ uint8_t(p[0]), uint8_t(p[1]), uint8_t(p[2]), uint8_t(p[3]) };
+        }
+    }
+
+    //
+    // BC4 channel block: two 8-bit endpoints, 3-bit indices. e0 > e1 interpolates 8 values,
+    // e0 <= e1 interpolates 6 and adds exact 0 and 255
+    //
+    inline void bc4_palette(int e0, int e1, float (&palette)[8])
+    {
+        palette[0] = float(e0);
+        palette[1] = float(e1);
+        if (e0 > e1)
+        {
+            for (int i = 1; i < 7; ++i) palette[i + 1] = float(((7 - i) * e0 + i * e1) / 7);
+        }
+        else
+        {
+            for (int i = 1; i < 5; ++i) palette[i + 1] = float(((5 - i) * e0 + i * e1) / 5);
+            palette[6] = 0.f;
+            palette[7] = 255.f;
+        }
+    }
+
+    inline float bc4_indices(const float* values, int e0, int e1, uint32_t (&indices)[16])
+    {
+        float palette[8];
+        bc4_palette(e0, e1, palette);
+
+        float error = 0.f;
+        CC_SIMD_LOOP
+        for (int i = 0; i < 16; ++i)
+        {
+            uint32_t best_index = 0;
+            float best = 1.e30f;
+            for (int j = 0; j < 8; ++j)
+            {
+                const float d = (values[i] - palette[j]) * (values[i] - palette[j]);
+                best_index = (d < best)? uint32_t(j) : best_index;
+                best = math::min(best, d);
+            }
+            indices[i] = best_index;
+            error += best;
+        }
+        return error;
+    }
+
+    inline void encode_bc4(const float* values, uint8_t* out, Quality quality)
+    {
+        float lo = values[0], hi = values[0];
+        for (int i = 0; i < 16; ++i)
+        {
+            lo = math::min(lo, values[i]);
+            hi = math::max(hi, values[i]);
+        }
+
+        int e0 = int(hi + .5f), e1 = int(lo + .5f);
+        uint32_t indices[16];
+        float error = bc4_indices(values, e0, e1, indices);
+
+        if (quality == Quality::High && error > 0.f)
+        {
+            // least squares on the 8-value ramp
+            if (e0 > e1)
+            {
+                constexpr float index_weight[8] = { 1.f, 0.f, 6.f / 7.f, 5.f / 7.f, 4.f / 7.f, 3.f / 7.f, 2.f / 7.f, 1.f / 7.f };
+                Block block;
+                float weights[16];
+                for (int i = 0; i < 16; ++i)
+                {
+                    block.c[0][i] = values[i];
+                    weights[i] = index_weight[indices[i]];
+                }
+
+                float r0, r1;
+                if (refine_endpoints(block, 1, weights, &r0, &r1))
+                {
+                    const int q0 = int(r0 + .5f), q1 = int(r1 + .5f);
+                    uint32_t candidate[16];
+                    const float candidate_error = (q0 > q1)? bc4_indices(values, q0, q1, candidate) : 1.e30f;
+                    if (candidate_error < error)
+                    {
+                        e0 = q0; e1 = q1; error = candidate_error;
+                        std::memcpy(indices, candidate, sizeof(indices));
+                    }
+                }
+            }
+
+            // 6-value ramp between the inner values, the extremes snap to 0/255
+            float inner_lo = 255.f, inner_hi = 0.f;
+            for (int i = 0; i < 16; ++i)
+            {
+                if (values[i] > 0.f && values[i] < 255.f)
+                {
+                    inner_lo = math::min(inner_lo, values[i]);
+                    inner_hi = math::max(inner_hi, values[i]);
+                }
+            }
+            if (inner_lo <= inner_hi)
+            {
+                const int q0 = int(inner_lo + .5f), q1 = int(inner_hi + .5f);
+                uint32_t candidate[16];
+                const float candidate_error = bc4_indices(values, q0, q1, candidate);
+                if (candidate_error < error)
+                {
+                    e0 = q0; e1 = q1; error = candidate_error;
+                    std::memcpy(indices, candidate, sizeof(indices));
+                }
+            }
+        }
+
+        uint64_t bits = 0;
+        for (int i = 0; i < 16; ++i) bits |= uint64_t(indices[i]) << (3 * i);
+
+        out[0] = uint8_t(e0);
+        out[1] = uint8_t(e1);
+        for (int i = 0; i < 6; ++i) out[2 + i] = uint8_t(bits >> (8 * i));
+    }
+
+    inline void decode_bc4(const uint8_t* in, uint8_t* values, size_t stride)
+    {
+        float palette[8];
+        bc4_palette(in[0], in[1], palette);
+
+        uint64_t bits = 0;
+        for (int i = 0; i < 6; ++i) bits |= uint64_t(in[2 + i]) << (8 * i);
+        for (int i = 0; i < 16; ++i)
+        {
+            values[i * stride] = uint8_t(palette[(bits >> (3 * i)) & 7]);
+        }
+    }
+
+    //
+    // BC7 mode 6: one subset, rgba 7-bit endpoints + 1 p-bit each, 4-bit indices
+    // (the first index has its top bit implied zero)
+    //
+    constexpr int BC7_WEIGHTS4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+    struct Bits128
+    {
+        uint64_t word[2];
+        uint32_t position;
+
+        void put(uint32_t value, uint32_t count)
+        {
+            for (uint32_t i = 0; i < count; ++i, ++position)
+            {
+                word[position >> 6] |= uint64_t((value >> i) & 1) << (position & 63);
+            }
+        }
+
+        uint32_t get(uint32_t count)
+        {
+            uint32_t value = 0;
+            for (uint32_t i = 0; i < count; ++i, ++position)
+            {
+                value |= uint32_t((word[position >> 6] >> (position & 63)) & 1) << i;
+            }
+            return value;
+        }
+    };
+
+    struct Bc7Candidate
+    {
+        int q[2][4];        // 7-bit endpoints
+        int p[2];
+        uint32_t indices[16];
+        float error;
+    };
+
+    inline float bc7_indices(const Block& block, const int (&endpoint)[2][4], uint32_t (&indices)[16])
+    {
+        float palette[16][4];
+        for (int j = 0; j < 16; ++j)
+            for (int k = 0; k < 4; ++k)
+                palette[j][k] = float(((64 - BC7_WEIGHTS4[j]) * endpoint[0][k] + BC7_WEIGHTS4[j] * endpoint[1][k] + 32) >> 6);
+
+        float error = 0.f;
+        CC_SIMD_LOOP
+        for (int i = 0; i < 16; ++i)
+        {
+            uint32_t best_index = 0;
+            float best = 1.e30f;
+            for (int j = 0; j < 16; ++j)
+            {
+                const float dr = block.c[0][i] - palette[j][0];
+                const float dg = block.c[1][i] - palette[j][1];
+                const float db = block.c[2][i] - palette[j][2];
+                const float da = block.c[3][i] - palette[j][3];
+                const float d = dr * dr + dg * dg + db * db + da * da;
+                best_index = (d < best)? uint32_t(j) : best_index;
+                best = math::min(best, d);
+            }
+            indices[i] = best_index;
+            error += best;
+        }
+        return error;
+    }
+
+    // quantize e0/e1 with the given p-bits (-1: pick the closest per endpoint)
+    inline void bc7_evaluate(const Block& block, const float* e0, const float* e1, int p0, int p1, Bc7Candidate& out)
+    {
+        const float* e[2] = { e0, e1 };
+        const int pbit[2] = { p0, p1 };
+        int endpoint[2][4];
+        for (int s = 0; s < 2; ++s)
+        {
+            float best = 1.e30f;
+            for (int p = 0; p < 2; ++p)
+            {
+                if (pbit[s] >= 0 && pbit[s] != p)
+                {
+                    continue;
+                }
+
+                int q[4];
+                float error = 0.f;
+                for (int k = 0; k < 4; ++k)
+                {
+                    q[k] = math::clamp(int((e[s][k] - p) * .5f + .5f), 0, 127);
+                    const float d = e[s][k] - float((q[k] << 1) | p);
+                    error += d * d;
+                }
+                if (error < best)
+                {
+                    best = error;
+                    out.p[s] = p;
+                    for (int k = 0; k < 4; ++k)
+                    {
+                        out.q[s][k] = q[k];
+                        endpoint[s][k] = (q[k] << 1) | p;
+                    }
+                }
+            }
+        }
+        out.error = bc7_indices(block, endpoint, out.indices);
+    }
+
+    inline void encode_bc7(const Block& block, uint8_t* out, Quality quality)
+    {
+        float e0[4], e1[4];
+        if (quality == Quality::Fast)
+        {
+            box_endpoints(block, 4, e0, e1);
+        }
+        else
+        {
+            axis_endpoints(block, 4, e0, e1);
+        }
+
+        Bc7Candidate best;
+        bc7_evaluate(block, e0, e1, -1, -1, best);
+
+        if (quality == Quality::High)
+        {
+            for (int iteration = 0; iteration < 2 && best.error > 0.f; ++iteration)
+            {
+                float weights[16];
+                for (int i = 0; i < 16; ++i) weights[i] = 1.f - BC7_WEIGHTS4[best.indices[i]] / 64.f;
+
+                float r0[4], r1[4];
+                if (!refine_endpoints(block, 4, weights, r0, r1))
+                {
+                    break;
+                }
+
+                bool improved = false;
+                for (int p = 0; p < 4; ++p)
+                {
+                    Bc7Candidate candidate;
+                    bc7_evaluate(block, r0, r1, p & 1, p >> 1, candidate);
+                    if (candidate.error < best.error)
+                    {
+                        best = candidate;
+                        improved = true;
+                    }
+                }
+                if (!improved)
+                {
+                    break;
+                }
+            }
+        }
+
+        // the anchor index has no top bit: swap the endpoints if texel 0 needs it
+        if (best.indices[0] & 8)
+        {
+            for (int k = 0; k < 4; ++k)
+            {
+                const int t = best.q[0][k]; best.q[0][k] = best.q[1][k]; best.q[1][k] = t;
+            }
+            const int t = best.p[0]; best.p[0] = best.p[1]; best.p[1] = t;
+            for (int i = 0; i < 16; ++i) best.indices[i] = 15 - best.indices[i];
+        }
+
+        Bits128 bits = {};
+        bits.put(1u << 6, 7);
+        for (int k = 0; k < 4; ++k)
+        {
+            bits.put(uint32_t(best.q[0][k]), 7);
+            bits.put(uint32_t(best.q[1][k]), 7);
+        }
+        bits.put(uint32_t(best.p[0]), 1);
+        bits.put(uint32_t(best.p[1]), 1);
+        bits.put(best.indices[0], 3);
+        for (int i = 1; i < 16; ++i) bits.put(best.indices[i], 4);
+
+        std::memcpy(out, bits.word, 16);
+    }
+
+    // mode 6 only, other modes decode to transparent black
+    inline void decode_bc7(const uint8_t* in, rgba8* texels)
+    {
+        Bits128 bits = {};
+        std::memcpy(bits.word, in, 16);
+        if (bits.get(7) != (1u << 6))
+        {
+            std::memset(texels, 0, 16 * sizeof(rgba8));
+            return;
+        }
+
+        int endpoint[2][4];
+        for (int k = 0; k < 4; ++k)
+        {
+            endpoint[0][k] = int(bits.get(7)) << 1;
+            endpoint[1][k] = int(bits.get(7)) << 1;
+        }
+        const int p0 = int(bits.get(1)), p1 = int(bits.get(1));
+        for (int k = 0; k < 4; ++k)
+        {
+            endpoint[0][k] |= p0;
+            endpoint[1][k] |= p1;
+        }
+
+        for (int i = 0; i < 16; ++i)
+        {
+            const int w = BC7_WEIGHTS4[bits.get(i == 0? 3 : 4)];
+            uint8_t c[4];
+            for (int k = 0; k < 4; ++k) c[k] = uint8_t(((64 - w) * endpoint[0][k] + w * endpoint[1][k] + 32) >> 6);
+            texels[i] = rgba8{ c[0], c[1], c[2], c[3] };
+        }
+    }
+}
+
+    // 16 texels in row order, out gets block_bytes(format) bytes
+    inline void encode_block(Format format, const rgba8* texels, uint8_t* out, Quality quality = Quality::Normal)
+    {
+        detail::Block block;
+        detail::load_block(texels, block);
+
+        switch (format)
+        {
+        case Format::BC1:
+            detail::encode_bc1(block, out, quality);
+            break;
+
+        case Format::BC3:
+            detail::encode_bc4(block.c[3], out, quality);
+            detail::encode_bc1(block, out + 8, quality);
+            break;
+
+        case Format::BC4:
+            detail::encode_bc4(block.c[0], out, quality);
+            break;
+
+        case Format::BC5:
+            detail::encode_bc4(block.c[0], out, quality);
+            detail::encode_bc4(block.c[1], out + 8, quality);
+            break;
+
+        default:
+            detail::encode_bc7(block, out, quality);
+            break;
+        }
+    }
+
+    // BC4 decodes to (r, 0, 0, 255), BC5 to (r, g, 0, 255)
+    inline void decode_block(Format format, const uint8_t* in, rgba8* texels)
+    {
+        switch (format)
+        {
+        case Format::BC1:
+            detail::decode_bc1(in, texels);
+            break;
+
+        case Format::BC3:
+            detail::decode_bc1(in + 8, texels);
+            detail::decode_bc4(in, &texels[0].a, sizeof(rgba8));
+            break;
+
+        case Format::BC4:
+        case Format::BC5:
+            for (int i = 0; i < 16; ++i) texels[i] = rgba8{ 0, 0, 0, 255 };
+            detail::decode_bc4(in, &texels[0].r, sizeof(rgba8));
+            if (format == Format::BC5)
+            {
+                detail::decode_bc4(in + 8, &texels[0].g, sizeof(rgba8));
+            }
+            break;
+
+        default:
+            detail::decode_bc7(in, texels);
+            break;
+        }
+    }
+
+    // blocks in row-major order into out (compressed_size() bytes), one row of blocks per task
+    inline void compress(const Image<rgba8>& image, Format format, Quality quality, uint8_t* out, ThreadPool& pool = ThreadPool::global())
+    {
+        const uint32_t width = image.width();
+        const uint32_t height = image.height();
+        const uint32_t blocks_x = (width + 3) / 4;
+        const uint32_t blocks_y = (height + 3) / 4;
+        const uint32_t bytes = block_bytes(format);
+
+        pool.parallel_for(0, blocks_y, [&](size_t first, size_t last)
+        {
+            rgba8 texels[16];
+            for (size_t by = first; by < last; ++by)
+            {
+                uint8_t* dst = out + by * blocks_x * bytes;
+                for (uint32_t bx = 0; bx < blocks_x; ++bx, dst += bytes)
+                {
+                    for (uint32_t i = 0; i < 16; ++i)
+                    {
+                        const uint32_t x = math::min(bx * 4 + (i & 3), width - 1);
+                        const uint32_t y = math::min(uint32_t(by) * 4 + (i >> 2), height - 1);
+                        texels[i] = image.at(x, y);
+                    }
+                    encode_block(format, texels, dst, quality);
+                }
+            }
+        }, 1);
+    }
+
+    inline Vector<uint8_t> compress(const Image<rgba8>& image, Format format, Quality quality = Quality::Normal, ThreadPool& pool = ThreadPool::global())
+    {
+        Vector<uint8_t> result(compressed_size(format, image.width(), image.height()));
+        if (!result.empty())
+        {
+            compress(image, format, quality, result.data(), pool);
+        }
+        return result;
+    }
+
+    inline Image<rgba8> decompress(const uint8_t* data, uint32_t width, uint32_t height, Format format, ThreadPool& pool = ThreadPool::global())
+    {
+        Image<rgba8> image(width, height);
+        const uint32_t blocks_x = (width + 3) / 4;
+        const uint32_t blocks_y = (height + 3) / 4;
+        const uint32_t bytes = block_bytes(format);
+
+        pool.parallel_for(0, blocks_y, [&](size_t first, size_t last)
+        {
+            rgba8 texels[16];
+            for (size_t by = first; by < last; ++by)
+            {
+                const uint8_t* src = data + by * blocks_x * bytes;
+                for (uint32_t bx = 0; bx < blocks_x; ++bx, src += bytes)
+                {
+                    decode_block(format, src, texels);
+                    for (uint32_t i = 0; i < 16; ++i)
+                    {
+                        const uint32_t x = bx * 4 + (i & 3);
+                        const uint32_t y = uint32_t(by) * 4 + (i >> 2);
+                        if (x < width && y < height) image.at(x, y) = texels[i];
+                    }
+                }
+            }
+        }, 1);
+
+        return image;
+    }
+
+    //
+    // error metrics over the first `channels` components (3: rgb, 4: rgba, 1/2 for BC4/BC5)
+    //
+    inline float mse(const Image<rgba8>& a, const Image<rgba8>& b, uint32_t channels = 3)
+    {
+        double sum = 0.;
+        for (uint32_t y = 0; y < a.height(); ++y)
+        {
+            for (uint32_t x = 0; x < a.width(); ++x)
+            {
+                const rgba8 p = a.at(x, y), q = b.at(x, y);
+                const vec3 d = vec3(p.r, p.g, p.b) - vec3(q.r, q.g, q.b);
+                const float da = float(p.a) - float(q.a);
+                const float e[4] = { d.r * d.r, d.g * d.g, d.b * d.b, da * da };
+                for (uint32_t k = 0; k < channels; ++k) sum += e[k];
+            }
+        }
+        const double count = double(a.width()) * a.height() * channels;
+        return (count > 0.)? float(sum / count) : 0.f;
+    }
+
+    // in dB, 255 peak. identical images give +inf
+    inline float psnr(const Image<rgba8>& a, const Image<rgba8>& b, uint32_t channels = 3)
+    {
+        return 10.f * std::log10(255.f * 255.f / mse(a, b, channels));
+    }
+
+    // luma only (cc::yuv weights), closer to what the eye picks up on photographic content
+    inline float psnr_luma(const Image<rgba8>& a, const Image<rgba8>& b)
+    {
+        double sum = 0.;
+        for (uint32_t y = 0; y < a.height(); ++y)
+        {
+            for (uint32_t x = 0; x < a.width(); ++x)
+            {
+                const rgba8 p = a.at(x, y), q = b.at(x, y);
+                const float d = yuv::yuv(vec3(p.r, p.g, p.b)).x - yuv::yuv(vec3(q.r, q.g, q.b)).x;
+                sum += d * d;
+            }
+        }
+        const double count = double(a.width()) * a.height();
+        return 10.f * std::log10(255.f * 255.f / float(sum / count));
+    }
+}
+}
@@ -0,0 +1,497 @@
+/*
+ * CCLib
+ *
+ * collection of utils i use in most projects.
+ * maybe it will evolve in a framework, maybe not
+ *
+ * (c) 2018 Carlo Casta <carlo.casta at gmail.com>
+ */
+#pragma once
+
+//
+// one bit per flag, 64 to a word:
+//
+//   cc::BitVector visible(objects.size());
+//   visible.set(i);                                      // or pack() a byte per flag mask
+//   visible &= in_frustum;                               // whole vector ops, simd
+//   const size_t n = visible.count();
+//   for (size_t i = visible.find_first(); i != cc::BitVector::NONE; i = visible.find_next(i)) ...
+//   const cc::Vector<uint32_t> list = visible.indices(); // mask -> indices, parallel
+//
+// bits past size() in the last word are always kept clear, so counts and scans can
+// work on whole words
+//
+
+#include <cstdint>
+#include <cstring>
+#include "cclib.h"
+#include "ccvector.h"
+#include "ccsimd.h"
+#include "ccparallel.h"
+
+#if !defined(_MSC_VER)
+ #include <immintrin.h>
+#endif
+
+namespace cc
+{
+namespace detail
+{
+    constexpr size_t WORD_BITS = 64;
+
+    inline uint32_t lowest_bit64(uint64_t word)
+    {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanForward64(&index, word);
+        return static_cast<uint32_t>(index);
+#else
+        return static_cast<uint32_t>(__builtin_ctzll(word));
+#endif
+    }
+
+    // swar, branch free and fine for auto-vectorization (no popcnt in the x86-64 baseline)
+    CC_FORCEINLINE uint64_t popcount64(uint64_t x)
+    {
+        x = x - ((x >> 1) & 0x5555555555555555ull);
+        x = (x & 0x3333333333333333ull) + ((x >> 2) & 0x3333333333333333ull);
+        x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0full;
+        return (x * 0x0101010101010101ull) >> 56;
+    }
+
+    inline size_t popcount_generic(const uint64_t* words, size_t count)
+    {
+        uint64_t sums[8] = {};
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            CC_SIMD_LOOP
+            for (size_t l = 0; l < 8; ++l)
+            {
+                sums[l] += popcount64(words[i + l]);
+            }
+        }
+
+        uint64_t total = 0;
+        for (size_t l = 0; l < 8; ++l) total += sums[l];
+        for (; i < count; ++i) total += popcount64(words[i]);
+        return size_t(total);
+    }
+
+    //
+    // nibble lookup through pshufb, per byte counts summed with psadbw (W. Mula). about
+    // twice the hardware popcnt per word loop
+    //
+    CC_TARGET_AVX2 inline size_t popcount_avx2(const uint64_t* words, size_t count)
+    {
+        const __m256i lut = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                             0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+        const __m256i low = _mm256_set1_epi8(0x0f);
+        __m256i sum = _mm256_setzero_si256();
+
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(words + i));
+            const __m256i bytes = _mm256_add_epi8(_mm256_shuffle_epi8(lut, _mm256_and_si256(v, low)),
+                                                  _mm256_shuffle_epi8(lut, _mm256_and_si256(_mm256_srli_epi16(v, 4), low)));
+            sum = _mm256_add_epi64(sum, _mm256_sad_epu8(bytes, _mm256_setzero_si256()));
+        }
+
+        uint64_t lanes[4];
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), sum);
+        uint64_t total = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+        for (; i < count; ++i) total += popcount64(words[i]);
+        return size_t(total);
+    }
+
+    CC_TARGET_AVX512 inline size_t popcount_avx512(const uint64_t* words, size_t count)
+    {
+        const __m512i lut = _mm512_set4_epi32(0x04030302, 0x03020201, 0x03020201, 0x02010100);
+        const __m512i low = _mm512_set1_epi8(0x0f);
+        __m512i sum = _mm512_setzero_si512();
+
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            const __m512i v = _mm512_loadu_si512(words + i);
+            const __m512i bytes = _mm512_add_epi8(_mm512_shuffle_epi8(lut, _mm512_and_si512(v, low)),
+                                                  _mm512_shuffle_epi8(lut, _mm512_and_si512(_mm512_srli_epi16(v, 4), low)));
+            sum = _mm512_add_epi64(sum, _mm512_sad_epu8(bytes, _mm512_setzero_si512()));
+        }
+
+        uint64_t lanes[8];
+        _mm512_storeu_si512(lanes, sum);
+        uint64_t total = 0;
+        for (uint32_t l = 0; l < 8; ++l) total += lanes[l];
+        for (; i < count; ++i) total += popcount64(words[i]);
+        return size_t(total);
+    }
+
+    // set bits of words[0, count) as indices starting at base, returns how many were written
+    inline size_t compress_generic(const uint64_t* words, size_t count, uint32_t base, uint32_t* out)
+    {
+        size_t n = 0;
+        for (size_t i = 0; i < count; ++i)
+        {
+            uint64_t word = words[i];
+            const uint32_t first = base + uint32_t(i * WORD_BITS);
+            while (word)
+            {
+                out[n++] = first + lowest_bit64(word);
+                word &= word - 1;
+            }
+        }
+        return n;
+    }
+
+    //
+    // 16 candidate indices at a time, compressed by the mask and stored with a masked store.
+    // words with few bits set are quicker bit by bit
+    //
+    constexpr uint32_t SPARSE_WORD = 8;
+
+    CC_TARGET_AVX512 inline size_t compress_avx512(const uint64_t* words, size_t count, uint32_t base, uint32_t* out)
+    {
+        const __m512i iota = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+        const __m512i step = _mm512_set1_epi32(16);
+
+        size_t n = 0;
+        for (size_t i = 0; i < count; ++i)
+        {
+            uint64_t word = words[i];
+            const uint32_t first = base + uint32_t(i * WORD_BITS);
+            if (popcount64(word) < SPARSE_WORD)
+            {
+                for (; word; word &= word - 1)
+                {
+                    out[n++] = first + lowest_bit64(word);
+                }
+                continue;
+            }
+
+            __m512i candidates = _mm512_add_epi32(iota, _mm512_set1_epi32(int32_t(first)));
+            for (uint32_t part = 0; part < 4; ++part, word >>= 16)
+            {
+                const __mmask16 mask = __mmask16(word & 0xffff);
+                const uint32_t found = uint32_t(popcount64(mask));
+                _mm512_mask_storeu_epi32(out + n, __mmask16((1u << found) - 1), _mm512_maskz_compress_epi32(mask, candidates));
+                n += found;
+                candidates = _mm512_add_epi32(candidates, step);
+            }
+        }
+        return n;
+    }
+
+    using Popcount = size_t (*)(const uint64_t*, size_t);
+    using Compress = size_t (*)(const uint64_t*, size_t, uint32_t, uint32_t*);
+
+    // widest kernels the active simd level allows (see simd::level())
+    inline Popcount popcount_kernel()
+    {
+        const simd::Level level = simd::level();
+        return (level >= simd::Level::AVX512)? popcount_avx512 : ((level >= simd::Level::AVX2)? popcount_avx2 : popcount_generic);
+    }
+
+    inline Compress compress_kernel()
+    {
+        return (simd::level() >= simd::Level::AVX512)? compress_avx512 : compress_generic;
+    }
+}
+
+    class BitVector
+    {
+    public:
+        static constexpr size_t NONE = ~size_t(0);
+
+        explicit BitVector()
+            : size_(0)
+        {
+        }
+
+        explicit BitVector(size_t count, bool value = false)
+            : size_(0)
+        {
+            resize(count, value);
+        }
+
+        size_t size() const                 { return size_; }
+
+        bool empty() const                  { return size_ == 0; }
+
+        size_t word_count() const           { return words_.size(); }
+
+        const uint64_t* words() const       { return words_.data(); }
+
+        bool test(size_t index) const       { return (words_[index / detail::WORD_BITS] >> (index % detail::WORD_BITS)) & 1; }
+
+        bool operator[](size_t index) const { return test(index); }
+
+        void set(size_t index)              { words_[index / detail::WORD_BITS] |= uint64_t(1) << (index % detail::WORD_BITS); }
+
+        void reset(size_t index)            { words_[index / detail::WORD_BITS] &= ~(uint64_t(1) << (index % detail::WORD_BITS)); }
+
+        void flip(size_t index)             { words_[index / detail::WORD_BITS] ^= uint64_t(1) << (index % detail::WORD_BITS); }
+
+        void set(size_t index, bool value)
+        {
+            uint64_t& word = words_[index / detail::WORD_BITS];
+            const uint64_t bit = uint64_t(1) << (index % detail::WORD_BITS);
+            word = (word & ~bit) | (value? bit : 0);
+        }
+
+        // 64 flags at once, bits [64 * index, 64 * index + 64)
+        uint64_t word(size_t index) const   { return words_[index]; }
+
+        void set_word(size_t index, uint64_t bits)
+        {
+            words_[index] = bits;
+            if (index + 1 == words_.size()) trim();
+        }
+
+        void push_back(bool value)
+        {
+            if (size_ % detail::WORD_BITS == 0)
+            {
+                words_.push_back(0);
+            }
+            ++size_;
+            set(size_ - 1, value);
+        }
+
+        void resize(size_t count, bool value = false)
+        {
+            const size_t old = size_;
+            if (value && old % detail::WORD_BITS != 0 && count > old)
+            {
+                words_[old / detail::WORD_BITS] |= ~uint64_t(0) << (old % detail::WORD_BITS);
+            }
+            words_.resize((count + detail::WORD_BITS - 1) / detail::WORD_BITS, value? ~uint64_t(0) : 0);
+            size_ = count;
+            trim();
+        }
+
+        void clear()
+        {
+            words_.clear();
+            size_ = 0;
+        }
+
+        void fill(bool value)
+        {
+            const uint64_t bits = value? ~uint64_t(0) : 0;
+            for (uint64_t& word : words_) word = bits;
+            trim();
+        }
+
+        //
+        // from one byte per flag (non zero is set), the usual output of a vectorized test.
+        // 8 flags at a time: a high bit per non zero byte, gathered into a byte by a multiply
+        //
+        void pack(const uint8_t* flags, size_t count)
+        {
+            words_.resize_uninitialized((count + detail::WORD_BITS - 1) / detail::WORD_BITS);
+            size_ = count;
+
+            const size_t full = count / detail::WORD_BITS;
+            for (size_t w = 0; w < full; ++w)
+            {
+                uint64_t bits = 0;
+                for (uint32_t group = 0; group < 8; ++group)
+                {
+                    uint64_t bytes;
+                    std::memcpy(&bytes, flags + w * detail::WORD_BITS + group * 8, sizeof(bytes));
+                    const uint64_t nonzero = (((bytes & 0x7f7f7f7f7f7f7f7full) + 0x7f7f7f7f7f7f7f7full) | bytes) >> 7;
+                    bits |= (((nonzero & 0x0101010101010101ull) * 0x0102040810204080ull) >> 56) << (group * 8);
+                }
+                words_[w] = bits;
+            }
+
+            if (full < words_.size())
+            {
+                uint64_t bits = 0;
+                for (size_t i = full * detail::WORD_BITS; i < count; ++i)
+                {
+                    bits |= uint64_t(flags[i] != 0) << (i % detail::WORD_BITS);
+                }
+                words_[full] = bits;
+            }
+        }
+
+        size_t count() const
+        {
+            return detail::popcount_kernel()(words_.data(), words_.size());
+        }
+
+        bool any() const
+        {
+            return find_first() != NONE;
+        }
+
+        bool none() const                   { return !any(); }
+
+        bool all() const                    { return count() == size_; }
+
+        size_t find_first() const
+        {
+            return find_from(0);
+        }
+
+        // first set bit after index, NONE if there are no more
+        size_t find_next(size_t index) const
+        {
+            return find_from(index + 1);
+        }
+
+        // whole vector ops, other must have the same size
+        BitVector& operator&=(const BitVector& other)
+        {
+            uint64_t* a = words_.data();
+            const uint64_t* b = other.words_.data();
+            CC_SIMD_LOOP
+            for (size_t i = 0; i < words_.size(); ++i) a[i] &= b[i];
+            return *this;
+        }
+
+        BitVector& operator|=(const BitVector& other)
+        {
+            uint64_t* a = words_.data();
+            const uint64_t* b = other.words_.data();
+            CC_SIMD_LOOP
+            for (size_t i = 0; i < words_.size(); ++i) a[i] |= b[i];
+            return *this;
+        }
+
+        BitVector& operator^=(const BitVector& other)
+        {
+            uint64_t* a = words_.data();
+            const uint64_t* b = other.words_.data();
+            CC_SIMD_LOOP
+            for (size_t i = 0; i < words_.size(); ++i) a[i] ^= b[i];
+            return *this;
+        }
+
+        // clears the bits set in other (this & ~other)
+        BitVector& and_not(const BitVector& other)
+        {
+            uint64_t* a = words_.data();
+            const uint64_t* b = other.words_.data();
+            CC_SIMD_LOOP
+            for (size_t i = 0; i < words_.size(); ++i) a[i] &= ~b[i];
+            return *this;
+        }
+
+        BitVector& flip()
+        {
+            uint64_t* a = words_.data();
+            CC_SIMD_LOOP
+            for (size_t i = 0; i < words_.size(); ++i) a[i] = ~a[i];
+            trim();
+            return *this;
+        }
+
+        bool operator==(const BitVector& other) const
+        {
+            return size_ == other.size_ && std::memcmp(words_.data(), other.words_.data(), words_.size() * sizeof(uint64_t)) == 0;
+        }
+
+        bool operator!=(const BitVector& other) const { return !(*this == other); }
+
+        //
+        // indices of the set bits, ascending. chunks of words are counted in parallel, then
+        // each writes its indices at its prefix offset: the output is sized once and never zeroed
+        //
+        void indices(Vector<uint32_t>& out, ThreadPool& pool = ThreadPool::global()) const
+        {
+            const size_t chunks = (words_.size() + CHUNK_WORDS - 1) / CHUNK_WORDS;
+            const detail::Popcount popcount = detail::popcount_kernel();
+            const detail::Compress compress = detail::compress_kernel();
+
+            Vector<size_t> offsets(chunks + 1);
+            pool.parallel_for(size_t(0), chunks, [&](size_t first, size_t last)
+            {
+                for (size_t c = first; c < last; ++c)
+                {
+                    offsets[c + 1] = popcount(words_.data() + c * CHUNK_WORDS, chunk_words(c));
+                }
+            }, 1);
+
+            for (size_t c = 0; c < chunks; ++c) offsets[c + 1] += offsets[c];
+
+            out.resize_uninitialized(offsets[chunks]);
+            pool.parallel_for(size_t(0), chunks, [&](size_t first, size_t last)
+            {
+                for (size_t c = first; c < last; ++c)
+                {
+                    compress(words_.data() + c * CHUNK_WORDS, chunk_words(c), uint32_t(c * CHUNK_WORDS * detail::WORD_BITS), out.data() + offsets[c]);
+                }
+            }, 1);
+        }
+
+        Vector<uint32_t> indices(ThreadPool& pool = ThreadPool::global()) const
+        {
+            Vector<uint32_t> out;
+            indices(out, pool);
+            return out;
+        }
+
+    private:
+        // words per parallel task in indices(), 256K flags
+        static constexpr size_t CHUNK_WORDS = 4096;
+
+        Vector<uint64_t> words_;
+        size_t size_;
+
+        size_t chunk_words(size_t chunk) const
+        {
+            const size_t first = chunk * CHUNK_WORDS;
+            return (words_.size() - first < CHUNK_WORDS)? words_.size() - first : CHUNK_WORDS;
+        }
+
+        void trim()
+        {
+            if (size_ % detail::WORD_BITS != 0)
+            {
+                words_[words_.size() - 1] &= ~uint64_t(0) >> (detail::WORD_BITS - size_ % detail::WORD_BITS);
+            }
+        }
+
+        // empty words are skipped 8 at a time with an or-reduction
+        size_t find_from(size_t index) const
+        {
+            if (index >= size_)
+            {
+                return NONE;
+            }
+
+            size_t w = index / detail::WORD_BITS;
+            const uint64_t head = words_[w] & (~uint64_t(0) << (index % detail::WORD_BITS));
+            if (head)
+            {
+                return w * detail::WORD_BITS + detail::lowest_bit64(head);
+            }
+
+            for (++w; w + 8 <= words_.size(); w += 8)
+            {
+                uint64_t bits = 0;
+                for (size_t l = 0; l < 8; ++l) bits |= words_[w + l];
+                if (bits) break;
+            }
+
+            for (; w < words_.size(); ++w)
+            {
+                if (words_[w])
+                {
+                    return w * detail::WORD_BITS + detail::lowest_bit64(words_[w]);
+                }
+            }
+            return NONE;
+        }
+    };
+
+    inline BitVector operator&(BitVector a, const BitVector& b)   { return a &= b; }
+
+    inline BitVector operator|(BitVector a, const BitVector& b)   { return a |= b; }
+
+    inline BitVector operator^(BitVector a, const BitVector& b)   { return a ^= b; }
+}
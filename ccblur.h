@@ -0,0 +1,500 @@
+/*
+ * CCLib
+ *
+ * collection of utils i use in most projects.
+ * maybe it will evolve in a framework, maybe not
+ *
+ * (c) 2018 Carlo Casta <carlo.casta at gmail.com>
+ */
+#pragma once
+
+//
+// separable filtering of float images (bloom, dof, denoise pre-passes):
+//
+//   cc::blur::gaussian(hdr, bloom, 8.f, cc::blur::Edge::Clamp);        // parallel
+//   cc::blur::box(hdr, blurred, 16);                                   // O(1) per pixel, any radius
+//
+//   cc::blur::Kernel k{ cc::Vector<float>{ -1.f, 0.f, 1.f } };
+//   cc::blur::convolve(hdr, dx, k, cc::blur::Kernel{ cc::Vector<float>{ 1.f } });
+//
+// out[x] = sum(weights[k] * in[x + k - size / 2]): odd kernels are centered, even ones reach
+// one pixel further left. edges are addressed like textures: clamp to edge, wrap around or
+// mirrored repeat.
+// bands of rows are filtered horizontally into a per task ring and then down the columns
+// in narrow blocks, nothing image sized is allocated unless dst is src or not row-major.
+// other layouts are converted.
+//
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include "cclib.h"
+#include "ccvector.h"
+#include "ccsimd.h"
+#include "ccparallel.h"
+#include "ccimage.h"
+
+namespace cc
+{
+namespace blur
+{
+    using math::vec4;
+
+    enum class Edge : uint32_t
+    {
+        Clamp,
+        Wrap,
+        Mirror,
+        Count
+    };
+
+    inline const char* edge_name(Edge edge)
+    {
+        constexpr const char* names[] = { "clamp", "wrap", "mirror" };
+        return (edge < Edge::Count)? names[uint32_t(edge)] : "unknown";
+    }
+
+    // source index read for i in [0, size), any i
+    inline uint32_t address(int64_t i, uint32_t size, Edge edge)
+    {
+        const int64_t n = size;
+        switch (edge)
+        {
+        case Edge::Wrap:
+            i %= n;
+            return uint32_t(i < 0? i + n : i);
+
+        case Edge::Mirror:
+            i %= 2 * n;
+            i = (i < 0)? i + 2 * n : i;
+            return uint32_t(i < n? i : 2 * n - 1 - i);
+
+        default:
+            return uint32_t(math::clamp(i, int64_t(0), n - 1));
+        }
+    }
+
+    struct Kernel
+    {
+        Vector<float> weights;
+
+        uint32_t radius() const         { return uint32_t(weights.size() / 2); }
+
+        uint32_t taps() const           { return uint32_t(weights.size()); }
+
+        bool symmetric() const
+        {
+            for (uint32_t k = 0; k < taps() / 2; ++k)
+            {
+                if (weights[k] != weights[taps() - 1 - k]) return false;
+            }
+            return true;
+        }
+    };
+
+    // normalized, radius 0 means ceil(3 sigma). sigma <= 0 gives the identity
+    inline Kernel gaussian_kernel(float sigma, uint32_t radius = 0)
+    {
+        if (sigma <= 0.f)
+        {
+            return Kernel{ Vector<float>{ 1.f } };
+        }
+
+        radius = radius? radius : uint32_t(std::ceil(3.f * sigma));
+
+        Kernel kernel{ Vector<float>(2 * radius + 1) };
+        double sum = 0.;
+        for (uint32_t k = 0; k < kernel.taps(); ++k)
+        {
+            const float x = float(int32_t(k) - int32_t(radius));
+            kernel.weights[k] = std::exp(-x * x / (2.f * sigma * sigma));
+            sum += kernel.weights[k];
+        }
+
+        for (float& w : kernel.weights) w = float(w / sum);
+        return kernel;
+    }
+
+    inline Kernel box_kernel(uint32_t radius)
+    {
+        return Kernel{ Vector<float>(2 * radius + 1, 1.f / float(2 * radius + 1)) };
+    }
+
+namespace detail
+{
+    // bands of rows are filtered horizontally into a ring, then down the columns in blocks
+    // 64 pixels (1KB) wide: a block keeps its tap rows in L1/L2 from one output row to the next
+    constexpr uint32_t COLUMN_BLOCK = 64;
+    constexpr uint32_t ROW_BAND = 32;
+
+    // band rows are a quarter block longer than image rows: those are often a multiple of 4KB
+    // apart and the taps of a column block would all land in the same L1 sets
+    constexpr uint32_t ROW_PADDING = COLUMN_BLOCK / 4;
+
+    // floats accumulated per sweep over the taps, a row is split in chunks that stay in L1
+    constexpr size_t CHUNK = 1024;
+
+    // out[j] = sum(weights[k] * taps[k][j]) for j < count floats. symmetric kernels add
+    // mirrored taps first and take half the multiplies, odd ones around their center tap
+    CC_FORCEINLINE void convolve_body(const float* const* taps, const float* weights, uint32_t count_taps, bool symmetric, float* out, size_t count)
+    {
+        const uint32_t half = count_taps / 2;
+        alignas(64) float acc[CHUNK];
+
+        for (size_t first = 0; first < count; first += CHUNK)
+        {
+            const size_t n = math::min(CHUNK, count - first);
+
+            if (symmetric)
+            {
+                if (count_taps & 1)
+                {
+                    const float w = weights[half];
+                    const float* in = taps[half] + first;
+                    CC_SIMD_LOOP
+                    for (size_t j = 0; j < n; ++j) acc[j] = w * in[j];
+                }
+                else
+                {
+                    CC_SIMD_LOOP
+                    for (size_t j = 0; j < n; ++j) acc[j] = 0.f;
+                }
+
+                for (uint32_t k = 0; k < half; ++k)
+                {
+                    const float wk = weights[k];
+                    const float* a = taps[k] + first;
+                    const float* b = taps[count_taps - 1 - k] + first;
+                    CC_SIMD_LOOP
+                    for (size_t j = 0; j < n; ++j) acc[j] += wk * (a[j] + b[j]);
+                }
+            }
+            else
+            {
+                const float w = weights[0];
+                const float* in = taps[0] + first;
+                CC_SIMD_LOOP
+                for (size_t j = 0; j < n; ++j) acc[j] = w * in[j];
+
+                for (uint32_t k = 1; k < count_taps; ++k)
+                {
+                    const float wk = weights[k];
+                    const float* a = taps[k] + first;
+                    CC_SIMD_LOOP
+                    for (size_t j = 0; j < n; ++j) acc[j] += wk * a[j];
+                }
+            }
+
+            std::memcpy(out + first, acc, n * sizeof(float));
+        }
+    }
+
+    //
+    // box filter along a row of vec4: in holds count + 2 * radius pixels, out[x] is the mean
+    // of in[x .. x + 2 * radius]. sums are doubles so that adding and removing bright hdr
+    // pixels doesn't leave residue on dark ones
+    //
+    CC_FORCEINLINE void box_row_body(const float* in, uint32_t radius, float* out, size_t count)
+    {
+        const size_t window = 2 * size_t(radius) + 1;
+        const double scale = 1. / double(window);
+
+        double sums[4] = {};
+        for (size_t k = 0; k < window; ++k)
+        {
+            CC_SIMD_LOOP
+            for (uint32_t c = 0; c < 4; ++c) sums[c] += in[k * 4 + c];
+        }
+
+        CC_SIMD_LOOP
+        for (uint32_t c = 0; c < 4; ++c) out[c] = float(sums[c] * scale);
+
+        for (size_t x = 1; x < count; ++x)
+        {
+            const float* add = in + (x + window - 1) * 4;
+            const float* sub = in + (x - 1) * 4;
+            CC_SIMD_LOOP
+            for (uint32_t c = 0; c < 4; ++c)
+            {
+                sums[c] += double(add[c]) - double(sub[c]);
+                out[x * 4 + c] = float(sums[c] * scale);
+            }
+        }
+    }
+
+    // one step of a running box sum down a column block: emit, then slide the window
+    CC_FORCEINLINE void box_step_body(const float* add, const float* sub, double* sums, double scale, float* out, size_t count)
+    {
+        CC_SIMD_LOOP
+        for (size_t j = 0; j < count; ++j)
+        {
+            out[j] = float(sums[j] * scale);
+            sums[j] += double(add[j]) - double(sub[j]);
+        }
+    }
+
+#define CC_BLUR_KERNELS(TARGET, SUFFIX)                                                                                                 \
+    TARGET inline void convolve##SUFFIX(const float* const* taps, const float* weights, uint32_t count_taps, bool symmetric, float* out, size_t count) \
+    { convolve_body(taps, weights, count_taps, symmetric, out, count); }                                                              \
+    TARGET inline void box_row##SUFFIX(const float* in, uint32_t radius, float* out, size_t count)                                    \
+    { box_row_body(in, radius, out, count); }                                                                                           \
+    TARGET inline void box_step##SUFFIX(const float* add, const float* sub, double* sums, double scale, float* out, size_t count)      \
+    { box_step_body(add, sub, sums, scale, out, count); }
+
+    CC_BLUR_KERNELS(, _generic)
+    CC_BLUR_KERNELS(CC_TARGET_AVX2, _avx2)
+    CC_BLUR_KERNELS(CC_TARGET_AVX512, _avx512)
+
+#undef CC_BLUR_KERNELS
+
+    struct Kernels
+    {
+        void (*convolve)(const float* const*, const float*, uint32_t, bool, float*, size_t);
+        void (*box_row)(const float*, uint32_t, float*, size_t);
+        void (*box_step)(const float*, const float*, double*, double, float*, size_t);
+    };
+
+    // widest kernels the active simd level allows (see simd::level())
+    inline Kernels kernels()
+    {
+        const simd::Level level = simd::level();
+        if (level >= simd::Level::AVX512) return Kernels{ convolve_avx512, box_row_avx512, box_step_avx512 };
+        if (level >= simd::Level::AVX2)   return Kernels{ convolve_avx2, box_row_avx2, box_step_avx2 };
+        return Kernels{ convolve_generic, box_row_generic, box_step_generic };
+    }
+
+    inline const float* floats(const vec4* p)   { return p->v; }
+
+    inline float* floats(vec4* p)               { return p->v; }
+
+    // row with left and right pixels around it addressed by edge, width + left + right in out
+    inline void pad_row(const vec4* row, uint32_t width, uint32_t left, uint32_t right, Edge edge, vec4* out)
+    {
+        for (uint32_t x = 0; x < left; ++x)
+        {
+            out[x] = row[address(int64_t(x) - left, width, edge)];
+        }
+        for (uint32_t x = 0; x < right; ++x)
+        {
+            out[left + width + x] = row[address(int64_t(width) + x, width, edge)];
+        }
+        std::memcpy(out + left, row, width * sizeof(vec4));
+    }
+
+    //
+    // bands of rows in parallel. each task keeps a ring of horizontally filtered rows, band
+    // height plus span deep, and a state from make_state(). rows(state, first, count, slots)
+    // filters count source rows from first (edge addressed) into their slots, those shared
+    // with the previous band are kept. then columns(state, window, x, block width, y, band
+    // height, resume) runs on every column block, window[i] being the filtered source row
+    // y - top + i. resume is set when the task has just done the band above
+    //
+    template<typename MakeState, typename Rows, typename Columns>
+    inline void for_each_band(uint32_t width, uint32_t height, uint32_t top, uint32_t span, ThreadPool& pool, MakeState&& make_state, Rows&& rows, Columns&& columns)
+    {
+        const size_t pitch = size_t(width) + ROW_PADDING;
+        const size_t bands = (height + ROW_BAND - 1) / ROW_BAND;
+
+        // every call refills span rows before its first band: give it at least 4 * span rows
+        // of its own so that the refill stays a small part of the horizontal work
+        const size_t grain = math::max<size_t>(bands / (pool.size() * 4), (4 * size_t(span) + ROW_BAND - 1) / ROW_BAND);
+        pool.parallel_for(0, bands, [&](size_t first, size_t last)
+        {
+            auto state = make_state();
+            const uint32_t slots = math::min(ROW_BAND, height) + span;
+            Vector<vec4> ring(slots * pitch);
+            Vector<vec4*> window(slots);
+
+            const int64_t origin = int64_t(first * ROW_BAND) - top;
+            int64_t next = origin;
+            for (size_t b = first; b < last; ++b)
+            {
+                const uint32_t y = uint32_t(b * ROW_BAND);
+                const uint32_t h = math::min(ROW_BAND, height - y);
+                const int64_t top_row = int64_t(y) - top;
+                for (uint32_t i = 0; i < h + span; ++i)
+                {
+                    window[i] = ring.data() + size_t((top_row + i - origin) % slots) * pitch;
+                }
+
+                rows(state, next, uint32_t(top_row + h + span - next), window.data() + (next - top_row));
+                next = top_row + h + span;
+
+                for (uint32_t x = 0; x < width; x += COLUMN_BLOCK)
+                {
+                    columns(state, window.data(), x, math::min(COLUMN_BLOCK, width - x), y, h, b > first);
+                }
+            }
+        }, math::max<size_t>(grain, 1));
+    }
+
+    struct ConvolveState
+    {
+        Vector<vec4> padded;
+        Vector<const float*> taps;
+    };
+
+    inline void convolve_image(const Image<vec4>& in, Image<vec4>& out, const Kernel& horizontal, const Kernel& vertical, Edge edge, ThreadPool& pool)
+    {
+        const uint32_t width = in.width();
+        const uint32_t height = in.height();
+        const bool symmetric_x = horizontal.symmetric();
+        const bool symmetric_y = vertical.symmetric();
+        const uint32_t left = horizontal.radius();
+        const uint32_t right = horizontal.taps() - 1 - left;
+        const auto convolve = kernels().convolve;
+
+        for_each_band(width, height, vertical.radius(), vertical.taps() - 1, pool,
+            [&]()
+            {
+                return ConvolveState{ Vector<vec4>(size_t(width) + left + right), Vector<const float*>(math::max(horizontal.taps(), vertical.taps())) };
+            },
+            [&](ConvolveState& s, int64_t first, uint32_t count, vec4* const* slots)
+            {
+                for (uint32_t k = 0; k < horizontal.taps(); ++k) s.taps[k] = floats(s.padded.data() + k);
+
+                for (uint32_t i = 0; i < count; ++i)
+                {
+                    pad_row(in.row(address(first + i, height, edge)), width, left, right, edge, s.padded.data());
+                    convolve(s.taps.data(), horizontal.weights.data(), horizontal.taps(), symmetric_x, floats(slots[i]), size_t(width) * 4);
+                }
+            },
+            [&](ConvolveState& s, vec4* const* window, uint32_t x, uint32_t w, uint32_t y, uint32_t h, bool)
+            {
+                for (uint32_t i = 0; i < h; ++i)
+                {
+                    for (uint32_t k = 0; k < vertical.taps(); ++k) s.taps[k] = floats(window[i + k] + x);
+                    convolve(s.taps.data(), vertical.weights.data(), vertical.taps(), symmetric_y, floats(out.row(y + i) + x), size_t(w) * 4);
+                }
+            });
+    }
+
+    struct BoxState
+    {
+        Vector<vec4> padded;
+        Vector<double> sums;            // vertical running sums, carried from band to band
+    };
+
+    inline void box_image(const Image<vec4>& in, Image<vec4>& out, uint32_t radius_x, uint32_t radius_y, Edge edge, ThreadPool& pool)
+    {
+        const uint32_t width = in.width();
+        const uint32_t height = in.height();
+        const uint32_t window = 2 * radius_y + 1;
+        const double scale = 1. / double(window);
+        const Kernels k = kernels();
+
+        // one more row than the window slides the sums past the last row of a band
+        for_each_band(width, height, radius_y, window, pool,
+            [&]()
+            {
+                return BoxState{ Vector<vec4>(size_t(width) + 2 * radius_x), Vector<double>(size_t(width) * 4) };
+            },
+            [&](BoxState& s, int64_t first, uint32_t count, vec4* const* slots)
+            {
+                for (uint32_t i = 0; i < count; ++i)
+                {
+                    pad_row(in.row(address(first + i, height, edge)), width, radius_x, radius_x, edge, s.padded.data());
+                    k.box_row(floats(s.padded.data()), radius_x, floats(slots[i]), width);
+                }
+            },
+            [&](BoxState& s, vec4* const* rows, uint32_t x, uint32_t w, uint32_t y, uint32_t h, bool resume)
+            {
+                const size_t count = size_t(w) * 4;
+                double* sums = s.sums.data() + size_t(x) * 4;
+                if (!resume)
+                {
+                    for (size_t j = 0; j < count; ++j) sums[j] = 0.;
+                    for (uint32_t i = 0; i < window; ++i)
+                    {
+                        const float* row = floats(rows[i] + x);
+                        for (size_t j = 0; j < count; ++j) sums[j] += row[j];
+                    }
+                }
+
+                for (uint32_t i = 0; i < h; ++i)
+                {
+                    k.box_step(floats(rows[i + window] + x), floats(rows[i] + x), sums, scale, floats(out.row(y + i) + x), count);
+                }
+            });
+    }
+
+    inline const Image<vec4>& row_major(const Image<vec4>& image, Image<vec4>& storage)
+    {
+        if (image.layout() == ImageLayout::RowMajor)
+        {
+            return image;
+        }
+
+        storage = image.converted(ImageLayout::RowMajor);
+        return storage;
+    }
+
+    //
+    // filter(in, out) from row-major src into dst, resized to src if needed. bands read
+    // their neighbours' rows, so filtering in place goes through a temporary
+    //
+    template<typename Filter>
+    inline void separable(const Image<vec4>& src, Image<vec4>& dst, Filter&& filter)
+    {
+        const uint32_t width = src.width();
+        const uint32_t height = src.height();
+        if (dst.width() != width || dst.height() != height)
+        {
+            dst = Image<vec4>(width, height, dst.layout());
+        }
+
+        if (width == 0 || height == 0)
+        {
+            return;
+        }
+
+        Image<vec4> src_storage;
+        const Image<vec4>& in = row_major(src, src_storage);
+
+        if (dst.layout() == ImageLayout::RowMajor && dst.data() != in.data())
+        {
+            filter(in, dst);
+        }
+        else
+        {
+            Image<vec4> out(width, height);
+            filter(in, out);
+            dst = (dst.layout() == ImageLayout::RowMajor)? std::move(out) : out.converted(dst.layout());
+        }
+    }
+}
+
+    //
+    // horizontal then vertical kernel over src into dst, resized to src if needed. an empty
+    // kernel is the identity
+    //
+    inline void convolve(const Image<vec4>& src, Image<vec4>& dst, const Kernel& horizontal, const Kernel& vertical, Edge edge = Edge::Clamp, ThreadPool& pool = ThreadPool::global())
+    {
+        const Kernel identity{ Vector<float>{ 1.f } };
+        const Kernel& h = horizontal.taps()? horizontal : identity;
+        const Kernel& v = vertical.taps()? vertical : identity;
+        detail::separable(src, dst, [&](const Image<vec4>& in, Image<vec4>& out) { detail::convolve_image(in, out, h, v, edge, pool); });
+    }
+
+    inline void gaussian(const Image<vec4>& src, Image<vec4>& dst, float sigma, Edge edge = Edge::Clamp, ThreadPool& pool = ThreadPool::global())
+    {
+        const Kernel kernel = gaussian_kernel(sigma);
+        convolve(src, dst, kernel, kernel, edge, pool);
+    }
+
+    //
+    // mean over (2 * radius_x + 1) x (2 * radius_y + 1) pixels with running sums, the cost
+    // per pixel doesn't depend on the radius
+    //
+    inline void box(const Image<vec4>& src, Image<vec4>& dst, uint32_t radius_x, uint32_t radius_y, Edge edge = Edge::Clamp, ThreadPool& pool = ThreadPool::global())
+    {
+        detail::separable(src, dst, [&](const Image<vec4>& in, Image<vec4>& out) { detail::box_image(in, out, radius_x, radius_y, edge, pool); });
+    }
+
+    inline void box(const Image<vec4>& src, Image<vec4>& dst, uint32_t radius, Edge edge = Edge::Clamp, ThreadPool& pool = ThreadPool::global())
+    {
+        box(src, dst, radius, radius, edge, pool);
+    }
+}
+}
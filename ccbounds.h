@@ -0,0 +1,503 @@
+/*
+ * CCLib
+ *
+ * collection of utils i use in most projects.
+ * maybe it will evolve in a framework, maybe not
+ *
+ * (c) 2018 Carlo Casta <carlo.casta at gmail.com>
+ */
+#pragma once
+
+//
+// bounding volumes and statistics of point sets, simd inside each task and parallel
+// across them:
+//
+//   const cc::spatial::Bounds box = cc::spatial::bounds(points);
+//   const cc::spatial::Sphere sphere = cc::spatial::bounding_sphere(points);
+//   const cc::spatial::Moments m = cc::spatial::moments(points);   // centroid(), covariance()
+//   const cc::spatial::OBB obb = cc::spatial::obb(points);         // axes from PCA
+//
+// tasks always cover the same ranges (GRAIN points) and partial results are merged
+// in a fixed order, so sums come out bit for bit the same whatever the thread count (for
+// a given simd level, fma changes the rounding). they are taken relative to the first
+// point and kept in double across blocks
+//
+
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include "cclib.h"
+#include "ccvector.h"
+#include "ccsimd.h"
+#include "ccparallel.h"
+
+namespace cc
+{
+namespace spatial
+{
+    using math::vec3;
+    using math::mat3;
+
+    struct Bounds
+    {
+        vec3 lo, hi;
+    };
+
+    struct Sphere
+    {
+        vec3 center;
+        float radius;
+    };
+
+    // box along orthonormal axes, right handed, extent is half the size along each of them
+    struct OBB
+    {
+        vec3 center;
+        vec3 axes[3];
+        vec3 extent;
+    };
+
+    //
+    // first and second order moments around origin, merged by plain addition (partial
+    // moments must share the origin)
+    //
+    struct Moments
+    {
+        size_t count = 0;
+        vec3 origin;
+        double sum[3] = {};             // p - origin
+        double products[6] = {};        // xx, yy, zz, xy, xz, yz of p - origin
+
+        void merge(const Moments& other)
+        {
+            count += other.count;
+            for (uint32_t i = 0; i < 3; ++i) sum[i] += other.sum[i];
+            for (uint32_t i = 0; i < 6; ++i) products[i] += other.products[i];
+        }
+
+        vec3 centroid() const
+        {
+            const double n = double(count? count : 1);
+            return vec3(origin.x + float(sum[0] / n), origin.y + float(sum[1] / n), origin.z + float(sum[2] / n));
+        }
+
+        // population covariance (divided by count)
+        mat3 covariance() const
+        {
+            const double n = double(count? count : 1);
+            const double m[3] = { sum[0] / n, sum[1] / n, sum[2] / n };
+            const float xx = float(products[0] / n - m[0] * m[0]);
+            const float yy = float(products[1] / n - m[1] * m[1]);
+            const float zz = float(products[2] / n - m[2] * m[2]);
+            const float xy = float(products[3] / n - m[0] * m[1]);
+            const float xz = float(products[4] / n - m[0] * m[2]);
+            const float yz = float(products[5] / n - m[1] * m[2]);
+            return mat3(vec3(xx, xy, xz), vec3(xy, yy, yz), vec3(xz, yz, zz));
+        }
+    };
+
+namespace detail
+{
+    constexpr uint32_t LANES = 16;
+
+    // points converted to SoA per round in moments()
+    constexpr uint32_t BLOCK = 256;
+
+    // points per task, fixed: the split (and so the summation order) can't follow the pool size
+    constexpr size_t GRAIN = size_t(1) << 16;
+
+    //
+    // LANES points are 3 * LANES consecutive floats, and float k always holds axis k % 3:
+    // min / max run straight on the array, no deinterleave
+    //
+    CC_FORCEINLINE Bounds box_body(const vec3* points, size_t count)
+    {
+        constexpr uint32_t W = 3 * LANES;
+        float lo[W], hi[W];
+        for (uint32_t k = 0; k < W; ++k)
+        {
+            lo[k] = FLT_MAX;
+            hi[k] = -FLT_MAX;
+        }
+
+        const float* flat = points[0].v;
+        const size_t full = count / LANES;
+        for (size_t i = 0; i < full; ++i)
+        {
+            const float* group = flat + i * W;
+            CC_SIMD_LOOP
+            for (uint32_t k = 0; k < W; ++k)
+            {
+                lo[k] = math::min(lo[k], group[k]);
+                hi[k] = math::max(hi[k], group[k]);
+            }
+        }
+
+        Bounds b{ vec3(FLT_MAX), vec3(-FLT_MAX) };
+        for (uint32_t k = 0; k < W; ++k)
+        {
+            b.lo[k % 3] = math::min(b.lo[k % 3], lo[k]);
+            b.hi[k % 3] = math::max(b.hi[k % 3], hi[k]);
+        }
+        for (size_t i = full * LANES; i < count; ++i)
+        {
+            b.lo = pmin(b.lo, points[i]);
+            b.hi = pmax(b.hi, points[i]);
+        }
+        return b;
+    }
+
+    // range of dot(p, axis) for each axis, as a box in that frame
+    CC_FORCEINLINE Bounds projected_box_body(const vec3* points, size_t count, const vec3* axes)
+    {
+        float lo[3][LANES], hi[3][LANES];
+        for (uint32_t a = 0; a < 3; ++a)
+        {
+            for (uint32_t l = 0; l < LANES; ++l)
+            {
+                lo[a][l] = FLT_MAX;
+                hi[a][l] = -FLT_MAX;
+            }
+        }
+
+        const vec3 u = axes[0], v = axes[1], w = axes[2];
+        const size_t full = count / LANES * LANES;
+        for (size_t i = 0; i < full; i += LANES)
+        {
+            const vec3* group = points + i;
+            CC_SIMD_LOOP
+            for (uint32_t l = 0; l < LANES; ++l)
+            {
+                const float x = group[l].x, y = group[l].y, z = group[l].z;
+                const float du = u.x * x + u.y * y + u.z * z;
+                const float dv = v.x * x + v.y * y + v.z * z;
+                const float dw = w.x * x + w.y * y + w.z * z;
+                lo[0][l] = math::min(lo[0][l], du); hi[0][l] = math::max(hi[0][l], du);
+                lo[1][l] = math::min(lo[1][l], dv); hi[1][l] = math::max(hi[1][l], dv);
+                lo[2][l] = math::min(lo[2][l], dw); hi[2][l] = math::max(hi[2][l], dw);
+            }
+        }
+
+        Bounds b{ vec3(FLT_MAX), vec3(-FLT_MAX) };
+        for (uint32_t a = 0; a < 3; ++a)
+        {
+            for (uint32_t l = 0; l < LANES; ++l)
+            {
+                b.lo[a] = math::min(b.lo[a], lo[a][l]);
+                b.hi[a] = math::max(b.hi[a], hi[a][l]);
+            }
+        }
+        for (size_t i = full; i < count; ++i)
+        {
+            const vec3 d(dot(u, points[i]), dot(v, points[i]), dot(w, points[i]));
+            b.lo = pmin(b.lo, d);
+            b.hi = pmax(b.hi, d);
+        }
+        return b;
+    }
+
+    // largest squared distance from center
+    CC_FORCEINLINE float farthest2_body(const vec3* points, size_t count, const vec3& center)
+    {
+        float far[LANES] = {};
+        const size_t full = count / LANES * LANES;
+        for (size_t i = 0; i < full; i += LANES)
+        {
+            const vec3* group = points + i;
+            CC_SIMD_LOOP
+            for (uint32_t l = 0; l < LANES; ++l)
+            {
+                const float dx = group[l].x - center.x, dy = group[l].y - center.y, dz = group[l].z - center.z;
+                far[l] = math::max(far[l], dx * dx + dy * dy + dz * dz);
+            }
+        }
+
+        float result = 0.f;
+        for (uint32_t l = 0; l < LANES; ++l) result = math::max(result, far[l]);
+        for (size_t i = full; i < count; ++i)
+        {
+            const vec3 d = points[i] - center;
+            result = math::max(result, dot(d, d));
+        }
+        return result;
+    }
+
+    //
+    // blocks go to SoA relative to the origin (zero padded to LANES, zeros add nothing),
+    // then nine sums with LANES partials each, in float within the block and double across
+    //
+    CC_FORCEINLINE void accumulate_body(const vec3* points, size_t count, Moments& moments)
+    {
+        float x[BLOCK], y[BLOCK], z[BLOCK];
+        const vec3 o = moments.origin;
+
+        for (size_t first = 0; first < count; first += BLOCK)
+        {
+            const uint32_t n = uint32_t(math::min<size_t>(BLOCK, count - first));
+            const uint32_t padded = (n + LANES - 1) & ~(LANES - 1);
+            const vec3* block = points + first;
+
+            CC_SIMD_LOOP
+            for (uint32_t i = 0; i < n; ++i)
+            {
+                x[i] = block[i].x - o.x;
+                y[i] = block[i].y - o.y;
+                z[i] = block[i].z - o.z;
+            }
+            for (uint32_t i = n; i < padded; ++i)
+            {
+                x[i] = y[i] = z[i] = 0.f;
+            }
+
+            float s[9][LANES] = {};
+            for (uint32_t i = 0; i < padded; i += LANES)
+            {
+                CC_SIMD_LOOP
+                for (uint32_t l = 0; l < LANES; ++l)
+                {
+                    const float px = x[i + l], py = y[i + l], pz = z[i + l];
+                    s[0][l] += px;
+                    s[1][l] += py;
+                    s[2][l] += pz;
+                    s[3][l] += px * px;
+                    s[4][l] += py * py;
+                    s[5][l] += pz * pz;
+                    s[6][l] += px * py;
+                    s[7][l] += px * pz;
+                    s[8][l] += py * pz;
+                }
+            }
+
+            for (uint32_t q = 0; q < 9; ++q)
+            {
+                float total = 0.f;
+                for (uint32_t l = 0; l < LANES; ++l) total += s[q][l];
+                if (q < 3) moments.sum[q] += double(total);
+                else moments.products[q - 3] += double(total);
+            }
+        }
+        moments.count += count;
+    }
+
+    //
+    // stride 3 loads only get full width vectors from avx2 on, so every kernel is built
+    // for each level and picked at runtime like the ccsimd ones
+    //
+#define CC_BOUNDS_KERNELS(TARGET, SUFFIX)                                                                                               \
+    TARGET inline Bounds box##SUFFIX(const vec3* points, size_t count)                          { return box_body(points, count); }    \
+    TARGET inline Bounds projected_box##SUFFIX(const vec3* points, size_t count, const vec3* axes)                                      \
+    { return projected_box_body(points, count, axes); }                                                                                \
+    TARGET inline float farthest2##SUFFIX(const vec3* points, size_t count, const vec3& center)                                        \
+    { return farthest2_body(points, count, center); }                                                                                  \
+    TARGET inline void accumulate##SUFFIX(const vec3* points, size_t count, Moments& moments)  { accumulate_body(points, count, moments); }
+
+    CC_BOUNDS_KERNELS(, _generic)
+    CC_BOUNDS_KERNELS(CC_TARGET_AVX2, _avx2)
+    CC_BOUNDS_KERNELS(CC_TARGET_AVX512, _avx512)
+
+#undef CC_BOUNDS_KERNELS
+
+    struct Kernels
+    {
+        Bounds (*box)(const vec3*, size_t);
+        Bounds (*projected_box)(const vec3*, size_t, const vec3*);
+        float (*farthest2)(const vec3*, size_t, const vec3&);
+        void (*accumulate)(const vec3*, size_t, Moments&);
+    };
+
+    inline Kernels kernels()
+    {
+        const simd::Level level = simd::level();
+        if (level >= simd::Level::AVX512) return Kernels{ box_avx512, projected_box_avx512, farthest2_avx512, accumulate_avx512 };
+        if (level >= simd::Level::AVX2)   return Kernels{ box_avx2, projected_box_avx2, farthest2_avx2, accumulate_avx2 };
+        return Kernels{ box_generic, projected_box_generic, farthest2_generic, accumulate_generic };
+    }
+
+    //
+    // cyclic jacobi on a symmetric 3x3, in double. eigenvectors end up in the columns of v
+    // and eigenvalues on the diagonal of a
+    //
+    inline void jacobi(double a[3][3], double v[3][3])
+    {
+        for (uint32_t i = 0; i < 3; ++i)
+        {
+            for (uint32_t j = 0; j < 3; ++j) v[i][j] = (i == j)? 1. : 0.;
+        }
+
+        for (uint32_t sweep = 0; sweep < 32; ++sweep)
+        {
+            const double off = a[0][1] * a[0][1] + a[0][2] * a[0][2] + a[1][2] * a[1][2];
+            const double diagonal = a[0][0] * a[0][0] + a[1][1] * a[1][1] + a[2][2] * a[2][2];
+            if (off <= 1e-30 * diagonal || off == 0.)
+            {
+                break;
+            }
+
+            constexpr uint32_t PAIRS[3][2] = { { 0, 1 }, { 0, 2 }, { 1, 2 } };
+            for (const auto& pair : PAIRS)
+            {
+                const uint32_t p = pair[0], q = pair[1];
+                if (a[p][q] == 0.)
+                {
+                    continue;
+                }
+
+                const double theta = (a[q][q] - a[p][p]) / (2. * a[p][q]);
+                const double t = ((theta >= 0.)? 1. : -1.) / (std::fabs(theta) + std::sqrt(theta * theta + 1.));
+                const double c = 1. / std::sqrt(t * t + 1.), s = t * c;
+
+                // a = J^T a J, v = v J with the rotation in the (p, q) plane
+                for (uint32_t k = 0; k < 3; ++k)
+                {
+                    const double akp = a[k][p], akq = a[k][q];
+                    a[k][p] = c * akp - s * akq;
+                    a[k][q] = s * akp + c * akq;
+                }
+                for (uint32_t k = 0; k < 3; ++k)
+                {
+                    const double apk = a[p][k], aqk = a[q][k];
+                    a[p][k] = c * apk - s * aqk;
+                    a[q][k] = s * apk + c * aqk;
+                }
+                for (uint32_t k = 0; k < 3; ++k)
+                {
+                    const double vkp = v[k][p], vkq = v[k][q];
+                    v[k][p] = c * vkp - s * vkq;
+                    v[k][q] = s * vkp + c * vkq;
+                }
+            }
+        }
+    }
+}
+
+    inline Bounds bounds(const vec3* points, size_t count, ThreadPool& pool = ThreadPool::global())
+    {
+        const Bounds empty{ vec3(FLT_MAX), vec3(-FLT_MAX) };
+        const detail::Kernels kernels = detail::kernels();
+        return pool.parallel_reduce(size_t(0), count, empty,
+            [points, &kernels](size_t first, size_t last) { return kernels.box(points + first, last - first); },
+            [](const Bounds& a, const Bounds& b) { return Bounds{ pmin(a.lo, b.lo), pmax(a.hi, b.hi) }; },
+            detail::GRAIN);
+    }
+
+    inline Moments moments(const vec3* points, size_t count, ThreadPool& pool = ThreadPool::global())
+    {
+        Moments empty;
+        empty.origin = (count > 0)? points[0] : vec3();
+        const detail::Kernels kernels = detail::kernels();
+        return pool.parallel_reduce(size_t(0), count, empty,
+            [points, &empty, &kernels](size_t first, size_t last)
+            {
+                Moments partial(empty);
+                kernels.accumulate(points + first, last - first, partial);
+                return partial;
+            },
+            [](Moments a, const Moments& b)
+            {
+                a.merge(b);
+                return a;
+            }, detail::GRAIN);
+    }
+
+    inline vec3 centroid(const vec3* points, size_t count, ThreadPool& pool = ThreadPool::global())
+    {
+        return moments(points, count, pool).centroid();
+    }
+
+    inline mat3 covariance(const vec3* points, size_t count, ThreadPool& pool = ThreadPool::global())
+    {
+        return moments(points, count, pool).covariance();
+    }
+
+    //
+    // eigenvectors of a covariance matrix, by decreasing variance (returned in variances if
+    // given). axes[2] is cross(axes[0], axes[1]) so the frame is right handed
+    //
+    inline void principal_axes(const mat3& covariance, vec3 axes[3], vec3* variances = nullptr)
+    {
+        double a[3][3], v[3][3];
+        for (uint32_t i = 0; i < 3; ++i)
+        {
+            for (uint32_t j = 0; j < 3; ++j) a[i][j] = double(covariance[i][j]);
+        }
+        detail::jacobi(a, v);
+
+        uint32_t order[3] = { 0, 1, 2 };
+        for (uint32_t i = 0; i < 3; ++i)
+        {
+            for (uint32_t j = i + 1; j < 3; ++j)
+            {
+                if (a[order[j]][order[j]] > a[order[i]][order[i]]) std::swap(order[i], order[j]);
+            }
+        }
+
+        for (uint32_t i = 0; i < 2; ++i)
+        {
+            axes[i] = normalize(vec3(float(v[0][order[i]]), float(v[1][order[i]]), float(v[2][order[i]])));
+        }
+        axes[2] = normalize(cross(axes[0], axes[1]));
+
+        if (variances)
+        {
+            *variances = vec3(float(a[order[0]][order[0]]), float(a[order[1]][order[1]]), float(a[order[2]][order[2]]));
+        }
+    }
+
+    // tight box along the given orthonormal axes
+    inline OBB obb(const vec3* points, size_t count, const vec3 axes[3], ThreadPool& pool = ThreadPool::global())
+    {
+        const Bounds empty{ vec3(FLT_MAX), vec3(-FLT_MAX) };
+        const detail::Kernels kernels = detail::kernels();
+        const Bounds range = pool.parallel_reduce(size_t(0), count, empty,
+            [points, axes, &kernels](size_t first, size_t last) { return kernels.projected_box(points + first, last - first, axes); },
+            [](const Bounds& a, const Bounds& b) { return Bounds{ pmin(a.lo, b.lo), pmax(a.hi, b.hi) }; },
+            detail::GRAIN);
+
+        OBB result;
+        const vec3 mid = (count > 0)? (range.lo + range.hi) * .5f : vec3();
+        result.center = axes[0] * mid.x + axes[1] * mid.y + axes[2] * mid.z;
+        result.extent = (count > 0)? (range.hi - range.lo) * .5f : vec3();
+        for (uint32_t i = 0; i < 3; ++i) result.axes[i] = axes[i];
+        return result;
+    }
+
+    // box along the principal axes of the points: moments, jacobi, then a projected min / max pass
+    inline OBB obb(const vec3* points, size_t count, ThreadPool& pool = ThreadPool::global())
+    {
+        vec3 axes[3];
+        principal_axes(covariance(points, count, pool), axes);
+        return obb(points, count, axes, pool);
+    }
+
+    //
+    // sphere around the box center reaching the farthest point: not the minimal one (at
+    // worst the box's circumscribed sphere) but two exact, parallel passes
+    //
+    inline Sphere bounding_sphere(const vec3* points, size_t count, ThreadPool& pool = ThreadPool::global())
+    {
+        if (count == 0)
+        {
+            return Sphere{ vec3(), 0.f };
+        }
+
+        const Bounds box = bounds(points, count, pool);
+        const vec3 center = (box.lo + box.hi) * .5f;
+        const detail::Kernels kernels = detail::kernels();
+        const float r2 = pool.parallel_reduce(size_t(0), count, 0.f,
+            [points, &center, &kernels](size_t first, size_t last) { return kernels.farthest2(points + first, last - first, center); },
+            [](float a, float b) { return math::max(a, b); },
+            detail::GRAIN);
+
+        // rounding in the sqrt may leave the farthest point a hair outside
+        return Sphere{ center, std::sqrt(r2) * (1.f + 2.f * FLT_EPSILON) };
+    }
+
+    inline Bounds bounds(const Vector<vec3>& points, ThreadPool& pool = ThreadPool::global())           { return bounds(points.data(), points.size(), pool); }
+
+    inline Moments moments(const Vector<vec3>& points, ThreadPool& pool = ThreadPool::global())         { return moments(points.data(), points.size(), pool); }
+
+    inline Sphere bounding_sphere(const Vector<vec3>& points, ThreadPool& pool = ThreadPool::global())  { return bounding_sphere(points.data(), points.size(), pool); }
+
+    inline OBB obb(const Vector<vec3>& points, ThreadPool& pool = ThreadPool::global())                 { return obb(points.data(), points.size(), pool); }
+}
+}
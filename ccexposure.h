@@ -0,0 +1,331 @@
+/*
+ * CCLib
+ *
+ * collection of utils i use in most projects.
+ * maybe it will evolve in a framework, maybe not
+ *
+ * (c) 2018 Carlo Casta <carlo.casta at gmail.com>
+ */
+#pragma once
+
+//
+// auto exposure from a log-luminance histogram:
+//
+//   cc::exposure::Adaptation eye;
+//   const auto histogram = cc::exposure::histogram(hdr);                     // parallel, one pass
+//   const float scale = cc::exposure::auto_exposure(histogram, {}, &eye, dt);
+//   out = cc::gfx::aces(pixel * scale);
+//
+// luminance is Rec.709 on linear rgb, alpha is ignored. samples are binned by EV
+// (log2 luminance) between Settings::min_ev and max_ev, out of range ones are clamped
+// to the first / last bin and black ones (luminance <= 2^-64) only go to bin 0.
+//
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include "cclib.h"
+#include "ccvector.h"
+#include "ccsimd.h"
+#include "ccparallel.h"
+#include "ccimage.h"
+
+namespace cc
+{
+namespace exposure
+{
+    using math::vec3;
+    using math::vec4;
+
+    constexpr uint32_t BINS = 128;
+
+    struct Settings
+    {
+        float min_ev = -16.f;           // histogram range
+        float max_ev = 16.f;
+        float low_percentile = .5f;     // darkest / brightest samples left out of the average
+        float high_percentile = .95f;
+        float key = .18f;               // the average is mapped here (middle grey)
+        float compensation = 0.f;       // EV added on top
+    };
+
+    struct Histogram
+    {
+        uint32_t bins[BINS];
+        uint64_t count;                 // every sample
+        uint64_t lit;                   // non black samples
+        double log_sum;                 // sum of their EV, clamped to the range
+        float min_ev;
+        float max_ev;
+
+        explicit Histogram(float min = -16.f, float max = 16.f)
+            : bins{}
+            , count(0)
+            , lit(0)
+            , log_sum(0.)
+            , min_ev(min)
+            , max_ev(max)
+        {
+        }
+
+        float bin_width() const         { return (max_ev - min_ev) / float(BINS); }
+
+        // EV at the lower edge of a bin
+        float bin_ev(uint32_t bin) const { return min_ev + float(bin) * bin_width(); }
+
+        void merge(const Histogram& other)
+        {
+            for (uint32_t i = 0; i < BINS; ++i) bins[i] += other.bins[i];
+            count += other.count;
+            lit += other.lit;
+            log_sum += other.log_sum;
+        }
+    };
+
+namespace detail
+{
+    // samples converted per round: luminance / bins in a vectorized loop, then the scatter
+    constexpr uint32_t BLOCK = 256;
+
+    // luminance at or below 2^-64 counts as black
+    constexpr int32_t BLACK_BITS = (127 - 64) << 23;
+
+    CC_FORCEINLINE float luminance(const vec3& rgb)     { return .2126f * rgb.x + .7152f * rgb.y + .0722f * rgb.z; }
+
+    CC_FORCEINLINE float luminance(const vec4& rgba)    { return .2126f * rgba.x + .7152f * rgba.y + .0722f * rgba.z; }
+
+    CC_FORCEINLINE int32_t float_bits(float x)
+    {
+        int32_t bits;
+        std::memcpy(&bits, &x, sizeof(bits));
+        return bits;
+    }
+
+    CC_FORCEINLINE float bits_float(int32_t bits)
+    {
+        float x;
+        std::memcpy(&x, &bits, sizeof(x));
+        return x;
+    }
+
+    //
+    // log2 good to ~1e-5 for normal positive x, branch free so that it vectorizes (std::log2
+    // doesn't without -ffast-math and libmvec): exponent from the bits, ln of the mantissa
+    // from the atanh series in s = (m - 1) / (m + 1), |s| < 1/3
+    //
+    CC_FORCEINLINE float fast_log2(float x)
+    {
+        const int32_t bits = float_bits(x);
+        const float e = float((bits >> 23) - 127);
+        const float m = bits_float((bits & 0x007fffff) | 0x3f800000);
+
+        const float s = (m - 1.f) / (m + 1.f);
+        const float s2 = s * s;
+        const float ln = 2.f * s * (1.f + s2 * (1.f / 3.f + s2 * (1.f / 5.f + s2 * (1.f / 7.f + s2 * (1.f / 9.f)))));
+        return e + ln * 1.44269504089f;
+    }
+
+    //
+    // luminance is clamped to [2^min_ev, 2^max_ev] before the log, as integers: positive
+    // floats order like their bits, and negatives / black drop to the low end. float
+    // compares here become branches that gcc threads the log through, and then it gives up
+    // vectorizing the loop
+    //
+    template<typename Pixel>
+    inline void accumulate(const Pixel* pixels, size_t count, Histogram& histogram)
+    {
+        const float scale = float(BINS) / (histogram.max_ev - histogram.min_ev);
+        const float min_ev = histogram.min_ev;
+        const int32_t low = float_bits(std::exp2(histogram.min_ev)), high = float_bits(std::exp2(histogram.max_ev));
+
+        int32_t bins[BLOCK];
+        float evs[BLOCK];               // clamped EV
+        int32_t lit[BLOCK];
+        for (size_t first = 0; first < count; first += BLOCK)
+        {
+            const uint32_t n = uint32_t(math::min<size_t>(BLOCK, count - first));
+            const Pixel* block = pixels + first;
+
+            CC_SIMD_LOOP
+            for (uint32_t i = 0; i < n; ++i)
+            {
+                const int32_t bits = float_bits(luminance(block[i]));
+                const float ev = fast_log2(bits_float(math::min(math::max(bits, low), high)));
+                bins[i] = math::min(math::max(int32_t((ev - min_ev) * scale), 0), int32_t(BINS - 1));
+                lit[i] = (bits > BLACK_BITS)? 1 : 0;
+                evs[i] = ev;
+            }
+
+            float log_sum = 0.f;
+            uint32_t lit_count = 0;
+            for (uint32_t i = 0; i < n; ++i)
+            {
+                ++histogram.bins[bins[i]];
+                lit_count += uint32_t(lit[i]);
+                log_sum += lit[i]? evs[i] : 0.f;
+            }
+            histogram.lit += lit_count;
+            histogram.log_sum += double(log_sum);
+        }
+        histogram.count += count;
+    }
+
+    template<typename Pixel>
+    inline Histogram histogram(const Pixel* pixels, size_t count, const Settings& settings, ThreadPool& pool)
+    {
+        // one partial histogram per task, merged in a fixed order: the result doesn't
+        // depend on scheduling
+        const Histogram empty(settings.min_ev, settings.max_ev);
+        return pool.parallel_reduce(size_t(0), count, empty, [pixels, &empty](size_t first, size_t last)
+        {
+            Histogram partial(empty);
+            accumulate(pixels + first, last - first, partial);
+            return partial;
+        },
+        [](Histogram a, const Histogram& b)
+        {
+            a.merge(b);
+            return a;
+        }, 64 * BLOCK);
+    }
+
+    template<typename Pixel>
+    inline Histogram histogram(const Image<Pixel>& image, const Settings& settings, ThreadPool& pool)
+    {
+        if (image.layout() == ImageLayout::RowMajor)
+        {
+            return histogram(image.data(), size_t(image.width()) * image.height(), settings, pool);
+        }
+
+        // tiled / morton storage has padding, gather rows instead
+        const Histogram empty(settings.min_ev, settings.max_ev);
+        return pool.parallel_reduce(size_t(0), size_t(image.height()), empty, [&image, &empty](size_t first, size_t last)
+        {
+            Histogram partial(empty);
+            Vector<Pixel> row(image.width());
+            for (size_t y = first; y < last; ++y)
+            {
+                for (uint32_t x = 0; x < image.width(); ++x) row[x] = image.at(x, uint32_t(y));
+                accumulate(row.data(), image.width(), partial);
+            }
+            return partial;
+        },
+        [](Histogram a, const Histogram& b)
+        {
+            a.merge(b);
+            return a;
+        });
+    }
+}
+
+    inline Histogram histogram(const vec3* pixels, size_t count, const Settings& settings = Settings(), ThreadPool& pool = ThreadPool::global())
+    {
+        return detail::histogram(pixels, count, settings, pool);
+    }
+
+    inline Histogram histogram(const vec4* pixels, size_t count, const Settings& settings = Settings(), ThreadPool& pool = ThreadPool::global())
+    {
+        return detail::histogram(pixels, count, settings, pool);
+    }
+
+    inline Histogram histogram(const Image<vec3>& image, const Settings& settings = Settings(), ThreadPool& pool = ThreadPool::global())
+    {
+        return detail::histogram(image, settings, pool);
+    }
+
+    inline Histogram histogram(const Image<vec4>& image, const Settings& settings = Settings(), ThreadPool& pool = ThreadPool::global())
+    {
+        return detail::histogram(image, settings, pool);
+    }
+
+    // geometric mean of the non black samples, 0 if there are none
+    inline float log_average(const Histogram& histogram)
+    {
+        return (histogram.lit > 0)? std::exp2(float(histogram.log_sum / double(histogram.lit))) : 0.f;
+    }
+
+    // luminance below which a fraction p of the samples lie (interpolated inside the bin)
+    inline float percentile(const Histogram& histogram, float p)
+    {
+        const double target = double(math::clamp(p, 0.f, 1.f)) * double(histogram.count);
+        double below = 0.;
+        for (uint32_t i = 0; i < BINS; ++i)
+        {
+            const double next = below + histogram.bins[i];
+            if (next >= target && histogram.bins[i] > 0)
+            {
+                const float t = float((target - below) / double(histogram.bins[i]));
+                return std::exp2(histogram.bin_ev(i) + t * histogram.bin_width());
+            }
+            below = next;
+        }
+        return std::exp2(histogram.max_ev);
+    }
+
+    //
+    // average luminance of the samples between the low and high percentiles, bins at their
+    // center EV and partially covered bins weighted by their share. bin 0 is left out
+    // when the range reaches it: it holds black samples
+    //
+    inline float average(const Histogram& histogram, const Settings& settings = Settings())
+    {
+        const double low = double(math::clamp(settings.low_percentile, 0.f, 1.f)) * double(histogram.count);
+        const double high = double(math::clamp(settings.high_percentile, settings.low_percentile, 1.f)) * double(histogram.count);
+
+        double below = 0., weight = 0., ev = 0.;
+        for (uint32_t i = 0; i < BINS; ++i)
+        {
+            const double first = math::max(below, low);
+            const double last = math::min(below + histogram.bins[i], high);
+            if (i > 0 && last > first)
+            {
+                weight += last - first;
+                ev += (last - first) * double(histogram.bin_ev(i) + .5f * histogram.bin_width());
+            }
+            below += histogram.bins[i];
+        }
+        return (weight > 0.)? std::exp2(float(ev / weight)) : log_average(histogram);
+    }
+
+    // scale for the hdr values so that luminance lands on the key, feed it to gfx::aces / reinhard
+    inline float exposure(float luminance, const Settings& settings = Settings())
+    {
+        return (luminance > 0.f)? settings.key / luminance * std::exp2(settings.compensation) : 1.f;
+    }
+
+    //
+    // temporal smoothing of the adapted luminance, exponential in EV: after dt seconds a
+    // fraction 1 - e^(-dt * speed) of the gap is closed. brightening usually adapts faster
+    // than darkening. the first update snaps to the target
+    //
+    struct Adaptation
+    {
+        float speed_up = 3.f;
+        float speed_down = 1.f;
+        float luminance = 0.f;          // 0 until the first update
+
+        float update(float target, float dt)
+        {
+            if (luminance <= 0.f || target <= 0.f)
+            {
+                luminance = target;
+                return luminance;
+            }
+
+            const float current_ev = std::log2(luminance), target_ev = std::log2(target);
+            const float speed = (target_ev > current_ev)? speed_up : speed_down;
+            luminance = std::exp2(current_ev + (target_ev - current_ev) * (1.f - std::exp(-math::max(dt, 0.f) * speed)));
+            return luminance;
+        }
+
+        void reset()                    { luminance = 0.f; }
+    };
+
+    // percentile-trimmed average, smoothed through `adaptation` if given, turned into an exposure scale
+    inline float auto_exposure(const Histogram& histogram, const Settings& settings = Settings(), Adaptation* adaptation = nullptr, float dt = 0.f)
+    {
+        const float target = average(histogram, settings);
+        return exposure(adaptation? adaptation->update(target, dt) : target, settings);
+    }
+}
+}
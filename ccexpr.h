@@ -0,0 +1,299 @@
+/*
+ * CCLib
+ *
+ * collection of utils i use in most projects.
+ * maybe it will evolve in a framework, maybe not
+ *
+ * (c) 2018 Carlo Casta <carlo.casta at gmail.com>
+ */
+#pragma once
+
+//
+// lazy element-wise expressions over cc::Vector, evaluated in a single pass:
+//
+//   using namespace cc::expr;
+//   lazy(out) = lazy(a) * s + lazy(b);                     // one loop, no temporaries
+//   eval(out, srgb(aces(lazy(hdr) * exposure)), pool);     // same, split across a ThreadPool
+//
+// the output may alias an input only element for element (out[i] from in[i]).
+// operands of different lengths are evaluated over the shortest one.
+// saturate, clamp and lerp share their names with the generic cc::math templates,
+// which ADL also finds for vec types: call them qualified (cc::expr::saturate).
+//
+
+#include <tuple>
+#include <cstdint>
+#include <type_traits>
+#include "cclib.h"
+#include "ccvector.h"
+#include "ccparallel.h"
+
+#if defined(_OPENMP) && !defined(_MSC_VER)
+ #define CC_EXPR_SIMD _Pragma("omp simd")
+#else
+ #define CC_EXPR_SIMD
+#endif
+
+namespace cc
+{
+namespace expr
+{
+    template<typename D>
+    struct Expr
+    {
+        const D& self() const { return static_cast<const D&>(*this); }
+    };
+
+    template<typename T>
+    struct is_expr : std::is_base_of<Expr<T>, T> {};
+
+    template<typename T>
+    constexpr bool is_expr_v = is_expr<std::decay_t<T>>::value;
+
+    // broadcasts a single value (float, vec3, ...) to any index
+    template<typename T>
+    struct Scalar : Expr<Scalar<T>>
+    {
+        using value_type = T;
+
+        explicit Scalar(const T& v) : value(v) {}
+
+        const T& operator[](size_t) const { return value; }
+
+        size_t size() const { return 0; }
+
+        T value;
+    };
+
+    template<typename T>
+    struct is_scalar : std::false_type {};
+
+    template<typename T>
+    struct is_scalar<Scalar<T>> : std::true_type {};
+
+    //
+    // node computing f(args[i]...), children are held by value: views and small nodes only.
+    // its size is the shortest of its children, scalars left out
+    //
+    template<typename F, typename ... Args>
+    class Apply : public Expr<Apply<F, Args...>>
+    {
+    public:
+        using value_type = std::decay_t<decltype(std::declval<F>()(std::declval<typename Args::value_type>()...))>;
+
+        explicit Apply(F f, const Args& ... args) : f_(f), args_(args...) {}
+
+        value_type operator[](size_t i) const
+        {
+            return at(i, std::index_sequence_for<Args...>{});
+        }
+
+        size_t size() const
+        {
+            return size(std::index_sequence_for<Args...>{});
+        }
+
+    private:
+        F f_;
+        std::tuple<Args...> args_;
+
+        template<size_t ... I>
+        value_type at(size_t i, std::index_sequence<I...>) const
+        {
+            return f_(std::get<I>(args_)[i]...);
+        }
+
+        template<size_t ... I>
+        size_t size(std::index_sequence<I...>) const
+        {
+            size_t result = SIZE_MAX;
+            ((result = is_scalar<Args>::value? result : math::min(result, std::get<I>(args_).size())), ...);
+            return (result == SIZE_MAX)? 0 : result;
+        }
+    };
+
+    template<typename T>
+    class Terminal;
+
+    template<typename T, typename E>
+    inline void eval(Vector<T>& out, const Expr<E>& e);
+
+    //
+    // view over a cc::Vector, assigning an expression to it evaluates the expression
+    //
+    template<typename T>
+    class Terminal : public Expr<Terminal<T>>
+    {
+    public:
+        using value_type = T;
+
+        Terminal(T* data, size_t size, Vector<T>* owner = nullptr) : data_(data), size_(size), owner_(owner) {}
+
+        const T& operator[](size_t i) const { return data_[i]; }
+
+        size_t size() const { return size_; }
+
+        template<typename E>
+        Terminal& operator=(const Expr<E>& e)
+        {
+            if (owner_)
+            {
+                eval(*owner_, e);
+                data_ = owner_->data();
+                size_ = owner_->size();
+            }
+            else
+            {
+                // a raw view can't grow: stop at the shorter of the two
+                assign(e.self(), 0, is_scalar<E>::value? size_ : math::min(size_, e.self().size()));
+            }
+            return *this;
+        }
+
+        Terminal& operator=(const Terminal& other)
+        {
+            return operator=<Terminal>(other);
+        }
+
+        Terminal(const Terminal&) = default;
+
+        template<typename E>
+        void assign(const E& e, size_t first, size_t last)
+        {
+            T* out = data_;
+            CC_EXPR_SIMD
+            for (size_t i = first; i < last; ++i)
+            {
+                out[i] = e[i];
+            }
+        }
+
+    private:
+        T* data_;
+        size_t size_;
+        Vector<T>* owner_;
+    };
+
+    //
+    // read-only view, for const vectors and pointers: can be an operand but not a target
+    //
+    template<typename T>
+    class ConstTerminal : public Expr<ConstTerminal<T>>
+    {
+    public:
+        using value_type = T;
+
+        ConstTerminal(const T* data, size_t size) : data_(data), size_(size) {}
+        ConstTerminal(const ConstTerminal&) = default;
+        ConstTerminal& operator=(const ConstTerminal&) = delete;
+
+        const T& operator[](size_t i) const { return data_[i]; }
+
+        size_t size() const { return size_; }
+
+    private:
+        const T* data_;
+        size_t size_;
+    };
+
+    template<typename T>
+    inline Terminal<T> lazy(Vector<T>& v) { return Terminal<T>(v.data(), v.size(), &v); }
+
+    template<typename T>
+    inline ConstTerminal<T> lazy(const Vector<T>& v) { return ConstTerminal<T>(v.data(), v.size()); }
+
+    template<typename T>
+    inline Terminal<T> lazy(T* data, size_t size) { return Terminal<T>(data, size); }
+
+    template<typename T>
+    inline ConstTerminal<T> lazy(const T* data, size_t size) { return ConstTerminal<T>(data, size); }
+
+    template<typename T, typename E>
+    inline void eval(Vector<T>& out, const Expr<E>& e)
+    {
+        const size_t count = e.self().size();
+        if (out.size() != count)
+        {
+            out.resize(count);
+        }
+
+        Terminal<T>(out.data(), count).assign(e.self(), 0, count);
+    }
+
+    template<typename T, typename E>
+    inline void eval(Vector<T>& out, const Expr<E>& e, ThreadPool& pool, size_t grain = 0)
+    {
+        const size_t count = e.self().size();
+        if (out.size() != count)
+        {
+            out.resize(count);
+        }
+
+        Terminal<T> target(out.data(), count);
+        const E& expr = e.self();
+        pool.parallel_for(0, count, [&](size_t first, size_t last) { Terminal<T>(target).assign(expr, first, last); }, grain);
+    }
+
+namespace detail
+{
+    template<typename T>
+    inline const T& wrap(const Expr<T>& e) { return e.self(); }
+
+    template<typename T, typename = std::enable_if_t<!is_expr_v<T>>>
+    inline Scalar<T> wrap(const T& v) { return Scalar<T>(v); }
+
+    template<typename T>
+    using wrapped_t = std::decay_t<decltype(wrap(std::declval<const T&>()))>;
+
+    template<typename ... T>
+    constexpr bool any_expr_v = (is_expr_v<T> || ...);
+}
+
+    //
+    // generic node: apply(f, a, b, ...) evaluates f(a[i], b[i], ...)
+    //
+    template<typename F, typename ... Args, typename = std::enable_if_t<detail::any_expr_v<Args...>>>
+    inline Apply<F, detail::wrapped_t<Args>...> apply(F f, const Args& ... args)
+    {
+        return Apply<F, detail::wrapped_t<Args>...>(f, detail::wrap(args)...);
+    }
+
+#define CC_EXPR_BINARY_OPERATOR(op, name)                                                                  \
+    struct name { template<typename A, typename B> auto operator()(const A& a, const B& b) const { return a op b; } }; \
+    template<typename L, typename R, typename = std::enable_if_t<detail::any_expr_v<L, R>>>                \
+    inline auto operator op(const L& l, const R& r) { return apply(name{}, l, r); }
+
+    CC_EXPR_BINARY_OPERATOR(+, Add)
+    CC_EXPR_BINARY_OPERATOR(-, Sub)
+    CC_EXPR_BINARY_OPERATOR(*, Mul)
+    CC_EXPR_BINARY_OPERATOR(/, Div)
+
+#undef CC_EXPR_BINARY_OPERATOR
+
+    struct Neg { template<typename A> auto operator()(const A& a) const { return -a; } };
+
+    template<typename E>
+    inline auto operator-(const Expr<E>& e) { return apply(Neg{}, e.self()); }
+
+#define CC_EXPR_FUNCTION(fn, call)                                                                         \
+    struct fn##_fn { template<typename ... A> auto operator()(const A& ... a) const { return call(a...); } }; \
+    template<typename ... Args, typename = std::enable_if_t<detail::any_expr_v<Args...>>>                  \
+    inline auto fn(const Args& ... args) { return apply(fn##_fn{}, args...); }
+
+    CC_EXPR_FUNCTION(dot, math::dot)
+    CC_EXPR_FUNCTION(cross, math::cross)
+    CC_EXPR_FUNCTION(length, math::length)
+    CC_EXPR_FUNCTION(normalize, math::normalize)
+    CC_EXPR_FUNCTION(saturate, math::saturate)
+    CC_EXPR_FUNCTION(clamp, math::clamp)
+    CC_EXPR_FUNCTION(lerp, math::lerp)
+    CC_EXPR_FUNCTION(pmin, math::pmin)
+    CC_EXPR_FUNCTION(pmax, math::pmax)
+    CC_EXPR_FUNCTION(aces, gfx::aces)
+    CC_EXPR_FUNCTION(reinhard, gfx::reinhard)
+    CC_EXPR_FUNCTION(srgb, gfx::srgb)
+    CC_EXPR_FUNCTION(linear, gfx::linear)
+
+#undef CC_EXPR_FUNCTION
+}
+}
@@ -0,0 +1,471 @@
+/*
+ * CCLib
+ *
+ * collection of utils i use in most projects.
+ * maybe it will evolve in a framework, maybe not
+ *
+ * (c) 2018 Carlo Casta <carlo.casta at gmail.com>
+ */
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include "cclib.h"
+
+namespace cc
+{
+namespace detail
+{
+    // murmur3 finalizer, every input bit reaches every output bit
+    constexpr inline uint64_t hash_mix(uint64_t h)
+    {
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdull;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ull;
+        h ^= h >> 33;
+        return h;
+    }
+
+    // index of the lowest / highest set bit, mask != 0
+    inline uint32_t lowest_bit(uint32_t mask)
+    {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanForward(&index, mask);
+        return static_cast<uint32_t>(index);
+#else
+        return static_cast<uint32_t>(__builtin_ctz(mask));
+#endif
+    }
+
+    inline uint32_t highest_bit(uint32_t mask)
+    {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanReverse(&index, mask);
+        return static_cast<uint32_t>(index);
+#else
+        return 31 - static_cast<uint32_t>(__builtin_clz(mask));
+#endif
+    }
+
+    // float bits with -0 folded into +0, so that the two compare (and hash) equal
+    inline uint32_t float_bits(float x)
+    {
+        uint32_t bits;
+        std::memcpy(&bits, &x, sizeof(bits));
+        return (x == 0.f)? 0 : bits;
+    }
+
+    //
+    // hashing of float vectors. with cell == 0 keys are compared bit by bit (math::operator==
+    // is approximate and not transitive, it can't be hashed), otherwise each component is
+    // snapped to a grid of that size and keys in the same cell are equal: like are_equal()
+    // but two values closer than cell can still land in neighbouring cells
+    //
+    template<typename Vec, uint32_t N>
+    class VecHash
+    {
+    public:
+        explicit VecHash(float cell = 0.f)
+            : cell_(cell)
+            , inv_cell_((cell > 0.f)? 1.f / cell : 0.f)
+        {
+        }
+
+        float cell() const { return cell_; }
+
+        uint64_t operator()(const Vec& v) const
+        {
+            constexpr uint64_t K[4] = { 0x9e3779b97f4a7c15ull, 0xc2b2ae3d27d4eb4full, 0x165667b19e3779f9ull, 0x27d4eb2f165667c5ull };
+            uint64_t h = 0;
+            for (uint32_t i = 0; i < N; ++i)
+            {
+                h = (h ^ component(v.v[i])) * K[i];
+            }
+            return hash_mix(h);
+        }
+
+        bool equal(const Vec& a, const Vec& b) const
+        {
+            bool same = true;
+            for (uint32_t i = 0; i < N; ++i)
+            {
+                same &= (component(a.v[i]) == component(b.v[i]));
+            }
+            return same;
+        }
+
+    private:
+        float cell_;
+        float inv_cell_;
+
+        uint64_t component(float x) const
+        {
+            return (inv_cell_ > 0.f)? static_cast<uint64_t>(static_cast<int64_t>(std::floor(x * inv_cell_ + .5f))) : float_bits(x);
+        }
+    };
+}
+
+    //
+    // hashers: uint64_t operator()(key) plus equal(a, b), one object so that a hasher can
+    // carry state (the vec grid size). integers, enums, pointers and floats work out of the box
+    //
+    template<typename T>
+    struct Hash
+    {
+        static_assert(std::is_integral<T>::value || std::is_enum<T>::value, "no cc::Hash for this type");
+
+        uint64_t operator()(const T& key) const         { return detail::hash_mix(uint64_t(key)); }
+
+        bool equal(const T& a, const T& b) const        { return a == b; }
+    };
+
+    template<typename T>
+    struct Hash<T*>
+    {
+        uint64_t operator()(T* key) const               { return detail::hash_mix(reinterpret_cast<uintptr_t>(key)); }
+
+        bool equal(T* a, T* b) const                    { return a == b; }
+    };
+
+    template<>
+    struct Hash<float>
+    {
+        uint64_t operator()(float key) const            { return detail::hash_mix(detail::float_bits(key)); }
+
+        bool equal(float a, float b) const              { return detail::float_bits(a) == detail::float_bits(b); }
+    };
+
+    template<>
+    struct Hash<math::vec2> : detail::VecHash<math::vec2, 2>
+    {
+        explicit Hash(float cell = 0.f) : VecHash(cell) {}
+    };
+
+    template<>
+    struct Hash<math::vec3> : detail::VecHash<math::vec3, 3>
+    {
+        explicit Hash(float cell = 0.f) : VecHash(cell) {}
+    };
+
+    template<>
+    struct Hash<math::vec4> : detail::VecHash<math::vec4, 4>
+    {
+        explicit Hash(float cell = 0.f) : VecHash(cell) {}
+    };
+
+    //
+    // open addressing hash map, swiss table style: one control byte per slot (empty, deleted
+    // or the low 7 bits of the hash) probed 16 at a time with sse2, entries only touched on
+    // a 7-bit match. capacity is a power of two, control bytes and entries share one
+    // allocation, load factor is kept below 7/8. entry pointers are invalidated by rehash
+    //
+    template<typename K, typename V, typename H = Hash<K>>
+    class HashMap
+    {
+    public:
+        struct Entry
+        {
+            K key;
+            V value;
+        };
+
+        explicit HashMap(size_t count = 0, const H& hash = H())
+            : hash_(hash)
+            , size_(0)
+        {
+            init(capacity_for(count));
+        }
+
+        ~HashMap()
+        {
+            destroy_entries();
+            deallocate(block_);
+        }
+
+        HashMap(HashMap&& other)
+            : hash_(other.hash_)
+            , size_(0)
+        {
+            init(GROUP);
+            swap(other);
+        }
+
+        HashMap& operator=(HashMap&& other)
+        {
+            swap(other);
+            return *this;
+        }
+
+        HashMap(const HashMap&) = delete;
+        HashMap& operator=(const HashMap&) = delete;
+
+        void swap(HashMap& other)
+        {
+            std::swap(hash_, other.hash_);
+            std::swap(block_, other.block_);
+            std::swap(ctrl_, other.ctrl_);
+            std::swap(entries_, other.entries_);
+            std::swap(capacity_, other.capacity_);
+            std::swap(size_, other.size_);
+            std::swap(growth_left_, other.growth_left_);
+        }
+
+        size_t size() const                             { return size_; }
+
+        bool empty() const                              { return size_ == 0; }
+
+        size_t capacity() const                         { return capacity_; }
+
+        const H& hasher() const                         { return hash_; }
+
+        V* find(const K& key)                           { const size_t i = find_index(key); return (i != NONE)? &entries_[i].value : nullptr; }
+
+        const V* find(const K& key) const               { const size_t i = find_index(key); return (i != NONE)? &entries_[i].value : nullptr; }
+
+        bool contains(const K& key) const               { return find_index(key) != NONE; }
+
+        //
+        // V(args...) is only constructed if key is missing. returns the value for key and
+        // whether it was inserted
+        //
+        template<typename ... Args>
+        std::pair<V*, bool> try_emplace(const K& key, Args&& ... args)
+        {
+            const uint64_t h = hash_(key);
+            const size_t found = find_index(key, h);
+            if (found != NONE)
+            {
+                return { &entries_[found].value, false };
+            }
+
+            size_t i = free_index(h);
+            if (growth_left_ == 0 && ctrl_[i] == EMPTY)
+            {
+                rehash(capacity_for(size_ + 1));
+                i = free_index(h);
+            }
+
+            // construct first: if V throws, the slot stays free
+            new (entries_ + i) Entry{ key, V(std::forward<Args>(args)...) };
+            growth_left_ -= (ctrl_[i] == EMPTY)? 1 : 0;
+            set_ctrl(i, static_cast<int8_t>(h & 0x7f));
+            ++size_;
+            return { &entries_[i].value, true };
+        }
+
+        // false if key was already there (value left untouched)
+        bool insert(const K& key, const V& value)       { return try_emplace(key, value).second; }
+
+        V& operator[](const K& key)                     { return *try_emplace(key).first; }
+
+        bool erase(const K& key)
+        {
+            const size_t i = find_index(key);
+            if (i == NONE)
+            {
+                return false;
+            }
+
+            // a slot can go back to empty only if no probe ever went past it: true when the
+            // group around it already has an empty slot on both sides
+            const size_t before = (i - GROUP) & (capacity_ - 1);
+            const uint32_t empty_after = match(ctrl_ + i, EMPTY);
+            const uint32_t empty_before = match(ctrl_ + before, EMPTY);
+            const bool reusable = empty_after && empty_before && (lzcnt16(empty_before) + tzcnt16(empty_after) < GROUP);
+
+            entries_[i].~Entry();
+            set_ctrl(i, reusable? EMPTY : DELETED);
+            growth_left_ += reusable? 1 : 0;
+            --size_;
+            return true;
+        }
+
+        // keeps the allocation
+        void clear()
+        {
+            destroy_entries();
+            std::memset(ctrl_, EMPTY, capacity_ + GROUP);
+            size_ = 0;
+            growth_left_ = max_load(capacity_);
+        }
+
+        void reserve(size_t count)
+        {
+            if (count > size_ + growth_left_)
+            {
+                rehash(capacity_for(count));
+            }
+        }
+
+        // f(const K&, V&) on every entry, in slot order
+        template<typename F>
+        void for_each(F&& f)
+        {
+            for_each_entry(ctrl_, entries_, capacity_, [&f](Entry& entry) { f(static_cast<const K&>(entry.key), entry.value); });
+        }
+
+        template<typename F>
+        void for_each(F&& f) const
+        {
+            for_each_entry(ctrl_, entries_, capacity_, [&f](const Entry& entry) { f(entry.key, entry.value); });
+        }
+
+    private:
+        static constexpr size_t GROUP = 16;
+        static constexpr size_t NONE = ~size_t(0);
+        static constexpr int8_t EMPTY = -128;
+        static constexpr int8_t DELETED = -2;
+
+        H hash_;
+        void* block_;
+        int8_t* ctrl_;              // capacity_ + GROUP bytes, the tail mirrors the first group
+        Entry* entries_;
+        size_t capacity_;
+        size_t size_;
+        size_t growth_left_;        // insertions into empty slots before the next rehash
+
+        static size_t max_load(size_t capacity)         { return capacity - capacity / 8; }
+
+        static size_t capacity_for(size_t count)
+        {
+            size_t capacity = GROUP;
+            while (max_load(capacity) < count) capacity *= 2;
+            return capacity;
+        }
+
+        static size_t entries_offset(size_t capacity)
+        {
+            constexpr size_t align = alignof(Entry);
+            return (capacity + GROUP + align - 1) / align * align;
+        }
+
+        static constexpr size_t block_align()           { return math::max<size_t>(alignof(Entry), 16); }
+
+        static void deallocate(void* block)             { ::operator delete(block, std::align_val_t(block_align())); }
+
+        static uint32_t tzcnt16(uint32_t mask)          { return detail::lowest_bit(mask); }
+
+        static uint32_t lzcnt16(uint32_t mask)          { return 15 - detail::highest_bit(mask); }
+
+        static uint32_t match(const int8_t* group, int8_t value)
+        {
+            const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(group));
+            return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(value))));
+        }
+
+        // empty and deleted both have the top bit set
+        static uint32_t free_mask(const int8_t* group)
+        {
+            return static_cast<uint32_t>(_mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(group))));
+        }
+
+        static uint32_t full_mask(const int8_t* group)  { return free_mask(group) ^ 0xffff; }
+
+        void init(size_t capacity)
+        {
+            capacity_ = capacity;
+            block_ = ::operator new(entries_offset(capacity) + capacity * sizeof(Entry), std::align_val_t(block_align()));
+            ctrl_ = static_cast<int8_t*>(block_);
+            entries_ = reinterpret_cast<Entry*>(static_cast<char*>(block_) + entries_offset(capacity));
+            std::memset(ctrl_, EMPTY, capacity + GROUP);
+            growth_left_ = max_load(capacity);
+        }
+
+        void set_ctrl(size_t i, int8_t value)
+        {
+            ctrl_[i] = value;
+            if (i < GROUP)
+            {
+                ctrl_[capacity_ + i] = value;
+            }
+        }
+
+        template<typename E, typename F>
+        static void for_each_entry(const int8_t* ctrl, E* entries, size_t capacity, F&& f)
+        {
+            for (size_t g = 0; g < capacity; g += GROUP)
+            {
+                for (uint32_t full = full_mask(ctrl + g); full; full &= full - 1)
+                {
+                    f(entries[g + tzcnt16(full)]);
+                }
+            }
+        }
+
+        void destroy_entries()
+        {
+            if (!std::is_trivially_destructible<Entry>::value)
+            {
+                for_each_entry(ctrl_, entries_, capacity_, [](Entry& entry) { entry.~Entry(); });
+            }
+        }
+
+        //
+        // triangular probing over groups: with a power-of-two capacity the sequence visits
+        // every group once. there is always an empty slot, so a miss terminates
+        //
+        size_t find_index(const K& key) const           { return find_index(key, hash_(key)); }
+
+        size_t find_index(const K& key, uint64_t h) const
+        {
+            const size_t mask = capacity_ - 1;
+            const int8_t tag = static_cast<int8_t>(h & 0x7f);
+            size_t pos = (h >> 7) & mask;
+            for (size_t step = GROUP; ; pos = (pos + step) & mask, step += GROUP)
+            {
+                for (uint32_t hit = match(ctrl_ + pos, tag); hit; hit &= hit - 1)
+                {
+                    const size_t i = (pos + tzcnt16(hit)) & mask;
+                    if (hash_.equal(entries_[i].key, key))
+                    {
+                        return i;
+                    }
+                }
+                if (match(ctrl_ + pos, EMPTY))
+                {
+                    return NONE;
+                }
+            }
+        }
+
+        size_t free_index(uint64_t h) const
+        {
+            const size_t mask = capacity_ - 1;
+            size_t pos = (h >> 7) & mask;
+            for (size_t step = GROUP; ; pos = (pos + step) & mask, step += GROUP)
+            {
+                if (const uint32_t free = free_mask(ctrl_ + pos))
+                {
+                    return (pos + tzcnt16(free)) & mask;
+                }
+            }
+        }
+
+        // also used at the same capacity to flush deleted slots
+        void rehash(size_t capacity)
+        {
+            void* old_block = block_;
+            const int8_t* old_ctrl = ctrl_;
+            Entry* old_entries = entries_;
+            const size_t old_capacity = capacity_;
+
+            init(capacity);
+            for_each_entry(old_ctrl, old_entries, old_capacity, [this](Entry& entry)
+            {
+                const uint64_t h = hash_(entry.key);
+                const size_t i = free_index(h);
+                set_ctrl(i, static_cast<int8_t>(h & 0x7f));
+                new (entries_ + i) Entry(std::move(entry));
+                entry.~Entry();
+            });
+            growth_left_ -= size_;
+            deallocate(old_block);
+        }
+    };
+}
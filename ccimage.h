@@ -0,0 +1,278 @@
+/*
+ * CCLib
+ *
+ * collection of utils i use in most projects.
+ * maybe it will evolve in a framework, maybe not
+ *
+ * (c) 2018 Carlo Casta <carlo.casta at gmail.com>
+ */
+#pragma once
+
+#include <cstdint>
+#include "cclib.h"
+#include "ccvector.h"
+#include "ccparallel.h"
+
+namespace cc
+{
+namespace gfx
+{
+    // 8-bit unorm pixel, usually sRGB encoded
+    struct rgba8
+    {
+        uint8_t r, g, b, a;
+    };
+
+    constexpr inline bool operator==(const rgba8& x, const rgba8& y) { return x.r == y.r && x.g == y.g && x.b == y.b && x.a == y.a; }
+    constexpr inline bool operator!=(const rgba8& x, const rgba8& y) { return !(x == y); }
+
+    inline rgba8 to_rgba8(const vec4& v)
+    {
+        const vec4 c = saturate(v) * 255.f + .5f;
+        return rgba8{ uint8_t(c.r), uint8_t(c.g), uint8_t(c.b), uint8_t(c.a) };
+    }
+
+    constexpr inline vec4 to_vec4(const rgba8& p)
+    {
+        return vec4(p.r, p.g, p.b, p.a) * (1.f / 255.f);
+    }
+}
+
+    //
+    // RowMajor: plain scanlines
+    // Tiled:    TILE_SIZE x TILE_SIZE blocks stored contiguously, blocks in row-major order
+    // Morton:   z-order over power-of-two padded extents (square z-blocks, row-major if not square)
+    //
+    enum class ImageLayout : uint32_t
+    {
+        RowMajor,
+        Tiled,
+        Morton,
+        Count
+    };
+
+    inline const char* layout_name(ImageLayout layout)
+    {
+        constexpr const char* names[] = { "rowmajor", "tiled", "morton" };
+        return (layout < ImageLayout::Count)? names[uint32_t(layout)] : "unknown";
+    }
+
+namespace detail
+{
+    // 0000abcd -> 0a0b0c0d, 16 bits in. a byte table is cheaper than the shift/mask ladder
+    // and doesn't need bmi2 (pdep)
+    struct SpreadTable
+    {
+        constexpr SpreadTable() : bits{}
+        {
+            for (uint32_t i = 0; i < 256; ++i)
+                for (uint32_t b = 0; b < 8; ++b)
+                    bits[i] |= uint16_t(((i >> b) & 1) << (2 * b));
+        }
+
+        uint16_t bits[256];
+    };
+
+    inline uint32_t spread_bits(uint32_t x)
+    {
+        static constexpr SpreadTable table;
+        return table.bits[x & 0xff] | (uint32_t(table.bits[(x >> 8) & 0xff]) << 16);
+    }
+
+    constexpr inline uint32_t log2_ceil(uint32_t x)
+    {
+        uint32_t result = 0;
+        while ((1u << result) < x) ++result;
+        return result;
+    }
+}
+
+    //
+    // 2D image with a layout picked at construction. pixels are addressed by (x, y) whatever the
+    // layout, for_each_tile() walks TILE_SIZE blocks (in parallel if given a pool), which is
+    // the cache-friendly order for the tiled and morton layouts
+    //
+    template<typename T>
+    class Image
+    {
+    public:
+        using value_type = T;
+
+        static constexpr uint32_t TILE_SHIFT = 3;
+        static constexpr uint32_t TILE_SIZE = 1u << TILE_SHIFT;
+
+        struct Tile
+        {
+            uint32_t x, y;              // top-left pixel
+            uint32_t width, height;     // clipped to the image
+        };
+
+        explicit Image()
+            : width_(0)
+            , height_(0)
+            , layout_(ImageLayout::RowMajor)
+            , tiles_x_(0)
+            , tiles_y_(0)
+            , morton_shift_(0)
+            , morton_blocks_x_(0)
+        {
+        }
+
+        explicit Image(uint32_t width, uint32_t height, ImageLayout layout = ImageLayout::RowMajor, const T& value = T())
+            : width_(width)
+            , height_(height)
+            , layout_(layout)
+            , tiles_x_((width + TILE_SIZE - 1) >> TILE_SHIFT)
+            , tiles_y_((height + TILE_SIZE - 1) >> TILE_SHIFT)
+            , morton_shift_(0)
+            , morton_blocks_x_(0)
+        {
+            size_t count = size_t(width) * height;
+            if (layout == ImageLayout::Tiled)
+            {
+                count = size_t(tiles_x_) * tiles_y_ * TILE_SIZE * TILE_SIZE;
+            }
+            else if (layout == ImageLayout::Morton)
+            {
+                const uint32_t log_w = detail::log2_ceil(width);
+                const uint32_t log_h = detail::log2_ceil(height);
+                morton_shift_ = math::min(log_w, log_h);
+                morton_blocks_x_ = 1u << (log_w - morton_shift_);
+                count = size_t(1) << (log_w + log_h);
+            }
+
+            pixels_ = Vector<T>(count, value);
+        }
+
+        Image(const Image&) = default;
+        Image(Image&&) noexcept = default;
+
+        Image& operator=(Image&& other) noexcept
+        {
+            width_ = other.width_;
+            height_ = other.height_;
+            layout_ = other.layout_;
+            tiles_x_ = other.tiles_x_;
+            tiles_y_ = other.tiles_y_;
+            morton_shift_ = other.morton_shift_;
+            morton_blocks_x_ = other.morton_blocks_x_;
+            pixels_ = std::move(other.pixels_);
+            return *this;
+        }
+
+        uint32_t width() const          { return width_; }
+
+        uint32_t height() const         { return height_; }
+
+        ImageLayout layout() const      { return layout_; }
+
+        // storage, including the padding of tiled and morton layouts
+        T* data() const                 { return pixels_.data(); }
+
+        size_t storage_size() const     { return pixels_.size(); }
+
+        size_t offset(uint32_t x, uint32_t y) const
+        {
+            switch (layout_)
+            {
+            case ImageLayout::Tiled:
+                return ((size_t(y >> TILE_SHIFT) * tiles_x_ + (x >> TILE_SHIFT)) << (2 * TILE_SHIFT)) +
+                       ((y & (TILE_SIZE - 1)) << TILE_SHIFT) + (x & (TILE_SIZE - 1));
+
+            case ImageLayout::Morton:
+            {
+                const uint32_t mask = (1u << morton_shift_) - 1;
+                const size_t block = size_t(y >> morton_shift_) * morton_blocks_x_ + (x >> morton_shift_);
+                return (block << (2 * morton_shift_)) + (detail::spread_bits(x & mask) | (detail::spread_bits(y & mask) << 1));
+            }
+
+            default:
+                return size_t(y) * width_ + x;
+            }
+        }
+
+        T& at(uint32_t x, uint32_t y)                   { return pixels_[offset(x, y)]; }
+
+        const T& at(uint32_t x, uint32_t y) const       { return pixels_[offset(x, y)]; }
+
+        T& operator()(uint32_t x, uint32_t y)           { return at(x, y); }
+
+        const T& operator()(uint32_t x, uint32_t y) const { return at(x, y); }
+
+        // RowMajor only
+        T* row(uint32_t y) const                        { return pixels_.data() + size_t(y) * width_; }
+
+        // Tiled only: TILE_SIZE rows of TILE_SIZE pixels, also for clipped border tiles
+        T* tile_data(const Tile& tile) const            { return pixels_.data() + offset(tile.x, tile.y); }
+
+        void fill(const T& value)
+        {
+            for (T& pixel : pixels_) pixel = value;
+        }
+
+        uint32_t tiles_x() const        { return tiles_x_; }
+
+        uint32_t tiles_y() const        { return tiles_y_; }
+
+        size_t tile_count() const       { return size_t(tiles_x_) * tiles_y_; }
+
+        Tile tile(size_t index) const
+        {
+            const uint32_t x = uint32_t(index % tiles_x_) << TILE_SHIFT;
+            const uint32_t y = uint32_t(index / tiles_x_) << TILE_SHIFT;
+            return Tile{ x, y, math::min(TILE_SIZE, width_ - x), math::min(TILE_SIZE, height_ - y) };
+        }
+
+        // f(const Tile&) on every tile, row of tiles by row of tiles
+        template<typename F>
+        void for_each_tile(F&& f) const
+        {
+            for (size_t i = 0; i < tile_count(); ++i)
+            {
+                f(tile(i));
+            }
+        }
+
+        // f(const Tile&) from any pool thread, every tile exactly once
+        template<typename F>
+        void for_each_tile(ThreadPool& pool, F&& f, size_t grain = 0) const
+        {
+            pool.parallel_for(0, tile_count(), [this, &f](size_t first, size_t last)
+            {
+                for (size_t i = first; i < last; ++i) f(tile(i));
+            }, grain);
+        }
+
+        // copy in another layout, walking tiles so that both sides stay in cache
+        Image converted(ImageLayout layout) const
+        {
+            Image result(width_, height_, layout);
+            for_each_tile([this, &result](const Tile& t) { copy_tile(t, result); });
+            return result;
+        }
+
+        Image converted(ImageLayout layout, ThreadPool& pool) const
+        {
+            Image result(width_, height_, layout);
+            for_each_tile(pool, [this, &result](const Tile& t) { copy_tile(t, result); });
+            return result;
+        }
+
+    private:
+        uint32_t width_;
+        uint32_t height_;
+        ImageLayout layout_;
+        uint32_t tiles_x_;
+        uint32_t tiles_y_;
+        uint32_t morton_shift_;         // log2 of the z-ordered block side
+        uint32_t morton_blocks_x_;
+        Vector<T> pixels_;
+
+        void copy_tile(const Tile& t, Image& dst) const
+        {
+            for (uint32_t y = t.y; y < t.y + t.height; ++y)
+                for (uint32_t x = t.x; x < t.x + t.width; ++x)
+                    dst.at(x, y) = at(x, y);
+        }
+    };
+}
@@ -0,0 +1,1107 @@
+/*
+ * CCLib
+ *
+ * collection of utils i use in most projects.
+ * maybe it will evolve in a framework, maybe not
+ *
+ * (c) 2018 Carlo Casta <carlo.casta at gmail.com>
+ */
+#pragma once
+
+//
+// OBJ / PLY mesh loading:
+//
+//   cc::mesh::Mesh mesh;
+//   if (cc::mesh::load("bunny.ply", mesh)) { ... }
+//
+// files are memory-mapped and split in chunks on line boundaries, chunks are parsed in
+// parallel straight into the final arrays (a counting pass sizes them first), faces are
+// fan-triangulated into per-chunk index lists and concatenated at the end.
+//
+// OBJ keeps its separate position / uv / normal indices (relative indices are resolved),
+// PLY attributes are per vertex and only fill `indices`. groups, materials, lines and
+// points are ignored.
+//
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include "cclib.h"
+#include "ccvector.h"
+#include "ccparallel.h"
+
+#if defined(_WIN32)
+ #if !defined(WIN32_LEAN_AND_MEAN)
+  #define WIN32_LEAN_AND_MEAN
+ #endif
+ #if !defined(NOMINMAX)
+  #define NOMINMAX
+ #endif
+ #include <windows.h>
+#else
+ #include <fcntl.h>
+ #include <sys/mman.h>
+ #include <sys/stat.h>
+ #include <unistd.h>
+#endif
+
+namespace cc
+{
+    //
+    // read-only view of a whole file, invalid (null data) if the file can't be opened or is empty
+    //
+    class MappedFile
+    {
+    public:
+        explicit MappedFile(const char* path)
+            : data_(nullptr)
+            , size_(0)
+        {
+#if defined(_WIN32)
+            file_ = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+            mapping_ = nullptr;
+            LARGE_INTEGER size;
+            if (file_ != INVALID_HANDLE_VALUE && GetFileSizeEx(file_, &size) && size.QuadPart > 0)
+            {
+                mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+                if (mapping_)
+                {
+                    data_ = static_cast<const char*>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+                    size_ = data_? size_t(size.QuadPart) : 0;
+                }
+            }
+#else
+            const int fd = open(path, O_RDONLY);
+            struct stat info;
+            if (fd >= 0 && fstat(fd, &info) == 0 && info.st_size > 0)
+            {
+                void* view = mmap(nullptr, size_t(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+                if (view != MAP_FAILED)
+                {
+                    // chunks are read in parallel, ask for everything up front
+                    madvise(view, size_t(info.st_size), MADV_WILLNEED);
+                    data_ = static_cast<const char*>(view);
+                    size_ = size_t(info.st_size);
+                }
+            }
+            if (fd >= 0)
+            {
+                close(fd);
+            }
+#endif
+        }
+
+        ~MappedFile()
+        {
+#if defined(_WIN32)
+            if (data_) UnmapViewOfFile(data_);
+            if (mapping_) CloseHandle(mapping_);
+            if (file_ != INVALID_HANDLE_VALUE) CloseHandle(file_);
+#else
+            if (data_) munmap(const_cast<char*>(data_), size_);
+#endif
+        }
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        bool valid() const              { return data_ != nullptr; }
+
+        const char* data() const        { return data_; }
+
+        size_t size() const             { return size_; }
+
+    private:
+        const char* data_;
+        size_t size_;
+#if defined(_WIN32)
+        HANDLE file_;
+        HANDLE mapping_;
+#endif
+    };
+
+namespace mesh
+{
+    using math::vec2;
+    using math::vec3;
+
+    struct Mesh
+    {
+        Vector<vec3> positions;
+        Vector<vec3> normals;
+        Vector<vec2> uvs;
+
+        // 3 per triangle, into positions
+        Vector<uint32_t> indices;
+
+        // OBJ only, same length as indices (NO_INDEX where a corner has none). empty when
+        // the file has none, or when the attribute is per vertex (PLY)
+        Vector<uint32_t> uv_indices;
+        Vector<uint32_t> normal_indices;
+
+        static constexpr uint32_t NO_INDEX = UINT32_MAX;
+
+        size_t triangle_count() const   { return indices.size() / 3; }
+    };
+
+    // chunks smaller than this aren't worth a task
+    constexpr size_t DEFAULT_CHUNK_BYTES = size_t(1) << 20;
+
+namespace detail
+{
+    struct Span
+    {
+        const char* first;
+        const char* last;
+    };
+
+    // ~chunk_bytes pieces, each ending after a '\n' (or at end)
+    inline Vector<Span> split_lines(const char* begin, const char* end, size_t chunk_bytes)
+    {
+        Vector<Span> chunks;
+        for (const char* p = begin; p < end;)
+        {
+            const char* q = end;
+            if (size_t(end - p) > chunk_bytes)
+            {
+                q = static_cast<const char*>(std::memchr(p + chunk_bytes, '\n', size_t(end - p - chunk_bytes)));
+                q = q? q + 1 : end;
+            }
+            chunks.push_back(Span{ p, q });
+            p = q;
+        }
+        return chunks;
+    }
+
+    inline const char* line_end(const char* p, const char* end)
+    {
+        const char* eol = static_cast<const char*>(std::memchr(p, '\n', size_t(end - p)));
+        return eol? eol : end;
+    }
+
+    inline bool is_space(char c)    { return c == ' ' || c == '\t' || c == '\r'; }
+
+    inline bool is_digit(char c)    { return unsigned(c - '0') < 10; }
+
+    inline const char* skip_space(const char* p, const char* end)
+    {
+        while (p < end && is_space(*p)) ++p;
+        return p;
+    }
+
+    inline const char* skip_token(const char* p, const char* end)
+    {
+        while (p < end && !is_space(*p) && *p != '\n') ++p;
+        return p;
+    }
+
+    //
+    // from_chars-like float parsing: up to 19 significant digits are gathered in an integer and
+    // scaled once by an exact power of ten (exact result whenever the exponent is small,
+    // Clinger's fast path), everything else (inf, nan, hex) goes through strtod.
+    // returns the first character after the number, or nullptr if there is none
+    //
+    inline const char* parse_float(const char* p, const char* end, float& value)
+    {
+        static constexpr double POW10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                            1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+        const char* start = p;
+        const bool negative = (p < end && *p == '-');
+        if (p < end && (*p == '-' || *p == '+')) ++p;
+
+        uint64_t mantissa = 0;
+        int exponent = 0;
+        int digits = 0;
+        bool any = false;
+        for (; p < end && is_digit(*p); ++p, any = true)
+        {
+            if (digits < 19)
+            {
+                mantissa = mantissa * 10 + uint64_t(*p - '0');
+                digits += (mantissa != 0)? 1 : 0;
+            }
+            else
+            {
+                ++exponent;
+            }
+        }
+        if (p < end && *p == '.')
+        {
+            for (++p; p < end && is_digit(*p); ++p, any = true)
+            {
+                if (digits < 19)
+                {
+                    mantissa = mantissa * 10 + uint64_t(*p - '0');
+                    digits += (mantissa != 0)? 1 : 0;
+                    --exponent;
+                }
+            }
+        }
+
+        if (!any)
+        {
+            // inf / nan and friends, never on the hot path
+            char buffer[64];
+            const size_t length = math::min(size_t(skip_token(start, end) - start), sizeof(buffer) - 1);
+            std::memcpy(buffer, start, length);
+            buffer[length] = '\0';
+            char* parsed;
+            value = std::strtof(buffer, &parsed);
+            return (parsed != buffer)? start + (parsed - buffer) : nullptr;
+        }
+
+        if (p < end && (*p == 'e' || *p == 'E'))
+        {
+            const char* q = p + 1;
+            const bool negative_exponent = (q < end && *q == '-');
+            if (q < end && (*q == '-' || *q == '+')) ++q;
+            if (q < end && is_digit(*q))
+            {
+                int e = 0;
+                for (; q < end && is_digit(*q); ++q) e = math::min(e * 10 + (*q - '0'), 100000);
+                exponent += negative_exponent? -e : e;
+                p = q;
+            }
+        }
+
+        double result = double(mantissa);
+        if (mantissa == 0)
+        {
+            result = 0.;
+        }
+        else if (exponent >= -22 && exponent <= 22 && mantissa < (uint64_t(1) << 53))
+        {
+            result = (exponent < 0)? result / POW10[-exponent] : result * POW10[exponent];
+        }
+        else
+        {
+            result *= std::pow(10., double(exponent));
+        }
+
+        value = float(negative? -result : result);
+        return p;
+    }
+
+    inline const char* parse_int(const char* p, const char* end, int64_t& value)
+    {
+        const bool negative = (p < end && *p == '-');
+        if (p < end && (*p == '-' || *p == '+')) ++p;
+        if (p >= end || !is_digit(*p))
+        {
+            return nullptr;
+        }
+
+        int64_t result = 0;
+        for (; p < end && is_digit(*p); ++p)
+        {
+            if (result > (INT64_MAX - (*p - '0')) / 10)
+            {
+                return nullptr;
+            }
+            result = result * 10 + (*p - '0');
+        }
+        value = negative? -result : result;
+        return p;
+    }
+
+    // n floats separated by blanks, missing trailing values are left untouched
+    inline void parse_floats(const char* p, const char* end, float* values, int n)
+    {
+        for (int i = 0; i < n; ++i)
+        {
+            p = skip_space(p, end);
+            const char* next = (p < end)? parse_float(p, end, values[i]) : nullptr;
+            if (!next)
+            {
+                return;
+            }
+            p = next;
+        }
+    }
+
+    // concatenate per-chunk lists into one array, in chunk order
+    template<typename T, typename Chunk>
+    void gather(Vector<T>& out, const Vector<Chunk>& chunks, Vector<T> Chunk::* list, ThreadPool& pool)
+    {
+        Vector<size_t> offsets(chunks.size() + 1);
+        for (size_t c = 0; c < chunks.size(); ++c) offsets[c + 1] = offsets[c] + (chunks[c].*list).size();
+
+        out = Vector<T>(offsets[chunks.size()]);
+        pool.parallel_for(0, chunks.size(), [&](size_t first, size_t last)
+        {
+            for (size_t c = first; c < last; ++c)
+            {
+                const Vector<T>& from = chunks[c].*list;
+                if (!from.empty())
+                {
+                    std::memcpy(out.data() + offsets[c], from.data(), from.size() * sizeof(T));
+                }
+            }
+        }, 1);
+    }
+
+    //
+    // OBJ
+    //
+    struct ObjChunk
+    {
+        Span text;
+        size_t v, vt, vn;                   // counts, then first global element of this chunk
+        Vector<uint32_t> indices;
+        Vector<uint32_t> uv_indices;
+        Vector<uint32_t> normal_indices;
+        bool has_uv, has_normal;
+        bool failed;
+    };
+
+    // 0: not an attribute, 1: v, 2: vt, 3: vn
+    inline int obj_attribute(const char* p, const char* eol)
+    {
+        if (eol - p < 2 || p[0] != 'v')
+        {
+            return 0;
+        }
+        if (is_space(p[1])) return 1;
+        if (eol - p < 3 || !is_space(p[2])) return 0;
+        return (p[1] == 't')? 2 : (p[1] == 'n')? 3 : 0;
+    }
+
+    // 1-based or negative (relative to the current count) -> 0-based, NO_INDEX if out of range
+    inline uint32_t obj_index(int64_t index, size_t current, size_t total)
+    {
+        const int64_t resolved = (index > 0)? index - 1 : int64_t(current) + index;
+        return (index != 0 && resolved >= 0 && resolved < int64_t(total))? uint32_t(resolved) : Mesh::NO_INDEX;
+    }
+
+    inline void parse_obj_chunk(ObjChunk& chunk, Mesh& mesh)
+    {
+        const char* end = chunk.text.last;
+        size_t v = chunk.v, vt = chunk.vt, vn = chunk.vn;
+
+        for (const char* p = chunk.text.first; p < end;)
+        {
+            const char* eol = line_end(p, end);
+            const char* s = skip_space(p, eol);
+
+            switch (obj_attribute(s, eol))
+            {
+            case 1:
+            {
+                float xyz[3] = {};
+                parse_floats(s + 1, eol, xyz, 3);
+                mesh.positions[v++] = vec3(xyz[0], xyz[1], xyz[2]);
+                break;
+            }
+
+            case 2:
+            {
+                float uv[2] = {};
+                parse_floats(s + 2, eol, uv, 2);
+                mesh.uvs[vt++] = vec2(uv[0], uv[1]);
+                break;
+            }
+
+            case 3:
+            {
+                float xyz[3] = {};
+                parse_floats(s + 2, eol, xyz, 3);
+                mesh.normals[vn++] = vec3(xyz[0], xyz[1], xyz[2]);
+                break;
+            }
+
+            default:
+                if (eol - s >= 2 && s[0] == 'f' && is_space(s[1]))
+                {
+                    // v, v/vt, v//vn, v/vt/vn corners, fan-triangulated
+                    uint32_t corner[3][3];      // first, previous, current x position/uv/normal
+                    int corners = 0;
+                    for (const char* q = skip_space(s + 1, eol); q < eol && *q != '#'; q = skip_space(q, eol))
+                    {
+                        int64_t index[3] = { 0, 0, 0 };
+                        q = parse_int(q, eol, index[0]);
+                        if (!q)
+                        {
+                            chunk.failed = true;
+                            break;
+                        }
+                        for (int k = 1; k < 3 && q < eol && *q == '/'; ++k)
+                        {
+                            ++q;
+                            if (q < eol && *q != '/')
+                            {
+                                q = parse_int(q, eol, index[k]);
+                                if (!q)
+                                {
+                                    chunk.failed = true;
+                                    break;
+                                }
+                            }
+                        }
+                        if (chunk.failed)
+                        {
+                            break;
+                        }
+
+                        uint32_t* current = corner[math::min(corners, 2)];
+                        current[0] = obj_index(index[0], v, mesh.positions.size());
+                        current[1] = index[1]? obj_index(index[1], vt, mesh.uvs.size()) : Mesh::NO_INDEX;
+                        current[2] = index[2]? obj_index(index[2], vn, mesh.normals.size()) : Mesh::NO_INDEX;
+                        chunk.failed |= (current[0] == Mesh::NO_INDEX) || (index[1] && current[1] == Mesh::NO_INDEX) || (index[2] && current[2] == Mesh::NO_INDEX);
+                        chunk.has_uv |= (index[1] != 0);
+                        chunk.has_normal |= (index[2] != 0);
+
+                        if (++corners >= 3)
+                        {
+                            for (int k = 0; k < 3; ++k)
+                            {
+                                chunk.indices.push_back(corner[k][0]);
+                                chunk.uv_indices.push_back(corner[k][1]);
+                                chunk.normal_indices.push_back(corner[k][2]);
+                            }
+                            std::memcpy(corner[1], corner[2], sizeof(corner[2]));
+                        }
+                    }
+                }
+                break;
+            }
+
+            p = eol + 1;
+        }
+    }
+
+    //
+    // PLY
+    //
+    enum class PlyType : uint32_t
+    {
+        None, Int8, UInt8, Int16, UInt16, Int32, UInt32, Float32, Float64
+    };
+
+    inline PlyType ply_type(const char* p, const char* end)
+    {
+        const size_t length = size_t(end - p);
+        struct Name { const char* name; PlyType type; };
+        static constexpr Name names[] = {
+            { "char", PlyType::Int8 },      { "int8", PlyType::Int8 },
+            { "uchar", PlyType::UInt8 },    { "uint8", PlyType::UInt8 },
+            { "short", PlyType::Int16 },    { "int16", PlyType::Int16 },
+            { "ushort", PlyType::UInt16 },  { "uint16", PlyType::UInt16 },
+            { "int", PlyType::Int32 },      { "int32", PlyType::Int32 },
+            { "uint", PlyType::UInt32 },    { "uint32", PlyType::UInt32 },
+            { "float", PlyType::Float32 },  { "float32", PlyType::Float32 },
+            { "double", PlyType::Float64 }, { "float64", PlyType::Float64 } };
+        for (const Name& n : names)
+        {
+            if (std::strlen(n.name) == length && std::memcmp(n.name, p, length) == 0)
+            {
+                return n.type;
+            }
+        }
+        return PlyType::None;
+    }
+
+    inline uint32_t ply_size(PlyType type)
+    {
+        constexpr uint32_t sizes[] = { 0, 1, 1, 2, 2, 4, 4, 4, 8 };
+        return sizes[uint32_t(type)];
+    }
+
+    // one binary value, swapped if the file endianness differs from ours (little)
+    inline double ply_read(const char* p, PlyType type, bool swap)
+    {
+        unsigned char bytes[8];
+        const uint32_t size = ply_size(type);
+        for (uint32_t i = 0; i < size; ++i) bytes[i] = uint8_t(p[swap? size - 1 - i : i]);
+
+        switch (type)
+        {
+        case PlyType::Int8:     { int8_t x;   std::memcpy(&x, bytes, 1); return x; }
+        case PlyType::UInt8:    { uint8_t x;  std::memcpy(&x, bytes, 1); return x; }
+        case PlyType::Int16:    { int16_t x;  std::memcpy(&x, bytes, 2); return x; }
+        case PlyType::UInt16:   { uint16_t x; std::memcpy(&x, bytes, 2); return x; }
+        case PlyType::Int32:    { int32_t x;  std::memcpy(&x, bytes, 4); return x; }
+        case PlyType::UInt32:   { uint32_t x; std::memcpy(&x, bytes, 4); return x; }
+        case PlyType::Float32:  { float x;    std::memcpy(&x, bytes, 4); return x; }
+        case PlyType::Float64:  { double x;   std::memcpy(&x, bytes, 8); return x; }
+        default:                return 0.;
+        }
+    }
+
+    // list counts and indices: exact for every integer type, -1 for anything out of range (or NaN)
+    inline int64_t ply_read_int(const char* p, PlyType type, bool swap)
+    {
+        const double value = ply_read(p, type, swap);
+        return (value > -2147483649. && value < 4294967296.)? int64_t(value) : -1;
+    }
+
+    // vertex slots filled from PLY properties
+    enum PlySlot : int
+    {
+        PLY_X, PLY_Y, PLY_Z, PLY_NX, PLY_NY, PLY_NZ, PLY_U, PLY_V, PLY_SLOTS, PLY_IGNORED = PLY_SLOTS, PLY_INDICES
+    };
+
+    inline int ply_slot(const char* p, const char* end)
+    {
+        const size_t length = size_t(end - p);
+        struct Name { const char* name; int slot; };
+        static constexpr Name names[] = {
+            { "x", PLY_X }, { "y", PLY_Y }, { "z", PLY_Z }, { "nx", PLY_NX }, { "ny", PLY_NY }, { "nz", PLY_NZ },
+            { "u", PLY_U }, { "s", PLY_U }, { "texture_u", PLY_U }, { "v", PLY_V }, { "t", PLY_V }, { "texture_v", PLY_V },
+            { "vertex_indices", PLY_INDICES }, { "vertex_index", PLY_INDICES } };
+        for (const Name& n : names)
+        {
+            if (std::strlen(n.name) == length && std::memcmp(n.name, p, length) == 0)
+            {
+                return n.slot;
+            }
+        }
+        return PLY_IGNORED;
+    }
+
+    struct PlyProperty
+    {
+        PlyType type;
+        PlyType count_type;     // list properties only
+        int slot;
+    };
+
+    struct PlyElement
+    {
+        enum Kind { Vertex, Face, Other } kind;
+        size_t count;
+        Vector<PlyProperty> properties;
+    };
+
+    struct PlyHeader
+    {
+        enum Format { Ascii, BinaryLittle, BinaryBig } format;
+        Vector<PlyElement> elements;
+        const char* body;
+    };
+
+    inline bool parse_ply_header(const char* data, const char* end, PlyHeader& header)
+    {
+        if (end - data < 4 || std::memcmp(data, "ply", 3) != 0)
+        {
+            return false;
+        }
+
+        bool has_format = false;
+        for (const char* p = line_end(data, end) + 1; p < end;)
+        {
+            const char* eol = line_end(p, end);
+            const char* word = skip_space(p, eol);
+            const char* word_end = skip_token(word, eol);
+            const size_t length = size_t(word_end - word);
+            auto is = [&](const char* keyword) { return std::strlen(keyword) == length && std::memcmp(keyword, word, length) == 0; };
+
+            if (is("end_header"))
+            {
+                header.body = (eol < end)? eol + 1 : end;
+                return has_format;
+            }
+
+            const char* arg = skip_space(word_end, eol);
+            const char* arg_end = skip_token(arg, eol);
+            if (is("format"))
+            {
+                const size_t n = size_t(arg_end - arg);
+                has_format = true;
+                if (n == 5 && std::memcmp(arg, "ascii", 5) == 0)                          header.format = PlyHeader::Ascii;
+                else if (n == 20 && std::memcmp(arg, "binary_little_endian", 20) == 0)    header.format = PlyHeader::BinaryLittle;
+                else if (n == 17 && std::memcmp(arg, "binary_big_endian", 17) == 0)       header.format = PlyHeader::BinaryBig;
+                else return false;
+            }
+            else if (is("element"))
+            {
+                PlyElement element;
+                const size_t n = size_t(arg_end - arg);
+                element.kind = (n == 6 && std::memcmp(arg, "vertex", 6) == 0)? PlyElement::Vertex :
+                               (n == 4 && std::memcmp(arg, "face", 4) == 0)? PlyElement::Face : PlyElement::Other;
+                int64_t count = 0;
+                if (!parse_int(skip_space(arg_end, eol), eol, count) || count < 0)
+                {
+                    return false;
+                }
+                element.count = size_t(count);
+                header.elements.emplace_back(std::move(element));
+            }
+            else if (is("property"))
+            {
+                if (header.elements.empty())
+                {
+                    return false;
+                }
+
+                PlyProperty property{ PlyType::None, PlyType::None, PLY_IGNORED };
+                const char* name = arg;
+                if (size_t(arg_end - arg) == 4 && std::memcmp(arg, "list", 4) == 0)
+                {
+                    const char* count_type = skip_space(arg_end, eol);
+                    const char* count_type_end = skip_token(count_type, eol);
+                    const char* item_type = skip_space(count_type_end, eol);
+                    const char* item_type_end = skip_token(item_type, eol);
+                    property.count_type = ply_type(count_type, count_type_end);
+                    property.type = ply_type(item_type, item_type_end);
+                    name = skip_space(item_type_end, eol);
+                    if (property.count_type == PlyType::None)
+                    {
+                        return false;
+                    }
+                }
+                else
+                {
+                    property.type = ply_type(arg, arg_end);
+                    name = skip_space(arg_end, eol);
+                }
+                if (property.type == PlyType::None)
+                {
+                    return false;
+                }
+                property.slot = ply_slot(name, skip_token(name, eol));
+                header.elements[header.elements.size() - 1].properties.push_back(property);
+            }
+
+            p = eol + 1;
+        }
+        return false;
+    }
+
+    inline void store_vertex(Mesh& mesh, size_t i, const float (&slots)[PLY_SLOTS], bool normals, bool uvs)
+    {
+        mesh.positions[i] = vec3(slots[PLY_X], slots[PLY_Y], slots[PLY_Z]);
+        if (normals) mesh.normals[i] = vec3(slots[PLY_NX], slots[PLY_NY], slots[PLY_NZ]);
+        if (uvs) mesh.uvs[i] = vec2(slots[PLY_U], slots[PLY_V]);
+    }
+
+    // larger PLY list polygons are rejected
+    constexpr size_t MAX_POLYGON = 64;
+
+    struct PlyChunk
+    {
+        Span text;
+        size_t first_line;      // line count, then index of the first line of this chunk
+        Vector<uint32_t> indices;
+        bool failed;
+    };
+
+    // bytes taken by a binary record with lists, 0 if it runs past end or a count is bad
+    inline size_t ply_record_size(const char* p, const char* end, const PlyElement& element, bool swap)
+    {
+        const char* q = p;
+        for (const PlyProperty& property : element.properties)
+        {
+            if (property.count_type != PlyType::None)
+            {
+                if (size_t(end - q) < ply_size(property.count_type))
+                {
+                    return 0;
+                }
+                const int64_t count = ply_read_int(q, property.count_type, swap);
+                q += ply_size(property.count_type);
+                if (count < 0 || size_t(count) > size_t(end - q) / ply_size(property.type))
+                {
+                    return 0;
+                }
+                q += size_t(count) * ply_size(property.type);
+            }
+            else
+            {
+                if (size_t(end - q) < ply_size(property.type))
+                {
+                    return 0;
+                }
+                q += ply_size(property.type);
+            }
+        }
+        return size_t(q - p);
+    }
+
+    inline void fan(Vector<uint32_t>& out, const int64_t* polygon, size_t count, size_t vertices, bool& failed)
+    {
+        for (size_t k = 0; k < count; ++k)
+        {
+            failed |= (polygon[k] < 0 || polygon[k] >= int64_t(vertices));
+        }
+        for (size_t k = 2; k < count && !failed; ++k)
+        {
+            out.push_back(uint32_t(polygon[0]));
+            out.push_back(uint32_t(polygon[k - 1]));
+            out.push_back(uint32_t(polygon[k]));
+        }
+    }
+}
+
+    //
+    // parse OBJ text already in memory. chunk_bytes is the parallel split granularity
+    //
+    inline bool parse_obj(const char* data, size_t size, Mesh& mesh, ThreadPool& pool = ThreadPool::global(), size_t chunk_bytes = DEFAULT_CHUNK_BYTES)
+    {
+        const Vector<detail::Span> spans = detail::split_lines(data, data + size, chunk_bytes);
+        Vector<detail::ObjChunk> chunks(spans.size());
+
+        // pass 1: attribute counts per chunk, so that they can be parsed in place
+        pool.parallel_for(0, chunks.size(), [&](size_t first, size_t last)
+        {
+            for (size_t c = first; c < last; ++c)
+            {
+                detail::ObjChunk& chunk = chunks[c];
+                chunk.text = spans[c];
+                chunk.v = chunk.vt = chunk.vn = 0;
+                chunk.has_uv = chunk.has_normal = chunk.failed = false;
+                for (const char* p = chunk.text.first; p < chunk.text.last;)
+                {
+                    const char* eol = detail::line_end(p, chunk.text.last);
+                    switch (detail::obj_attribute(detail::skip_space(p, eol), eol))
+                    {
+                    case 1: ++chunk.v; break;
+                    case 2: ++chunk.vt; break;
+                    case 3: ++chunk.vn; break;
+                    default: break;
+                    }
+                    p = eol + 1;
+                }
+            }
+        }, 1);
+
+        size_t v = 0, vt = 0, vn = 0;
+        for (detail::ObjChunk& chunk : chunks)
+        {
+            const size_t counts[3] = { chunk.v, chunk.vt, chunk.vn };
+            chunk.v = v;
+            chunk.vt = vt;
+            chunk.vn = vn;
+            v += counts[0];
+            vt += counts[1];
+            vn += counts[2];
+        }
+
+        mesh.positions = Vector<vec3>(v);
+        mesh.uvs = Vector<vec2>(vt);
+        mesh.normals = Vector<vec3>(vn);
+
+        // pass 2: attributes in place, faces into per-chunk lists
+        pool.parallel_for(0, chunks.size(), [&](size_t first, size_t last)
+        {
+            for (size_t c = first; c < last; ++c) detail::parse_obj_chunk(chunks[c], mesh);
+        }, 1);
+
+        bool has_uv = false, has_normal = false;
+        for (const detail::ObjChunk& chunk : chunks)
+        {
+            if (chunk.failed)
+            {
+                return false;
+            }
+            has_uv |= chunk.has_uv;
+            has_normal |= chunk.has_normal;
+        }
+
+        detail::gather(mesh.indices, chunks, &detail::ObjChunk::indices, pool);
+        mesh.uv_indices = Vector<uint32_t>();
+        mesh.normal_indices = Vector<uint32_t>();
+        if (has_uv) detail::gather(mesh.uv_indices, chunks, &detail::ObjChunk::uv_indices, pool);
+        if (has_normal) detail::gather(mesh.normal_indices, chunks, &detail::ObjChunk::normal_indices, pool);
+        return true;
+    }
+
+    //
+    // parse a PLY file already in memory (ascii or binary, vertex and face elements)
+    //
+    inline bool parse_ply(const char* data, size_t size, Mesh& mesh, ThreadPool& pool = ThreadPool::global(), size_t chunk_bytes = DEFAULT_CHUNK_BYTES)
+    {
+        using namespace detail;
+
+        const char* end = data + size;
+        PlyHeader header;
+        if (!parse_ply_header(data, end, header))
+        {
+            return false;
+        }
+
+        // vertex attributes present, and at most one element of each kind
+        size_t vertices = 0;
+        bool normals = false, uvs = false, has_vertex = false;
+        for (const PlyElement& element : header.elements)
+        {
+            if (element.kind == PlyElement::Vertex)
+            {
+                if (has_vertex)
+                {
+                    return false;
+                }
+                has_vertex = true;
+                vertices = element.count;
+                for (const PlyProperty& property : element.properties)
+                {
+                    normals |= (property.slot >= PLY_NX && property.slot <= PLY_NZ);
+                    uvs |= (property.slot == PLY_U || property.slot == PLY_V);
+                }
+            }
+        }
+
+        mesh.positions = Vector<vec3>(vertices);
+        mesh.normals = Vector<vec3>(normals? vertices : 0);
+        mesh.uvs = Vector<vec2>(uvs? vertices : 0);
+        mesh.uv_indices = Vector<uint32_t>();
+        mesh.normal_indices = Vector<uint32_t>();
+
+        if (header.format == PlyHeader::Ascii)
+        {
+            // line numbers per chunk, then every line knows its element from the counts
+            const Vector<Span> spans = split_lines(header.body, end, chunk_bytes);
+            Vector<PlyChunk> chunks(spans.size());
+            pool.parallel_for(0, chunks.size(), [&](size_t first, size_t last)
+            {
+                for (size_t c = first; c < last; ++c)
+                {
+                    chunks[c].text = spans[c];
+                    chunks[c].failed = false;
+                    size_t lines = 0;
+                    for (const char* p = spans[c].first; p < spans[c].last; p = line_end(p, spans[c].last) + 1) ++lines;
+                    chunks[c].first_line = lines;
+                }
+            }, 1);
+
+            size_t line = 0;
+            for (PlyChunk& chunk : chunks)
+            {
+                const size_t lines = chunk.first_line;
+                chunk.first_line = line;
+                line += lines;
+            }
+
+            pool.parallel_for(0, chunks.size(), [&](size_t first, size_t last)
+            {
+                for (size_t c = first; c < last; ++c)
+                {
+                    PlyChunk& chunk = chunks[c];
+                    size_t line_index = chunk.first_line;
+                    for (const char* p = chunk.text.first; p < chunk.text.last && !chunk.failed; ++line_index)
+                    {
+                        const char* eol = line_end(p, chunk.text.last);
+
+                        size_t element_index = 0, element_base = 0;
+                        while (element_index < header.elements.size() && line_index >= element_base + header.elements[element_index].count)
+                        {
+                            element_base += header.elements[element_index++].count;
+                        }
+                        if (element_index == header.elements.size())
+                        {
+                            break;
+                        }
+
+                        const PlyElement& element = header.elements[element_index];
+                        float slots[PLY_SLOTS] = {};
+                        const char* q = p;
+                        for (const PlyProperty& property : element.properties)
+                        {
+                            q = skip_space(q, eol);
+                            if (property.count_type != PlyType::None)
+                            {
+                                int64_t count = 0;
+                                q = parse_int(q, eol, count);
+                                if (!q || count < 0 || count > int64_t(MAX_POLYGON))
+                                {
+                                    chunk.failed = true;
+                                    break;
+                                }
+                                int64_t polygon[MAX_POLYGON];
+                                for (int64_t k = 0; k < count && q; ++k)
+                                {
+                                    q = parse_int(skip_space(q, eol), eol, polygon[k]);
+                                }
+                                if (!q)
+                                {
+                                    chunk.failed = true;
+                                    break;
+                                }
+                                if (element.kind == PlyElement::Face && property.slot == PLY_INDICES)
+                                {
+                                    fan(chunk.indices, polygon, size_t(count), vertices, chunk.failed);
+                                }
+                            }
+                            else
+                            {
+                                float value = 0.f;
+                                q = (q < eol)? parse_float(q, eol, value) : nullptr;
+                                if (!q)
+                                {
+                                    chunk.failed = true;
+                                    break;
+                                }
+                                if (property.slot < PLY_SLOTS) slots[property.slot] = value;
+                            }
+                        }
+
+                        if (element.kind == PlyElement::Vertex && !chunk.failed)
+                        {
+                            store_vertex(mesh, line_index - element_base, slots, normals, uvs);
+                        }
+                        p = eol + 1;
+                    }
+                }
+            }, 1);
+
+            for (const PlyChunk& chunk : chunks)
+            {
+                if (chunk.failed)
+                {
+                    return false;
+                }
+            }
+            gather(mesh.indices, chunks, &PlyChunk::indices, pool);
+            return true;
+        }
+
+        // binary: fixed-size records are decoded in parallel straight away. elements with lists
+        // get a serial walk that only reads the counts to cut them in chunks, then the same
+        const bool swap = (header.format == PlyHeader::BinaryBig);
+        const char* p = header.body;
+        Vector<PlyChunk> chunks;
+        for (const PlyElement& element : header.elements)
+        {
+            bool fixed = true;
+            size_t stride = 0;
+            for (const PlyProperty& property : element.properties)
+            {
+                fixed &= (property.count_type == PlyType::None);
+                stride += ply_size(property.type);
+            }
+
+            if (fixed)
+            {
+                if (stride && element.count > size_t(end - p) / stride)
+                {
+                    return false;
+                }
+                if (element.kind == PlyElement::Vertex)
+                {
+                    const char* records = p;
+                    pool.parallel_for(0, element.count, [&](size_t first, size_t last)
+                    {
+                        for (size_t i = first; i < last; ++i)
+                        {
+                            float slots[PLY_SLOTS] = {};
+                            const char* field = records + i * stride;
+                            for (const PlyProperty& property : element.properties)
+                            {
+                                if (property.slot < PLY_SLOTS) slots[property.slot] = float(ply_read(field, property.type, swap));
+                                field += ply_size(property.type);
+                            }
+                            store_vertex(mesh, i, slots, normals, uvs);
+                        }
+                    }, math::max<size_t>(chunk_bytes / math::max<size_t>(stride, 1), 1));
+                }
+                p += stride * element.count;
+                continue;
+            }
+
+            const size_t first_chunk = chunks.size();
+            const char* chunk_first = p;
+            size_t chunk_record = 0;
+            for (size_t i = 0; i < element.count; ++i)
+            {
+                const size_t size = ply_record_size(p, end, element, swap);
+                if (!size)
+                {
+                    return false;
+                }
+                p += size;
+                if (size_t(p - chunk_first) >= chunk_bytes || i + 1 == element.count)
+                {
+                    PlyChunk& chunk = chunks.emplace_back();
+                    chunk.text = Span{ chunk_first, p };
+                    chunk.first_line = chunk_record;
+                    chunk.failed = false;
+                    chunk_first = p;
+                    chunk_record = i + 1;
+                }
+            }
+
+            // counts were checked by the walk above
+            pool.parallel_for(first_chunk, chunks.size(), [&](size_t first, size_t last)
+            {
+                for (size_t c = first; c < last; ++c)
+                {
+                    PlyChunk& chunk = chunks[c];
+                    size_t i = chunk.first_line;
+                    for (const char* q = chunk.text.first; q < chunk.text.last && !chunk.failed; ++i)
+                    {
+                        float slots[PLY_SLOTS] = {};
+                        for (const PlyProperty& property : element.properties)
+                        {
+                            if (property.count_type == PlyType::None)
+                            {
+                                if (property.slot < PLY_SLOTS) slots[property.slot] = float(ply_read(q, property.type, swap));
+                                q += ply_size(property.type);
+                                continue;
+                            }
+
+                            const size_t count = size_t(ply_read_int(q, property.count_type, swap));
+                            q += ply_size(property.count_type);
+                            if (element.kind == PlyElement::Face && property.slot == PLY_INDICES)
+                            {
+                                int64_t polygon[MAX_POLYGON];
+                                if (count > MAX_POLYGON)
+                                {
+                                    chunk.failed = true;
+                                    break;
+                                }
+                                for (size_t k = 0; k < count; ++k) polygon[k] = ply_read_int(q + k * ply_size(property.type), property.type, swap);
+                                fan(chunk.indices, polygon, count, vertices, chunk.failed);
+                            }
+                            q += count * ply_size(property.type);
+                        }
+
+                        if (element.kind == PlyElement::Vertex && !chunk.failed)
+                        {
+                            store_vertex(mesh, i, slots, normals, uvs);
+                        }
+                    }
+                }
+            }, 1);
+        }
+
+        for (const PlyChunk& chunk : chunks)
+        {
+            if (chunk.failed)
+            {
+                return false;
+            }
+        }
+        gather(mesh.indices, chunks, &PlyChunk::indices, pool);
+        return true;
+    }
+
+    inline bool load_obj(const char* path, Mesh& mesh, ThreadPool& pool = ThreadPool::global())
+    {
+        const MappedFile file(path);
+        return file.valid() && parse_obj(file.data(), file.size(), mesh, pool);
+    }
+
+    inline bool load_ply(const char* path, Mesh& mesh, ThreadPool& pool = ThreadPool::global())
+    {
+        const MappedFile file(path);
+        return file.valid() && parse_ply(file.data(), file.size(), mesh, pool);
+    }
+
+    // by extension (.obj / .ply, case-insensitive)
+    inline bool load(const char* path, Mesh& mesh, ThreadPool& pool = ThreadPool::global())
+    {
+        const size_t length = std::strlen(path);
+        if (length < 4 || path[length - 4] != '.')
+        {
+            return false;
+        }
+
+        char extension[3];
+        for (int i = 0; i < 3; ++i) extension[i] = char(path[length - 3 + i] | 0x20);
+        if (std::memcmp(extension, "obj", 3) == 0) return load_obj(path, mesh, pool);
+        if (std::memcmp(extension, "ply", 3) == 0) return load_ply(path, mesh, pool);
+        return false;
+    }
+}
+}
@@ -0,0 +1,520 @@
+/*
+ * CCLib
+ *
+ * collection of utils i use in most projects.
+ * maybe it will evolve in a framework, maybe not
+ *
+ * (c) 2018 Carlo Casta <carlo.casta at gmail.com>
+ */
+#pragma once
+
+#include <cstdint>
+#include <cmath>
+#include <cstring>
+#include "cclib.h"
+#include "ccvector.h"
+#include "cchash.h"
+#include "ccmeshio.h"
+
+namespace cc
+{
+namespace mesh
+{
+    // post-transform cache entries assumed by the optimizers and the stats
+    constexpr uint32_t DEFAULT_CACHE_SIZE = 16;
+    constexpr uint32_t MAX_CACHE_SIZE = 64;
+
+    enum class CacheOptimizer
+    {
+        Tipsify,
+        Forsyth,
+        Count
+    };
+
+    inline const char* cache_optimizer_name(CacheOptimizer optimizer)
+    {
+        constexpr const char* names[] = { "tipsify", "forsyth" };
+        return (optimizer < CacheOptimizer::Count)? names[static_cast<uint32_t>(optimizer)] : "unknown";
+    }
+
+    //
+    // FIFO cache simulation. acmr: transformed vertices per triangle (0.5 is a perfect regular
+    // grid, 3 no reuse at all), atvr: transformed per referenced vertex (1 is ideal)
+    //
+    struct CacheStats
+    {
+        float acmr;
+        float atvr;
+    };
+
+namespace detail
+{
+    constexpr size_t NO_TRIANGLE = ~size_t(0);
+
+    // triangles around each vertex: triangles[offsets[v], offsets[v] + counts[v])
+    struct Adjacency
+    {
+        Vector<uint32_t> offsets;
+        Vector<uint32_t> counts;
+        Vector<uint32_t> triangles;
+    };
+
+    inline void build_adjacency(const uint32_t* indices, size_t index_count, size_t vertex_count, Adjacency& adjacency)
+    {
+        Vector<uint32_t> counts(vertex_count);
+        Vector<uint32_t> offsets(vertex_count + 1);
+        for (size_t i = 0; i < index_count; ++i)
+        {
+            ++counts[indices[i]];
+        }
+        for (size_t v = 0; v < vertex_count; ++v)
+        {
+            offsets[v + 1] = offsets[v] + counts[v];
+            counts[v] = 0;
+        }
+
+        Vector<uint32_t> triangles(index_count);
+        for (size_t i = 0; i < index_count; ++i)
+        {
+            const uint32_t v = indices[i];
+            triangles[offsets[v] + counts[v]++] = static_cast<uint32_t>(i / 3);
+        }
+
+        adjacency.offsets = std::move(offsets);
+        adjacency.counts = std::move(counts);
+        adjacency.triangles = std::move(triangles);
+    }
+
+    // welding key: a vertex index, compared on position and on whatever per vertex attribute the mesh has
+    class VertexHash
+    {
+    public:
+        explicit VertexHash(const Mesh* mesh = nullptr, float tolerance = 0.f)
+            : mesh_(mesh)
+            , position_(tolerance)
+            , normals_(mesh && mesh->normals.size() == mesh->positions.size())
+            , uvs_(mesh && mesh->uvs.size() == mesh->positions.size())
+        {
+        }
+
+        uint64_t operator()(uint32_t v) const
+        {
+            uint64_t h = position_(mesh_->positions[v]);
+            if (normals_) h ^= attribute3_(mesh_->normals[v]) * 0x9e3779b97f4a7c15ull;
+            if (uvs_) h ^= attribute2_(mesh_->uvs[v]) * 0xc2b2ae3d27d4eb4full;
+            return h;
+        }
+
+        bool equal(uint32_t a, uint32_t b) const
+        {
+            return position_.equal(mesh_->positions[a], mesh_->positions[b]) &&
+                   (!normals_ || attribute3_.equal(mesh_->normals[a], mesh_->normals[b])) &&
+                   (!uvs_ || attribute2_.equal(mesh_->uvs[a], mesh_->uvs[b]));
+        }
+
+    private:
+        const Mesh* mesh_;
+        Hash<vec3> position_;
+        Hash<vec3> attribute3_;
+        Hash<vec2> attribute2_;
+        bool normals_;
+        bool uvs_;
+    };
+
+    // out[remap[v]] = in[v] for every kept vertex
+    template<typename T>
+    void remap_attribute(Vector<T>& data, const Vector<uint32_t>& remap, size_t count)
+    {
+        if (data.size() != remap.size())
+        {
+            return;
+        }
+
+        Vector<T> out(count);
+        for (size_t v = 0; v < remap.size(); ++v)
+        {
+            if (remap[v] != Mesh::NO_INDEX)
+            {
+                out[remap[v]] = data[v];
+            }
+        }
+        data = std::move(out);
+    }
+
+    // Forsyth, "Linear-speed vertex cache optimisation"
+    inline float forsyth_score(int32_t cache_position, uint32_t live, uint32_t cache_size)
+    {
+        if (live == 0)
+        {
+            return -1.f;
+        }
+
+        float score = 0.f;
+        if (cache_position >= 0)
+        {
+            // the last triangle's vertices get a fixed score so that its neighbours don't win by default
+            score = (cache_position < 3)? .75f : powf(1.f - float(cache_position - 3) / float(cache_size - 3), 1.5f);
+        }
+        return score + 2.f / sqrtf(float(live));
+    }
+
+    inline void forsyth(const uint32_t* indices, size_t index_count, size_t vertex_count, uint32_t cache_size, uint32_t* out)
+    {
+        const size_t triangle_count = index_count / 3;
+        Adjacency adjacency;
+        build_adjacency(indices, index_count, vertex_count, adjacency);
+        Vector<uint32_t>& live = adjacency.counts;
+
+        Vector<int32_t> cache_position(vertex_count, -1);
+        Vector<float> vertex_score(vertex_count);
+        Vector<float> triangle_score(triangle_count);
+        Vector<uint8_t> emitted(triangle_count);
+        for (size_t v = 0; v < vertex_count; ++v)
+        {
+            vertex_score[v] = forsyth_score(-1, live[v], cache_size);
+        }
+
+        size_t best = NO_TRIANGLE;
+        float best_score = -1.f;
+        for (size_t t = 0; t < triangle_count; ++t)
+        {
+            triangle_score[t] = vertex_score[indices[t * 3]] + vertex_score[indices[t * 3 + 1]] + vertex_score[indices[t * 3 + 2]];
+            if (triangle_score[t] > best_score)
+            {
+                best = t;
+                best_score = triangle_score[t];
+            }
+        }
+
+        uint32_t cache[MAX_CACHE_SIZE + 3];
+        uint32_t next_cache[MAX_CACHE_SIZE + 3];
+        uint32_t cache_count = 0;
+        size_t cursor = 0;
+        for (size_t written = 0; written < triangle_count; ++written)
+        {
+            // nothing in the cache has live triangles left: take the next one in input order
+            if (best == NO_TRIANGLE)
+            {
+                while (emitted[cursor]) ++cursor;
+                best = cursor;
+            }
+
+            const uint32_t* triangle = indices + best * 3;
+            emitted[best] = 1;
+            uint32_t next_count = 0;
+            for (uint32_t k = 0; k < 3; ++k)
+            {
+                const uint32_t v = triangle[k];
+                out[written * 3 + k] = v;
+
+                uint32_t* around = adjacency.triangles.data() + adjacency.offsets[v];
+                for (uint32_t i = 0; i < live[v]; ++i)
+                {
+                    if (around[i] == best)
+                    {
+                        around[i] = around[--live[v]];
+                        break;
+                    }
+                }
+
+                bool present = false;
+                for (uint32_t i = 0; i < next_count; ++i) present |= (next_cache[i] == v);
+                if (!present) next_cache[next_count++] = v;
+            }
+
+            // LRU: the triangle goes in front, what falls past cache_size is evicted
+            for (uint32_t i = 0; i < cache_count; ++i)
+            {
+                const uint32_t v = cache[i];
+                if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+                {
+                    next_cache[next_count++] = v;
+                }
+            }
+
+            for (uint32_t i = 0; i < next_count; ++i)
+            {
+                const uint32_t v = next_cache[i];
+                cache_position[v] = (i < cache_size)? int32_t(i) : -1;
+                const float score = forsyth_score(cache_position[v], live[v], cache_size);
+                const float delta = score - vertex_score[v];
+                vertex_score[v] = score;
+
+                const uint32_t* around = adjacency.triangles.data() + adjacency.offsets[v];
+                for (uint32_t j = 0; j < live[v]; ++j)
+                {
+                    triangle_score[around[j]] += delta;
+                }
+            }
+
+            cache_count = math::min(next_count, cache_size);
+            best = NO_TRIANGLE;
+            best_score = -1.f;
+            for (uint32_t i = 0; i < cache_count; ++i)
+            {
+                const uint32_t v = cache[i] = next_cache[i];
+                const uint32_t* around = adjacency.triangles.data() + adjacency.offsets[v];
+                for (uint32_t j = 0; j < live[v]; ++j)
+                {
+                    if (triangle_score[around[j]] > best_score)
+                    {
+                        best = around[j];
+                        best_score = triangle_score[around[j]];
+                    }
+                }
+            }
+        }
+    }
+
+    // Sander, Nehab, Barczak, "Fast triangle reordering for vertex locality and reduced overdraw"
+    inline void tipsify(const uint32_t* indices, size_t index_count, size_t vertex_count, uint32_t cache_size, uint32_t* out)
+    {
+        Adjacency adjacency;
+        build_adjacency(indices, index_count, vertex_count, adjacency);
+        Vector<uint32_t> live(adjacency.counts);
+
+        // v is in the cache while time - stamp[v] < cache_size
+        Vector<size_t> stamp(vertex_count);
+        size_t time = cache_size + 1;
+        Vector<uint8_t> emitted(index_count / 3);
+        Vector<uint32_t> dead_end(index_count);
+        size_t dead_end_size = 0;
+        size_t written = 0;
+        size_t cursor = 0;
+
+        auto next_live = [&]() -> size_t
+        {
+            // most recently used vertex that still has triangles, then input order
+            while (dead_end_size > 0)
+            {
+                const uint32_t v = dead_end[--dead_end_size];
+                if (live[v] > 0) return v;
+            }
+            while (cursor < vertex_count && live[cursor] == 0) ++cursor;
+            return cursor;
+        };
+
+        size_t fan = next_live();
+        while (fan < vertex_count)
+        {
+            const size_t fan_first = written;
+            const uint32_t* around = adjacency.triangles.data() + adjacency.offsets[fan];
+            for (uint32_t i = 0; i < adjacency.counts[fan]; ++i)
+            {
+                const uint32_t t = around[i];
+                if (emitted[t])
+                {
+                    continue;
+                }
+                emitted[t] = 1;
+                for (uint32_t k = 0; k < 3; ++k)
+                {
+                    const uint32_t v = indices[t * 3 + k];
+                    out[written++] = v;
+                    dead_end[dead_end_size++] = v;
+                    --live[v];
+                    if (time - stamp[v] > cache_size)
+                    {
+                        stamp[v] = time++;
+                    }
+                }
+            }
+
+            // best candidate among the vertices just emitted: still has triangles and would
+            // still be cached after fanning around it, the oldest such one first
+            size_t best = vertex_count;
+            size_t best_priority = 0;
+            for (size_t i = fan_first; i < written; ++i)
+            {
+                const uint32_t v = out[i];
+                if (live[v] == 0)
+                {
+                    continue;
+                }
+                size_t priority = 0;
+                if (time - stamp[v] + 2 * live[v] <= cache_size)
+                {
+                    priority = time - stamp[v];
+                }
+                if (best == vertex_count || priority > best_priority)
+                {
+                    best = v;
+                    best_priority = priority;
+                }
+            }
+            fan = (best < vertex_count)? best : next_live();
+        }
+    }
+}
+
+    //
+    // indexes a triangle soup: identical positions (or positions in the same tolerance-sized
+    // grid cell) share one vertex, the first one seen. returns the vertex count
+    //
+    inline size_t generate_indices(const vec3* soup, size_t count, float tolerance, Vector<vec3>& vertices, Vector<uint32_t>& indices)
+    {
+        HashMap<vec3, uint32_t> unique(count / 4, Hash<vec3>(tolerance));
+        Vector<vec3> out_vertices;
+        Vector<uint32_t> out_indices(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            const auto slot = unique.try_emplace(soup[i], static_cast<uint32_t>(out_vertices.size()));
+            if (slot.second)
+            {
+                out_vertices.push_back(soup[i]);
+            }
+            out_indices[i] = *slot.first;
+        }
+
+        vertices = std::move(out_vertices);
+        indices = std::move(out_indices);
+        return vertices.size();
+    }
+
+    //
+    // merges duplicate vertices: positions within tolerance (see Hash<vec3>), per vertex
+    // normals and uvs must match exactly. a mesh without indices is taken as a soup and gets
+    // them. false (mesh untouched) for OBJ-style per corner uv/normal indices
+    //
+    inline bool weld(Mesh& mesh, float tolerance = 0.f)
+    {
+        if (!mesh.uv_indices.empty() || !mesh.normal_indices.empty())
+        {
+            return false;
+        }
+
+        const size_t vertex_count = mesh.positions.size();
+        HashMap<uint32_t, uint32_t, detail::VertexHash> unique(vertex_count / 4, detail::VertexHash(&mesh, tolerance));
+        Vector<uint32_t> remap(vertex_count);
+        uint32_t welded = 0;
+        for (uint32_t v = 0; v < vertex_count; ++v)
+        {
+            const auto slot = unique.try_emplace(v, welded);
+            welded += slot.second? 1 : 0;
+            remap[v] = *slot.first;
+        }
+
+        if (mesh.indices.empty())
+        {
+            mesh.indices = Vector<uint32_t>(remap);
+        }
+        else
+        {
+            for (uint32_t& index : mesh.indices) index = remap[index];
+        }
+
+        // the first vertex of each group keeps its slot, the rest are dropped
+        for (uint32_t v = 0, next = 0; v < vertex_count; ++v)
+        {
+            if (remap[v] == next) ++next;
+            else remap[v] = Mesh::NO_INDEX;
+        }
+        detail::remap_attribute(mesh.positions, remap, welded);
+        detail::remap_attribute(mesh.normals, remap, welded);
+        detail::remap_attribute(mesh.uvs, remap, welded);
+        return true;
+    }
+
+    //
+    // reorders triangles (in place) for post-transform cache hits. tipsify is linear time and
+    // targets a FIFO cache like analyze_vertex_cache(), forsyth scores an LRU cache and is
+    // slower. cache_size is clamped to [4, MAX_CACHE_SIZE]. trailing indices of a partial
+    // triangle are left where they are
+    //
+    inline void optimize_vertex_cache(uint32_t* indices, size_t index_count, size_t vertex_count,
+                                      CacheOptimizer optimizer = CacheOptimizer::Tipsify, uint32_t cache_size = DEFAULT_CACHE_SIZE)
+    {
+        index_count -= index_count % 3;
+        if (index_count < 3 || vertex_count == 0)
+        {
+            return;
+        }
+
+        cache_size = math::clamp(cache_size, 4u, MAX_CACHE_SIZE);
+        Vector<uint32_t> out(index_count);
+        if (optimizer == CacheOptimizer::Forsyth)
+        {
+            detail::forsyth(indices, index_count, vertex_count, cache_size, out.data());
+        }
+        else
+        {
+            detail::tipsify(indices, index_count, vertex_count, cache_size, out.data());
+        }
+        std::memcpy(indices, out.data(), index_count * sizeof(uint32_t));
+    }
+
+    //
+    // renumbers vertices in order of first use so that vertex fetches walk memory forward.
+    // returns old -> new (NO_INDEX for vertices no triangle uses), indices are rewritten
+    //
+    inline Vector<uint32_t> optimize_vertex_fetch(uint32_t* indices, size_t index_count, size_t vertex_count, size_t* used = nullptr)
+    {
+        Vector<uint32_t> remap(vertex_count, Mesh::NO_INDEX);
+        uint32_t next = 0;
+        for (size_t i = 0; i < index_count; ++i)
+        {
+            uint32_t& slot = remap[indices[i]];
+            if (slot == Mesh::NO_INDEX)
+            {
+                slot = next++;
+            }
+            indices[i] = slot;
+        }
+        if (used)
+        {
+            *used = next;
+        }
+        return remap;
+    }
+
+    inline CacheStats analyze_vertex_cache(const uint32_t* indices, size_t index_count, size_t vertex_count, uint32_t cache_size = DEFAULT_CACHE_SIZE)
+    {
+        Vector<size_t> stamp(vertex_count);
+        Vector<uint8_t> referenced(vertex_count);
+        size_t time = cache_size;
+        size_t transformed = 0;
+        size_t unique = 0;
+        for (size_t i = 0; i < index_count; ++i)
+        {
+            const uint32_t v = indices[i];
+            if (time - stamp[v] >= cache_size)
+            {
+                stamp[v] = time++;
+                ++transformed;
+            }
+            unique += referenced[v]? 0 : 1;
+            referenced[v] = 1;
+        }
+
+        CacheStats stats;
+        stats.acmr = (index_count >= 3)? float(transformed) / float(index_count / 3) : 0.f;
+        stats.atvr = (unique > 0)? float(transformed) / float(unique) : 0.f;
+        return stats;
+    }
+
+    inline CacheStats analyze_vertex_cache(const Mesh& mesh, uint32_t cache_size = DEFAULT_CACHE_SIZE)
+    {
+        return analyze_vertex_cache(mesh.indices.data(), mesh.indices.size(), mesh.positions.size(), cache_size);
+    }
+
+    //
+    // the usual pipeline on an indexed mesh: triangle order for the cache, then vertex order
+    // for fetch. unused vertices are dropped, unindexed meshes are left alone
+    //
+    inline void optimize(Mesh& mesh, CacheOptimizer optimizer = CacheOptimizer::Tipsify, uint32_t cache_size = DEFAULT_CACHE_SIZE)
+    {
+        if (mesh.indices.empty() || !mesh.uv_indices.empty() || !mesh.normal_indices.empty())
+        {
+            return;
+        }
+
+        optimize_vertex_cache(mesh.indices.data(), mesh.indices.size(), mesh.positions.size(), optimizer, cache_size);
+
+        size_t used = 0;
+        const Vector<uint32_t> remap = optimize_vertex_fetch(mesh.indices.data(), mesh.indices.size(), mesh.positions.size(), &used);
+        detail::remap_attribute(mesh.normals, remap, used);
+        detail::remap_attribute(mesh.uvs, remap, used);
+        detail::remap_attribute(mesh.positions, remap, used);
+    }
+}
+}
@@ -0,0 +1,538 @@
+/*
+ * CCLib
+ *
+ * collection of utils i use in most projects.
+ * maybe it will evolve in a framework, maybe not
+ *
+ * (c) 2018 Carlo Casta <carlo.casta at gmail.com>
+ */
+#pragma once
+
+#include <cstdint>
+#include <cmath>
+#include "cclib.h"
+#include "ccsimd.h"
+#include "ccparallel.h"
+#include "ccimage.h"
+
+namespace cc
+{
+namespace noise
+{
+    using math::vec2;
+    using math::vec3;
+    using math::vec4;
+
+    enum class Type
+    {
+        Perlin,
+        Simplex,
+        Count
+    };
+
+    inline const char* type_name(Type type)
+    {
+        constexpr const char* names[] = { "perlin", "simplex" };
+        return (type < Type::Count)? names[static_cast<uint32_t>(type)] : "unknown";
+    }
+
+    //
+    // octaves of noise: sum of gain^o * noise(p * frequency * lacunarity^o), divided by the
+    // sum of the weights so that the result stays in [-1, 1] ([0, 1] for turbulence, which
+    // adds |noise|). every octave gets its own seed
+    //
+    struct Fractal
+    {
+        uint32_t octaves = 1;
+        float frequency = 1.f;
+        float lacunarity = 2.f;
+        float gain = .5f;
+        bool turbulence = false;
+    };
+
+    // samples per evaluation of the *8 functions
+    constexpr uint32_t LANES = 8;
+
+namespace detail
+{
+    //
+    // everything below is branch free and table free (lattice points are hashed, not looked
+    // up in a permutation) so that a loop over lanes vectorizes: the scalar API and the
+    // lane API run the very same code
+    //
+    CC_FORCEINLINE int32_t fast_floor(float x)
+    {
+        const int32_t i = static_cast<int32_t>(x);
+        return i - ((x < static_cast<float>(i))? 1 : 0);
+    }
+
+    CC_FORCEINLINE uint32_t hash(uint32_t seed, int32_t x, int32_t y, int32_t z = 0, int32_t w = 0)
+    {
+        uint32_t h = seed ^ (uint32_t(x) * 0x8da6b343u) ^ (uint32_t(y) * 0xd8163841u) ^ (uint32_t(z) * 0xcb1ab31fu) ^ (uint32_t(w) * 0x165667b1u);
+        h ^= h >> 15;
+        h *= 0x2c1b3c6du;
+        h ^= h >> 12;
+        h *= 0x297a2d39u;
+        h ^= h >> 15;
+        return h;
+    }
+
+    CC_FORCEINLINE float fade(float t)
+    {
+        return t * t * t * (t * (t * 6.f - 15.f) + 10.f);
+    }
+
+    CC_FORCEINLINE float lerp(float a, float b, float t)
+    {
+        return a + t * (b - a);
+    }
+
+    // bit ? a : b and bit ? -v : v as arithmetic (exact for bit in {0, 1}): plain ternaries
+    // here leave gcc with too many branches to if-convert below avx-512
+    CC_FORCEINLINE float select(uint32_t bit, float a, float b)
+    {
+        const float m = static_cast<float>(bit);
+        return m * a + (1.f - m) * b;
+    }
+
+    CC_FORCEINLINE float negate(uint32_t bit, float v)
+    {
+        return v * (1.f - 2.f * static_cast<float>(bit));
+    }
+
+    // Perlin's "improved noise" gradients: 8 in 2D, 12 cube edges in 3D, 32 in 4D
+    CC_FORCEINLINE float grad(uint32_t h, float x, float y)
+    {
+        const uint32_t swap = (h >> 2) & 1;
+        return negate(h & 1, select(swap, y, x)) + negate((h >> 1) & 1, .5f * select(swap, x, y));
+    }
+
+    CC_FORCEINLINE float grad(uint32_t h, float x, float y, float z)
+    {
+        // the tests on h are spelled in bits: gcc won't vectorize bool -> float conversions
+        h &= 15;
+        const uint32_t below8 = 1 - (h >> 3), below4 = (4 - (h >> 2)) >> 2, is12or14 = (h >> 3) & (h >> 2) & ~h & 1;
+        const float u = select(below8, x, y);
+        const float v = select(below4, y, select(is12or14, x, z));
+        return negate(h & 1, u) + negate((h >> 1) & 1, v);
+    }
+
+    CC_FORCEINLINE float grad(uint32_t h, float x, float y, float z, float w)
+    {
+        h &= 31;
+        const uint32_t below24 = 1 - ((h >> 4) & (h >> 3) & 1), below16 = 1 - (h >> 4), below8 = (4 - (h >> 3)) >> 2;
+        const float u = select(below24, x, y);
+        const float v = select(below16, y, z);
+        const float t = select(below8, z, w);
+        return negate(h & 1, u) + negate((h >> 1) & 1, v) + negate((h >> 2) & 1, t);
+    }
+
+    // the scales bring the output to [-1, 1] (peaks measured over 2 * 10^7 random samples, the rest is clamped)
+    constexpr float PERLIN2_SCALE = 1.32f;
+    constexpr float PERLIN3_SCALE = 1.f;
+    constexpr float PERLIN4_SCALE = .83f;
+    constexpr float SIMPLEX2_SCALE = 90.f;
+    constexpr float SIMPLEX3_SCALE = 76.f;
+    constexpr float SIMPLEX4_SCALE = 62.f;
+
+    // branch free clamp to [-1, 1] (off by an ulp of 1 at most), same reason as select()
+    CC_FORCEINLINE float clamp1(float x)
+    {
+        return .5f * (std::fabs(x + 1.f) - std::fabs(x - 1.f));
+    }
+
+    CC_FORCEINLINE float perlin(float x, float y, uint32_t seed)
+    {
+        const int32_t ix = fast_floor(x), iy = fast_floor(y);
+        const float fx = x - float(ix), fy = y - float(iy);
+        const float u = fade(fx), v = fade(fy);
+
+        const float n00 = grad(hash(seed, ix, iy), fx, fy);
+        const float n10 = grad(hash(seed, ix + 1, iy), fx - 1.f, fy);
+        const float n01 = grad(hash(seed, ix, iy + 1), fx, fy - 1.f);
+        const float n11 = grad(hash(seed, ix + 1, iy + 1), fx - 1.f, fy - 1.f);
+        return clamp1(PERLIN2_SCALE * lerp(lerp(n00, n10, u), lerp(n01, n11, u), v));
+    }
+
+    // bilinear blend of the 4 (x, y) corners of a cell face, z / w offsets fixed. no loops
+    // in the 3D / 4D bodies or gcc won't vectorize the lanes
+    CC_FORCEINLINE float face(uint32_t seed, int32_t ix, int32_t iy, int32_t iz, int32_t iw, float fx, float fy, float gz, float gw, float u, float v)
+    {
+        const float n00 = grad(hash(seed, ix, iy, iz, iw), fx, fy, gz, gw);
+        const float n10 = grad(hash(seed, ix + 1, iy, iz, iw), fx - 1.f, fy, gz, gw);
+        const float n01 = grad(hash(seed, ix, iy + 1, iz, iw), fx, fy - 1.f, gz, gw);
+        const float n11 = grad(hash(seed, ix + 1, iy + 1, iz, iw), fx - 1.f, fy - 1.f, gz, gw);
+        return lerp(lerp(n00, n10, u), lerp(n01, n11, u), v);
+    }
+
+    CC_FORCEINLINE float face(uint32_t seed, int32_t ix, int32_t iy, int32_t iz, float fx, float fy, float gz, float u, float v)
+    {
+        const float n00 = grad(hash(seed, ix, iy, iz), fx, fy, gz);
+        const float n10 = grad(hash(seed, ix + 1, iy, iz), fx - 1.f, fy, gz);
+        const float n01 = grad(hash(seed, ix, iy + 1, iz), fx, fy - 1.f, gz);
+        const float n11 = grad(hash(seed, ix + 1, iy + 1, iz), fx - 1.f, fy - 1.f, gz);
+        return lerp(lerp(n00, n10, u), lerp(n01, n11, u), v);
+    }
+
+    CC_FORCEINLINE float perlin(float x, float y, float z, uint32_t seed)
+    {
+        const int32_t ix = fast_floor(x), iy = fast_floor(y), iz = fast_floor(z);
+        const float fx = x - float(ix), fy = y - float(iy), fz = z - float(iz);
+        const float u = fade(fx), v = fade(fy), w = fade(fz);
+
+        const float n0 = face(seed, ix, iy, iz, fx, fy, fz, u, v);
+        const float n1 = face(seed, ix, iy, iz + 1, fx, fy, fz - 1.f, u, v);
+        return clamp1(PERLIN3_SCALE * lerp(n0, n1, w));
+    }
+
+    CC_FORCEINLINE float perlin(float x, float y, float z, float w, uint32_t seed)
+    {
+        const int32_t ix = fast_floor(x), iy = fast_floor(y), iz = fast_floor(z), iw = fast_floor(w);
+        const float fx = x - float(ix), fy = y - float(iy), fz = z - float(iz), fw = w - float(iw);
+        const float u = fade(fx), v = fade(fy), s = fade(fz), t = fade(fw);
+
+        const float n00 = face(seed, ix, iy, iz, iw, fx, fy, fz, fw, u, v);
+        const float n01 = face(seed, ix, iy, iz + 1, iw, fx, fy, fz - 1.f, fw, u, v);
+        const float n10 = face(seed, ix, iy, iz, iw + 1, fx, fy, fz, fw - 1.f, u, v);
+        const float n11 = face(seed, ix, iy, iz + 1, iw + 1, fx, fy, fz - 1.f, fw - 1.f, u, v);
+        return clamp1(PERLIN4_SCALE * lerp(lerp(n00, n01, s), lerp(n10, n11, s), t));
+    }
+
+    //
+    // simplex corner: (r - |d|^2)^4 * grad, zero outside the radius. r = .5 everywhere: the
+    // .6 of the reference code reaches past the simplex in 3D/4D and the field jumps on
+    // its faces
+    //
+    CC_FORCEINLINE float corner(float r, float d2, float g)
+    {
+        float t = r - d2;
+        t = .5f * (t + std::fabs(t));
+        t *= t;
+        return t * t * g;
+    }
+
+    // Gustavson, "Simplex noise demystified", corners ordered by rank instead of branches
+    CC_FORCEINLINE float simplex(float x, float y, uint32_t seed)
+    {
+        constexpr float F2 = .366025403784f;
+        constexpr float G2 = .211324865405f;
+
+        const float s = (x + y) * F2;
+        const int32_t i = fast_floor(x + s), j = fast_floor(y + s);
+        const float t = float(i + j) * G2;
+        const float x0 = x - (float(i) - t), y0 = y - (float(j) - t);
+
+        const int32_t i1 = (x0 > y0)? 1 : 0, j1 = 1 - i1;
+        const float x1 = x0 - float(i1) + G2, y1 = y0 - float(j1) + G2;
+        const float x2 = x0 - 1.f + 2.f * G2, y2 = y0 - 1.f + 2.f * G2;
+
+        const float n = corner(.5f, x0 * x0 + y0 * y0, grad(hash(seed, i, j), x0, y0)) +
+                        corner(.5f, x1 * x1 + y1 * y1, grad(hash(seed, i + i1, j + j1), x1, y1)) +
+                        corner(.5f, x2 * x2 + y2 * y2, grad(hash(seed, i + 1, j + 1), x2, y2));
+        return clamp1(SIMPLEX2_SCALE * n);
+    }
+
+    CC_FORCEINLINE float simplex(float x, float y, float z, uint32_t seed)
+    {
+        constexpr float F3 = 1.f / 3.f;
+        constexpr float G3 = 1.f / 6.f;
+
+        const float s = (x + y + z) * F3;
+        const int32_t i = fast_floor(x + s), j = fast_floor(y + s), k = fast_floor(z + s);
+        const float t = float(i + j + k) * G3;
+        const float x0 = x - (float(i) - t), y0 = y - (float(j) - t), z0 = z - (float(k) - t);
+
+        const int32_t xy = (x0 >= y0)? 1 : 0, xz = (x0 >= z0)? 1 : 0, yz = (y0 >= z0)? 1 : 0;
+        const int32_t i1 = xy & xz, j1 = (1 - xy) & yz, k1 = (1 - xz) & (1 - yz);
+        const int32_t i2 = xy | xz, j2 = (1 - xy) | yz, k2 = 1 - (xz & yz);
+
+        const float x1 = x0 - float(i1) + G3, y1 = y0 - float(j1) + G3, z1 = z0 - float(k1) + G3;
+        const float x2 = x0 - float(i2) + 2.f * G3, y2 = y0 - float(j2) + 2.f * G3, z2 = z0 - float(k2) + 2.f * G3;
+        const float x3 = x0 - 1.f + 3.f * G3, y3 = y0 - 1.f + 3.f * G3, z3 = z0 - 1.f + 3.f * G3;
+
+        const float n = corner(.5f, x0 * x0 + y0 * y0 + z0 * z0, grad(hash(seed, i, j, k), x0, y0, z0)) +
+                        corner(.5f, x1 * x1 + y1 * y1 + z1 * z1, grad(hash(seed, i + i1, j + j1, k + k1), x1, y1, z1)) +
+                        corner(.5f, x2 * x2 + y2 * y2 + z2 * z2, grad(hash(seed, i + i2, j + j2, k + k2), x2, y2, z2)) +
+                        corner(.5f, x3 * x3 + y3 * y3 + z3 * z3, grad(hash(seed, i + 1, j + 1, k + 1), x3, y3, z3));
+        return clamp1(SIMPLEX3_SCALE * n);
+    }
+
+    // c-th corner of a 4D simplex (0 < c <= 4): the axes whose rank is >= 4 - c are offset
+    CC_FORCEINLINE float corner4(uint32_t seed, int32_t c, int32_t i, int32_t j, int32_t k, int32_t l, int32_t rx, int32_t ry, int32_t rz, int32_t rw,
+                                 float x0, float y0, float z0, float w0)
+    {
+        constexpr float G4 = .138196601125f;
+
+        const int32_t ci = (rx >= 4 - c)? 1 : 0, cj = (ry >= 4 - c)? 1 : 0, ck = (rz >= 4 - c)? 1 : 0, cl = (rw >= 4 - c)? 1 : 0;
+        const float g = float(c) * G4;
+        const float x = x0 - float(ci) + g, y = y0 - float(cj) + g, z = z0 - float(ck) + g, w = w0 - float(cl) + g;
+        return corner(.5f, x * x + y * y + z * z + w * w, grad(hash(seed, i + ci, j + cj, k + ck, l + cl), x, y, z, w));
+    }
+
+    CC_FORCEINLINE float simplex(float x, float y, float z, float w, uint32_t seed)
+    {
+        constexpr float F4 = .309016994375f;
+        constexpr float G4 = .138196601125f;
+
+        const float s = (x + y + z + w) * F4;
+        const int32_t i = fast_floor(x + s), j = fast_floor(y + s), k = fast_floor(z + s), l = fast_floor(w + s);
+        const float t = float(i + j + k + l) * G4;
+        const float x0 = x - (float(i) - t), y0 = y - (float(j) - t), z0 = z - (float(k) - t), w0 = w - (float(l) - t);
+
+        // rank of each coordinate, ties broken by axis order
+        const int32_t rx = (x0 > y0) + (x0 > z0) + (x0 > w0);
+        const int32_t ry = (y0 >= x0) + (y0 > z0) + (y0 > w0);
+        const int32_t rz = (z0 >= x0) + (z0 >= y0) + (z0 > w0);
+        const int32_t rw = (w0 >= x0) + (w0 >= y0) + (w0 >= z0);
+
+        const float n = corner(.5f, x0 * x0 + y0 * y0 + z0 * z0 + w0 * w0, grad(hash(seed, i, j, k, l), x0, y0, z0, w0)) +
+                        corner4(seed, 1, i, j, k, l, rx, ry, rz, rw, x0, y0, z0, w0) +
+                        corner4(seed, 2, i, j, k, l, rx, ry, rz, rw, x0, y0, z0, w0) +
+                        corner4(seed, 3, i, j, k, l, rx, ry, rz, rw, x0, y0, z0, w0) +
+                        corner4(seed, 4, i, j, k, l, rx, ry, rz, rw, x0, y0, z0, w0);
+        return clamp1(SIMPLEX4_SCALE * n);
+    }
+
+    template<typename ... F>
+    CC_FORCEINLINE float sample(Type type, uint32_t seed, F ... p)
+    {
+        return (type == Type::Simplex)? simplex(p..., seed) : perlin(p..., seed);
+    }
+
+    // W lanes of fractal noise, p[d][lane] are the coordinates (D of them)
+    template<uint32_t W, uint32_t D>
+    CC_FORCEINLINE void fractal_lanes(Type type, const float (&p)[D][W], const Fractal& fractal, uint32_t seed, float* out)
+    {
+        float sum[W] = {};
+        float frequency = fractal.frequency;
+        float amplitude = 1.f;
+        float total = 0.f;
+        for (uint32_t o = 0; o < math::max(fractal.octaves, 1u); ++o)
+        {
+            const uint32_t octave_seed = seed + o * 0x9e3779b9u;
+            const bool turbulence = fractal.turbulence;
+            if (type == Type::Simplex)
+            {
+                CC_SIMD_LOOP
+                for (uint32_t l = 0; l < W; ++l)
+                {
+                    float n;
+                    if (D == 2) n = simplex(p[0][l] * frequency, p[1 % D][l] * frequency, octave_seed);
+                    else if (D == 3) n = simplex(p[0][l] * frequency, p[1 % D][l] * frequency, p[2 % D][l] * frequency, octave_seed);
+                    else n = simplex(p[0][l] * frequency, p[1 % D][l] * frequency, p[2 % D][l] * frequency, p[3 % D][l] * frequency, octave_seed);
+                    sum[l] += amplitude * (turbulence? math::abs(n) : n);
+                }
+            }
+            else
+            {
+                CC_SIMD_LOOP
+                for (uint32_t l = 0; l < W; ++l)
+                {
+                    float n;
+                    if (D == 2) n = perlin(p[0][l] * frequency, p[1 % D][l] * frequency, octave_seed);
+                    else if (D == 3) n = perlin(p[0][l] * frequency, p[1 % D][l] * frequency, p[2 % D][l] * frequency, octave_seed);
+                    else n = perlin(p[0][l] * frequency, p[1 % D][l] * frequency, p[2 % D][l] * frequency, p[3 % D][l] * frequency, octave_seed);
+                    sum[l] += amplitude * (turbulence? math::abs(n) : n);
+                }
+            }
+            total += amplitude;
+            amplitude *= fractal.gain;
+            frequency *= fractal.lacunarity;
+        }
+
+        const float scale = 1.f / total;
+        for (uint32_t l = 0; l < W; ++l)
+        {
+            out[l] = sum[l] * scale;
+        }
+    }
+
+    //
+    // one row of a grid: x = (first + i + .5) / extent, the other coordinates fixed.
+    // count samples, W at a time (the tail is padded)
+    //
+    template<uint32_t W, uint32_t D>
+    CC_FORCEINLINE void row_body(Type type, const float (&fixed)[D], uint32_t first, uint32_t count, float extent, const Fractal& fractal, uint32_t seed, float* out)
+    {
+        float p[D][W];
+        float values[W];
+        for (uint32_t d = 1; d < D; ++d)
+        {
+            for (uint32_t l = 0; l < W; ++l) p[d][l] = fixed[d];
+        }
+
+        for (uint32_t x = 0; x < count; x += W)
+        {
+            for (uint32_t l = 0; l < W; ++l)
+            {
+                p[0][l] = (float(first + x + l) + .5f) / extent;
+            }
+            fractal_lanes<W, D>(type, p, fractal, seed, values);
+            const uint32_t n = math::min(W, count - x);
+            for (uint32_t l = 0; l < n; ++l)
+            {
+                out[x + l] = values[l];
+            }
+        }
+    }
+
+#define CC_NOISE_ROW_KERNELS(TARGET, SUFFIX, W)                                                                                        \
+    TARGET inline void row2##SUFFIX(Type type, const float (&fixed)[2], uint32_t first, uint32_t count, float extent,                   \
+                                    const Fractal& fractal, uint32_t seed, float* out)                                                  \
+    { row_body<W, 2>(type, fixed, first, count, extent, fractal, seed, out); }                                                            \
+    TARGET inline void row3##SUFFIX(Type type, const float (&fixed)[3], uint32_t first, uint32_t count, float extent,                   \
+                                    const Fractal& fractal, uint32_t seed, float* out)                                                  \
+    { row_body<W, 3>(type, fixed, first, count, extent, fractal, seed, out); }
+
+    CC_NOISE_ROW_KERNELS(, , 8)
+    CC_NOISE_ROW_KERNELS(CC_TARGET_AVX2, _avx2, 8)
+    CC_NOISE_ROW_KERNELS(CC_TARGET_AVX512, _avx512, 16)
+
+#undef CC_NOISE_ROW_KERNELS
+
+    using Row2 = void (*)(Type, const float (&)[2], uint32_t, uint32_t, float, const Fractal&, uint32_t, float*);
+    using Row3 = void (*)(Type, const float (&)[3], uint32_t, uint32_t, float, const Fractal&, uint32_t, float*);
+
+    // widest kernel the active simd level allows (see simd::level())
+    inline Row2 row2_kernel()
+    {
+        const simd::Level level = simd::level();
+        return (level >= simd::Level::AVX512)? row2_avx512 : ((level >= simd::Level::AVX2)? row2_avx2 : row2);
+    }
+
+    inline Row3 row3_kernel()
+    {
+        const simd::Level level = simd::level();
+        return (level >= simd::Level::AVX512)? row3_avx512 : ((level >= simd::Level::AVX2)? row3_avx2 : row3);
+    }
+}
+
+    //
+    // single samples, in [-1, 1]. the same seed always gives the same field
+    //
+    inline float perlin(const vec2& p, uint32_t seed = 0)      { return detail::perlin(p.x, p.y, seed); }
+
+    inline float perlin(const vec3& p, uint32_t seed = 0)      { return detail::perlin(p.x, p.y, p.z, seed); }
+
+    inline float perlin(const vec4& p, uint32_t seed = 0)      { return detail::perlin(p.x, p.y, p.z, p.w, seed); }
+
+    inline float simplex(const vec2& p, uint32_t seed = 0)     { return detail::simplex(p.x, p.y, seed); }
+
+    inline float simplex(const vec3& p, uint32_t seed = 0)     { return detail::simplex(p.x, p.y, p.z, seed); }
+
+    inline float simplex(const vec4& p, uint32_t seed = 0)     { return detail::simplex(p.x, p.y, p.z, p.w, seed); }
+
+    inline float sample(Type type, const vec2& p, uint32_t seed = 0)   { return detail::sample(type, seed, p.x, p.y); }
+
+    inline float sample(Type type, const vec3& p, uint32_t seed = 0)   { return detail::sample(type, seed, p.x, p.y, p.z); }
+
+    inline float sample(Type type, const vec4& p, uint32_t seed = 0)   { return detail::sample(type, seed, p.x, p.y, p.z, p.w); }
+
+    inline float fractal(Type type, const vec2& p, const Fractal& f, uint32_t seed = 0)
+    {
+        const float lanes[2][1] = { { p.x }, { p.y } };
+        float out;
+        detail::fractal_lanes<1, 2>(type, lanes, f, seed, &out);
+        return out;
+    }
+
+    inline float fractal(Type type, const vec3& p, const Fractal& f, uint32_t seed = 0)
+    {
+        const float lanes[3][1] = { { p.x }, { p.y }, { p.z } };
+        float out;
+        detail::fractal_lanes<1, 3>(type, lanes, f, seed, &out);
+        return out;
+    }
+
+    inline float fractal(Type type, const vec4& p, const Fractal& f, uint32_t seed = 0)
+    {
+        const float lanes[4][1] = { { p.x }, { p.y }, { p.z }, { p.w } };
+        float out;
+        detail::fractal_lanes<1, 4>(type, lanes, f, seed, &out);
+        return out;
+    }
+
+    //
+    // LANES samples at once, coordinates in SoA form (x[LANES], y[LANES], ...). same
+    // results as the single sample calls
+    //
+    inline void sample8(Type type, const float* x, const float* y, float* out, uint32_t seed = 0)
+    {
+        float p[2][LANES];
+        for (uint32_t l = 0; l < LANES; ++l) { p[0][l] = x[l]; p[1][l] = y[l]; }
+        detail::fractal_lanes<LANES, 2>(type, p, Fractal(), seed, out);
+    }
+
+    inline void sample8(Type type, const float* x, const float* y, const float* z, float* out, uint32_t seed = 0)
+    {
+        float p[3][LANES];
+        for (uint32_t l = 0; l < LANES; ++l) { p[0][l] = x[l]; p[1][l] = y[l]; p[2][l] = z[l]; }
+        detail::fractal_lanes<LANES, 3>(type, p, Fractal(), seed, out);
+    }
+
+    inline void sample8(Type type, const float* x, const float* y, const float* z, const float* w, float* out, uint32_t seed = 0)
+    {
+        float p[4][LANES];
+        for (uint32_t l = 0; l < LANES; ++l) { p[0][l] = x[l]; p[1][l] = y[l]; p[2][l] = z[l]; p[3][l] = w[l]; }
+        detail::fractal_lanes<LANES, 4>(type, p, Fractal(), seed, out);
+    }
+
+    inline void fractal8(Type type, const float* x, const float* y, const Fractal& f, float* out, uint32_t seed = 0)
+    {
+        float p[2][LANES];
+        for (uint32_t l = 0; l < LANES; ++l) { p[0][l] = x[l]; p[1][l] = y[l]; }
+        detail::fractal_lanes<LANES, 2>(type, p, f, seed, out);
+    }
+
+    inline void fractal8(Type type, const float* x, const float* y, const float* z, const Fractal& f, float* out, uint32_t seed = 0)
+    {
+        float p[3][LANES];
+        for (uint32_t l = 0; l < LANES; ++l) { p[0][l] = x[l]; p[1][l] = y[l]; p[2][l] = z[l]; }
+        detail::fractal_lanes<LANES, 3>(type, p, f, seed, out);
+    }
+
+    //
+    // fills a whole image with 2D fractal noise, pixel (x, y) samples ((x + .5) / width,
+    // (y + .5) / height): f.frequency is the number of base cells across the image. rows are
+    // spread over the pool and evaluated with the widest simd the cpu has
+    //
+    inline void fill(Image<float>& image, Type type, const Fractal& f = Fractal(), uint32_t seed = 0, ThreadPool& pool = ThreadPool::global())
+    {
+        const uint32_t width = image.width(), height = image.height();
+        const detail::Row2 row = detail::row2_kernel();
+        pool.parallel_for(0, height, [&](size_t first, size_t last)
+        {
+            Vector<float> scratch(width);
+            for (size_t y = first; y < last; ++y)
+            {
+                const float fixed[2] = { 0.f, (float(y) + .5f) / float(height) };
+                float* out = (image.layout() == ImageLayout::RowMajor)? image.row(uint32_t(y)) : scratch.data();
+                row(type, fixed, 0, width, float(width), f, seed, out);
+                if (out == scratch.data())
+                {
+                    for (uint32_t x = 0; x < width; ++x) image.at(x, uint32_t(y)) = scratch[x];
+                }
+            }
+        });
+    }
+
+    //
+    // same for a width x height x depth volume of 3D noise, x fastest. voxel (x, y, z)
+    // samples (x + .5, y + .5, z + .5) / width: cells stay cubic whatever the extents
+    //
+    inline void fill(float* volume, uint32_t width, uint32_t height, uint32_t depth, Type type, const Fractal& f = Fractal(), uint32_t seed = 0,
+                     ThreadPool& pool = ThreadPool::global())
+    {
+        const detail::Row3 row = detail::row3_kernel();
+        const float extent = float(width);
+        pool.parallel_for(0, size_t(height) * depth, [&](size_t first, size_t last)
+        {
+            for (size_t r = first; r < last; ++r)
+            {
+                const float fixed[3] = { 0.f, (float(r % height) + .5f) / extent, (float(r / height) + .5f) / extent };
+                row(type, fixed, 0, width, extent, f, seed, volume + r * width);
+            }
+        });
+    }
+}
+}
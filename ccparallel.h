@@ -0,0 +1,528 @@
+/*
+ * CCLib
+ *
+ * collection of utils i use in most projects.
+ * maybe it will evolve in a framework, maybe not
+ *
+ * (c) 2018 Carlo Casta <carlo.casta at gmail.com>
+ */
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+#include <exception>
+#include "cclib.h"
+#include "ccvector.h"
+
+#if defined(_WIN32)
+ #if !defined(WIN32_LEAN_AND_MEAN)
+  #define WIN32_LEAN_AND_MEAN
+ #endif
+ #if !defined(NOMINMAX)
+  #define NOMINMAX
+ #endif
+ #include <windows.h>
+#else
+ #include <pthread.h>
+ #include <sched.h>
+#endif
+
+namespace cc
+{
+namespace detail
+{
+    class SpinLock
+    {
+    public:
+        void lock()
+        {
+            while (flag_.exchange(true, std::memory_order_acquire))
+            {
+                while (flag_.load(std::memory_order_relaxed)) _mm_pause();
+            }
+        }
+
+        void unlock()
+        {
+            flag_.store(false, std::memory_order_release);
+        }
+
+    private:
+        std::atomic<bool> flag_{ false };
+    };
+
+    struct Task
+    {
+        explicit Task(void (*run_fn)(Task*)) : run(run_fn), done(false) {}
+
+        void (*run)(Task*);
+        std::atomic<bool> done;
+        std::exception_ptr error;       // thrown by run, rethrown to whoever joins
+    };
+
+    struct alignas(64) TaskQueue
+    {
+        SpinLock lock;
+        std::deque<Task*> tasks;
+    };
+
+    inline void pin_thread(std::thread& thread, size_t cpu)
+    {
+#if defined(_WIN32)
+        SetThreadAffinityMask(thread.native_handle(), DWORD_PTR(1) << (cpu % (sizeof(DWORD_PTR) * 8)));
+#else
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu % CPU_SETSIZE, &set);
+        pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+#endif
+    }
+}
+
+    //
+    // fork-join pool: every thread owns a deque, pops its own work LIFO and steals FIFO
+    // from the others. the calling thread counts as one of the threads and keeps working
+    // while it waits, nested calls from inside a task reuse the same workers.
+    // an exception thrown by a callable is rethrown by the parallel_* call once all of its
+    // tasks are done; if several throw, the others are dropped
+    //
+    class ThreadPool
+    {
+    public:
+        // threads == 0 uses all hardware threads, caller included
+        explicit ThreadPool(size_t threads = 0, bool pin_threads = false)
+            : queues_(math::max<size_t>(threads? threads : std::thread::hardware_concurrency(), 1))
+            , epoch_(0)
+            , sleepers_(0)
+            , stop_(false)
+        {
+            for (size_t i = 1; i < queues_.size(); ++i)
+            {
+                workers_.emplace_back([this, i] { worker_main(i); });
+                if (pin_threads)
+                {
+                    detail::pin_thread(workers_.back(), i);
+                }
+            }
+        }
+
+        ~ThreadPool()
+        {
+            {
+                std::lock_guard<std::mutex> guard(sleep_lock_);
+                stop_ = true;
+            }
+            wakeup_.notify_all();
+
+            for (std::thread& worker : workers_)
+            {
+                worker.join();
+            }
+        }
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        size_t size() const
+        {
+            return queues_.size();
+        }
+
+        //
+        // f(first, last) is called on disjoint subranges of [begin, end) no larger than grain.
+        // the range is split lazily, only while other threads run out of work, so grain is
+        // just the unit of work between checks. grain 0 picks roughly 32 chunks per thread
+        //
+        template<typename F>
+        void parallel_for(size_t begin, size_t end, F&& f, size_t grain = 0)
+        {
+            if (begin < end)
+            {
+                for_range(begin, end, grain? grain : auto_grain(end - begin, 32), f);
+            }
+        }
+
+        // f(T* first, T* last) over contiguous chunks of v
+        template<typename T, typename F>
+        void parallel_for(const Vector<T>& v, F&& f, size_t grain = 0)
+        {
+            T* data = v.data();
+            parallel_for(size_t(0), v.size(), [data, &f](size_t first, size_t last) { f(data + first, data + last); }, grain);
+        }
+
+        //
+        // map(first, last) -> T on subranges, then reduce(T, T) -> T. for a given grain the
+        // split tree and thus the reduction order is fixed, whatever thread runs each part.
+        // grain 0 picks about REDUCE_CHUNKS chunks whatever the pool size, so floating point
+        // results are the same on every pool
+        //
+        template<typename T, typename Map, typename Reduce>
+        T parallel_reduce(size_t begin, size_t end, const T& identity, Map&& map, Reduce&& reduce, size_t grain = 0)
+        {
+            if (begin >= end)
+            {
+                return identity;
+            }
+
+            return reduce_range(begin, end, grain? grain : math::max<size_t>(1, (end - begin) / REDUCE_CHUNKS), identity, map, reduce);
+        }
+
+        template<typename F0, typename ... F>
+        void parallel_invoke(F0&& f0, F&& ... fs)
+        {
+            invoke_all(f0, fs...);
+        }
+
+        static constexpr size_t REDUCE_CHUNKS = 256;
+
+        static ThreadPool& global()
+        {
+            static ThreadPool instance;
+            return instance;
+        }
+
+    private:
+        template<typename F>
+        struct ForTask : detail::Task
+        {
+            ForTask(ThreadPool* p, size_t b, size_t e, size_t g, const F& fn)
+                : Task(&ForTask::execute), pool(p), begin(b), end(e), grain(g), f(fn) {}
+
+            static void execute(detail::Task* task)
+            {
+                ForTask* self = static_cast<ForTask*>(task);
+                self->pool->for_range(self->begin, self->end, self->grain, self->f);
+            }
+
+            ThreadPool* pool;
+            size_t begin, end, grain;
+            const F& f;
+        };
+
+        template<typename T, typename Map, typename Reduce>
+        struct ReduceTask : detail::Task
+        {
+            ReduceTask(ThreadPool* p, size_t b, size_t e, size_t g, const T& id, const Map& m, const Reduce& r)
+                : Task(&ReduceTask::execute), pool(p), begin(b), end(e), grain(g), identity(id), map(m), reduce(r), result(id) {}
+
+            static void execute(detail::Task* task)
+            {
+                ReduceTask* self = static_cast<ReduceTask*>(task);
+                self->result = self->pool->reduce_range(self->begin, self->end, self->grain, self->identity, self->map, self->reduce);
+            }
+
+            ThreadPool* pool;
+            size_t begin, end, grain;
+            const T& identity;
+            const Map& map;
+            const Reduce& reduce;
+            T result;
+        };
+
+        template<typename F>
+        struct InvokeTask : detail::Task
+        {
+            explicit InvokeTask(F& fn) : Task(&InvokeTask::execute), f(fn) {}
+
+            static void execute(detail::Task* task)
+            {
+                static_cast<InvokeTask*>(task)->f();
+            }
+
+            F& f;
+        };
+
+        struct ThreadSlot
+        {
+            ThreadPool* pool;
+            size_t index;
+        };
+
+        std::vector<detail::TaskQueue> queues_;
+        std::vector<std::thread> workers_;
+        std::atomic<uint64_t> epoch_;
+        std::atomic<uint32_t> sleepers_;
+        std::mutex sleep_lock_;
+        std::condition_variable wakeup_;
+        bool stop_;
+
+        static ThreadSlot& this_thread()
+        {
+            static thread_local ThreadSlot slot{ nullptr, 0 };
+            return slot;
+        }
+
+        // external threads share queue 0
+        size_t queue_index() const
+        {
+            const ThreadSlot& slot = this_thread();
+            return (slot.pool == this)? slot.index : 0;
+        }
+
+        size_t auto_grain(size_t count, size_t chunks_per_thread) const
+        {
+            return math::max<size_t>(1, count / (size() * chunks_per_thread));
+        }
+
+        // nothing left to steal from this thread: someone took our last split or never had one
+        bool starving(size_t index)
+        {
+            detail::TaskQueue& queue = queues_[index];
+            queue.lock.lock();
+            const bool empty = queue.tasks.empty();
+            queue.lock.unlock();
+            return empty;
+        }
+
+        // lazy binary splitting: run one grain at a time and hand out half of what is left
+        // only when our queue has drained, so splits follow the load instead of the size
+        template<typename F>
+        void for_range(size_t begin, size_t end, size_t grain, const F& f)
+        {
+            const size_t index = queue_index();
+            while (end - begin > grain)
+            {
+                if (starving(index))
+                {
+                    const size_t mid = begin + (end - begin) / 2;
+                    ForTask<F> right(this, mid, end, grain, f);
+                    submit(&right);
+                    try
+                    {
+                        for_range(begin, mid, grain, f);
+                    }
+                    catch (...)
+                    {
+                        wait(&right);
+                        throw;
+                    }
+                    join(&right);
+                    return;
+                }
+
+                f(begin, begin + grain);
+                begin += grain;
+            }
+
+            f(begin, end);
+        }
+
+        template<typename T, typename Map, typename Reduce>
+        T reduce_range(size_t begin, size_t end, size_t grain, const T& identity, const Map& map, const Reduce& reduce)
+        {
+            if (end - begin <= grain)
+            {
+                return map(begin, end);
+            }
+
+            const size_t mid = begin + (end - begin) / 2;
+            ReduceTask<T, Map, Reduce> right(this, mid, end, grain, identity, map, reduce);
+            submit(&right);
+            T left = identity;
+            try
+            {
+                left = reduce_range(begin, mid, grain, identity, map, reduce);
+            }
+            catch (...)
+            {
+                wait(&right);
+                throw;
+            }
+            join(&right);
+            return reduce(left, right.result);
+        }
+
+        template<typename F0>
+        void invoke_all(F0& f0)
+        {
+            f0();
+        }
+
+        template<typename F0, typename F1, typename ... F>
+        void invoke_all(F0& f0, F1& f1, F& ... fs)
+        {
+            InvokeTask<F1> next(f1);
+            submit(&next);
+            try
+            {
+                invoke_all(f0, fs...);
+            }
+            catch (...)
+            {
+                wait(&next);
+                throw;
+            }
+            join(&next);
+        }
+
+        void submit(detail::Task* task)
+        {
+            detail::TaskQueue& queue = queues_[queue_index()];
+            queue.lock.lock();
+            queue.tasks.push_back(task);
+            queue.lock.unlock();
+
+            epoch_.fetch_add(1);
+            if (sleepers_.load() > 0)
+            {
+                std::lock_guard<std::mutex> guard(sleep_lock_);
+                wakeup_.notify_one();
+            }
+        }
+
+        detail::Task* pop(size_t index)
+        {
+            detail::TaskQueue& queue = queues_[index];
+            detail::Task* task = nullptr;
+            queue.lock.lock();
+            if (!queue.tasks.empty())
+            {
+                task = queue.tasks.back();
+                queue.tasks.pop_back();
+            }
+            queue.lock.unlock();
+            return task;
+        }
+
+        detail::Task* steal(size_t index)
+        {
+            for (size_t i = 1; i < queues_.size(); ++i)
+            {
+                detail::TaskQueue& queue = queues_[(index + i) % queues_.size()];
+                queue.lock.lock();
+                if (!queue.tasks.empty())
+                {
+                    detail::Task* task = queue.tasks.front();
+                    queue.tasks.pop_front();
+                    queue.lock.unlock();
+                    return task;
+                }
+                queue.lock.unlock();
+            }
+            return nullptr;
+        }
+
+        detail::Task* find_work(size_t index)
+        {
+            detail::Task* task = pop(index);
+            return task? task : steal(index);
+        }
+
+        // never throws: tasks live on the stack of whoever submitted them, which must not
+        // unwind before they are done
+        static void execute(detail::Task* task)
+        {
+            try
+            {
+                task->run(task);
+            }
+            catch (...)
+            {
+                task->error = std::current_exception();
+            }
+            task->done.store(true, std::memory_order_release);
+        }
+
+        // run other tasks until this one is done, the awaited task is usually the next to pop
+        void wait(detail::Task* task)
+        {
+            const size_t index = queue_index();
+            for (uint32_t idle = 0; !task->done.load(std::memory_order_acquire);)
+            {
+                if (detail::Task* other = find_work(index))
+                {
+                    execute(other);
+                    idle = 0;
+                }
+                else if (++idle < 64)
+                {
+                    _mm_pause();
+                }
+                else
+                {
+                    std::this_thread::yield();
+                }
+            }
+        }
+
+        void join(detail::Task* task)
+        {
+            wait(task);
+            if (task->error)
+            {
+                std::rethrow_exception(task->error);
+            }
+        }
+
+        void worker_main(size_t index)
+        {
+            this_thread() = ThreadSlot{ this, index };
+
+            for (;;)
+            {
+                detail::Task* task = nullptr;
+                for (uint32_t spin = 0; !task && spin < 256; ++spin)
+                {
+                    task = find_work(index);
+                    if (!task) _mm_pause();
+                }
+
+                if (!task)
+                {
+                    // anything pushed after reading the epoch will change it and wake us up
+                    const uint64_t seen = epoch_.load();
+                    task = find_work(index);
+                    if (!task)
+                    {
+                        std::unique_lock<std::mutex> guard(sleep_lock_);
+                        sleepers_.fetch_add(1);
+                        while (!stop_ && epoch_.load() == seen)
+                        {
+                            wakeup_.wait(guard);
+                        }
+                        sleepers_.fetch_sub(1);
+
+                        if (stop_)
+                        {
+                            return;
+                        }
+                        continue;
+                    }
+                }
+
+                execute(task);
+            }
+        }
+    };
+
+    //
+    // shortcuts on the global pool
+    //
+    template<typename F>
+    inline void parallel_for(size_t begin, size_t end, F&& f, size_t grain = 0)
+    {
+        ThreadPool::global().parallel_for(begin, end, std::forward<F>(f), grain);
+    }
+
+    template<typename T, typename F>
+    inline void parallel_for(const Vector<T>& v, F&& f, size_t grain = 0)
+    {
+        ThreadPool::global().parallel_for(v, std::forward<F>(f), grain);
+    }
+
+    template<typename T, typename Map, typename Reduce>
+    inline T parallel_reduce(size_t begin, size_t end, const T& identity, Map&& map, Reduce&& reduce, size_t grain = 0)
+    {
+        return ThreadPool::global().parallel_reduce(begin, end, identity, std::forward<Map>(map), std::forward<Reduce>(reduce), grain);
+    }
+
+    template<typename ... F>
+    inline void parallel_invoke(F&& ... fs)
+    {
+        ThreadPool::global().parallel_invoke(std::forward<F>(fs)...);
+    }
+}
@@ -0,0 +1,265 @@
+/*
+ * CCLib
+ *
+ * collection of utils i use in most projects.
+ * maybe it will evolve in a framework, maybe not
+ *
+ * (c) 2018 Carlo Casta <carlo.casta at gmail.com>
+ */
+#pragma once
+
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include "cclib.h"
+#include "ccvector.h"
+#include "ccparallel.h"
+
+namespace cc
+{
+    //
+    // index + generation packed in one word. 32-bit handles have 20 index bits (1M live
+    // objects) and 12 generation bits, 64-bit handles 32 + 32. the generation of a slot
+    // grows on every destroy so stale handles stop resolving (32-bit ones can alias again
+    // after 4095 reuses of the same slot). a zero handle is never valid
+    //
+    template<typename Word>
+    struct PoolHandle
+    {
+        static_assert(std::is_same<Word, uint32_t>::value || std::is_same<Word, uint64_t>::value, "pool handles are 32 or 64 bits");
+
+        static constexpr uint32_t INDEX_BITS = (sizeof(Word) == 4)? 20 : 32;
+        static constexpr Word INDEX_MASK = (Word(1) << INDEX_BITS) - 1;
+        static constexpr Word GENERATION_MASK = Word(~Word(0)) >> INDEX_BITS;
+
+        Word value;
+
+        constexpr PoolHandle() : value(0) {}
+
+        constexpr PoolHandle(uint32_t index, Word generation) : value((generation << INDEX_BITS) | Word(index)) {}
+
+        constexpr uint32_t index() const        { return uint32_t(value & INDEX_MASK); }
+
+        constexpr Word generation() const       { return value >> INDEX_BITS; }
+
+        constexpr explicit operator bool() const { return value != 0; }
+
+        constexpr bool operator==(const PoolHandle& other) const { return value == other.value; }
+
+        constexpr bool operator!=(const PoolHandle& other) const { return value != other.value; }
+    };
+
+    using Handle32 = PoolHandle<uint32_t>;
+    using Handle64 = PoolHandle<uint64_t>;
+
+    //
+    // object pool: live objects are kept packed at the front of chunked storage (chunks
+    // never move, growing doesn't copy anything), a slot table maps handles to their
+    // current position. destroy() moves the last object into the hole, so iteration is
+    // always over a dense range, chunk by chunk. create/destroy/get are O(1).
+    // pointers and dense indices are only valid until the next destroy()
+    //
+    template<typename T, typename Word = uint32_t, uint32_t CHUNK_SIZE = 1024>
+    class Pool
+    {
+    public:
+        using Handle = PoolHandle<Word>;
+        using value_type = T;
+
+        static_assert((CHUNK_SIZE & (CHUNK_SIZE - 1)) == 0, "CHUNK_SIZE must be a power of two");
+
+        static constexpr uint32_t MAX_OBJECTS = uint32_t(math::min<uint64_t>(Handle::INDEX_MASK, UINT32_MAX - 1));
+
+        explicit Pool()
+            : size_(0)
+            , free_head_(NONE)
+        {
+        }
+
+        ~Pool()
+        {
+            clear();
+            for (T* chunk : chunks_)
+            {
+                deallocate(chunk);
+            }
+        }
+
+        Pool(const Pool&) = delete;
+        Pool& operator=(const Pool&) = delete;
+
+        // constructs T(args...), returns a null handle once MAX_OBJECTS are alive
+        template<typename ... Args>
+        Handle create(Args&& ... args)
+        {
+            uint32_t slot = free_head_;
+            if (slot != NONE)
+            {
+                free_head_ = slots_[slot].dense;
+            }
+            else
+            {
+                if (slots_.size() >= MAX_OBJECTS)
+                {
+                    return Handle();
+                }
+                slot = static_cast<uint32_t>(slots_.size());
+                slots_.push_back(Slot{ NONE, 1 });
+            }
+
+            if (size_ == chunks_.size() * CHUNK_SIZE)
+            {
+                chunks_.push_back(allocate());
+            }
+
+            new (address(size_)) T(std::forward<Args>(args)...);
+            if (size_ == owners_.size())
+            {
+                owners_.push_back(slot);
+            }
+            else
+            {
+                owners_[size_] = slot;
+            }
+            slots_[slot].dense = static_cast<uint32_t>(size_++);
+
+            return Handle(slot, slots_[slot].generation);
+        }
+
+        // false (and nothing happens) for stale or null handles
+        bool destroy(Handle handle)
+        {
+            if (!alive(handle))
+            {
+                return false;
+            }
+
+            Slot& slot = slots_[handle.index()];
+            const uint32_t hole = slot.dense;
+            const uint32_t last = static_cast<uint32_t>(--size_);
+
+            T* target = address(hole);
+            target->~T();
+            if (hole != last)
+            {
+                T* moved = address(last);
+                new (target) T(std::move(*moved));
+                moved->~T();
+                owners_[hole] = owners_[last];
+                slots_[owners_[hole]].dense = hole;
+            }
+
+            slot.generation = (slot.generation + 1) & Handle::GENERATION_MASK;
+            if (slot.generation == 0)
+            {
+                slot.generation = 1;
+            }
+            slot.dense = free_head_;
+            free_head_ = handle.index();
+            return true;
+        }
+
+        bool alive(Handle handle) const
+        {
+            const uint32_t index = handle.index();
+            return handle && index < slots_.size() && slots_[index].generation == handle.generation() && slots_[index].dense < size_ &&
+                   owners_[slots_[index].dense] == index;
+        }
+
+        // nullptr for stale handles
+        T* get(Handle handle)                           { return alive(handle)? address(slots_[handle.index()].dense) : nullptr; }
+
+        const T* get(Handle handle) const               { return alive(handle)? address(slots_[handle.index()].dense) : nullptr; }
+
+        size_t size() const                             { return size_; }
+
+        bool empty() const                              { return size_ == 0; }
+
+        size_t capacity() const                         { return chunks_.size() * CHUNK_SIZE; }
+
+        // dense access, 0 <= index < size()
+        T& operator[](size_t index)                     { return *address(index); }
+
+        const T& operator[](size_t index) const         { return *address(index); }
+
+        Handle handle_at(size_t index) const
+        {
+            const uint32_t slot = owners_[index];
+            return Handle(slot, slots_[slot].generation);
+        }
+
+        // destroys everything, chunks are kept. outstanding handles become stale
+        void clear()
+        {
+            while (size_ > 0)
+            {
+                destroy(handle_at(size_ - 1));
+            }
+        }
+
+        // f(T&) on every live object
+        template<typename F>
+        void for_each(F&& f)
+        {
+            for_each_span([&f](T* first, T* last) { for (T* it = first; it != last; ++it) f(*it); });
+        }
+
+        //
+        // f(T* first, T* last) on contiguous runs of live objects (one per chunk), the shape
+        // batch / SIMD updates want
+        //
+        template<typename F>
+        void for_each_span(F&& f)
+        {
+            for (size_t c = 0; c * CHUNK_SIZE < size_; ++c)
+            {
+                f(chunks_[c], chunks_[c] + math::min<size_t>(CHUNK_SIZE, size_ - c * CHUNK_SIZE));
+            }
+        }
+
+        // same, chunks spread across the pool. f must not create/destroy
+        template<typename F>
+        void for_each_span(ThreadPool& pool, F&& f)
+        {
+            const size_t chunks = (size_ + CHUNK_SIZE - 1) / CHUNK_SIZE;
+            pool.parallel_for(0, chunks, [this, &f](size_t first, size_t last)
+            {
+                for (size_t c = first; c < last; ++c)
+                {
+                    f(chunks_[c], chunks_[c] + math::min<size_t>(CHUNK_SIZE, size_ - c * CHUNK_SIZE));
+                }
+            }, 1);
+        }
+
+    private:
+        static constexpr uint32_t NONE = UINT32_MAX;
+
+        struct Slot
+        {
+            uint32_t dense;         // position of the object, or next free slot
+            Word generation;
+        };
+
+        Vector<T*> chunks_;
+        Vector<Slot> slots_;
+        Vector<uint32_t> owners_;   // dense position -> slot
+        size_t size_;
+        uint32_t free_head_;
+
+        T* address(size_t index) const
+        {
+            return chunks_[index / CHUNK_SIZE] + (index & (CHUNK_SIZE - 1));
+        }
+
+        static T* allocate()
+        {
+            return static_cast<T*>(::operator new(CHUNK_SIZE * sizeof(T), std::align_val_t(math::max<size_t>(alignof(T), 64))));
+        }
+
+        static void deallocate(T* chunk)
+        {
+            ::operator delete(chunk, std::align_val_t(math::max<size_t>(alignof(T), 64)));
+        }
+    };
+}
@@ -0,0 +1,345 @@
+/*
+ * CCLib
+ *
+ * collection of utils i use in most projects.
+ * maybe it will evolve in a framework, maybe not
+ *
+ * (c) 2018 Carlo Casta <carlo.casta at gmail.com>
+ */
+#pragma once
+
+//
+// hot-path instrumentation: define CC_PROF_ENABLED before including to record
+// zones and counters, otherwise every CC_PROF_* macro expands to nothing.
+// each mode lives in its own inline namespace, so translation units built with and
+// without the define link together: the disabled ones just see nothing recorded.
+//
+//   void update() { CC_PROF_ZONE("update"); ... CC_PROF_COUNTER("visible", n); }
+//   cc::prof::save_chrome_trace("trace.json");   // chrome://tracing, perfetto
+//   cc::prof::print_summary(stdout);
+//
+
+#include <cstdio>
+#include <cstdint>
+#include <vector>
+#include <string>
+
+namespace cc
+{
+namespace prof
+{
+    struct ZoneStats
+    {
+        std::string name;
+        uint64_t count;
+        double total_us;
+        double min_us;
+        double p50_us;
+        double p90_us;
+        double p99_us;
+        double max_us;
+    };
+}
+}
+
+#if defined(CC_PROF_ENABLED)
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <map>
+#include <algorithm>
+#include "cclib.h"
+
+#if !defined(CC_PROF_BUFFER_SIZE)
+ #define CC_PROF_BUFFER_SIZE (1 << 16)
+#endif
+
+#define CC_PROF_CONCAT_(a, b) a##b
+#define CC_PROF_CONCAT(a, b) CC_PROF_CONCAT_(a, b)
+#define CC_PROF_ZONE(name) ::cc::prof::Zone CC_PROF_CONCAT(cc_prof_zone_, __LINE__)(name)
+#define CC_PROF_FUNCTION() CC_PROF_ZONE(__func__)
+#define CC_PROF_COUNTER(name, value) ::cc::prof::counter(name, static_cast<int64_t>(value))
+
+namespace cc
+{
+namespace prof
+{
+inline namespace enabled
+{
+    static_assert((CC_PROF_BUFFER_SIZE & (CC_PROF_BUFFER_SIZE - 1)) == 0, "CC_PROF_BUFFER_SIZE must be a power of two");
+
+    inline uint64_t now() { return __rdtsc(); }
+
+    struct Event
+    {
+        const char* name;
+        uint64_t begin;
+        uint64_t end;          // counters store their value here
+        bool is_counter;
+    };
+
+    //
+    // single-writer ring, owned by one thread. when full the oldest events are overwritten.
+    // readers should run once the instrumented work is done, they never block the writer
+    //
+    class ThreadBuffer
+    {
+    public:
+        explicit ThreadBuffer(uint32_t tid)
+            : tid_(tid)
+            , head_(0)
+            , events_(new Event[CC_PROF_BUFFER_SIZE])
+        {
+        }
+
+        ~ThreadBuffer()
+        {
+            delete[] events_;
+        }
+
+        void push(const char* name, uint64_t begin, uint64_t end, bool is_counter)
+        {
+            const uint64_t head = head_.load(std::memory_order_relaxed);
+            events_[head & (CC_PROF_BUFFER_SIZE - 1)] = Event{ name, begin, end, is_counter };
+            head_.store(head + 1, std::memory_order_release);
+        }
+
+        template<typename F>
+        void for_each(F&& callback) const
+        {
+            const uint64_t head = head_.load(std::memory_order_acquire);
+            const uint64_t first = (head > CC_PROF_BUFFER_SIZE)? head - CC_PROF_BUFFER_SIZE : 0;
+            for (uint64_t i = first; i < head; ++i)
+            {
+                callback(events_[i & (CC_PROF_BUFFER_SIZE - 1)]);
+            }
+        }
+
+        uint32_t tid() const { return tid_; }
+
+        void reset() { head_.store(0, std::memory_order_release); }
+
+    private:
+        uint32_t tid_;
+        alignas(64) std::atomic<uint64_t> head_;
+        Event* events_;
+    };
+
+namespace detail
+{
+    struct Registry
+    {
+        std::mutex lock;
+        std::vector<ThreadBuffer*> buffers;
+    };
+
+    // never destroyed, buffers included: threads may still record while the program exits
+    inline Registry& registry()
+    {
+        static Registry& instance = *new Registry;
+        return instance;
+    }
+
+    // buffers outlive their threads so that traces can be exported after joining workers
+    inline ThreadBuffer* register_thread()
+    {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> guard(r.lock);
+        r.buffers.push_back(new ThreadBuffer(static_cast<uint32_t>(r.buffers.size())));
+        return r.buffers.back();
+    }
+
+    inline ThreadBuffer& thread_buffer()
+    {
+        static thread_local ThreadBuffer* buffer = register_thread();
+        return *buffer;
+    }
+
+    // rdtsc ticks per microsecond, measured once against the steady clock
+    inline double ticks_per_us()
+    {
+        static const double ratio = []
+        {
+            using clock = std::chrono::steady_clock;
+            const auto t0 = clock::now();
+            const uint64_t c0 = now();
+            while (clock::now() - t0 < std::chrono::milliseconds(10)) {}
+            const auto t1 = clock::now();
+            const uint64_t c1 = now();
+            return double(c1 - c0) / std::chrono::duration<double, std::micro>(t1 - t0).count();
+        }();
+        return ratio;
+    }
+
+    inline void write_escaped(std::FILE* out, const char* name)
+    {
+        for (; *name; ++name)
+        {
+            if (*name == '"' || *name == '\\') std::fputc('\\', out);
+            std::fputc(*name, out);
+        }
+    }
+}
+
+    class Zone
+    {
+    public:
+        explicit Zone(const char* name)
+            : name_(name)
+            , begin_(now())
+        {
+        }
+
+        ~Zone()
+        {
+            detail::thread_buffer().push(name_, begin_, now(), false);
+        }
+
+        Zone(const Zone&) = delete;
+        Zone& operator=(const Zone&) = delete;
+
+    private:
+        const char* name_;
+        uint64_t begin_;
+    };
+
+    inline void counter(const char* name, int64_t value)
+    {
+        detail::thread_buffer().push(name, now(), static_cast<uint64_t>(value), true);
+    }
+
+    //
+    // per-zone aggregates over all threads, sorted by total time
+    //
+    inline std::vector<ZoneStats> summary()
+    {
+        std::map<std::string, std::vector<uint64_t>> durations;
+        {
+            detail::Registry& r = detail::registry();
+            std::lock_guard<std::mutex> guard(r.lock);
+            for (const ThreadBuffer* buffer : r.buffers)
+            {
+                buffer->for_each([&](const Event& e) { if (!e.is_counter) durations[e.name].push_back(e.end - e.begin); });
+            }
+        }
+
+        const double scale = 1. / detail::ticks_per_us();
+        auto percentile = [scale](const std::vector<uint64_t>& sorted, double p)
+        {
+            const size_t idx = math::min(sorted.size() - 1, static_cast<size_t>(p * double(sorted.size())));
+            return double(sorted[idx]) * scale;
+        };
+
+        std::vector<ZoneStats> result;
+        for (auto& zone : durations)
+        {
+            std::vector<uint64_t>& d = zone.second;
+            std::sort(d.begin(), d.end());
+
+            uint64_t total = 0;
+            for (uint64_t ticks : d) total += ticks;
+
+            result.push_back(ZoneStats{ zone.first, d.size(), double(total) * scale, double(d.front()) * scale,
+                                        percentile(d, .5), percentile(d, .9), percentile(d, .99), double(d.back()) * scale });
+        }
+
+        std::sort(result.begin(), result.end(), [](const ZoneStats& a, const ZoneStats& b) { return a.total_us > b.total_us; });
+        return result;
+    }
+
+    inline void print_summary(std::FILE* out)
+    {
+        std::fprintf(out, "%-32s %10s %12s %10s %10s %10s %10s %10s\n", "zone", "count", "total(us)", "min", "p50", "p90", "p99", "max");
+        for (const ZoneStats& s : summary())
+        {
+            std::fprintf(out, "%-32s %10llu %12.1f %10.2f %10.2f %10.2f %10.2f %10.2f\n", s.name.c_str(), static_cast<unsigned long long>(s.count),
+                         s.total_us, s.min_us, s.p50_us, s.p90_us, s.p99_us, s.max_us);
+        }
+    }
+
+    //
+    // chrome trace event format ("X" complete events and "C" counters)
+    //
+    inline void write_chrome_trace(std::FILE* out)
+    {
+        detail::Registry& r = detail::registry();
+        std::lock_guard<std::mutex> guard(r.lock);
+
+        uint64_t base = UINT64_MAX;
+        for (const ThreadBuffer* buffer : r.buffers)
+        {
+            buffer->for_each([&](const Event& e) { base = math::min(base, e.begin); });
+        }
+
+        const double scale = 1. / detail::ticks_per_us();
+        bool first = true;
+
+        std::fputs("{\"traceEvents\":[\n", out);
+        for (const ThreadBuffer* buffer : r.buffers)
+        {
+            buffer->for_each([&](const Event& e)
+            {
+                std::fputs(first? "{\"name\":\"" : ",\n{\"name\":\"", out);
+                detail::write_escaped(out, e.name);
+                if (e.is_counter)
+                {
+                    std::fprintf(out, "\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":0,\"tid\":%u,\"args\":{\"value\":%lld}}",
+                                 double(e.begin - base) * scale, buffer->tid(), static_cast<long long>(e.end));
+                }
+                else
+                {
+                    std::fprintf(out, "\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":0,\"tid\":%u}",
+                                 double(e.begin - base) * scale, double(e.end - e.begin) * scale, buffer->tid());
+                }
+                first = false;
+            });
+        }
+        std::fputs("\n]}\n", out);
+    }
+
+    inline bool save_chrome_trace(const char* path)
+    {
+        std::FILE* out = std::fopen(path, "w");
+        if (!out)
+        {
+            return false;
+        }
+
+        write_chrome_trace(out);
+        return std::fclose(out) == 0;
+    }
+
+    // drop all recorded events, threads must not be recording
+    inline void reset()
+    {
+        detail::Registry& r = detail::registry();
+        std::lock_guard<std::mutex> guard(r.lock);
+        for (ThreadBuffer* buffer : r.buffers) buffer->reset();
+    }
+}
+}
+}
+
+#else
+
+#define CC_PROF_ZONE(name) ((void)0)
+#define CC_PROF_FUNCTION() ((void)0)
+#define CC_PROF_COUNTER(name, value) ((void)0)
+
+namespace cc
+{
+namespace prof
+{
+inline namespace disabled
+{
+    inline std::vector<ZoneStats> summary()      { return {}; }
+    inline void print_summary(std::FILE*)        {}
+    inline void write_chrome_trace(std::FILE*)   {}
+    inline bool save_chrome_trace(const char*)   { return false; }
+    inline void reset()                          {}
+}
+}
+}
+
+#endif
@@ -0,0 +1,619 @@
+/*
+ * CCLib
+ *
+ * collection of utils i use in most projects.
+ * maybe it will evolve in a framework, maybe not
+ *
+ * (c) 2018 Carlo Casta <carlo.casta at gmail.com>
+ */
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <new>
+#include <utility>
+#include "cclib.h"
+
+namespace cc
+{
+namespace detail
+{
+    constexpr size_t CACHE_LINE = 64;
+
+    inline size_t queue_capacity(size_t capacity)
+    {
+        size_t pow2 = 2;
+        while (pow2 < capacity) pow2 *= 2;
+        return pow2;
+    }
+
+    // short waits on another thread that is mid-operation: pause, then give up the core
+    inline void backoff(uint32_t& round)
+    {
+        if (++round < 64) _mm_pause();
+        else std::this_thread::yield();
+    }
+
+    //
+    // blocking side of the queues: spin, then yield, then sleep on a condition variable.
+    // only the blocking calls notify, so the lock-free try_* paths never pay for the fence.
+    // a sleeper whose peer only uses try_* still sees its state within SLEEP, and wakers only
+    // touch the mutex when somebody is actually asleep
+    //
+    class Waiter
+    {
+    public:
+        static constexpr uint32_t SPINS = 64;
+        static constexpr uint32_t YIELDS = 64;
+        static constexpr std::chrono::microseconds SLEEP{ 500 };
+
+        // returns once ready() is true
+        template<typename F>
+        void wait(const F& ready)
+        {
+            for (uint32_t round = 0; round < SPINS + YIELDS;)
+            {
+                if (ready())
+                {
+                    return;
+                }
+                backoff(round);
+            }
+
+            std::unique_lock<std::mutex> guard(lock_);
+            sleepers_.fetch_add(1);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            while (!ready())
+            {
+                wakeup_.wait_for(guard, SLEEP);
+            }
+            sleepers_.fetch_sub(1);
+        }
+
+        // after the state ready() looks at has been published
+        void notify()
+        {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (sleepers_.load(std::memory_order_relaxed) > 0)
+            {
+                std::lock_guard<std::mutex> guard(lock_);
+                wakeup_.notify_all();
+            }
+        }
+
+    private:
+        std::atomic<uint32_t> sleepers_{ 0 };
+        std::mutex lock_;
+        std::condition_variable wakeup_;
+    };
+
+    // raw storage for capacity T's
+    template<typename T>
+    T* allocate_slots(size_t capacity)
+    {
+        return static_cast<T*>(::operator new(capacity * sizeof(T), std::align_val_t(math::max<size_t>(alignof(T), CACHE_LINE))));
+    }
+
+    template<typename T>
+    void deallocate_slots(T* slots)
+    {
+        ::operator delete(slots, std::align_val_t(math::max<size_t>(alignof(T), CACHE_LINE)));
+    }
+}
+
+    //
+    // bounded single producer / single consumer ring. head and tail live on their own cache
+    // lines and each side keeps a cached copy of the other's index, so the shared lines are
+    // only read when the ring looks full (producer) or empty (consumer). try_* never block
+    // nor wake anybody, push/pop wait (spin, yield, sleep) and wake the other side. pop fails
+    // once the queue is closed and drained
+    //
+    template<typename T>
+    class SpscQueue
+    {
+    public:
+        // rounded up to a power of two
+        explicit SpscQueue(size_t capacity)
+            : capacity_(detail::queue_capacity(capacity))
+            , mask_(capacity_ - 1)
+            , slots_(detail::allocate_slots<T>(capacity_))
+        {
+        }
+
+        // no other thread may be using the queue: whatever is left is destroyed in place
+        ~SpscQueue()
+        {
+            const size_t tail = tail_.index.load(std::memory_order_acquire);
+            for (size_t i = head_.index.load(std::memory_order_acquire); i != tail; ++i)
+            {
+                slots_[i & mask_].~T();
+            }
+            detail::deallocate_slots(slots_);
+        }
+
+        SpscQueue(const SpscQueue&) = delete;
+        SpscQueue& operator=(const SpscQueue&) = delete;
+
+        size_t capacity() const                         { return capacity_; }
+
+        // exact when called by either side, a snapshot otherwise
+        size_t size() const
+        {
+            const size_t head = head_.index.load(std::memory_order_acquire);
+            return tail_.index.load(std::memory_order_acquire) - head;
+        }
+
+        bool empty() const                              { return size() == 0; }
+
+        template<typename U>
+        bool try_push(U&& item)
+        {
+            const size_t tail = tail_.index.load(std::memory_order_relaxed);
+            if (tail - producer_.head == capacity_)
+            {
+                producer_.head = head_.index.load(std::memory_order_acquire);
+                if (tail - producer_.head == capacity_)
+                {
+                    return false;
+                }
+            }
+
+            new (slots_ + (tail & mask_)) T(std::forward<U>(item));
+            tail_.index.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        bool try_pop(T& item)
+        {
+            const size_t head = head_.index.load(std::memory_order_relaxed);
+            if (head == consumer_.tail)
+            {
+                consumer_.tail = tail_.index.load(std::memory_order_acquire);
+                if (head == consumer_.tail)
+                {
+                    return false;
+                }
+            }
+
+            T* slot = slots_ + (head & mask_);
+            item = std::move(*slot);
+            slot->~T();
+            head_.index.store(head + 1, std::memory_order_release);
+            return true;
+        }
+
+        // up to count items, one release store for all of them. returns how many went in
+        size_t try_push_batch(const T* items, size_t count)
+        {
+            const size_t tail = tail_.index.load(std::memory_order_relaxed);
+            if (capacity_ - (tail - producer_.head) < count)
+            {
+                producer_.head = head_.index.load(std::memory_order_acquire);
+            }
+            count = math::min(count, capacity_ - (tail - producer_.head));
+
+            for (size_t i = 0; i < count; ++i)
+            {
+                new (slots_ + ((tail + i) & mask_)) T(items[i]);
+            }
+            if (count > 0)
+            {
+                tail_.index.store(tail + count, std::memory_order_release);
+            }
+            return count;
+        }
+
+        // up to count items, returns how many came out
+        size_t try_pop_batch(T* items, size_t count)
+        {
+            const size_t head = head_.index.load(std::memory_order_relaxed);
+            if (consumer_.tail - head < count)
+            {
+                consumer_.tail = tail_.index.load(std::memory_order_acquire);
+            }
+            count = math::min(count, consumer_.tail - head);
+
+            for (size_t i = 0; i < count; ++i)
+            {
+                T* slot = slots_ + ((head + i) & mask_);
+                items[i] = std::move(*slot);
+                slot->~T();
+            }
+            if (count > 0)
+            {
+                head_.index.store(head + count, std::memory_order_release);
+            }
+            return count;
+        }
+
+        // blocks while full. false (item dropped) if the queue gets closed
+        template<typename U>
+        bool push(U&& item)
+        {
+            for (;;)
+            {
+                if (closed())
+                {
+                    return false;
+                }
+                if (try_push(std::forward<U>(item)))
+                {
+                    not_empty_.notify();
+                    return true;
+                }
+                not_full_.wait([this] { return closed() || size() < capacity_; });
+            }
+        }
+
+        // blocks while empty. false once the queue is closed and nothing is left
+        bool pop(T& item)
+        {
+            for (;;)
+            {
+                if (try_pop(item))
+                {
+                    not_full_.notify();
+                    return true;
+                }
+                if (closed() && empty())
+                {
+                    return false;
+                }
+                not_empty_.wait([this] { return closed() || !empty(); });
+            }
+        }
+
+        // blocks until all count items are in, returns fewer only if the queue gets closed
+        size_t push_batch(const T* items, size_t count)
+        {
+            size_t pushed = 0;
+            while (pushed < count && !closed())
+            {
+                const size_t added = try_push_batch(items + pushed, count - pushed);
+                if (added > 0)
+                {
+                    not_empty_.notify();
+                    pushed += added;
+                }
+                if (pushed < count)
+                {
+                    not_full_.wait([this] { return closed() || size() < capacity_; });
+                }
+            }
+            return pushed;
+        }
+
+        // blocks until at least one item is there, 0 once the queue is closed and drained
+        size_t pop_batch(T* items, size_t count)
+        {
+            for (;;)
+            {
+                if (const size_t popped = try_pop_batch(items, count))
+                {
+                    not_full_.notify();
+                    return popped;
+                }
+                if (closed() && empty())
+                {
+                    return 0;
+                }
+                not_empty_.wait([this] { return closed() || !empty(); });
+            }
+        }
+
+        // wakes up every waiter, pending items can still be popped
+        void close()
+        {
+            closed_.store(true);
+            not_empty_.notify();
+            not_full_.notify();
+        }
+
+        bool closed() const                             { return closed_.load(std::memory_order_acquire); }
+
+    private:
+        struct alignas(detail::CACHE_LINE) Index
+        {
+            std::atomic<size_t> index{ 0 };
+        };
+
+        struct alignas(detail::CACHE_LINE) Cached
+        {
+            size_t head = 0;
+            size_t tail = 0;
+        };
+
+        const size_t capacity_;
+        const size_t mask_;
+        T* const slots_;
+        Index head_;                    // written by the consumer
+        Index tail_;                    // written by the producer
+        Cached producer_;               // producer's view of head
+        Cached consumer_;               // consumer's view of tail
+        std::atomic<bool> closed_{ false };
+        detail::Waiter not_empty_;
+        detail::Waiter not_full_;
+    };
+
+    //
+    // bounded multi producer / multi consumer ring (Vyukov): every slot carries a sequence
+    // number telling whose turn it is, producers and consumers claim positions with a CAS on
+    // their own padded counter and never touch the other side's. batches claim a whole run
+    // of positions with one CAS
+    //
+    template<typename T>
+    class MpmcQueue
+    {
+    public:
+        // rounded up to a power of two
+        explicit MpmcQueue(size_t capacity)
+            : capacity_(detail::queue_capacity(capacity))
+            , mask_(capacity_ - 1)
+            , cells_(detail::allocate_slots<Cell>(capacity_))
+        {
+            for (size_t i = 0; i < capacity_; ++i)
+            {
+                new (&cells_[i].sequence) std::atomic<size_t>(i);
+            }
+        }
+
+        // no other thread may be using the queue: whatever is left is destroyed in place
+        ~MpmcQueue()
+        {
+            const size_t tail = enqueue_.index.load(std::memory_order_acquire);
+            for (size_t i = dequeue_.index.load(std::memory_order_acquire); i != tail; ++i)
+            {
+                cells_[i & mask_].item()->~T();
+            }
+            detail::deallocate_slots(cells_);
+        }
+
+        MpmcQueue(const MpmcQueue&) = delete;
+        MpmcQueue& operator=(const MpmcQueue&) = delete;
+
+        size_t capacity() const                         { return capacity_; }
+
+        // a snapshot, other threads may be halfway through
+        size_t size() const
+        {
+            const size_t head = dequeue_.index.load(std::memory_order_acquire);
+            const size_t tail = enqueue_.index.load(std::memory_order_acquire);
+            return (tail > head)? tail - head : 0;
+        }
+
+        bool empty() const                              { return size() == 0; }
+
+        template<typename U>
+        bool try_push(U&& item)
+        {
+            size_t pos = enqueue_.index.load(std::memory_order_relaxed);
+            for (;;)
+            {
+                Cell& cell = cells_[pos & mask_];
+                const intptr_t turn = intptr_t(cell.sequence.load(std::memory_order_acquire)) - intptr_t(pos);
+                if (turn == 0)
+                {
+                    if (enqueue_.index.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    {
+                        new (cell.item()) T(std::forward<U>(item));
+                        cell.sequence.store(pos + 1, std::memory_order_release);
+                        return true;
+                    }
+                }
+                else if (turn < 0)
+                {
+                    return false;
+                }
+                else
+                {
+                    pos = enqueue_.index.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        bool try_pop(T& item)
+        {
+            size_t pos = dequeue_.index.load(std::memory_order_relaxed);
+            for (;;)
+            {
+                Cell& cell = cells_[pos & mask_];
+                const intptr_t turn = intptr_t(cell.sequence.load(std::memory_order_acquire)) - intptr_t(pos + 1);
+                if (turn == 0)
+                {
+                    if (dequeue_.index.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    {
+                        take(cell, pos, item);
+                        return true;
+                    }
+                }
+                else if (turn < 0)
+                {
+                    return false;
+                }
+                else
+                {
+                    pos = dequeue_.index.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        //
+        // claims up to count consecutive positions at once. a claimed cell can still be in
+        // the hands of the consumer (producer) that claimed it a lap earlier, that one is
+        // waited for: it is past its own CAS and only copying
+        //
+        size_t try_push_batch(const T* items, size_t count)
+        {
+            size_t pos = enqueue_.index.load(std::memory_order_relaxed);
+            size_t claimed = 0;
+            for (;;)
+            {
+                const size_t head = dequeue_.index.load(std::memory_order_acquire);
+                claimed = math::min(count, capacity_ - math::min(capacity_, pos - math::min(pos, head)));
+                if (claimed == 0)
+                {
+                    return 0;
+                }
+                if (enqueue_.index.compare_exchange_weak(pos, pos + claimed, std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+
+            for (size_t i = 0; i < claimed; ++i)
+            {
+                Cell& cell = cells_[(pos + i) & mask_];
+                for (uint32_t round = 0; cell.sequence.load(std::memory_order_acquire) != pos + i;) detail::backoff(round);
+                new (cell.item()) T(items[i]);
+                cell.sequence.store(pos + i + 1, std::memory_order_release);
+            }
+            return claimed;
+        }
+
+        size_t try_pop_batch(T* items, size_t count)
+        {
+            size_t pos = dequeue_.index.load(std::memory_order_relaxed);
+            size_t claimed = 0;
+            for (;;)
+            {
+                const size_t tail = enqueue_.index.load(std::memory_order_acquire);
+                claimed = math::min(count, tail - math::min(tail, pos));
+                if (claimed == 0)
+                {
+                    return 0;
+                }
+                if (dequeue_.index.compare_exchange_weak(pos, pos + claimed, std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+
+            for (size_t i = 0; i < claimed; ++i)
+            {
+                Cell& cell = cells_[(pos + i) & mask_];
+                for (uint32_t round = 0; cell.sequence.load(std::memory_order_acquire) != pos + i + 1;) detail::backoff(round);
+                take(cell, pos + i, items[i]);
+            }
+            return claimed;
+        }
+
+        // blocks while full. false (item dropped) if the queue gets closed
+        template<typename U>
+        bool push(U&& item)
+        {
+            for (;;)
+            {
+                if (closed())
+                {
+                    return false;
+                }
+                if (try_push(std::forward<U>(item)))
+                {
+                    not_empty_.notify();
+                    return true;
+                }
+                not_full_.wait([this] { return closed() || size() < capacity_; });
+            }
+        }
+
+        // blocks while empty. false once the queue is closed and nothing is left
+        bool pop(T& item)
+        {
+            for (;;)
+            {
+                if (try_pop(item))
+                {
+                    not_full_.notify();
+                    return true;
+                }
+                if (closed() && empty())
+                {
+                    return false;
+                }
+                not_empty_.wait([this] { return closed() || !empty(); });
+            }
+        }
+
+        // blocks until all count items are in, returns fewer only if the queue gets closed
+        size_t push_batch(const T* items, size_t count)
+        {
+            size_t pushed = 0;
+            while (pushed < count && !closed())
+            {
+                const size_t added = try_push_batch(items + pushed, count - pushed);
+                if (added > 0)
+                {
+                    not_empty_.notify();
+                    pushed += added;
+                }
+                if (pushed < count)
+                {
+                    not_full_.wait([this] { return closed() || size() < capacity_; });
+                }
+            }
+            return pushed;
+        }
+
+        // blocks until at least one item is there, 0 once the queue is closed and drained
+        size_t pop_batch(T* items, size_t count)
+        {
+            for (;;)
+            {
+                if (const size_t popped = try_pop_batch(items, count))
+                {
+                    not_full_.notify();
+                    return popped;
+                }
+                if (closed() && empty())
+                {
+                    return 0;
+                }
+                not_empty_.wait([this] { return closed() || !empty(); });
+            }
+        }
+
+        // wakes up every waiter, pending items can still be popped
+        void close()
+        {
+            closed_.store(true);
+            not_empty_.notify();
+            not_full_.notify();
+        }
+
+        bool closed() const                             { return closed_.load(std::memory_order_acquire); }
+
+    private:
+        struct Cell
+        {
+            std::atomic<size_t> sequence;
+            alignas(T) unsigned char storage[sizeof(T)];
+
+            T* item()                                   { return reinterpret_cast<T*>(storage); }
+        };
+
+        struct alignas(detail::CACHE_LINE) Index
+        {
+            std::atomic<size_t> index{ 0 };
+        };
+
+        const size_t capacity_;
+        const size_t mask_;
+        Cell* const cells_;
+        Index enqueue_;
+        Index dequeue_;
+        std::atomic<bool> closed_{ false };
+        detail::Waiter not_empty_;
+        detail::Waiter not_full_;
+
+        // the cell is free again for the producer one lap ahead
+        void take(Cell& cell, size_t pos, T& item)
+        {
+            item = std::move(*cell.item());
+            cell.item()->~T();
+            cell.sequence.store(pos + capacity_, std::memory_order_release);
+        }
+    };
+}
@@ -0,0 +1,408 @@
+/*
+ * CCLib
+ *
+ * collection of utils i use in most projects.
+ * maybe it will evolve in a framework, maybe not
+ *
+ * (c) 2018 Carlo Casta <carlo.casta at gmail.com>
+ */
+#pragma once
+
+//
+// separable image resampling in linear space:
+//
+//   cc::Image<cc::gfx::rgba8> small(256, 256);
+//   cc::resample::resize(texture, small, cc::resample::Filter::Kaiser);   // srgb -> linear -> filter -> srgb
+//   auto mips = cc::resample::mip_chain(texture, cc::resample::Filter::Box);
+//
+// rgba8 pixels are sRGB encoded with linear alpha, vec4 pixels are already linear.
+// images are processed as row-major, other layouts are converted first.
+//
+
+#include <cmath>
+#include <type_traits>
+#include "cclib.h"
+#include "ccvector.h"
+#include "ccparallel.h"
+#include "ccimage.h"
+
+namespace cc
+{
+namespace resample
+{
+    using math::vec4;
+    using gfx::rgba8;
+
+    enum class Filter : uint32_t
+    {
+        Box,
+        Tent,
+        Lanczos3,
+        Kaiser,
+        Count
+    };
+
+    inline const char* filter_name(Filter filter)
+    {
+        constexpr const char* names[] = { "box", "tent", "lanczos3", "kaiser" };
+        return (filter < Filter::Count)? names[uint32_t(filter)] : "unknown";
+    }
+
+    // half-width of the filter at scale 1
+    inline float filter_radius(Filter filter)
+    {
+        switch (filter)
+        {
+        case Filter::Box:   return .5f;
+        case Filter::Tent:  return 1.f;
+        default:            return 3.f;
+        }
+    }
+
+namespace detail
+{
+    inline float sinc(float x)
+    {
+        if (math::abs(x) < 1.e-5f)
+        {
+            return 1.f;
+        }
+        x *= math::PI;
+        return std::sin(x) / x;
+    }
+
+    // modified bessel function of the first kind, order 0
+    inline float bessel_i0(float x)
+    {
+        float sum = 1.f;
+        float term = 1.f;
+        const float half_x2 = x * x * .25f;
+        for (int k = 1; k < 32 && term > sum * 1.e-8f; ++k)
+        {
+            term *= half_x2 / float(k * k);
+            sum += term;
+        }
+        return sum;
+    }
+}
+
+    inline float filter_weight(Filter filter, float x)
+    {
+        x = math::abs(x);
+        switch (filter)
+        {
+        case Filter::Box:
+            return (x < .5f)? 1.f : 0.f;
+
+        case Filter::Tent:
+            return math::max(0.f, 1.f - x);
+
+        case Filter::Lanczos3:
+            return (x < 3.f)? detail::sinc(x) * detail::sinc(x / 3.f) : 0.f;
+
+        case Filter::Kaiser:
+        {
+            // windowed sinc, alpha 4
+            constexpr float alpha = 4.f;
+            if (x >= 3.f) return 0.f;
+            const float t = x / 3.f;
+            return detail::sinc(x) * detail::bessel_i0(alpha * std::sqrt(1.f - t * t)) / detail::bessel_i0(alpha);
+        }
+
+        default:
+            return 0.f;
+        }
+    }
+
+    //
+    // 1D weights from src to dst samples: output i reads taps consecutive samples from first[i].
+    // samples past the edges are clamped (their weight goes to the border sample), rows are
+    // zero padded to taps and normalized to 1
+    //
+    struct Weights
+    {
+        uint32_t taps;
+        Vector<uint32_t> first;
+        Vector<float> weights;      // taps per output sample
+    };
+
+    inline Weights compute_weights(uint32_t src, uint32_t dst, Filter filter)
+    {
+        const float scale = float(dst) / float(src);
+        const float stretch = math::min(scale, 1.f);           // minification widens the filter
+        const float support = filter_radius(filter) / stretch;
+
+        Weights result;
+        result.taps = math::min(uint32_t(std::ceil(support * 2.f)) + 1, src);
+        result.first.resize(dst);
+        result.weights.resize(size_t(dst) * result.taps, 0.f);
+
+        for (uint32_t i = 0; i < dst; ++i)
+        {
+            const float center = (float(i) + .5f) / scale - .5f;
+            const int lo = int(std::ceil(center - support));
+            const int hi = int(std::floor(center + support));
+            const uint32_t first = math::min(uint32_t(math::max(lo, 0)), src - result.taps);
+
+            float* w = result.weights.data() + size_t(i) * result.taps;
+            float sum = 0.f;
+            for (int j = lo; j <= hi; ++j)
+            {
+                const float weight = filter_weight(filter, (float(j) - center) * stretch);
+                const int sample = math::min(math::max(j, 0), int(src) - 1);
+                w[sample - int(first)] += weight;
+                sum += weight;
+            }
+
+            // a box narrower than the sample spacing can miss every sample: take the nearest
+            if (sum == 0.f)
+            {
+                const int nearest = math::min(math::max(int(std::floor(center + .5f)), 0), int(src) - 1);
+                w[nearest - int(first)] = sum = 1.f;
+            }
+
+            for (uint32_t k = 0; k < result.taps; ++k) w[k] /= sum;
+            result.first[i] = first;
+        }
+
+        return result;
+    }
+
+namespace detail
+{
+    inline const float* srgb_to_linear_table()
+    {
+        static const struct Table
+        {
+            Table() { for (int i = 0; i < 256; ++i) values[i] = gfx::linear(float(i) / 255.f); }
+            float values[256];
+        } table;
+        return table.values;
+    }
+
+    // linear -> 8-bit srgb sampled every 1/65535: the step is well under half a code even where
+    // the curve is steepest (12.92 * 255 codes per unit near black)
+    inline const uint8_t* linear_to_srgb_table()
+    {
+        static const struct Table
+        {
+            Table() { for (int i = 0; i < 65536; ++i) values[i] = uint8_t(gfx::srgb(float(i) / 65535.f) * 255.f + .5f); }
+            uint8_t values[65536];
+        } table;
+        return table.values;
+    }
+
+    inline void decode_row(const rgba8* in, vec4* out, size_t count)
+    {
+        const float* lut = srgb_to_linear_table();
+        for (size_t i = 0; i < count; ++i)
+        {
+            out[i] = vec4(lut[in[i].r], lut[in[i].g], lut[in[i].b], float(in[i].a) * (1.f / 255.f));
+        }
+    }
+
+    inline void encode_row(const vec4* in, rgba8* out, size_t count)
+    {
+        const uint8_t* lut = linear_to_srgb_table();
+        for (size_t i = 0; i < count; ++i)
+        {
+            const vec4 c = math::saturate(in[i]) * 65535.f + .5f;
+            out[i] = rgba8{ lut[uint32_t(c.r)], lut[uint32_t(c.g)], lut[uint32_t(c.b)], uint8_t(math::saturate(in[i].a) * 255.f + .5f) };
+        }
+    }
+
+    inline void filter_row(const vec4* in, vec4* out, const Weights& w, size_t count)
+    {
+        for (size_t x = 0; x < count; ++x)
+        {
+            const vec4* taps = in + w.first[x];
+            const float* weights = w.weights.data() + x * w.taps;
+
+            __m128 sum = _mm_setzero_ps();
+            for (uint32_t k = 0; k < w.taps; ++k)
+            {
+                sum = _mm_add_ps(sum, _mm_mul_ps(_mm_load_ps(taps[k].v), _mm_set1_ps(weights[k])));
+            }
+            _mm_store_ps(out[x].v, sum);
+        }
+    }
+
+    // out = sum(weights[k] * rows[k])
+    inline void filter_column(const vec4* const* rows, const float* weights, uint32_t taps, vec4* out, size_t count)
+    {
+        for (size_t x = 0; x < count; ++x)
+        {
+            _mm_store_ps(out[x].v, _mm_setzero_ps());
+        }
+
+        for (uint32_t k = 0; k < taps; ++k)
+        {
+            if (weights[k] == 0.f) continue;
+
+            const vec4* row = rows[k];
+            const __m128 w = _mm_set1_ps(weights[k]);
+            for (size_t x = 0; x < count; ++x)
+            {
+                _mm_store_ps(out[x].v, _mm_add_ps(_mm_load_ps(out[x].v), _mm_mul_ps(_mm_load_ps(row[x].v), w)));
+            }
+        }
+    }
+
+    //
+    // both passes in one sweep over output rows: each chunk keeps the last taps horizontally
+    // filtered source rows in a ring (row r in slot r % taps) and filters them vertically as
+    // soon as an output row's window is complete. nothing image-sized is allocated, chunks
+    // only redo the few rows they share with their neighbour
+    //
+    template<typename Src, typename Dst>
+    inline void resize_rows(const Src* src, uint32_t src_w, uint32_t src_h, Dst* dst, uint32_t dst_w, uint32_t dst_h, Filter filter, ThreadPool& pool)
+    {
+        const Weights wx = compute_weights(src_w, dst_w, filter);
+        const Weights wy = compute_weights(src_h, dst_h, filter);
+        const uint32_t taps = wy.taps;
+
+        pool.parallel_for(0, dst_h, [&](size_t first, size_t last)
+        {
+            Vector<vec4> ring(size_t(taps) * dst_w);
+            Vector<vec4> decoded(std::is_same<Src, vec4>::value? 0 : src_w);
+            Vector<vec4> filtered(std::is_same<Dst, vec4>::value? 0 : dst_w);
+            Vector<const vec4*> rows(taps);
+
+            uint32_t next_row = wy.first[first];
+            for (size_t y = first; y < last; ++y)
+            {
+                const uint32_t window = wy.first[y];
+                for (next_row = math::max(next_row, window); next_row < window + taps; ++next_row)
+                {
+                    vec4* slot = ring.data() + size_t(next_row % taps) * dst_w;
+                    if constexpr (std::is_same<Src, vec4>::value)
+                    {
+                        filter_row(src + size_t(next_row) * src_w, slot, wx, dst_w);
+                    }
+                    else
+                    {
+                        decode_row(src + size_t(next_row) * src_w, decoded.data(), src_w);
+                        filter_row(decoded.data(), slot, wx, dst_w);
+                    }
+                }
+
+                for (uint32_t k = 0; k < taps; ++k)
+                {
+                    rows[k] = ring.data() + size_t((window + k) % taps) * dst_w;
+                }
+
+                if constexpr (std::is_same<Dst, vec4>::value)
+                {
+                    filter_column(rows.data(), wy.weights.data() + y * taps, taps, dst + y * dst_w, dst_w);
+                }
+                else
+                {
+                    filter_column(rows.data(), wy.weights.data() + y * taps, taps, filtered.data(), dst_w);
+                    encode_row(filtered.data(), dst + y * dst_w, dst_w);
+                }
+            }
+        });
+    }
+
+    template<typename T>
+    inline const Image<T>& row_major(const Image<T>& image, Image<T>& storage)
+    {
+        if (image.layout() == ImageLayout::RowMajor)
+        {
+            return image;
+        }
+
+        storage = image.converted(ImageLayout::RowMajor);
+        return storage;
+    }
+}
+
+    //
+    // resample src into dst (its size and layout are kept). vec4 and rgba8 in any combination
+    //
+    template<typename Src, typename Dst>
+    inline void resize(const Image<Src>& src, Image<Dst>& dst, Filter filter, ThreadPool& pool = ThreadPool::global())
+    {
+        if (src.width() == 0 || src.height() == 0 || dst.width() == 0 || dst.height() == 0)
+        {
+            return;
+        }
+
+        Image<Src> src_storage;
+        const Image<Src>& in = detail::row_major(src, src_storage);
+
+        if (dst.layout() == ImageLayout::RowMajor)
+        {
+            detail::resize_rows(in.data(), in.width(), in.height(), dst.data(), dst.width(), dst.height(), filter, pool);
+        }
+        else
+        {
+            Image<Dst> out(dst.width(), dst.height());
+            detail::resize_rows(in.data(), in.width(), in.height(), out.data(), out.width(), out.height(), filter, pool);
+            dst = out.converted(dst.layout());
+        }
+    }
+
+    template<typename T>
+    inline Image<T> resized(const Image<T>& src, uint32_t width, uint32_t height, Filter filter, ThreadPool& pool = ThreadPool::global())
+    {
+        Image<T> result(width, height);
+        resize(src, result, filter, pool);
+        return result;
+    }
+
+    //
+    // full chain down to 1x1, level 0 is a copy of src. every level is filtered from the
+    // previous one kept in linear float, 8-bit levels are only quantized on output
+    //
+    template<typename T>
+    inline Vector<Image<T>> mip_chain(const Image<T>& src, Filter filter = Filter::Box, ThreadPool& pool = ThreadPool::global())
+    {
+        Vector<Image<T>> levels;
+        if (src.width() == 0 || src.height() == 0)
+        {
+            return levels;
+        }
+
+        Image<T> src_storage;
+        const Image<T>& base = detail::row_major(src, src_storage);
+        levels.emplace_back(base);
+
+        // level 1 reads the (maybe 8-bit) base directly, deeper levels the previous linear one
+        Image<vec4> linear;
+        for (uint32_t width = base.width(), height = base.height(); width > 1 || height > 1;)
+        {
+            width = math::max(width / 2, 1u);
+            height = math::max(height / 2, 1u);
+
+            Image<vec4> next(width, height);
+            if (levels.size() == 1)
+            {
+                detail::resize_rows(base.data(), base.width(), base.height(), next.data(), width, height, filter, pool);
+            }
+            else
+            {
+                detail::resize_rows(linear.data(), linear.width(), linear.height(), next.data(), width, height, filter, pool);
+            }
+
+            if constexpr (std::is_same<T, vec4>::value)
+            {
+                levels.emplace_back(next);
+            }
+            else
+            {
+                Image<T> level(width, height);
+                pool.parallel_for(0, height, [&](size_t first, size_t last)
+                {
+                    for (size_t y = first; y < last; ++y) detail::encode_row(next.row(uint32_t(y)), level.row(uint32_t(y)), width);
+                });
+                levels.emplace_back(std::move(level));
+            }
+
+            linear = std::move(next);
+        }
+
+        return levels;
+    }
+}
+}
@@ -0,0 +1,494 @@
+/*
+ * CCLib
+ *
+ * collection of utils i use in most projects.
+ * maybe it will evolve in a framework, maybe not
+ *
+ * (c) 2018 Carlo Casta <carlo.casta at gmail.com>
+ */
+#pragma once
+
+//
+// real spherical harmonics up to L3, rgb coefficients:
+//
+//   const cc::sh::SH2 radiance = cc::sh::project_equirect<2>(environment);   // parallel
+//   const cc::sh::SH2 irradiance = cc::sh::convolve_cosine(radiance);
+//   const vec3 diffuse = albedo * cc::sh::evaluate(irradiance, normal) / cc::math::PI;
+//
+// basis is the usual graphics one (no Condon-Shortley phase), coefficients ordered by band
+// then m = -l..l. directions are unit vectors, y up; equirect u wraps around y starting at
+// +x, v goes from +y (top row) to -y. cube faces are +x, -x, +y, -y, +z, -z with GL
+// orientation.
+//
+
+#include <cmath>
+#include <cstdint>
+#include "cclib.h"
+#include "ccvector.h"
+#include "ccsimd.h"
+#include "ccparallel.h"
+#include "ccimage.h"
+
+namespace cc
+{
+namespace sh
+{
+    using math::vec3;
+    using math::vec4;
+
+    template<uint32_t L>
+    struct SH
+    {
+        static_assert(L >= 1 && L <= 3, "L1 to L3 only");
+
+        static constexpr uint32_t ORDER = L;
+        static constexpr uint32_t COUNT = (L + 1) * (L + 1);
+
+        vec3 c[COUNT];
+
+        SH& operator+=(const SH& other)         { for (uint32_t k = 0; k < COUNT; ++k) c[k] = c[k] + other.c[k]; return *this; }
+
+        SH& operator*=(float s)                 { for (uint32_t k = 0; k < COUNT; ++k) c[k] = c[k] * s; return *this; }
+
+        SH operator+(const SH& other) const     { SH result(*this); return result += other; }
+
+        SH operator*(float s) const             { SH result(*this); return result *= s; }
+    };
+
+    using SH1 = SH<1>;
+    using SH2 = SH<2>;
+    using SH3 = SH<3>;
+
+    // cosine lobe per band (Ramamoorthi & Hanrahan): radiance -> irradiance
+    constexpr float COSINE_LOBE[4] = { math::PI, 2.f * math::PI / 3.f, math::PI / 4.f, 0.f };
+
+namespace detail
+{
+    //
+    // (L + 1)^2 basis values of unit direction (x, y, z), the k-th at out[k * stride].
+    // strided so that a loop over directions can write SoA tables and still vectorize
+    //
+    template<uint32_t L>
+    CC_FORCEINLINE void basis(float x, float y, float z, float* out, size_t stride)
+    {
+        out[0] = .282094792f;
+
+        out[1 * stride] = .488602512f * y;
+        out[2 * stride] = .488602512f * z;
+        out[3 * stride] = .488602512f * x;
+
+        if (L >= 2)
+        {
+            const float z2 = z * z;
+            out[4 * stride] = 1.092548431f * x * y;
+            out[5 * stride] = 1.092548431f * y * z;
+            out[6 * stride] = .315391565f * (3.f * z2 - 1.f);
+            out[7 * stride] = 1.092548431f * x * z;
+            out[8 * stride] = .546274215f * (x * x - y * y);
+        }
+
+        if (L >= 3)
+        {
+            const float x2 = x * x, y2 = y * y, z2 = z * z;
+            out[9 * stride] = .590043589f * y * (3.f * x2 - y2);
+            out[10 * stride] = 2.890611442f * x * y * z;
+            out[11 * stride] = .457045799f * y * (5.f * z2 - 1.f);
+            out[12 * stride] = .373176332f * z * (5.f * z2 - 3.f);
+            out[13 * stride] = .457045799f * x * (5.f * z2 - 1.f);
+            out[14 * stride] = 1.445305721f * z * (x2 - y2);
+            out[15 * stride] = .590043589f * x * (x2 - 3.f * y2);
+        }
+    }
+
+    CC_FORCEINLINE vec3 rgb(const vec3& pixel)  { return pixel; }
+
+    CC_FORCEINLINE vec3 rgb(const vec4& pixel)  { return vec3(pixel.x, pixel.y, pixel.z); }
+
+    // directions per round of the block kernels, a multiple of the widest simd
+    constexpr uint32_t BLOCK = 64;
+    constexpr uint32_t LANES = 16;
+
+    // projection sums, double so that large maps don't lose the small texels
+    template<uint32_t L>
+    struct Sums
+    {
+        double c[3][SH<L>::COUNT] = {};
+
+        Sums& operator+=(const Sums& other)
+        {
+            for (uint32_t ch = 0; ch < 3; ++ch)
+            {
+                for (uint32_t k = 0; k < SH<L>::COUNT; ++k) c[ch][k] += other.c[ch][k];
+            }
+            return *this;
+        }
+
+        SH<L> coefficients() const
+        {
+            SH<L> result;
+            for (uint32_t k = 0; k < SH<L>::COUNT; ++k)
+            {
+                result.c[k] = vec3(float(c[0][k]), float(c[1][k]), float(c[2][k]));
+            }
+            return result;
+        }
+    };
+
+    // SoA block of up to BLOCK samples
+    template<uint32_t L>
+    struct Block
+    {
+        float x[BLOCK], y[BLOCK], z[BLOCK], w[BLOCK];
+        float r[BLOCK], g[BLOCK], b[BLOCK];
+        uint32_t size = 0;
+    };
+
+    //
+    // padded to LANES with zero weight: basis times weight as a [k][sample] table (simd
+    // over samples), then per coefficient dot products with LANES partial sums (simd
+    // again, and a fixed summation order)
+    //
+    template<uint32_t L>
+    CC_FORCEINLINE void flush_body(Block<L>& block, Sums<L>& sums)
+    {
+        const uint32_t n = (block.size + LANES - 1) & ~(LANES - 1);
+        for (uint32_t i = block.size; i < n; ++i)
+        {
+            block.x[i] = 0.f; block.y[i] = 1.f; block.z[i] = 0.f; block.w[i] = 0.f;
+            block.r[i] = 0.f; block.g[i] = 0.f; block.b[i] = 0.f;
+        }
+
+        float table[SH<L>::COUNT][BLOCK];
+        CC_SIMD_LOOP
+        for (uint32_t i = 0; i < n; ++i)
+        {
+            basis<L>(block.x[i], block.y[i], block.z[i], &table[0][i], BLOCK);
+        }
+
+        for (uint32_t k = 0; k < SH<L>::COUNT; ++k)
+        {
+            float sr[LANES] = {}, sg[LANES] = {}, sb[LANES] = {};
+            for (uint32_t i = 0; i < n; i += LANES)
+            {
+                CC_SIMD_LOOP
+                for (uint32_t l = 0; l < LANES; ++l)
+                {
+                    const float weighted = table[k][i + l] * block.w[i + l];
+                    sr[l] += weighted * block.r[i + l];
+                    sg[l] += weighted * block.g[i + l];
+                    sb[l] += weighted * block.b[i + l];
+                }
+            }
+
+            float tr = 0.f, tg = 0.f, tb = 0.f;
+            for (uint32_t l = 0; l < LANES; ++l)
+            {
+                tr += sr[l];
+                tg += sg[l];
+                tb += sb[l];
+            }
+            sums.c[0][k] += tr;
+            sums.c[1][k] += tg;
+            sums.c[2][k] += tb;
+        }
+        block.size = 0;
+    }
+
+    // basis tables in simd over the normals, then coefficient by coefficient multiply-adds
+    template<uint32_t L>
+    CC_FORCEINLINE void evaluate_body(const SH<L>& sh, const vec3* normals, vec3* out, size_t count)
+    {
+        float table[SH<L>::COUNT][BLOCK];
+        float r[BLOCK], g[BLOCK], b[BLOCK];
+
+        for (size_t first = 0; first < count; first += BLOCK)
+        {
+            const uint32_t n = uint32_t(math::min<size_t>(BLOCK, count - first));
+            const vec3* block = normals + first;
+
+            CC_SIMD_LOOP
+            for (uint32_t i = 0; i < n; ++i)
+            {
+                basis<L>(block[i].x, block[i].y, block[i].z, &table[0][i], BLOCK);
+            }
+
+            // band 0 is a constant
+            const vec3 dc = sh.c[0] * table[0][0];
+            for (uint32_t i = 0; i < n; ++i)
+            {
+                r[i] = dc.x;
+                g[i] = dc.y;
+                b[i] = dc.z;
+            }
+
+            for (uint32_t k = 1; k < SH<L>::COUNT; ++k)
+            {
+                const float cr = sh.c[k].x, cg = sh.c[k].y, cb = sh.c[k].z;
+                CC_SIMD_LOOP
+                for (uint32_t i = 0; i < n; ++i)
+                {
+                    r[i] += cr * table[k][i];
+                    g[i] += cg * table[k][i];
+                    b[i] += cb * table[k][i];
+                }
+            }
+
+            for (uint32_t i = 0; i < n; ++i)
+            {
+                out[first + i] = vec3(r[i], g[i], b[i]);
+            }
+        }
+    }
+
+#define CC_SH_KERNELS(TARGET, SUFFIX)                                                                                                   \
+    template<uint32_t L>                                                                                                                \
+    TARGET inline void flush##SUFFIX(Block<L>& block, Sums<L>& sums)            { flush_body(block, sums); }                            \
+    template<uint32_t L>                                                                                                                \
+    TARGET inline void evaluate##SUFFIX(const SH<L>& sh, const vec3* normals, vec3* out, size_t count)                                  \
+    { evaluate_body(sh, normals, out, count); }
+
+    CC_SH_KERNELS(, _generic)
+    CC_SH_KERNELS(CC_TARGET_AVX2, _avx2)
+    CC_SH_KERNELS(CC_TARGET_AVX512, _avx512)
+
+#undef CC_SH_KERNELS
+
+    template<uint32_t L>
+    using Flush = void (*)(Block<L>&, Sums<L>&);
+
+    template<uint32_t L>
+    using Evaluate = void (*)(const SH<L>&, const vec3*, vec3*, size_t);
+
+    // widest kernels the active simd level allows (see simd::level())
+    template<uint32_t L>
+    inline Flush<L> flush_kernel()
+    {
+        const simd::Level level = simd::level();
+        return (level >= simd::Level::AVX512)? flush_avx512<L> : ((level >= simd::Level::AVX2)? flush_avx2<L> : flush_generic<L>);
+    }
+
+    template<uint32_t L>
+    inline Evaluate<L> evaluate_kernel()
+    {
+        const simd::Level level = simd::level();
+        return (level >= simd::Level::AVX512)? evaluate_avx512<L> : ((level >= simd::Level::AVX2)? evaluate_avx2<L> : evaluate_generic<L>);
+    }
+
+    // integral of the cube face area element from (0, 0) to (s, t), for texel solid angles
+    inline float cube_area(float s, float t)
+    {
+        return std::atan2(s * t, std::sqrt(s * s + t * t + 1.f));
+    }
+
+    // face direction as major + s * ds + t * dt, s / t in [-1, 1]
+    struct CubeFace
+    {
+        vec3 major, ds, dt;
+    };
+
+    constexpr CubeFace CUBE_FACES[6] =
+    {
+        { vec3( 1.f,  0.f,  0.f), vec3( 0.f, 0.f, -1.f), vec3(0.f, -1.f,  0.f) },
+        { vec3(-1.f,  0.f,  0.f), vec3( 0.f, 0.f,  1.f), vec3(0.f, -1.f,  0.f) },
+        { vec3( 0.f,  1.f,  0.f), vec3( 1.f, 0.f,  0.f), vec3(0.f,  0.f,  1.f) },
+        { vec3( 0.f, -1.f,  0.f), vec3( 1.f, 0.f,  0.f), vec3(0.f,  0.f, -1.f) },
+        { vec3( 0.f,  0.f,  1.f), vec3( 1.f, 0.f,  0.f), vec3(0.f, -1.f,  0.f) },
+        { vec3( 0.f,  0.f, -1.f), vec3(-1.f, 0.f,  0.f), vec3(0.f, -1.f,  0.f) },
+    };
+}
+
+    // basis values of unit direction n, out has SH<L>::COUNT entries
+    template<uint32_t L>
+    inline void basis(const vec3& n, float* out)
+    {
+        detail::basis<L>(n.x, n.y, n.z, out, 1);
+    }
+
+    template<uint32_t L>
+    inline vec3 evaluate(const SH<L>& sh, const vec3& n)
+    {
+        float y[SH<L>::COUNT];
+        basis<L>(n, y);
+
+        vec3 result(0.f);
+        for (uint32_t k = 0; k < SH<L>::COUNT; ++k)
+        {
+            result = result + sh.c[k] * y[k];
+        }
+        return result;
+    }
+
+    // out[i] = evaluate(sh, normals[i]) for count normals, with the widest simd available
+    template<uint32_t L>
+    inline void evaluate(const SH<L>& sh, const vec3* normals, vec3* out, size_t count)
+    {
+        detail::evaluate_kernel<L>()(sh, normals, out, count);
+    }
+
+    // same, blocks spread across the pool
+    template<uint32_t L>
+    inline void evaluate(const SH<L>& sh, const vec3* normals, vec3* out, size_t count, ThreadPool& pool)
+    {
+        const detail::Evaluate<L> kernel = detail::evaluate_kernel<L>();
+        pool.parallel_for(size_t(0), count, [&](size_t first, size_t last)
+        {
+            kernel(sh, normals + first, out + first, last - first);
+        }, 16 * detail::BLOCK);
+    }
+
+    // radiance -> irradiance, i.e. the cosine-weighted integral over the hemisphere around n
+    template<uint32_t L>
+    inline SH<L> convolve_cosine(const SH<L>& sh)
+    {
+        SH<L> result(sh);
+        for (uint32_t l = 0; l <= L; ++l)
+        {
+            for (uint32_t k = l * l; k < (l + 1) * (l + 1); ++k)
+            {
+                result.c[k] = result.c[k] * COSINE_LOBE[l];
+            }
+        }
+        return result;
+    }
+
+    // adds one sample of radiance from direction n, weighted by its solid angle
+    template<uint32_t L>
+    inline void add(SH<L>& sh, const vec3& n, const vec3& radiance, float solid_angle)
+    {
+        float y[SH<L>::COUNT];
+        basis<L>(n, y);
+        for (uint32_t k = 0; k < SH<L>::COUNT; ++k)
+        {
+            sh.c[k] = sh.c[k] + radiance * (y[k] * solid_angle);
+        }
+    }
+
+    // direction through the center of texel (x, y)
+    inline vec3 equirect_direction(uint32_t x, uint32_t y, uint32_t width, uint32_t height)
+    {
+        const float phi = 2.f * math::PI * (float(x) + .5f) / float(width);
+        const float theta = math::PI * (float(y) + .5f) / float(height);
+        return vec3(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+    }
+
+    inline vec3 cubemap_direction(uint32_t face, uint32_t x, uint32_t y, uint32_t size)
+    {
+        const detail::CubeFace& f = detail::CUBE_FACES[face];
+        const float s = 2.f * (float(x) + .5f) / float(size) - 1.f;
+        const float t = 2.f * (float(y) + .5f) / float(size) - 1.f;
+        return math::normalize(f.major + f.ds * s + f.dt * t);
+    }
+
+    //
+    // projection of an equirect environment, every texel weighted by its exact solid
+    // angle. rows are spread over the pool, partial sums are added in a fixed order
+    //
+    template<uint32_t L, typename Pixel>
+    inline SH<L> project_equirect(const Image<Pixel>& image, ThreadPool& pool = ThreadPool::global())
+    {
+        const uint32_t width = image.width(), height = image.height();
+        Vector<float> cos_phi(width), sin_phi(width);
+        for (uint32_t x = 0; x < width; ++x)
+        {
+            const float phi = 2.f * math::PI * (float(x) + .5f) / float(width);
+            cos_phi[x] = std::cos(phi);
+            sin_phi[x] = std::sin(phi);
+        }
+
+        const detail::Flush<L> flush = detail::flush_kernel<L>();
+        const detail::Sums<L> empty;
+        const detail::Sums<L> sums = pool.parallel_reduce(size_t(0), size_t(height), empty, [&](size_t first, size_t last)
+        {
+            detail::Sums<L> partial;
+            detail::Block<L> block;
+            for (size_t y = first; y < last; ++y)
+            {
+                const float theta0 = math::PI * float(y) / float(height), theta1 = math::PI * float(y + 1) / float(height);
+                const float theta = math::PI * (float(y) + .5f) / float(height);
+                const float sin_theta = std::sin(theta), cos_theta = std::cos(theta);
+                const float solid_angle = 2.f * math::PI / float(width) * (std::cos(theta0) - std::cos(theta1));
+
+                for (uint32_t x = 0; x < width; ++x)
+                {
+                    const vec3 color = detail::rgb(image.at(x, uint32_t(y)));
+                    const uint32_t i = block.size++;
+                    block.x[i] = sin_theta * cos_phi[x];
+                    block.y[i] = cos_theta;
+                    block.z[i] = sin_theta * sin_phi[x];
+                    block.w[i] = solid_angle;
+                    block.r[i] = color.x;
+                    block.g[i] = color.y;
+                    block.b[i] = color.z;
+                    if (block.size == detail::BLOCK) flush(block, partial);
+                }
+            }
+            if (block.size > 0) flush(block, partial);
+            return partial;
+        },
+        [](detail::Sums<L> a, const detail::Sums<L>& b)
+        {
+            return a += b;
+        }, 4);
+
+        return sums.coefficients();
+    }
+
+    // same for a cube map, six square faces of the same size
+    template<uint32_t L, typename Pixel>
+    inline SH<L> project_cubemap(const Image<Pixel> (&faces)[6], ThreadPool& pool = ThreadPool::global())
+    {
+        const uint32_t size = faces[0].width();
+
+        // texel solid angles are the same on every face: from the area element at the corners
+        Vector<float> corners(size_t(size + 1) * (size + 1));
+        for (uint32_t y = 0; y <= size; ++y)
+        {
+            for (uint32_t x = 0; x <= size; ++x)
+            {
+                corners[size_t(y) * (size + 1) + x] = detail::cube_area(2.f * float(x) / float(size) - 1.f, 2.f * float(y) / float(size) - 1.f);
+            }
+        }
+
+        const detail::Flush<L> flush = detail::flush_kernel<L>();
+        const detail::Sums<L> empty;
+        const detail::Sums<L> sums = pool.parallel_reduce(size_t(0), size_t(6) * size, empty, [&](size_t first, size_t last)
+        {
+            detail::Sums<L> partial;
+            detail::Block<L> block;
+            for (size_t row = first; row < last; ++row)
+            {
+                const uint32_t face = uint32_t(row / size), y = uint32_t(row % size);
+                const detail::CubeFace& f = detail::CUBE_FACES[face];
+                const float t = 2.f * (float(y) + .5f) / float(size) - 1.f;
+                const float* c0 = &corners[size_t(y) * (size + 1)];
+                const float* c1 = c0 + (size + 1);
+
+                for (uint32_t x = 0; x < size; ++x)
+                {
+                    const float s = 2.f * (float(x) + .5f) / float(size) - 1.f;
+                    const vec3 d = f.major + f.ds * s + f.dt * t;
+                    const float inv_length = 1.f / std::sqrt(s * s + t * t + 1.f);
+                    const vec3 color = detail::rgb(faces[face].at(x, y));
+                    const uint32_t i = block.size++;
+                    block.x[i] = d.x * inv_length;
+                    block.y[i] = d.y * inv_length;
+                    block.z[i] = d.z * inv_length;
+                    block.w[i] = c0[x] - c0[x + 1] - c1[x] + c1[x + 1];
+                    block.r[i] = color.x;
+                    block.g[i] = color.y;
+                    block.b[i] = color.z;
+                    if (block.size == detail::BLOCK) flush(block, partial);
+                }
+            }
+            if (block.size > 0) flush(block, partial);
+            return partial;
+        },
+        [](detail::Sums<L> a, const detail::Sums<L>& b)
+        {
+            return a += b;
+        }, 4);
+
+        return sums.coefficients();
+    }
+}
+}
@@ -0,0 +1,822 @@
+/*
+ * CCLib
+ *
+ * collection of utils i use in most projects.
+ * maybe it will evolve in a framework, maybe not
+ *
+ * (c) 2018 Carlo Casta <carlo.casta at gmail.com>
+ */
+#pragma once
+
+#include <cstdlib>
+#include <cstring>
+#include "cclib.h"
+
+#if !defined(_MSC_VER)
+ #include <cpuid.h>
+#endif
+
+//
+// per-function ISA selection: kernels are compiled for several instruction
+// sets in the same binary and picked at runtime (MSVC always allows intrinsics)
+//
+#if defined(_MSC_VER)
+ #define CC_TARGET(isa)
+ #define CC_FORCEINLINE __forceinline
+#else
+ #define CC_TARGET(isa) __attribute__((target(isa)))
+ #define CC_FORCEINLINE inline __attribute__((always_inline))
+#endif
+
+// SoA loops that must vectorize whatever the cost model thinks (needs -fopenmp or -fopenmp-simd)
+#if defined(_OPENMP) && !defined(_MSC_VER)
+ #define CC_SIMD_LOOP _Pragma("omp simd")
+#else
+ #define CC_SIMD_LOOP
+#endif
+
+#define CC_TARGET_SSE2   CC_TARGET("sse2")
+#define CC_TARGET_SSE41  CC_TARGET("sse4.1")
+#define CC_TARGET_AVX2   CC_TARGET("avx2,fma")
+#define CC_TARGET_AVX512 CC_TARGET("avx512f,avx512dq,avx512vl,avx512bw,avx2,fma")
+
+namespace cc
+{
+namespace simd
+{
+    using math::vec4;
+    using math::mat4;
+    using math::mat3;
+
+    enum class Level : uint32_t
+    {
+        Scalar,
+        SSE2,
+        SSE41,
+        AVX2,
+        AVX512,
+        Count
+    };
+
+    inline const char* level_name(Level level)
+    {
+        constexpr const char* names[] = { "scalar", "sse2", "sse4.1", "avx2", "avx512" };
+        return (level < Level::Count)? names[static_cast<uint32_t>(level)] : "unknown";
+    }
+
+namespace detail
+{
+    inline void cpuid(uint32_t leaf, uint32_t subleaf, uint32_t regs[4])
+    {
+#if defined(_MSC_VER)
+        int r[4];
+        __cpuidex(r, static_cast<int>(leaf), static_cast<int>(subleaf));
+        for (int i = 0; i < 4; ++i) regs[i] = static_cast<uint32_t>(r[i]);
+#else
+        regs[0] = regs[1] = regs[2] = regs[3] = 0;
+        __get_cpuid_count(leaf, subleaf, &regs[0], &regs[1], &regs[2], &regs[3]);
+#endif
+    }
+
+    inline uint64_t xgetbv()
+    {
+#if defined(_MSC_VER)
+        return _xgetbv(0);
+#else
+        uint32_t eax, edx;
+        __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+        return (static_cast<uint64_t>(edx) << 32) | eax;
+#endif
+    }
+}
+
+    //
+    // highest level supported by both cpu and os (ymm/zmm state must be enabled)
+    //
+    inline Level detect()
+    {
+        uint32_t r[4];
+        detail::cpuid(0, 0, r);
+        const uint32_t max_leaf = r[0];
+
+        detail::cpuid(1, 0, r);
+        const bool sse2 = (r[3] & (1u << 26)) != 0;
+        const bool sse41 = (r[2] & (1u << 19)) != 0;
+        const bool fma = (r[2] & (1u << 12)) != 0;
+        const bool osxsave = (r[2] & (1u << 27)) != 0;
+
+        if (!sse2)
+        {
+            return Level::Scalar;
+        }
+
+        const uint64_t xcr0 = osxsave? detail::xgetbv() : 0;
+        const bool os_ymm = (xcr0 & 0x06) == 0x06;
+        const bool os_zmm = (xcr0 & 0xe6) == 0xe6;
+
+        bool avx2 = false, avx512 = false;
+        if (max_leaf >= 7)
+        {
+            detail::cpuid(7, 0, r);
+            avx2 = (r[1] & (1u << 5)) != 0;
+            const bool avx512f = (r[1] & (1u << 16)) != 0;
+            const bool avx512dq = (r[1] & (1u << 17)) != 0;
+            const bool avx512bw = (r[1] & (1u << 30)) != 0;
+            const bool avx512vl = (r[1] & (1u << 31)) != 0;
+            avx512 = avx512f && avx512dq && avx512bw && avx512vl;
+        }
+
+        if (avx512 && avx2 && fma && os_zmm) return Level::AVX512;
+        if (avx2 && fma && os_ymm)           return Level::AVX2;
+        if (sse41)                           return Level::SSE41;
+        return Level::SSE2;
+    }
+
+namespace detail
+{
+    //
+    // portable kernel bodies, auto-vectorized for the isa of the wrapper they are inlined in
+    //
+    CC_FORCEINLINE void transform_body(const mat4& m, const vec4* in, vec4* out, size_t count)
+    {
+        for (size_t i = 0; i < count; ++i) out[i] = m * in[i];
+    }
+
+    CC_FORCEINLINE void mul_body(const mat4* a, const mat4* b, mat4* out, size_t count)
+    {
+        for (size_t i = 0; i < count; ++i) out[i] = a[i] * b[i];
+    }
+
+    CC_FORCEINLINE void srgb_body(const float* in, float* out, size_t count)
+    {
+        for (size_t i = 0; i < count; ++i) out[i] = gfx::srgb(in[i]);
+    }
+
+    CC_FORCEINLINE void linear_body(const float* in, float* out, size_t count)
+    {
+        for (size_t i = 0; i < count; ++i) out[i] = gfx::linear(in[i]);
+    }
+
+    CC_FORCEINLINE void srgb4_body(const vec4* in, vec4* out, size_t count)
+    {
+        for (size_t i = 0; i < count; ++i) out[i] = gfx::srgb(in[i]);
+    }
+
+    CC_FORCEINLINE void linear4_body(const vec4* in, vec4* out, size_t count)
+    {
+        for (size_t i = 0; i < count; ++i) out[i] = gfx::linear(in[i]);
+    }
+
+    CC_FORCEINLINE void aces_body(const float* in, float* out, size_t count)
+    {
+        for (size_t i = 0; i < count; ++i) out[i] = gfx::aces(in[i]);
+    }
+
+    CC_FORCEINLINE void reinhard_body(const float* in, float* out, size_t count)
+    {
+        for (size_t i = 0; i < count; ++i) out[i] = gfx::reinhard(in[i]);
+    }
+
+    CC_FORCEINLINE void rsqrt_body(const float* in, float* out, size_t count)
+    {
+        for (size_t i = 0; i < count; ++i) out[i] = math::rsqrt(in[i]);
+    }
+
+    CC_FORCEINLINE void sincos_body(const float* in, float* s, float* c, size_t count)
+    {
+        for (size_t i = 0; i < count; ++i) math::sincosf(in[i], s + i, c + i);
+    }
+
+    //
+    // batch inverse: blocks of W matrices are transposed to SoA (one Lanes per matrix element)
+    // so that the cofactor expansion vectorizes across matrices. the per-level kernels only
+    // provide the AoS <-> SoA transposes, the math below is shared
+    //
+    template<int W>
+    struct Lanes
+    {
+        float v[W];
+    };
+
+    //
+    // inverts W matrices in SoA form with the same expansion as math::inverse(), one lane
+    // per iteration. a determinant below FLT_MIN (or NaN) gives a zero matrix and sets
+    // singular[lane], returns the number of singular lanes
+    //
+    template<int W>
+    CC_FORCEINLINE uint32_t invert_lanes(const Lanes<W> (&m)[4][4], Lanes<W> (&inv)[4][4], uint8_t* singular)
+    {
+        uint32_t flags[W];      // 32-bit like the float lanes, uint8_t stops the vectorizer
+
+        CC_SIMD_LOOP
+        for (int l = 0; l < W; ++l)
+        {
+            const float m00 = m[0][0].v[l], m01 = m[0][1].v[l], m02 = m[0][2].v[l], m03 = m[0][3].v[l];
+            const float m10 = m[1][0].v[l], m11 = m[1][1].v[l], m12 = m[1][2].v[l], m13 = m[1][3].v[l];
+            const float m20 = m[2][0].v[l], m21 = m[2][1].v[l], m22 = m[2][2].v[l], m23 = m[2][3].v[l];
+            const float m30 = m[3][0].v[l], m31 = m[3][1].v[l], m32 = m[3][2].v[l], m33 = m[3][3].v[l];
+
+            const float c00 = m22 * m33 - m32 * m23;
+            const float c02 = m12 * m33 - m32 * m13;
+            const float c03 = m12 * m23 - m22 * m13;
+            const float c04 = m21 * m33 - m31 * m23;
+            const float c06 = m11 * m33 - m31 * m13;
+            const float c07 = m11 * m23 - m21 * m13;
+            const float c08 = m21 * m32 - m31 * m22;
+            const float c10 = m11 * m32 - m31 * m12;
+            const float c11 = m11 * m22 - m21 * m12;
+            const float c12 = m20 * m33 - m30 * m23;
+            const float c14 = m10 * m33 - m30 * m13;
+            const float c15 = m10 * m23 - m20 * m13;
+            const float c16 = m20 * m32 - m30 * m22;
+            const float c18 = m10 * m32 - m30 * m12;
+            const float c19 = m10 * m22 - m20 * m12;
+            const float c20 = m20 * m31 - m30 * m21;
+            const float c22 = m10 * m31 - m30 * m11;
+            const float c23 = m10 * m21 - m20 * m11;
+
+            const float i00 =  (m11 * c00 - m12 * c04 + m13 * c08);
+            const float i01 = -(m01 * c00 - m02 * c04 + m03 * c08);
+            const float i02 =  (m01 * c02 - m02 * c06 + m03 * c10);
+            const float i03 = -(m01 * c03 - m02 * c07 + m03 * c11);
+            const float i10 = -(m10 * c00 - m12 * c12 + m13 * c16);
+            const float i11 =  (m00 * c00 - m02 * c12 + m03 * c16);
+            const float i12 = -(m00 * c02 - m02 * c14 + m03 * c18);
+            const float i13 =  (m00 * c03 - m02 * c15 + m03 * c19);
+            const float i20 =  (m10 * c04 - m11 * c12 + m13 * c20);
+            const float i21 = -(m00 * c04 - m01 * c12 + m03 * c20);
+            const float i22 =  (m00 * c06 - m01 * c14 + m03 * c22);
+            const float i23 = -(m00 * c07 - m01 * c15 + m03 * c23);
+            const float i30 = -(m10 * c08 - m11 * c16 + m12 * c20);
+            const float i31 =  (m00 * c08 - m01 * c16 + m02 * c20);
+            const float i32 = -(m00 * c10 - m01 * c18 + m02 * c22);
+            const float i33 =  (m00 * c11 - m01 * c19 + m02 * c23);
+
+            const float det = m00 * i00 + m01 * i10 + m02 * i20 + m03 * i30;
+            const bool invertible = math::abs(det) >= 1.17549435e-38f;
+            const float rdet = invertible? 1.f / det : 0.f;
+            flags[l] = !invertible;
+
+            inv[0][0].v[l] = i00 * rdet; inv[0][1].v[l] = i01 * rdet; inv[0][2].v[l] = i02 * rdet; inv[0][3].v[l] = i03 * rdet;
+            inv[1][0].v[l] = i10 * rdet; inv[1][1].v[l] = i11 * rdet; inv[1][2].v[l] = i12 * rdet; inv[1][3].v[l] = i13 * rdet;
+            inv[2][0].v[l] = i20 * rdet; inv[2][1].v[l] = i21 * rdet; inv[2][2].v[l] = i22 * rdet; inv[2][3].v[l] = i23 * rdet;
+            inv[3][0].v[l] = i30 * rdet; inv[3][1].v[l] = i31 * rdet; inv[3][2].v[l] = i32 * rdet; inv[3][3].v[l] = i33 * rdet;
+        }
+
+        uint32_t singular_count = 0;
+        for (int l = 0; l < W; ++l)
+        {
+            singular[l] = static_cast<uint8_t>(flags[l]);
+            singular_count += flags[l];
+        }
+        return singular_count;
+    }
+
+    // same as math::inverse(const mat3&)
+    template<int W>
+    CC_FORCEINLINE uint32_t invert_lanes(const Lanes<W> (&m)[3][3], Lanes<W> (&inv)[3][3], uint8_t* singular)
+    {
+        uint32_t flags[W];
+
+        CC_SIMD_LOOP
+        for (int l = 0; l < W; ++l)
+        {
+            const float m00 = m[0][0].v[l], m01 = m[0][1].v[l], m02 = m[0][2].v[l];
+            const float m10 = m[1][0].v[l], m11 = m[1][1].v[l], m12 = m[1][2].v[l];
+            const float m20 = m[2][0].v[l], m21 = m[2][1].v[l], m22 = m[2][2].v[l];
+
+            const float i00 =  (m11 * m22 - m21 * m12);
+            const float i10 = -(m10 * m22 - m20 * m12);
+            const float i20 =  (m10 * m21 - m20 * m11);
+            const float i01 = -(m01 * m22 - m21 * m02);
+            const float i11 =  (m00 * m22 - m20 * m02);
+            const float i21 = -(m00 * m21 - m20 * m01);
+            const float i02 =  (m01 * m12 - m11 * m02);
+            const float i12 = -(m00 * m12 - m10 * m02);
+            const float i22 =  (m00 * m11 - m10 * m01);
+
+            const float det = m00 * i00 + m10 * i01 + m20 * i02;
+            const bool invertible = math::abs(det) >= 1.17549435e-38f;
+            const float rdet = invertible? 1.f / det : 0.f;
+            flags[l] = !invertible;
+
+            inv[0][0].v[l] = i00 * rdet; inv[0][1].v[l] = i01 * rdet; inv[0][2].v[l] = i02 * rdet;
+            inv[1][0].v[l] = i10 * rdet; inv[1][1].v[l] = i11 * rdet; inv[1][2].v[l] = i12 * rdet;
+            inv[2][0].v[l] = i20 * rdet; inv[2][1].v[l] = i21 * rdet; inv[2][2].v[l] = i22 * rdet;
+        }
+
+        uint32_t singular_count = 0;
+        for (int l = 0; l < W; ++l)
+        {
+            singular[l] = static_cast<uint8_t>(flags[l]);
+            singular_count += flags[l];
+        }
+        return singular_count;
+    }
+
+    // plain AoS <-> SoA copies, for the scalar level and for mat3 (36 bytes, no nice shuffles)
+    template<int W, int N, typename M>
+    CC_FORCEINLINE uint32_t inverse_block(const M* in, M* out, uint8_t* singular, bool transpose)
+    {
+        Lanes<W> m[N][N], inv[N][N];
+        for (int c = 0; c < N; ++c)
+            for (int r = 0; r < N; ++r)
+                for (int l = 0; l < W; ++l)
+                    m[c][r].v[l] = in[l][c][r];
+
+        const uint32_t singular_count = invert_lanes(m, inv, singular);
+
+        for (int l = 0; l < W; ++l)
+            for (int c = 0; c < N; ++c)
+                for (int r = 0; r < N; ++r)
+                    out[l][c][r] = transpose? inv[r][c].v[l] : inv[c][r].v[l];
+
+        return singular_count;
+    }
+
+    // full blocks in place, the tail goes through a block padded with identities
+    template<int W, typename M, typename Block>
+    CC_FORCEINLINE size_t inverse_body(const M* in, M* out, uint8_t* singular, size_t count, bool transpose, Block block)
+    {
+        uint8_t flags[W];
+        size_t singular_count = 0;
+        size_t i = 0;
+        for (; i + W <= count; i += W)
+        {
+            singular_count += block(in + i, out + i, flags, transpose);
+            if (singular) std::memcpy(singular + i, flags, W);
+        }
+
+        if (i < count)
+        {
+            alignas(64) M tail_in[W];
+            alignas(64) M tail_out[W];
+            for (size_t l = 0; l < W; ++l) tail_in[l] = (i + l < count)? in[i + l] : M(1.f);
+            singular_count += block(tail_in, tail_out, flags, transpose);
+            for (size_t l = 0; i + l < count; ++l) out[i + l] = tail_out[l];
+            if (singular) std::memcpy(singular + i, flags, count - i);
+        }
+
+        return singular_count;
+    }
+
+    struct Kernels
+    {
+        void (*transform)(const mat4&, const vec4*, vec4*, size_t);
+        void (*mul)(const mat4*, const mat4*, mat4*, size_t);
+        void (*srgb)(const float*, float*, size_t);
+        void (*linear)(const float*, float*, size_t);
+        void (*srgb4)(const vec4*, vec4*, size_t);
+        void (*linear4)(const vec4*, vec4*, size_t);
+        void (*aces)(const float*, float*, size_t);
+        void (*reinhard)(const float*, float*, size_t);
+        void (*rsqrt)(const float*, float*, size_t);
+        void (*sincos)(const float*, float*, float*, size_t);
+        size_t (*inverse4)(const mat4*, mat4*, uint8_t*, size_t, bool);
+        size_t (*inverse3)(const mat3*, mat3*, uint8_t*, size_t, bool);
+    };
+}
+
+// W matrices per block, BLOCK4 is the level's mat4 block (mat3 always uses the generic one)
+#define CC_SIMD_INVERSE_KERNELS(TARGET, W, BLOCK4)                                                                                \
+    TARGET inline size_t inverse(const mat4* in, mat4* out, uint8_t* singular, size_t count, bool transpose)                      \
+    { return detail::inverse_body<W>(in, out, singular, count, transpose, BLOCK4); }                                              \
+    TARGET inline size_t inverse(const mat3* in, mat3* out, uint8_t* singular, size_t count, bool transpose)                      \
+    { return detail::inverse_body<W>(in, out, singular, count, transpose, detail::inverse_block<W, 3, mat3>); }
+
+#define CC_SIMD_GENERIC_KERNELS(TARGET)                                                                                           \
+    TARGET inline void srgb(const float* in, float* out, size_t count)               { detail::srgb_body(in, out, count); }      \
+    TARGET inline void linear(const float* in, float* out, size_t count)             { detail::linear_body(in, out, count); }    \
+    TARGET inline void srgb(const vec4* in, vec4* out, size_t count)                 { detail::srgb4_body(in, out, count); }     \
+    TARGET inline void linear(const vec4* in, vec4* out, size_t count)               { detail::linear4_body(in, out, count); }   \
+    TARGET inline void aces(const float* in, float* out, size_t count)               { detail::aces_body(in, out, count); }      \
+    TARGET inline void reinhard(const float* in, float* out, size_t count)           { detail::reinhard_body(in, out, count); }  \
+    TARGET inline void rsqrt(const float* in, float* out, size_t count)              { detail::rsqrt_body(in, out, count); }     \
+    TARGET inline void sincos(const float* in, float* s, float* c, size_t count)     { detail::sincos_body(in, s, c, count); }
+
+namespace scalar
+{
+    inline void transform(const mat4& m, const vec4* in, vec4* out, size_t count) { detail::transform_body(m, in, out, count); }
+    inline void mul(const mat4* a, const mat4* b, mat4* out, size_t count)        { detail::mul_body(a, b, out, count); }
+    CC_SIMD_GENERIC_KERNELS()
+    CC_SIMD_INVERSE_KERNELS(, 4, (detail::inverse_block<4, 4, mat4>))
+}
+
+namespace sse2
+{
+    CC_TARGET_SSE2 inline void transform(const mat4& m, const vec4* in, vec4* out, size_t count)
+    {
+        const __m128 c0 = _mm_load_ps(m[0].v);
+        const __m128 c1 = _mm_load_ps(m[1].v);
+        const __m128 c2 = _mm_load_ps(m[2].v);
+        const __m128 c3 = _mm_load_ps(m[3].v);
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            const __m128 v = _mm_load_ps(in[i].v);
+            __m128 r = _mm_mul_ps(c0, _mm_shuffle_ps(v, v, _MM_SHUFFLE(0, 0, 0, 0)));
+            r = _mm_add_ps(r, _mm_mul_ps(c1, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1))));
+            r = _mm_add_ps(r, _mm_mul_ps(c2, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 2, 2))));
+            r = _mm_add_ps(r, _mm_mul_ps(c3, _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3))));
+            _mm_store_ps(out[i].v, r);
+        }
+    }
+
+    CC_TARGET_SSE2 inline void mul(const mat4* a, const mat4* b, mat4* out, size_t count)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            const __m128 a0 = _mm_load_ps(a[i][0].v);
+            const __m128 a1 = _mm_load_ps(a[i][1].v);
+            const __m128 a2 = _mm_load_ps(a[i][2].v);
+            const __m128 a3 = _mm_load_ps(a[i][3].v);
+
+            for (int j = 0; j < 4; ++j)
+            {
+                const __m128 v = _mm_load_ps(b[i][j].v);
+                __m128 r = _mm_mul_ps(a0, _mm_shuffle_ps(v, v, _MM_SHUFFLE(0, 0, 0, 0)));
+                r = _mm_add_ps(r, _mm_mul_ps(a1, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1))));
+                r = _mm_add_ps(r, _mm_mul_ps(a2, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 2, 2))));
+                r = _mm_add_ps(r, _mm_mul_ps(a3, _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3))));
+                _mm_store_ps(out[i][j].v, r);
+            }
+        }
+    }
+
+    // 4 matrices per block, one _MM_TRANSPOSE4_PS per column
+    CC_TARGET_SSE2 CC_FORCEINLINE uint32_t inverse_block(const mat4* in, mat4* out, uint8_t* singular, bool transpose)
+    {
+        detail::Lanes<4> m[4][4], inv[4][4];
+        for (int c = 0; c < 4; ++c)
+        {
+            __m128 r0 = _mm_load_ps(in[0][c].v);
+            __m128 r1 = _mm_load_ps(in[1][c].v);
+            __m128 r2 = _mm_load_ps(in[2][c].v);
+            __m128 r3 = _mm_load_ps(in[3][c].v);
+            _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+            _mm_storeu_ps(m[c][0].v, r0);
+            _mm_storeu_ps(m[c][1].v, r1);
+            _mm_storeu_ps(m[c][2].v, r2);
+            _mm_storeu_ps(m[c][3].v, r3);
+        }
+
+        const uint32_t singular_count = detail::invert_lanes(m, inv, singular);
+
+        for (int c = 0; c < 4; ++c)
+        {
+            __m128 r0 = _mm_loadu_ps(transpose? inv[0][c].v : inv[c][0].v);
+            __m128 r1 = _mm_loadu_ps(transpose? inv[1][c].v : inv[c][1].v);
+            __m128 r2 = _mm_loadu_ps(transpose? inv[2][c].v : inv[c][2].v);
+            __m128 r3 = _mm_loadu_ps(transpose? inv[3][c].v : inv[c][3].v);
+            _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+            _mm_store_ps(out[0][c].v, r0);
+            _mm_store_ps(out[1][c].v, r1);
+            _mm_store_ps(out[2][c].v, r2);
+            _mm_store_ps(out[3][c].v, r3);
+        }
+
+        return singular_count;
+    }
+
+    CC_SIMD_GENERIC_KERNELS(CC_TARGET_SSE2)
+    CC_SIMD_INVERSE_KERNELS(CC_TARGET_SSE2, 4, inverse_block)
+}
+
+namespace sse41
+{
+    // nothing in sse4.1 helps a column-major mat4 * vec4, only generic kernels gain from it
+    using sse2::transform;
+    using sse2::mul;
+    CC_SIMD_GENERIC_KERNELS(CC_TARGET_SSE41)
+    CC_SIMD_INVERSE_KERNELS(CC_TARGET_SSE41, 4, sse2::inverse_block)
+}
+
+namespace avx2
+{
+    CC_TARGET_AVX2 inline void transform(const mat4& m, const vec4* in, vec4* out, size_t count)
+    {
+        const __m256 c0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(m[0].v));
+        const __m256 c1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(m[1].v));
+        const __m256 c2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(m[2].v));
+        const __m256 c3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(m[3].v));
+
+        size_t i = 0;
+        for (; i + 2 <= count; i += 2)
+        {
+            const __m256 v = _mm256_loadu_ps(in[i].v);
+            __m256 r = _mm256_mul_ps(c0, _mm256_permute_ps(v, _MM_SHUFFLE(0, 0, 0, 0)));
+            r = _mm256_fmadd_ps(c1, _mm256_permute_ps(v, _MM_SHUFFLE(1, 1, 1, 1)), r);
+            r = _mm256_fmadd_ps(c2, _mm256_permute_ps(v, _MM_SHUFFLE(2, 2, 2, 2)), r);
+            r = _mm256_fmadd_ps(c3, _mm256_permute_ps(v, _MM_SHUFFLE(3, 3, 3, 3)), r);
+            _mm256_storeu_ps(out[i].v, r);
+        }
+
+        if (i < count)
+        {
+            sse2::transform(m, in + i, out + i, count - i);
+        }
+    }
+
+    CC_TARGET_AVX2 inline void mul(const mat4* a, const mat4* b, mat4* out, size_t count)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            const __m256 a0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a[i][0].v));
+            const __m256 a1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a[i][1].v));
+            const __m256 a2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a[i][2].v));
+            const __m256 a3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a[i][3].v));
+
+            for (int j = 0; j < 4; j += 2)
+            {
+                const __m256 v = _mm256_load_ps(b[i][j].v);
+                __m256 r = _mm256_mul_ps(a0, _mm256_permute_ps(v, _MM_SHUFFLE(0, 0, 0, 0)));
+                r = _mm256_fmadd_ps(a1, _mm256_permute_ps(v, _MM_SHUFFLE(1, 1, 1, 1)), r);
+                r = _mm256_fmadd_ps(a2, _mm256_permute_ps(v, _MM_SHUFFLE(2, 2, 2, 2)), r);
+                r = _mm256_fmadd_ps(a3, _mm256_permute_ps(v, _MM_SHUFFLE(3, 3, 3, 3)), r);
+                _mm256_store_ps(out[i][j].v, r);
+            }
+        }
+    }
+
+    //
+    // 8 matrices per block: matrix l and l + 4 share a ymm (one per 128-bit half),
+    // then an in-lane 4x4 transpose leaves element (c, r) of all 8 matrices in one register
+    //
+    CC_TARGET_AVX2 CC_FORCEINLINE void transpose_halves(__m256& r0, __m256& r1, __m256& r2, __m256& r3)
+    {
+        const __m256 t0 = _mm256_unpacklo_ps(r0, r1);
+        const __m256 t1 = _mm256_unpacklo_ps(r2, r3);
+        const __m256 t2 = _mm256_unpackhi_ps(r0, r1);
+        const __m256 t3 = _mm256_unpackhi_ps(r2, r3);
+        r0 = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(1, 0, 1, 0));
+        r1 = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(3, 2, 3, 2));
+        r2 = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(1, 0, 1, 0));
+        r3 = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(3, 2, 3, 2));
+    }
+
+    CC_TARGET_AVX2 CC_FORCEINLINE __m256 load_pair(const mat4* in, int l, int c)
+    {
+        return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_load_ps(in[l][c].v)), _mm_load_ps(in[l + 4][c].v), 1);
+    }
+
+    CC_TARGET_AVX2 CC_FORCEINLINE uint32_t inverse_block(const mat4* in, mat4* out, uint8_t* singular, bool transpose)
+    {
+        detail::Lanes<8> m[4][4], inv[4][4];
+        for (int c = 0; c < 4; ++c)
+        {
+            __m256 r0 = load_pair(in, 0, c);
+            __m256 r1 = load_pair(in, 1, c);
+            __m256 r2 = load_pair(in, 2, c);
+            __m256 r3 = load_pair(in, 3, c);
+            transpose_halves(r0, r1, r2, r3);
+            _mm256_storeu_ps(m[c][0].v, r0);
+            _mm256_storeu_ps(m[c][1].v, r1);
+            _mm256_storeu_ps(m[c][2].v, r2);
+            _mm256_storeu_ps(m[c][3].v, r3);
+        }
+
+        const uint32_t singular_count = detail::invert_lanes(m, inv, singular);
+
+        for (int c = 0; c < 4; ++c)
+        {
+            __m256 r[4];
+            for (int k = 0; k < 4; ++k) r[k] = _mm256_loadu_ps(transpose? inv[k][c].v : inv[c][k].v);
+            transpose_halves(r[0], r[1], r[2], r[3]);
+            for (int l = 0; l < 4; ++l)
+            {
+                _mm_store_ps(out[l][c].v, _mm256_castps256_ps128(r[l]));
+                _mm_store_ps(out[l + 4][c].v, _mm256_extractf128_ps(r[l], 1));
+            }
+        }
+
+        return singular_count;
+    }
+
+    CC_SIMD_GENERIC_KERNELS(CC_TARGET_AVX2)
+    CC_SIMD_INVERSE_KERNELS(CC_TARGET_AVX2, 8, inverse_block)
+}
+
+// gcc 12 warns on _mm512_undefined_ps() inside the avx512 intrinsics themselves
+#if defined(__GNUC__) && !defined(__clang__)
+ #pragma GCC diagnostic push
+ #pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+ #pragma GCC diagnostic ignored "-Wuninitialized"
+#endif
+
+namespace avx512
+{
+    CC_TARGET_AVX512 inline void transform(const mat4& m, const vec4* in, vec4* out, size_t count)
+    {
+        const __m512 c0 = _mm512_broadcast_f32x4(_mm_load_ps(m[0].v));
+        const __m512 c1 = _mm512_broadcast_f32x4(_mm_load_ps(m[1].v));
+        const __m512 c2 = _mm512_broadcast_f32x4(_mm_load_ps(m[2].v));
+        const __m512 c3 = _mm512_broadcast_f32x4(_mm_load_ps(m[3].v));
+
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            const __m512 v = _mm512_loadu_ps(in[i].v);
+            __m512 r = _mm512_mul_ps(c0, _mm512_permute_ps(v, _MM_SHUFFLE(0, 0, 0, 0)));
+            r = _mm512_fmadd_ps(c1, _mm512_permute_ps(v, _MM_SHUFFLE(1, 1, 1, 1)), r);
+            r = _mm512_fmadd_ps(c2, _mm512_permute_ps(v, _MM_SHUFFLE(2, 2, 2, 2)), r);
+            r = _mm512_fmadd_ps(c3, _mm512_permute_ps(v, _MM_SHUFFLE(3, 3, 3, 3)), r);
+            _mm512_storeu_ps(out[i].v, r);
+        }
+
+        if (i < count)
+        {
+            avx2::transform(m, in + i, out + i, count - i);
+        }
+    }
+
+    CC_TARGET_AVX512 inline void mul(const mat4* a, const mat4* b, mat4* out, size_t count)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            // mat4 is 64-byte aligned: one zmm holds all four columns of b
+            const __m512 v = _mm512_load_ps(b[i][0].v);
+            __m512 r = _mm512_mul_ps(_mm512_broadcast_f32x4(_mm_load_ps(a[i][0].v)), _mm512_permute_ps(v, _MM_SHUFFLE(0, 0, 0, 0)));
+            r = _mm512_fmadd_ps(_mm512_broadcast_f32x4(_mm_load_ps(a[i][1].v)), _mm512_permute_ps(v, _MM_SHUFFLE(1, 1, 1, 1)), r);
+            r = _mm512_fmadd_ps(_mm512_broadcast_f32x4(_mm_load_ps(a[i][2].v)), _mm512_permute_ps(v, _MM_SHUFFLE(2, 2, 2, 2)), r);
+            r = _mm512_fmadd_ps(_mm512_broadcast_f32x4(_mm_load_ps(a[i][3].v)), _mm512_permute_ps(v, _MM_SHUFFLE(3, 3, 3, 3)), r);
+            _mm512_store_ps(out[i][0].v, r);
+        }
+    }
+
+    // same as avx2 with four 128-bit lanes: matrices l, l + 4, l + 8, l + 12 share a zmm
+    CC_TARGET_AVX512 CC_FORCEINLINE void transpose_lanes(__m512& r0, __m512& r1, __m512& r2, __m512& r3)
+    {
+        const __m512 t0 = _mm512_unpacklo_ps(r0, r1);
+        const __m512 t1 = _mm512_unpacklo_ps(r2, r3);
+        const __m512 t2 = _mm512_unpackhi_ps(r0, r1);
+        const __m512 t3 = _mm512_unpackhi_ps(r2, r3);
+        r0 = _mm512_shuffle_ps(t0, t1, _MM_SHUFFLE(1, 0, 1, 0));
+        r1 = _mm512_shuffle_ps(t0, t1, _MM_SHUFFLE(3, 2, 3, 2));
+        r2 = _mm512_shuffle_ps(t2, t3, _MM_SHUFFLE(1, 0, 1, 0));
+        r3 = _mm512_shuffle_ps(t2, t3, _MM_SHUFFLE(3, 2, 3, 2));
+    }
+
+    CC_TARGET_AVX512 CC_FORCEINLINE __m512 load_quad(const mat4* in, int l, int c)
+    {
+        __m512 r = _mm512_castps128_ps512(_mm_load_ps(in[l][c].v));
+        r = _mm512_insertf32x4(r, _mm_load_ps(in[l + 4][c].v), 1);
+        r = _mm512_insertf32x4(r, _mm_load_ps(in[l + 8][c].v), 2);
+        return _mm512_insertf32x4(r, _mm_load_ps(in[l + 12][c].v), 3);
+    }
+
+    CC_TARGET_AVX512 CC_FORCEINLINE uint32_t inverse_block(const mat4* in, mat4* out, uint8_t* singular, bool transpose)
+    {
+        detail::Lanes<16> m[4][4], inv[4][4];
+        for (int c = 0; c < 4; ++c)
+        {
+            __m512 r0 = load_quad(in, 0, c);
+            __m512 r1 = load_quad(in, 1, c);
+            __m512 r2 = load_quad(in, 2, c);
+            __m512 r3 = load_quad(in, 3, c);
+            transpose_lanes(r0, r1, r2, r3);
+            _mm512_storeu_ps(m[c][0].v, r0);
+            _mm512_storeu_ps(m[c][1].v, r1);
+            _mm512_storeu_ps(m[c][2].v, r2);
+            _mm512_storeu_ps(m[c][3].v, r3);
+        }
+
+        const uint32_t singular_count = detail::invert_lanes(m, inv, singular);
+
+        for (int c = 0; c < 4; ++c)
+        {
+            __m512 r[4];
+            for (int k = 0; k < 4; ++k) r[k] = _mm512_loadu_ps(transpose? inv[k][c].v : inv[c][k].v);
+            transpose_lanes(r[0], r[1], r[2], r[3]);
+            for (int l = 0; l < 4; ++l)
+            {
+                _mm_store_ps(out[l][c].v, _mm512_castps512_ps128(r[l]));
+                _mm_store_ps(out[l + 4][c].v, _mm512_extractf32x4_ps(r[l], 1));
+                _mm_store_ps(out[l + 8][c].v, _mm512_extractf32x4_ps(r[l], 2));
+                _mm_store_ps(out[l + 12][c].v, _mm512_extractf32x4_ps(r[l], 3));
+            }
+        }
+
+        return singular_count;
+    }
+
+    CC_SIMD_GENERIC_KERNELS(CC_TARGET_AVX512)
+    CC_SIMD_INVERSE_KERNELS(CC_TARGET_AVX512, 16, inverse_block)
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+ #pragma GCC diagnostic pop
+#endif
+
+#undef CC_SIMD_GENERIC_KERNELS
+#undef CC_SIMD_INVERSE_KERNELS
+
+namespace detail
+{
+    inline Kernels kernels_for(Level level)
+    {
+        switch (level)
+        {
+        case Level::AVX512: return { avx512::transform, avx512::mul, avx512::srgb, avx512::linear, avx512::srgb, avx512::linear, avx512::aces, avx512::reinhard, avx512::rsqrt, avx512::sincos, avx512::inverse, avx512::inverse };
+        case Level::AVX2:   return { avx2::transform, avx2::mul, avx2::srgb, avx2::linear, avx2::srgb, avx2::linear, avx2::aces, avx2::reinhard, avx2::rsqrt, avx2::sincos, avx2::inverse, avx2::inverse };
+        case Level::SSE41:  return { sse41::transform, sse41::mul, sse41::srgb, sse41::linear, sse41::srgb, sse41::linear, sse41::aces, sse41::reinhard, sse41::rsqrt, sse41::sincos, sse41::inverse, sse41::inverse };
+        case Level::SSE2:   return { sse2::transform, sse2::mul, sse2::srgb, sse2::linear, sse2::srgb, sse2::linear, sse2::aces, sse2::reinhard, sse2::rsqrt, sse2::sincos, sse2::inverse, sse2::inverse };
+        default:            return { scalar::transform, scalar::mul, scalar::srgb, scalar::linear, scalar::srgb, scalar::linear, scalar::aces, scalar::reinhard, scalar::rsqrt, scalar::sincos, scalar::inverse, scalar::inverse };
+        }
+    }
+
+    inline Level level_from_env(Level fallback)
+    {
+        if (const char* env = std::getenv("CC_SIMD_LEVEL"))
+        {
+            for (uint32_t i = 0; i < static_cast<uint32_t>(Level::Count); ++i)
+            {
+                if (std::strcmp(env, level_name(static_cast<Level>(i))) == 0)
+                {
+                    return static_cast<Level>(i);
+                }
+            }
+        }
+        return fallback;
+    }
+
+    struct Dispatch
+    {
+        Level level;
+        Kernels kernels;
+
+        Dispatch()
+        {
+            const Level supported = detect();
+            level = math::min(level_from_env(supported), supported);
+            kernels = kernels_for(level);
+        }
+    };
+
+    // resolved once, on first use (thread-safe static init)
+    inline Dispatch& dispatch()
+    {
+        static Dispatch instance;
+        return instance;
+    }
+}
+
+    //
+    // active level (CC_SIMD_LEVEL env var can lower it, e.g. CC_SIMD_LEVEL=sse2)
+    //
+    inline Level level()
+    {
+        return detail::dispatch().level;
+    }
+
+    //
+    // force a level, meant for tests and benchmarks: not thread-safe w.r.t. running kernels.
+    // levels above what the cpu supports are clamped, the selected one is returned
+    //
+    inline Level force(Level level)
+    {
+        detail::Dispatch& d = detail::dispatch();
+        d.level = math::min(level, detect());
+        d.kernels = detail::kernels_for(d.level);
+        return d.level;
+    }
+
+    //
+    // batch kernels
+    //
+    inline void transform(const mat4& m, const vec4* in, vec4* out, size_t count)      { detail::dispatch().kernels.transform(m, in, out, count); }
+    inline void mul(const mat4* a, const mat4* b, mat4* out, size_t count)             { detail::dispatch().kernels.mul(a, b, out, count); }
+    inline void srgb(const float* in, float* out, size_t count)                        { detail::dispatch().kernels.srgb(in, out, count); }
+    inline void linear(const float* in, float* out, size_t count)                      { detail::dispatch().kernels.linear(in, out, count); }
+    inline void srgb(const vec4* in, vec4* out, size_t count)                          { detail::dispatch().kernels.srgb4(in, out, count); }
+    inline void linear(const vec4* in, vec4* out, size_t count)                        { detail::dispatch().kernels.linear4(in, out, count); }
+    inline void aces(const float* in, float* out, size_t count)                        { detail::dispatch().kernels.aces(in, out, count); }
+    inline void reinhard(const float* in, float* out, size_t count)                    { detail::dispatch().kernels.reinhard(in, out, count); }
+    inline void rsqrt(const float* in, float* out, size_t count)                       { detail::dispatch().kernels.rsqrt(in, out, count); }
+    inline void sincos(const float* in, float* s, float* c, size_t count)              { detail::dispatch().kernels.sincos(in, s, c, count); }
+
+    //
+    // batch inverse / inverse-transpose (normal matrices). a matrix whose determinant is
+    // below FLT_MIN is written as zeros and flagged in singular[i] (if not null).
+    // in == out is allowed, the number of singular matrices is returned
+    //
+    inline size_t inverse(const mat4* in, mat4* out, size_t count, uint8_t* singular = nullptr)
+    {
+        return detail::dispatch().kernels.inverse4(in, out, singular, count, false);
+    }
+
+    inline size_t inverse_transpose(const mat4* in, mat4* out, size_t count, uint8_t* singular = nullptr)
+    {
+        return detail::dispatch().kernels.inverse4(in, out, singular, count, true);
+    }
+
+    inline size_t inverse(const mat3* in, mat3* out, size_t count, uint8_t* singular = nullptr)
+    {
+        return detail::dispatch().kernels.inverse3(in, out, singular, count, false);
+    }
+
+    inline size_t inverse_transpose(const mat3* in, mat3* out, size_t count, uint8_t* singular = nullptr)
+    {
+        return detail::dispatch().kernels.inverse3(in, out, singular, count, true);
+    }
+}
+}
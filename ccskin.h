@@ -0,0 +1,310 @@
+/*
+ * CCLib
+ *
+ * collection of utils i use in most projects.
+ * maybe it will evolve in a framework, maybe not
+ *
+ * (c) 2018 Carlo Casta <carlo.casta at gmail.com>
+ */
+#pragma once
+
+//
+// vertex skinning with up to four bones per vertex:
+//
+//   cc::skin::Mesh mesh{ positions, normals, joints, weights, count };      // bind pose streams
+//   cc::skin::linear_blend(mesh, palette, out_positions, out_normals);        // parallel
+//
+//   cc::skin::dual_quats(palette, dq_palette, bones);
+//   cc::skin::dual_quaternion(mesh, dq_palette, out_positions, out_normals);
+//
+// palette entries are bind-to-pose matrices (inverse bind times bone world). linear blend
+// weights are expected to sum to 1, normals go through the blended upper 3x3 and are
+// renormalized (exact for rigid and uniformly scaled bones). dual quaternion skinning only
+// takes rotation and translation and doesn't need normalized weights.
+//
+
+#include <cmath>
+#include <cstdint>
+#include "cclib.h"
+#include "ccvector.h"
+#include "ccsimd.h"
+#include "ccparallel.h"
+
+namespace cc
+{
+namespace skin
+{
+    using math::vec3;
+    using math::vec4;
+    using math::mat4;
+
+    // bone indices of a vertex, unused slots need a valid index and weight 0
+    struct Joints
+    {
+        uint16_t index[4];
+    };
+
+    // unit rotation quaternion (x, y, z, w) and dual part 0.5 * translation * real
+    struct DualQuat
+    {
+        vec4 real;
+        vec4 dual;
+    };
+
+    // input streams, count entries each. normals are optional
+    struct Mesh
+    {
+        const vec3* positions;
+        const vec3* normals;
+        const Joints* joints;
+        const vec4* weights;
+        size_t count;
+    };
+
+    // rotation and translation of a rigid transform (no scale, no shear)
+    inline DualQuat dual_quat(const mat4& m)
+    {
+        // m[column][row]
+        const float trace = m[0].x + m[1].y + m[2].z;
+        vec4 q;
+        if (trace > 0.f)
+        {
+            const float s = 2.f * std::sqrt(trace + 1.f);
+            q = vec4((m[1].z - m[2].y) / s, (m[2].x - m[0].z) / s, (m[0].y - m[1].x) / s, .25f * s);
+        }
+        else if (m[0].x > m[1].y && m[0].x > m[2].z)
+        {
+            const float s = 2.f * std::sqrt(1.f + m[0].x - m[1].y - m[2].z);
+            q = vec4(.25f * s, (m[1].x + m[0].y) / s, (m[2].x + m[0].z) / s, (m[1].z - m[2].y) / s);
+        }
+        else if (m[1].y > m[2].z)
+        {
+            const float s = 2.f * std::sqrt(1.f + m[1].y - m[0].x - m[2].z);
+            q = vec4((m[1].x + m[0].y) / s, .25f * s, (m[2].y + m[1].z) / s, (m[2].x - m[0].z) / s);
+        }
+        else
+        {
+            const float s = 2.f * std::sqrt(1.f + m[2].z - m[0].x - m[1].y);
+            q = vec4((m[2].x + m[0].z) / s, (m[2].y + m[1].z) / s, .25f * s, (m[0].y - m[1].x) / s);
+        }
+        q = q * (1.f / std::sqrt(q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w));
+
+        const vec3 t = vec3(m[3].x, m[3].y, m[3].z) * .5f;
+        const vec4 d( t.x * q.w + t.y * q.z - t.z * q.y,
+                     -t.x * q.z + t.y * q.w + t.z * q.x,
+                      t.x * q.y - t.y * q.x + t.z * q.w,
+                     -t.x * q.x - t.y * q.y - t.z * q.z);
+        return DualQuat{ q, d };
+    }
+
+    inline void dual_quats(const mat4* palette, DualQuat* out, size_t count)
+    {
+        for (size_t i = 0; i < count; ++i) out[i] = dual_quat(palette[i]);
+    }
+
+namespace detail
+{
+    // vertices per round: blended bones as rows of a table, then transforms in simd over the rows
+    constexpr uint32_t BLOCK = 64;
+
+    // vertices per task
+    constexpr size_t GRAIN = 64 * BLOCK;
+
+    //
+    // the four columns of each bone blended as one 16 float row (a single zmm at avx512),
+    // positions and normals then go through the rows in simd over vertices. the normal
+    // lengths are inverted out of the simd loop: std::sqrt sets errno and gcc won't
+    // vectorize around it
+    //
+    CC_FORCEINLINE void linear_blend_body(const mat4* palette, const Mesh& mesh, size_t first, size_t last, vec3* positions, vec3* normals)
+    {
+        alignas(64) float m[BLOCK][16];
+        float scale[BLOCK];
+
+        for (; first < last; first += BLOCK)
+        {
+            const uint32_t n = uint32_t(math::min<size_t>(BLOCK, last - first));
+
+            for (uint32_t i = 0; i < n; ++i)
+            {
+                const uint16_t* index = mesh.joints[first + i].index;
+                const vec4 w = mesh.weights[first + i];
+                const float* b0 = palette[index[0]][0].v;
+                const float* b1 = palette[index[1]][0].v;
+                const float* b2 = palette[index[2]][0].v;
+                const float* b3 = palette[index[3]][0].v;
+
+                CC_SIMD_LOOP
+                for (uint32_t k = 0; k < 16; ++k)
+                {
+                    m[i][k] = w.x * b0[k] + w.y * b1[k] + w.z * b2[k] + w.w * b3[k];
+                }
+            }
+
+            const vec3* in = mesh.positions + first;
+            vec3* out = positions + first;
+            CC_SIMD_LOOP
+            for (uint32_t i = 0; i < n; ++i)
+            {
+                const float x = in[i].x, y = in[i].y, z = in[i].z;
+                out[i].x = m[i][0] * x + m[i][4] * y + m[i][8] * z + m[i][12];
+                out[i].y = m[i][1] * x + m[i][5] * y + m[i][9] * z + m[i][13];
+                out[i].z = m[i][2] * x + m[i][6] * y + m[i][10] * z + m[i][14];
+            }
+
+            if (normals && mesh.normals)
+            {
+                in = mesh.normals + first;
+                out = normals + first;
+                CC_SIMD_LOOP
+                for (uint32_t i = 0; i < n; ++i)
+                {
+                    const float x = in[i].x, y = in[i].y, z = in[i].z;
+                    const float tx = m[i][0] * x + m[i][4] * y + m[i][8] * z;
+                    const float ty = m[i][1] * x + m[i][5] * y + m[i][9] * z;
+                    const float tz = m[i][2] * x + m[i][6] * y + m[i][10] * z;
+                    out[i].x = tx;
+                    out[i].y = ty;
+                    out[i].z = tz;
+                    scale[i] = tx * tx + ty * ty + tz * tz;
+                }
+
+                for (uint32_t i = 0; i < n; ++i)
+                {
+                    scale[i] = 1.f / std::sqrt(math::max(scale[i], 1.e-30f));
+                }
+
+                CC_SIMD_LOOP
+                for (uint32_t i = 0; i < n; ++i)
+                {
+                    out[i].x *= scale[i];
+                    out[i].y *= scale[i];
+                    out[i].z *= scale[i];
+                }
+            }
+        }
+    }
+
+    //
+    // real and dual parts blended as one 8 float row, with the weight of a bone negated
+    // when its rotation is on the other side of the first one (shortest path). the blend
+    // is not normalized: rotating by q / |q| and translating by 2 d q* / |q|^2 only needs a
+    // division, no sqrt, and the transform vectorizes over the rows
+    //
+    CC_FORCEINLINE void dual_quaternion_body(const DualQuat* palette, const Mesh& mesh, size_t first, size_t last, vec3* positions, vec3* normals)
+    {
+        alignas(32) float q[BLOCK][8];
+
+        for (; first < last; first += BLOCK)
+        {
+            const uint32_t n = uint32_t(math::min<size_t>(BLOCK, last - first));
+
+            for (uint32_t i = 0; i < n; ++i)
+            {
+                const uint16_t* index = mesh.joints[first + i].index;
+                const vec4 w = mesh.weights[first + i];
+                const float* q0 = palette[index[0]].real.v;
+                const float* q1 = palette[index[1]].real.v;
+                const float* q2 = palette[index[2]].real.v;
+                const float* q3 = palette[index[3]].real.v;
+
+                const float w1 = std::copysign(w.y, q0[0] * q1[0] + q0[1] * q1[1] + q0[2] * q1[2] + q0[3] * q1[3]);
+                const float w2 = std::copysign(w.z, q0[0] * q2[0] + q0[1] * q2[1] + q0[2] * q2[2] + q0[3] * q2[3]);
+                const float w3 = std::copysign(w.w, q0[0] * q3[0] + q0[1] * q3[1] + q0[2] * q3[2] + q0[3] * q3[3]);
+
+                CC_SIMD_LOOP
+                for (uint32_t k = 0; k < 8; ++k)
+                {
+                    q[i][k] = w.x * q0[k] + w1 * q1[k] + w2 * q2[k] + w3 * q3[k];
+                }
+            }
+
+            const vec3* in = mesh.positions + first;
+            vec3* out = positions + first;
+            CC_SIMD_LOOP
+            for (uint32_t i = 0; i < n; ++i)
+            {
+                const float rx = q[i][0], ry = q[i][1], rz = q[i][2], rw = q[i][3];
+                const float dx = q[i][4], dy = q[i][5], dz = q[i][6], dw = q[i][7];
+                const float s = 2.f / (rx * rx + ry * ry + rz * rz + rw * rw);
+
+                // v + s * r x (r x v + rw v) + s * (rw d - dw r + r x d)
+                const float x = in[i].x, y = in[i].y, z = in[i].z;
+                const float cx = ry * z - rz * y + rw * x;
+                const float cy = rz * x - rx * z + rw * y;
+                const float cz = rx * y - ry * x + rw * z;
+                out[i].x = x + s * (ry * cz - rz * cy + rw * dx - dw * rx + ry * dz - rz * dy);
+                out[i].y = y + s * (rz * cx - rx * cz + rw * dy - dw * ry + rz * dx - rx * dz);
+                out[i].z = z + s * (rx * cy - ry * cx + rw * dz - dw * rz + rx * dy - ry * dx);
+            }
+
+            if (normals && mesh.normals)
+            {
+                in = mesh.normals + first;
+                out = normals + first;
+                CC_SIMD_LOOP
+                for (uint32_t i = 0; i < n; ++i)
+                {
+                    const float rx = q[i][0], ry = q[i][1], rz = q[i][2], rw = q[i][3];
+                    const float s = 2.f / (rx * rx + ry * ry + rz * rz + rw * rw);
+
+                    const float x = in[i].x, y = in[i].y, z = in[i].z;
+                    const float cx = ry * z - rz * y + rw * x;
+                    const float cy = rz * x - rx * z + rw * y;
+                    const float cz = rx * y - ry * x + rw * z;
+                    out[i].x = x + s * (ry * cz - rz * cy);
+                    out[i].y = y + s * (rz * cx - rx * cz);
+                    out[i].z = z + s * (rx * cy - ry * cx);
+                }
+            }
+        }
+    }
+
+#define CC_SKIN_KERNELS(TARGET, SUFFIX)                                                                                                 \
+    TARGET inline void linear_blend##SUFFIX(const mat4* palette, const Mesh& mesh, size_t first, size_t last, vec3* positions, vec3* normals)       \
+    { linear_blend_body(palette, mesh, first, last, positions, normals); }                                                             \
+    TARGET inline void dual_quaternion##SUFFIX(const DualQuat* palette, const Mesh& mesh, size_t first, size_t last, vec3* positions, vec3* normals) \
+    { dual_quaternion_body(palette, mesh, first, last, positions, normals); }
+
+    CC_SKIN_KERNELS(, _generic)
+    CC_SKIN_KERNELS(CC_TARGET_AVX2, _avx2)
+    CC_SKIN_KERNELS(CC_TARGET_AVX512, _avx512)
+
+#undef CC_SKIN_KERNELS
+
+    struct Kernels
+    {
+        void (*linear_blend)(const mat4*, const Mesh&, size_t, size_t, vec3*, vec3*);
+        void (*dual_quaternion)(const DualQuat*, const Mesh&, size_t, size_t, vec3*, vec3*);
+    };
+
+    // widest kernels the active simd level allows (see simd::level())
+    inline Kernels kernels()
+    {
+        const simd::Level level = simd::level();
+        if (level >= simd::Level::AVX512) return Kernels{ linear_blend_avx512, dual_quaternion_avx512 };
+        if (level >= simd::Level::AVX2)   return Kernels{ linear_blend_avx2, dual_quaternion_avx2 };
+        return Kernels{ linear_blend_generic, dual_quaternion_generic };
+    }
+}
+
+    // skinned positions (and normals, if both streams are given) of every vertex of mesh
+    inline void linear_blend(const Mesh& mesh, const mat4* palette, vec3* positions, vec3* normals = nullptr, ThreadPool& pool = ThreadPool::global())
+    {
+        const auto kernel = detail::kernels().linear_blend;
+        pool.parallel_for(size_t(0), mesh.count, [&](size_t first, size_t last)
+        {
+            kernel(palette, mesh, first, last, positions, normals);
+        }, detail::GRAIN);
+    }
+
+    inline void dual_quaternion(const Mesh& mesh, const DualQuat* palette, vec3* positions, vec3* normals = nullptr, ThreadPool& pool = ThreadPool::global())
+    {
+        const auto kernel = detail::kernels().dual_quaternion;
+        pool.parallel_for(size_t(0), mesh.count, [&](size_t first, size_t last)
+        {
+            kernel(palette, mesh, first, last, positions, normals);
+        }, detail::GRAIN);
+    }
+}
+}
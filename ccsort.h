@@ -0,0 +1,192 @@
+/*
+ * CCLib
+ *
+ * collection of utils i use in most projects.
+ * maybe it will evolve in a framework, maybe not
+ *
+ * (c) 2018 Carlo Casta <carlo.casta at gmail.com>
+ */
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include "cclib.h"
+#include "ccvector.h"
+#include "ccparallel.h"
+
+namespace cc
+{
+namespace detail
+{
+    constexpr uint32_t RADIX_BITS = 11;
+    constexpr uint32_t RADIX_BUCKETS = 1u << RADIX_BITS;
+
+    // below this many pairs a single chunk is used, the pool overhead is not worth it
+    constexpr size_t RADIX_SERIAL_THRESHOLD = 1 << 16;
+
+    // chunk c covers [c * size, min((c + 1) * size, count))
+    struct RadixChunks
+    {
+        size_t count;
+        size_t chunks;
+        size_t size;
+
+        size_t first(size_t c) const    { return math::min(c * size, count); }
+        size_t last(size_t c) const     { return math::min((c + 1) * size, count); }
+    };
+}
+
+    //
+    // stable LSD radix sort of key/value pairs, 11 bits per pass: scattering to 2048 buckets
+    // costs about as much as to 256 and 64-bit keys take 6 passes instead of 8. the input is
+    // split in a fixed number of chunks, every pass histograms each chunk in parallel, scans
+    // the counts bucket-major so that chunk order is kept, then scatters each chunk in parallel.
+    // digits shared by every key (e.g. high bits of small keys) are skipped. Key must be an
+    // unsigned integer, Value any trivially copyable type (usually a uint32_t index)
+    //
+    template<typename Key, typename Value>
+    void radix_sort(Vector<Key>& keys, Vector<Value>& values, ThreadPool& pool = ThreadPool::global())
+    {
+        static_assert(std::is_unsigned<Key>::value, "radix_sort needs unsigned integer keys");
+        static_assert(std::is_trivially_copyable<Value>::value, "radix_sort moves values with plain copies");
+
+        using detail::RADIX_BITS;
+        using detail::RADIX_BUCKETS;
+        constexpr uint32_t PASSES = (sizeof(Key) * 8 + RADIX_BITS - 1) / RADIX_BITS;
+
+        const size_t count = keys.size();
+        if (count < 2 || values.size() != count)
+        {
+            return;
+        }
+
+        detail::RadixChunks split;
+        split.count = count;
+        split.chunks = (count < detail::RADIX_SERIAL_THRESHOLD)? 1 : math::min(pool.size() * 4, count / (detail::RADIX_SERIAL_THRESHOLD / 4));
+        split.size = (count + split.chunks - 1) / split.chunks;
+
+        // one read for the digit histograms of every pass: a pass whose digit puts every key
+        // in the same bucket is a no-op
+        Vector<size_t> counts(split.chunks * PASSES * RADIX_BUCKETS);
+        pool.parallel_for(0, split.chunks, [&](size_t first_chunk, size_t last_chunk)
+        {
+            for (size_t c = first_chunk; c < last_chunk; ++c)
+            {
+                size_t* histogram = counts.data() + c * PASSES * RADIX_BUCKETS;
+                for (size_t i = split.first(c); i < split.last(c); ++i)
+                {
+                    for (uint32_t p = 0; p < PASSES; ++p)
+                    {
+                        ++histogram[p * RADIX_BUCKETS + ((keys[i] >> (p * RADIX_BITS)) & (RADIX_BUCKETS - 1))];
+                    }
+                }
+            }
+        }, 1);
+
+        bool needed[PASSES];
+        uint32_t needed_passes = 0;
+        for (uint32_t p = 0; p < PASSES; ++p)
+        {
+            needed[p] = true;
+            for (uint32_t b = 0; b < RADIX_BUCKETS && needed[p]; ++b)
+            {
+                size_t total = 0;
+                for (size_t c = 0; c < split.chunks; ++c) total += counts[(c * PASSES + p) * RADIX_BUCKETS + b];
+                needed[p] = (total != count);
+            }
+            needed_passes += needed[p]? 1 : 0;
+        }
+
+        if (needed_passes == 0)
+        {
+            return;
+        }
+
+        Vector<Key> key_scratch(count);
+        Vector<Value> value_scratch(count);
+        Key* src_keys = keys.data();
+        Value* src_values = values.data();
+        Key* dst_keys = key_scratch.data();
+        Value* dst_values = value_scratch.data();
+
+        Vector<size_t> offsets(split.chunks * RADIX_BUCKETS);
+        bool first_pass = true;
+        for (uint32_t p = 0; p < PASSES; ++p)
+        {
+            if (!needed[p])
+            {
+                continue;
+            }
+            const uint32_t shift = p * RADIX_BITS;
+
+            // the first pass reads the original order, its histograms are already known
+            if (!first_pass)
+            {
+                pool.parallel_for(0, split.chunks, [&](size_t first_chunk, size_t last_chunk)
+                {
+                    for (size_t c = first_chunk; c < last_chunk; ++c)
+                    {
+                        size_t* histogram = counts.data() + (c * PASSES + p) * RADIX_BUCKETS;
+                        std::memset(histogram, 0, RADIX_BUCKETS * sizeof(size_t));
+                        for (size_t i = split.first(c); i < split.last(c); ++i)
+                        {
+                            ++histogram[(src_keys[i] >> shift) & (RADIX_BUCKETS - 1)];
+                        }
+                    }
+                }, 1);
+            }
+            first_pass = false;
+
+            size_t sum = 0;
+            for (uint32_t b = 0; b < RADIX_BUCKETS; ++b)
+            {
+                for (size_t c = 0; c < split.chunks; ++c)
+                {
+                    offsets[c * RADIX_BUCKETS + b] = sum;
+                    sum += counts[(c * PASSES + p) * RADIX_BUCKETS + b];
+                }
+            }
+
+            pool.parallel_for(0, split.chunks, [&](size_t first_chunk, size_t last_chunk)
+            {
+                for (size_t c = first_chunk; c < last_chunk; ++c)
+                {
+                    size_t* offset = offsets.data() + c * RADIX_BUCKETS;
+                    for (size_t i = split.first(c); i < split.last(c); ++i)
+                    {
+                        const size_t to = offset[(src_keys[i] >> shift) & (RADIX_BUCKETS - 1)]++;
+                        dst_keys[to] = src_keys[i];
+                        dst_values[to] = src_values[i];
+                    }
+                }
+            }, 1);
+
+            std::swap(src_keys, dst_keys);
+            std::swap(src_values, dst_values);
+        }
+
+        // odd number of passes: the sorted pairs are in the scratch buffers
+        if (src_keys != keys.data())
+        {
+            keys.swap(key_scratch);
+            values.swap(value_scratch);
+        }
+    }
+
+    //
+    // permutation that sorts keys (stable), keys are left untouched
+    //
+    template<typename Key>
+    Vector<uint32_t> sorted_order(const Vector<Key>& keys, ThreadPool& pool = ThreadPool::global())
+    {
+        Vector<Key> sorted(keys);
+        Vector<uint32_t> order(keys.size());
+        pool.parallel_for(0, order.size(), [&order](size_t first, size_t last)
+        {
+            for (size_t i = first; i < last; ++i) order[i] = static_cast<uint32_t>(i);
+        });
+        radix_sort(sorted, order, pool);
+        return order;
+    }
+}
@@ -0,0 +1,419 @@
+/*
+ * CCLib
+ *
+ * collection of utils i use in most projects.
+ * maybe it will evolve in a framework, maybe not
+ *
+ * (c) 2018 Carlo Casta <carlo.casta at gmail.com>
+ */
+#pragma once
+
+//
+// space-filling curve keys for points, the usual first step of LBVH builds and
+// locality-preserving reorders:
+//
+//   const cc::spatial::Bounds box = cc::spatial::bounds(points.data(), points.size());
+//   cc::spatial::compute_keys(points.data(), points.size(), box, keys.data(), cc::spatial::Curve::Hilbert);
+//   cc::radix_sort(keys, indices);
+//
+// morton codes interleave x, y, z from bit 0 (x | y << 1 | z << 2). the 30-bit variant uses
+// 10 bits per axis, the 63-bit one 21. bmi2 pdep/pext are used when the build targets it,
+// the batch key functions also pick them at runtime.
+//
+
+#include <cfloat>
+#include <cstdint>
+#include "cclib.h"
+#include "ccvector.h"
+#include "ccparallel.h"
+#include "ccsort.h"
+#include "ccsimd.h"
+#include "ccbounds.h"
+
+#if defined(__BMI2__)
+ #include <immintrin.h>
+#endif
+
+namespace cc
+{
+namespace spatial
+{
+    using math::vec3;
+
+    enum class Curve : uint32_t
+    {
+        Morton,
+        Hilbert,
+        Count
+    };
+
+    inline const char* curve_name(Curve curve)
+    {
+        constexpr const char* names[] = { "morton", "hilbert" };
+        return (curve < Curve::Count)? names[uint32_t(curve)] : "unknown";
+    }
+
+namespace detail
+{
+    constexpr uint32_t MORTON30_X = 0x09249249u;
+    constexpr uint64_t MORTON63_X = 0x1249249249249249ull;
+
+    // 10 bits -> every third bit
+    constexpr inline uint32_t spread3_10(uint32_t x)
+    {
+        x &= 0x3ff;
+        x = (x | (x << 16)) & 0x030000ffu;
+        x = (x | (x << 8))  & 0x0300f00fu;
+        x = (x | (x << 4))  & 0x030c30c3u;
+        x = (x | (x << 2))  & 0x09249249u;
+        return x;
+    }
+
+    constexpr inline uint32_t compact3_10(uint32_t x)
+    {
+        x &= 0x09249249u;
+        x = (x ^ (x >> 2))  & 0x030c30c3u;
+        x = (x ^ (x >> 4))  & 0x0300f00fu;
+        x = (x ^ (x >> 8))  & 0x030000ffu;
+        x = (x ^ (x >> 16)) & 0x000003ffu;
+        return x;
+    }
+
+    // 21 bits -> every third bit
+    constexpr inline uint64_t spread3_21(uint64_t x)
+    {
+        x &= 0x1fffff;
+        x = (x | (x << 32)) & 0x001f00000000ffffull;
+        x = (x | (x << 16)) & 0x001f0000ff0000ffull;
+        x = (x | (x << 8))  & 0x100f00f00f00f00full;
+        x = (x | (x << 4))  & 0x10c30c30c30c30c3ull;
+        x = (x | (x << 2))  & 0x1249249249249249ull;
+        return x;
+    }
+
+    constexpr inline uint64_t compact3_21(uint64_t x)
+    {
+        x &= 0x1249249249249249ull;
+        x = (x ^ (x >> 2))  & 0x10c30c30c30c30c3ull;
+        x = (x ^ (x >> 4))  & 0x100f00f00f00f00full;
+        x = (x ^ (x >> 8))  & 0x001f0000ff0000ffull;
+        x = (x ^ (x >> 16)) & 0x001f00000000ffffull;
+        x = (x ^ (x >> 32)) & 0x00000000001fffffull;
+        return x;
+    }
+
+#if !defined(_MSC_VER)
+    CC_TARGET("bmi2") inline uint64_t morton63_pdep(uint32_t x, uint32_t y, uint32_t z)
+    {
+        return __builtin_ia32_pdep_di(x, MORTON63_X) | __builtin_ia32_pdep_di(y, MORTON63_X << 1) | __builtin_ia32_pdep_di(z, MORTON63_X << 2);
+    }
+#endif
+
+    inline bool has_bmi2()
+    {
+        static const bool bmi2 = []
+        {
+            uint32_t r[4];
+            simd::detail::cpuid(0, 0, r);
+            if (r[0] < 7)
+            {
+                return false;
+            }
+            simd::detail::cpuid(7, 0, r);
+            return (r[1] & (1u << 8)) != 0;
+        }();
+        return bmi2;
+    }
+}
+
+    //
+    // morton codes
+    //
+    inline uint32_t morton30(uint32_t x, uint32_t y, uint32_t z)
+    {
+#if defined(__BMI2__)
+        return _pdep_u32(x, detail::MORTON30_X) | _pdep_u32(y, detail::MORTON30_X << 1) | _pdep_u32(z, detail::MORTON30_X << 2);
+#else
+        return detail::spread3_10(x) | (detail::spread3_10(y) << 1) | (detail::spread3_10(z) << 2);
+#endif
+    }
+
+    inline void morton30_decode(uint32_t code, uint32_t& x, uint32_t& y, uint32_t& z)
+    {
+#if defined(__BMI2__)
+        x = _pext_u32(code, detail::MORTON30_X);
+        y = _pext_u32(code, detail::MORTON30_X << 1);
+        z = _pext_u32(code, detail::MORTON30_X << 2);
+#else
+        x = detail::compact3_10(code);
+        y = detail::compact3_10(code >> 1);
+        z = detail::compact3_10(code >> 2);
+#endif
+    }
+
+    inline uint64_t morton63(uint32_t x, uint32_t y, uint32_t z)
+    {
+#if defined(__BMI2__)
+        return _pdep_u64(x, detail::MORTON63_X) | _pdep_u64(y, detail::MORTON63_X << 1) | _pdep_u64(z, detail::MORTON63_X << 2);
+#else
+        return detail::spread3_21(x) | (detail::spread3_21(y) << 1) | (detail::spread3_21(z) << 2);
+#endif
+    }
+
+    inline void morton63_decode(uint64_t code, uint32_t& x, uint32_t& y, uint32_t& z)
+    {
+#if defined(__BMI2__)
+        x = uint32_t(_pext_u64(code, detail::MORTON63_X));
+        y = uint32_t(_pext_u64(code, detail::MORTON63_X << 1));
+        z = uint32_t(_pext_u64(code, detail::MORTON63_X << 2));
+#else
+        x = uint32_t(detail::compact3_21(code));
+        y = uint32_t(detail::compact3_21(code >> 1));
+        z = uint32_t(detail::compact3_21(code >> 2));
+#endif
+    }
+
+    //
+    // hilbert keys (Skilling's transpose algorithm), bits per axis up to 21. consecutive
+    // keys are always face-adjacent cells, unlike morton
+    //
+    inline uint64_t hilbert(uint32_t x, uint32_t y, uint32_t z, uint32_t bits = 21)
+    {
+        uint32_t axes[3] = { x, y, z };
+
+        // inverse undo: invert the low bits of axis 0 if bit q of axis i is set, else swap
+        // them with axis i. done with masks, the branches would mispredict half of the time
+        for (uint32_t bit = bits - 1; bit > 0; --bit)
+        {
+            const uint32_t p = (1u << bit) - 1;
+            for (int i = 0; i < 3; ++i)
+            {
+                const uint32_t set = 0u - ((axes[i] >> bit) & 1);
+                const uint32_t t = (axes[0] ^ axes[i]) & p & ~set;
+                axes[0] ^= (p & set) | t;
+                axes[i] ^= t;
+            }
+        }
+
+        // gray encode
+        axes[1] ^= axes[0];
+        axes[2] ^= axes[1];
+        uint32_t t = 0;
+        for (uint32_t bit = bits - 1; bit > 0; --bit)
+        {
+            t ^= ((1u << bit) - 1) & (0u - ((axes[2] >> bit) & 1));
+        }
+        for (int i = 0; i < 3; ++i) axes[i] ^= t;
+
+        // the first axis holds the most significant bit of every triple
+        return morton63(axes[2], axes[1], axes[0]);
+    }
+
+    inline void hilbert_decode(uint64_t key, uint32_t& x, uint32_t& y, uint32_t& z, uint32_t bits = 21)
+    {
+        uint32_t axes[3];
+        morton63_decode(key, axes[2], axes[1], axes[0]);
+
+        // gray decode
+        uint32_t t = axes[2] >> 1;
+        axes[2] ^= axes[1];
+        axes[1] ^= axes[0];
+        axes[0] ^= t;
+
+        // undo excess work
+        for (uint32_t q = 2; q != (2u << (bits - 1)); q <<= 1)
+        {
+            const uint32_t p = q - 1;
+            for (int i = 2; i >= 0; --i)
+            {
+                const uint32_t set = 0u - uint32_t((axes[i] & q) != 0);
+                t = (axes[0] ^ axes[i]) & p & ~set;
+                axes[0] ^= (p & set) | t;
+                axes[i] ^= t;
+            }
+        }
+
+        x = axes[0];
+        y = axes[1];
+        z = axes[2];
+    }
+
+    //
+    // points to integer grid coordinates in [0, 2^bits) inside bounds
+    //
+    inline void quantize(const vec3& p, const Bounds& bounds, uint32_t bits, uint32_t& x, uint32_t& y, uint32_t& z)
+    {
+        const float cells = float(1u << bits);
+        const vec3 extent = bounds.hi - bounds.lo;
+        const vec3 scale(extent.x > 0.f? cells / extent.x : 0.f, extent.y > 0.f? cells / extent.y : 0.f, extent.z > 0.f? cells / extent.z : 0.f);
+        const vec3 cell = math::clamp((p - bounds.lo) * scale, vec3(0.f), vec3(cells - 1.f));
+        x = uint32_t(cell.x);
+        y = uint32_t(cell.y);
+        z = uint32_t(cell.z);
+    }
+
+    inline uint32_t morton30(const vec3& p, const Bounds& bounds)
+    {
+        uint32_t x, y, z;
+        quantize(p, bounds, 10, x, y, z);
+        return morton30(x, y, z);
+    }
+
+    inline uint64_t morton63(const vec3& p, const Bounds& bounds)
+    {
+        uint32_t x, y, z;
+        quantize(p, bounds, 21, x, y, z);
+        return morton63(x, y, z);
+    }
+
+    inline uint64_t hilbert(const vec3& p, const Bounds& bounds)
+    {
+        uint32_t x, y, z;
+        quantize(p, bounds, 21, x, y, z);
+        return hilbert(x, y, z);
+    }
+
+namespace detail
+{
+    inline void morton_keys(const vec3* points, size_t count, const Bounds& bounds, uint64_t* keys)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            uint32_t x, y, z;
+            quantize(points[i], bounds, 21, x, y, z);
+            keys[i] = spread3_21(x) | (spread3_21(y) << 1) | (spread3_21(z) << 2);
+        }
+    }
+
+    //
+    // hilbert() over a batch of points in SoA form: the per-bit steps are the same for every
+    // point, so each one runs across lanes and vectorizes
+    //
+    inline void hilbert_keys(const vec3* points, size_t count, const Bounds& bounds, uint64_t* keys)
+    {
+        constexpr size_t LANES = 64;
+        constexpr uint32_t BITS = 21;
+        uint32_t axes[3][LANES];
+
+        for (size_t base = 0; base < count; base += LANES)
+        {
+            const size_t n = math::min(LANES, count - base);
+            for (size_t l = 0; l < n; ++l)
+            {
+                quantize(points[base + l], bounds, BITS, axes[0][l], axes[1][l], axes[2][l]);
+            }
+
+            for (uint32_t bit = BITS - 1; bit > 0; --bit)
+            {
+                const uint32_t p = (1u << bit) - 1;
+                CC_SIMD_LOOP
+                for (size_t l = 0; l < LANES; ++l)
+                {
+                    uint32_t x = axes[0][l], y = axes[1][l], z = axes[2][l];
+                    x ^= p & (0u - ((x >> bit) & 1));
+
+                    const uint32_t y_set = 0u - ((y >> bit) & 1);
+                    const uint32_t ty = (x ^ y) & p & ~y_set;
+                    x ^= (p & y_set) | ty;
+                    y ^= ty;
+
+                    const uint32_t z_set = 0u - ((z >> bit) & 1);
+                    const uint32_t tz = (x ^ z) & p & ~z_set;
+                    x ^= (p & z_set) | tz;
+                    z ^= tz;
+
+                    axes[0][l] = x;
+                    axes[1][l] = y;
+                    axes[2][l] = z;
+                }
+            }
+
+            // gray encode, t is the xor of every higher bit of the last axis (a prefix xor)
+            CC_SIMD_LOOP
+            for (size_t l = 0; l < LANES; ++l)
+            {
+                const uint32_t x = axes[0][l];
+                const uint32_t y = axes[1][l] ^ x;
+                const uint32_t z = axes[2][l] ^ y;
+                uint32_t t = z >> 1;
+                t ^= t >> 1;
+                t ^= t >> 2;
+                t ^= t >> 4;
+                t ^= t >> 8;
+                t ^= t >> 16;
+                axes[0][l] = x ^ t;
+                axes[1][l] = y ^ t;
+                axes[2][l] = z ^ t;
+            }
+
+            for (size_t l = 0; l < n; ++l)
+            {
+                keys[base + l] = spread3_21(axes[2][l]) | (spread3_21(axes[1][l]) << 1) | (spread3_21(axes[0][l]) << 2);
+            }
+        }
+    }
+
+#if !defined(_MSC_VER)
+    CC_TARGET("bmi2") inline void morton_keys_bmi2(const vec3* points, size_t count, const Bounds& bounds, uint64_t* keys)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            uint32_t x, y, z;
+            quantize(points[i], bounds, 21, x, y, z);
+            keys[i] = morton63_pdep(x, y, z);
+        }
+    }
+#endif
+}
+
+    //
+    // 63-bit keys of count points (morton63 or hilbert with 21 bits per axis)
+    //
+    inline void compute_keys(const vec3* points, size_t count, const Bounds& bounds, uint64_t* keys, Curve curve = Curve::Morton, ThreadPool& pool = ThreadPool::global())
+    {
+        pool.parallel_for(0, count, [=](size_t first, size_t last)
+        {
+            if (curve == Curve::Hilbert)
+            {
+                detail::hilbert_keys(points + first, last - first, bounds, keys + first);
+            }
+#if !defined(_MSC_VER)
+            else if (detail::has_bmi2())
+            {
+                detail::morton_keys_bmi2(points + first, last - first, bounds, keys + first);
+            }
+#endif
+            else
+            {
+                detail::morton_keys(points + first, last - first, bounds, keys + first);
+            }
+        });
+    }
+
+    // 30-bit morton keys, half the sort passes when 1024^3 cells are enough
+    inline void compute_keys(const vec3* points, size_t count, const Bounds& bounds, uint32_t* keys, ThreadPool& pool = ThreadPool::global())
+    {
+        pool.parallel_for(0, count, [=](size_t first, size_t last)
+        {
+            for (size_t i = first; i < last; ++i) keys[i] = morton30(points[i], bounds);
+        });
+    }
+
+    //
+    // indices of points along the curve
+    //
+    inline Vector<uint32_t> sorted_order(const vec3* points, size_t count, Curve curve = Curve::Morton, ThreadPool& pool = ThreadPool::global())
+    {
+        Vector<uint64_t> keys(count);
+        compute_keys(points, count, bounds(points, count, pool), keys.data(), curve, pool);
+
+        Vector<uint32_t> order(count);
+        pool.parallel_for(0, count, [&order](size_t first, size_t last)
+        {
+            for (size_t i = first; i < last; ++i) order[i] = static_cast<uint32_t>(i);
+        });
+        radix_sort(keys, order, pool);
+        return order;
+    }
+}
+}
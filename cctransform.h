@@ -0,0 +1,196 @@
+/*
+ * CCLib
+ *
+ * collection of utils i use in most projects.
+ * maybe it will evolve in a framework, maybe not
+ *
+ * (c) 2018 Carlo Casta <carlo.casta at gmail.com>
+ */
+#pragma once
+
+#include <cstring>
+#include "cclib.h"
+#include "ccvector.h"
+#include "ccparallel.h"
+
+namespace cc
+{
+    //
+    // flat transform hierarchy: nodes are stored in SoA arrays and a parent is always
+    // added before its children. set_local() only flags a node, update() recomputes the
+    // world matrix of flagged nodes and of everything below them, one tree level at a
+    // time (levels can be split across a ThreadPool). world inverses are refreshed on access.
+    //
+    class TransformHierarchy
+    {
+    public:
+        using mat4 = math::mat4;
+
+        static constexpr uint32_t NO_PARENT = UINT32_MAX;
+
+        explicit TransformHierarchy()
+            : parallel_threshold_(1024)
+        {
+        }
+
+        void reserve(size_t count)
+        {
+            parent_.reserve(count);
+            level_.reserve(count);
+            local_.reserve(count);
+            world_.reserve(count);
+            world_inverse_.reserve(count);
+            dirty_.reserve(count);
+            inverse_dirty_.reserve(count);
+        }
+
+        uint32_t add(uint32_t parent = NO_PARENT, const mat4& local = mat4(1.f))
+        {
+            const uint32_t node = static_cast<uint32_t>(parent_.size());
+            const uint32_t level = (parent == NO_PARENT)? 0 : level_[parent] + 1;
+
+            parent_.push_back(parent);
+            level_.push_back(level);
+            local_.push_back(local);
+            world_.push_back(local);
+            world_inverse_.push_back(mat4(1.f));
+            dirty_.push_back(1);
+            inverse_dirty_.push_back(1);
+
+            if (level == levels_.size())
+            {
+                levels_.emplace_back();
+                level_marks_.push_back(0);
+            }
+            levels_[level].push_back(node);
+            ++level_marks_[level];
+
+            return node;
+        }
+
+        void set_local(uint32_t node, const mat4& local)
+        {
+            local_[node] = local;
+            if (!dirty_[node])
+            {
+                dirty_[node] = 1;
+                ++level_marks_[level_[node]];
+            }
+        }
+
+        const mat4& local(uint32_t node) const          { return local_[node]; }
+
+        // valid after update()
+        const mat4& world(uint32_t node) const          { return world_[node]; }
+
+        // computed on first access after the world matrix changed, not thread-safe for the same node
+        const mat4& world_inverse(uint32_t node)
+        {
+            if (inverse_dirty_[node])
+            {
+                world_inverse_[node] = math::inverse(world_[node]);
+                inverse_dirty_[node] = 0;
+            }
+            return world_inverse_[node];
+        }
+
+        uint32_t parent(uint32_t node) const            { return parent_[node]; }
+
+        uint32_t level(uint32_t node) const             { return level_[node]; }
+
+        size_t size() const                             { return parent_.size(); }
+
+        size_t levels() const                           { return levels_.size(); }
+
+        // levels smaller than this are updated on the calling thread
+        void set_parallel_threshold(size_t nodes)       { parallel_threshold_ = nodes; }
+
+        void update()
+        {
+            update_levels(nullptr);
+        }
+
+        void update(ThreadPool& pool)
+        {
+            update_levels(&pool);
+        }
+
+        // refresh every stale inverse at once instead of on access
+        void update_inverses(ThreadPool& pool)
+        {
+            pool.parallel_for(0, size(), [this](size_t first, size_t last)
+            {
+                for (size_t i = first; i < last; ++i) world_inverse(static_cast<uint32_t>(i));
+            });
+        }
+
+    private:
+        Vector<uint32_t> parent_;
+        Vector<uint32_t> level_;
+        Vector<mat4> local_;
+        Vector<mat4> world_;
+        Vector<mat4> world_inverse_;
+        Vector<uint8_t> dirty_;
+        Vector<uint8_t> inverse_dirty_;
+
+        Vector<Vector<uint32_t>> levels_;
+        Vector<uint32_t> level_marks_;   // nodes flagged by set_local()/add() per level
+        size_t parallel_threshold_;
+
+        // returns true if any node in [first, last) of this level changed
+        bool update_nodes(const Vector<uint32_t>& nodes, size_t first, size_t last)
+        {
+            bool changed = false;
+            for (size_t n = first; n < last; ++n)
+            {
+                const uint32_t i = nodes[n];
+                const uint32_t p = parent_[i];
+                if (p == NO_PARENT)
+                {
+                    if (dirty_[i])
+                    {
+                        world_[i] = local_[i];
+                        inverse_dirty_[i] = 1;
+                        changed = true;
+                    }
+                }
+                else if (dirty_[i] || dirty_[p])
+                {
+                    dirty_[i] = 1;
+                    world_[i] = world_[p] * local_[i];
+                    inverse_dirty_[i] = 1;
+                    changed = true;
+                }
+            }
+            return changed;
+        }
+
+        void update_levels(ThreadPool* pool)
+        {
+            bool parent_level_changed = false;
+            for (size_t l = 0; l < levels_.size(); ++l)
+            {
+                // nothing flagged here and nothing moved above: the whole level is clean
+                if (!parent_level_changed && level_marks_[l] == 0)
+                {
+                    continue;
+                }
+
+                const Vector<uint32_t>& nodes = levels_[l];
+                if (pool && nodes.size() >= parallel_threshold_)
+                {
+                    parent_level_changed = pool->parallel_reduce(size_t(0), nodes.size(), false,
+                        [this, &nodes](size_t first, size_t last) { return update_nodes(nodes, first, last); },
+                        [](bool a, bool b) { return a || b; });
+                }
+                else
+                {
+                    parent_level_changed = update_nodes(nodes, 0, nodes.size());
+                }
+            }
+
+            std::memset(dirty_.data(), 0, dirty_.size());
+            std::memset(level_marks_.data(), 0, level_marks_.size() * sizeof(uint32_t));
+        }
+    };
+}
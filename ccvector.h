@@ -8,8 +8,100 @@
  */
 #pragma once
 
+#include <new>
+#include <cstring>
+#include <iterator>
+#include <type_traits>
+#include "ccvectorstats.h"
+
 namespace cc
 {
+namespace detail
+{
+    // count elements from src to uninitialized dst, src is left uninitialized. dst <= src
+    // or the ranges don't overlap, relocate_back() for the other direction
+    template<typename T>
+    inline void relocate(T* dst, T* src, size_t count)
+    {
+        if constexpr (std::is_trivially_copyable_v<T>)
+        {
+            if (count > 0) std::memmove(static_cast<void*>(dst), src, count * sizeof(T));
+        }
+        else
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                new (dst + i) T(std::move(src[i]));
+                src[i].~T();
+            }
+        }
+    }
+
+    template<typename T>
+    inline void relocate_back(T* dst, T* src, size_t count)
+    {
+        if constexpr (std::is_trivially_copyable_v<T>)
+        {
+            if (count > 0) std::memmove(static_cast<void*>(dst), src, count * sizeof(T));
+        }
+        else
+        {
+            for (size_t i = count; i > 0; --i)
+            {
+                new (dst + i - 1) T(std::move(src[i - 1]));
+                src[i - 1].~T();
+            }
+        }
+    }
+
+    template<typename T, typename It>
+    inline void construct(T* dst, It first, size_t count)
+    {
+        if constexpr (std::is_pointer_v<It> && std::is_trivially_copyable_v<T> &&
+                      std::is_same_v<std::remove_cv_t<std::remove_pointer_t<It>>, T>)
+        {
+            if (count > 0) std::memcpy(static_cast<void*>(dst), first, count * sizeof(T));
+        }
+        else
+        {
+            for (size_t i = 0; i < count; ++i, ++first)
+            {
+                new (dst + i) T(*first);
+            }
+        }
+    }
+
+    template<typename T>
+    inline void destroy(T* first, size_t count)
+    {
+        if constexpr (!std::is_trivially_destructible_v<T>)
+        {
+            for (size_t i = count; i > 0; --i)
+            {
+                first[i - 1].~T();
+            }
+        }
+    }
+
+    // drops count elements at dst and moves the tail elements after them down
+    template<typename T>
+    inline void close_gap(T* dst, size_t count, size_t tail)
+    {
+        if constexpr (std::is_trivially_copyable_v<T>)
+        {
+            if (tail > 0) std::memmove(static_cast<void*>(dst), dst + count, tail * sizeof(T));
+        }
+        else
+        {
+            for (size_t i = 0; i < tail; ++i)
+            {
+                dst[i] = std::move(dst[i + count]);
+            }
+            destroy(dst + tail, count);
+        }
+    }
+}
+
     template<typename T>
     class Vector
     {
@@ -20,21 +112,25 @@ namespace cc
         explicit Vector()
             : size_(0)
             , capacity_(16)
-            , buffer_(static_cast<T*>(::operator new(capacity_ * sizeof(T))))
+            , buffer_(allocate(capacity_))
         {
         }
 
         explicit Vector(size_type count)
             : size_(count)
             , capacity_(count)
-            , buffer_(new T[count])
+            , buffer_(allocate(capacity_))
         {
+            for (size_type i = 0; i < count; ++i)
+            {
+                new (buffer_ + i) T();
+            }
         }
 
         explicit Vector(size_type count, const T& elem)
             : size_(0)
             , capacity_(count)
-            , buffer_(static_cast<T*>(::operator new(capacity_ * sizeof(T))))
+            , buffer_(allocate(capacity_))
         {
             for (size_type i = 0; i < count; ++i)
             {
@@ -45,7 +141,7 @@ namespace cc
         explicit Vector(std::initializer_list<T> list)
             : size_(0)
             , capacity_(list.size())
-            , buffer_(static_cast<T*>(::operator new(capacity_ * sizeof(T))))
+            , buffer_(allocate(capacity_))
         {
             for (auto&& it = list.begin(); it != list.end(); ++it)
             {
@@ -53,33 +149,45 @@ namespace cc
             }
         }
 
+        // forward iterator range, not integers (those go to Vector(count, elem))
+        template<typename It, typename = std::enable_if_t<!std::is_integral_v<It>>>
+        explicit Vector(It first, It last)
+            : size_(0)
+            , capacity_(size_type(std::distance(first, last)))
+            , buffer_(allocate(capacity_))
+        {
+            detail::construct(buffer_, first, capacity_);
+            size_ = capacity_;
+        }
+
         ~Vector()
         {
-            for (size_type i = 0; i < size_; ++i)
+            if (buffer_)
             {
-                buffer_[size_ - i - 1].~T();
+                vector_stats::detail::on_destroy<T>(size_, capacity_);
             }
-
-            ::operator delete(buffer_);
+            detail::destroy(buffer_, size_);
+            deallocate(buffer_, capacity_);
         }
 
         Vector(const Vector& other)
             : size_(0)
             , capacity_(other.capacity_)
-            , buffer_(static_cast<T*>(::operator new(capacity_ * sizeof(T))))
+            , buffer_(allocate(capacity_))
         {
+            vector_stats::detail::on_copy<T>(other.size_);
             for (size_type i = 0; i < other.size_; ++i)
             {
                 new (buffer_ + size_++) T(other.buffer_[i]);
             }
         }
 
-        Vector& operator=(Vector& other)
+        Vector& operator=(const Vector& other)
         {
             if (buffer_ != other.buffer_)
             {
                 Vector<T> temp(other);
-                other.swap(*this);
+                temp.swap(*this);
             }
             return *this;
         }
@@ -168,7 +276,7 @@ namespace cc
 
         void pop_back()
         {
-            buffer_[size_--].~T();
+            buffer_[--size_].~T();
         }
 
         const T& front() const
@@ -183,23 +291,127 @@ namespace cc
 
         void clear()
         {
-            for (size_type i = 0; i < size_; ++i)
+            detail::destroy(buffer_, size_);
+            size_ = 0;
+        }
+
+        void resize(size_type count, const T& elem = T())
+        {
+            if (count > size_)
+            {
+                if (count > capacity_)
+                {
+                    const T copy(elem);     // elem may live in the buffer we are about to free
+                    realloc(grown_capacity(count));
+                    fill(count, copy);
+                }
+                else
+                {
+                    fill(count, elem);
+                }
+            }
+            else
+            {
+                detail::destroy(buffer_ + count, size_ - count);
+                size_ = count;
+            }
+        }
+
+        //
+        // like resize() but new elements are default-initialized: no writes at all for
+        // trivial types (the contents are garbage until written), default ctor for the
+        // rest. for buffers that are about to be overwritten anyway, e.g. decode targets
+        //
+        void resize_uninitialized(size_type count)
+        {
+            if (count > size_)
+            {
+                if (count > capacity_)
+                {
+                    realloc(grown_capacity(count));
+                }
+                if constexpr (!std::is_trivially_default_constructible_v<T>)
+                {
+                    for (size_type i = size_; i < count; ++i)
+                    {
+                        new (buffer_ + i) T;
+                    }
+                }
+                size_ = count;
+            }
+            else
             {
-                pop_back();
+                detail::destroy(buffer_ + count, size_ - count);
+                size_ = count;
             }
         }
 
-        void resize(size_type count, const T& elem = T())
+        T* insert(const T* pos, const T& value)
         {
-            for (size_type i = size_; i < count; ++i)
+            return insert(pos, &value, &value + 1);
+        }
+
+        T* insert(const T* pos, size_type count, const T& value)
+        {
+            const T copy(value);
+            T* gap = open_gap(pos, count);
+            for (size_type i = 0; i < count; ++i)
             {
-                emplace_back(elem);
+                new (gap + i) T(copy);
             }
+            return gap;
+        }
 
-            for (size_type i = size_; i > count; --i)
+        //
+        // inserts [first, last) before pos, returns a pointer to the first inserted element.
+        // the tail is relocated once (memmove for trivially copyable types), or straight
+        // into the new buffer when it has to grow
+        //
+        template<typename It, typename = std::enable_if_t<!std::is_integral_v<It>>>
+        T* insert(const T* pos, It first, It last)
+        {
+            if constexpr (std::is_pointer_v<It>)
+            {
+                // a range out of this same vector would move under us
+                if (first != last && &*first >= buffer_ && &*first < buffer_ + size_)
+                {
+                    const Vector<T> temp(first, last);
+                    return insert(pos, temp.begin(), temp.end());
+                }
+            }
+
+            const size_type count = size_type(std::distance(first, last));
+            T* gap = open_gap(pos, count);
+            detail::construct(gap, first, count);
+            return gap;
+        }
+
+        template<typename It, typename = std::enable_if_t<!std::is_integral_v<It>>>
+        void append(It first, It last)
+        {
+            insert(end(), first, last);
+        }
+
+        T* erase(const T* pos)
+        {
+            return erase(pos, pos + 1);
+        }
+
+        // removes [first, last), returns a pointer to the element that followed them
+        T* erase(const T* first, const T* last)
+        {
+            T* dst = buffer_ + (first - buffer_);
+            const size_type count = size_type(last - first);
+            const size_type tail = size_type((buffer_ + size_) - last);
+            if (count == 0)
             {
-                pop_back();
+                return dst;
             }
+
+            detail::close_gap(dst, count, tail);
+            vector_stats::detail::on_move<T>(tail);
+            size_ -= count;
+            return dst;
         }
 
         void reserve(size_type capacity)
@@ -227,21 +439,95 @@ namespace cc
         size_type capacity_;
         T* buffer_;
 
-        Vector(size_type capacity, bool add_uninitialized)
-            : size_(0)
-            , capacity_(capacity)
-            , buffer_(static_cast<T*>(::operator new(capacity_ * sizeof(T))))
+        // over-aligned types (mat4) need the aligned operator new. with telemetry on, the
+        // buffer is preceded by a header naming the stats slot it was allocated under
+        static T* allocate(size_type count)
+        {
+            constexpr size_t header = vector_stats::detail::header_size<T>();
+            char* raw;
+            if constexpr (alignof(T) > __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+            {
+                raw = static_cast<char*>(::operator new(count * sizeof(T) + header, std::align_val_t(alignof(T))));
+            }
+            else
+            {
+                raw = static_cast<char*>(::operator new(count * sizeof(T) + header));
+            }
+            vector_stats::detail::on_allocate<T>(raw, count);
+            return reinterpret_cast<T*>(raw + header);
+        }
+
+        static void deallocate(T* buffer, size_type capacity)
         {
+            if (!buffer)
+            {
+                return;
+            }
+
+            char* raw = reinterpret_cast<char*>(buffer) - vector_stats::detail::header_size<T>();
+            vector_stats::detail::on_free<T>(raw, capacity);
+            if constexpr (alignof(T) > __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+            {
+                ::operator delete(raw, std::align_val_t(alignof(T)));
+            }
+            else
+            {
+                ::operator delete(raw);
+            }
+        }
+
+        // geometric growth, so that repeated small grows stay amortized O(1)
+        size_type grown_capacity(size_type needed) const
+        {
+            const size_type grown = capacity_ * 2 + 1;
+            return (needed > grown)? needed : grown;
         }
 
         void realloc(size_type new_capacity)
         {
-            Vector<T> expanded(new_capacity, true);
-            for (size_type i = 0; i < size_; ++i)
+            T* expanded = allocate(new_capacity);
+            detail::relocate(expanded, buffer_, size_);
+            vector_stats::detail::on_reallocate<T>(size_, size_);
+            deallocate(buffer_, capacity_);
+            buffer_ = expanded;
+            capacity_ = new_capacity;
+        }
+
+        void fill(size_type count, const T& elem)
+        {
+            for (size_type i = size_; i < count; ++i)
+            {
+                new (buffer_ + i) T(elem);
+            }
+            size_ = count;
+        }
+
+        //
+        // makes room for count uninitialized elements before pos and returns where they go.
+        // growing moves prefix and tail straight to their final place in the new buffer
+        //
+        T* open_gap(const T* pos, size_type count)
+        {
+            const size_type index = size_type(pos - buffer_);
+            const size_type tail = size_ - index;
+            if (size_ + count > capacity_)
+            {
+                const size_type new_capacity = grown_capacity(size_ + count);
+                T* expanded = allocate(new_capacity);
+                detail::relocate(expanded, buffer_, index);
+                detail::relocate(expanded + index + count, buffer_ + index, tail);
+                vector_stats::detail::on_reallocate<T>(size_, size_ + count);
+                deallocate(buffer_, capacity_);
+                buffer_ = expanded;
+                capacity_ = new_capacity;
+            }
+            else
             {
-                expanded.emplace_back(std::move(buffer_[i]));
+                detail::relocate_back(buffer_ + index + count, buffer_ + index, tail);
+                vector_stats::detail::on_move<T>(tail);
             }
-            expanded.swap(*this);
+            size_ += count;
+            return buffer_ + index;
         }
     };
 
@@ -0,0 +1,420 @@
+/*
+ * CCLib
+ *
+ * collection of utils i use in most projects.
+ * maybe it will evolve in a framework, maybe not
+ *
+ * (c) 2018 Carlo Casta <carlo.casta at gmail.com>
+ */
+#pragma once
+
+//
+// cc::Vector allocation telemetry: define CC_VECTOR_STATS_ENABLED before the first
+// include of ccvector.h (in every translation unit: buffers carry a header when it is on,
+// so all of them must agree) to count buffers, reallocations, moved / copied bytes and capacity
+// high-water marks per element type and tag. otherwise the hooks are empty,
+// CC_VECTOR_TAG expands to nothing and summary() is always empty.
+//
+//   { CC_VECTOR_TAG("mesh import"); load(path); }   // vectors growing in here are tagged
+//   cc::vector_stats::print_summary(stdout);
+//
+// counters are thread local, updated without atomics read-modify-writes and merged on
+// summary(). tags are per thread too: pool workers don't inherit the caller's tag.
+// a buffer remembers the slot it was allocated under in a small header in front of it,
+// its free is charged there (atomically, it may happen on any thread and under any tag)
+//
+
+#include <cstdio>
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <string>
+
+namespace cc
+{
+namespace vector_stats
+{
+    struct Stats
+    {
+        std::string tag;                // empty outside CC_VECTOR_TAG scopes
+        std::string type;
+        size_t element_size;
+        uint64_t allocations;           // buffers, reallocations included
+        uint64_t reallocations;         // live elements moved to a new buffer (growth, shrink_to_fit)
+        uint64_t frees;
+        uint64_t allocated_bytes;
+        uint64_t live_bytes;            // allocated and not freed yet
+        uint64_t moved_bytes;           // relocated by reallocations, shifted by insert / erase
+        uint64_t copies;                // vector copy constructions and assignments
+        uint64_t copied_bytes;
+        uint64_t max_capacity;          // elements
+        uint64_t max_size;              // elements, seen at reallocation or destruction
+        uint64_t destroyed;             // vectors destroyed
+        uint64_t slack_bytes;           // capacity they left unused
+    };
+}
+}
+
+#if defined(CC_VECTOR_STATS_ENABLED)
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <map>
+#include <utility>
+#include <algorithm>
+#include <cstring>
+
+#define CC_VECTOR_CONCAT_(a, b) a##b
+#define CC_VECTOR_CONCAT(a, b) CC_VECTOR_CONCAT_(a, b)
+#define CC_VECTOR_TAG(name) ::cc::vector_stats::Tag CC_VECTOR_CONCAT(cc_vector_tag_, __LINE__)(name)
+
+namespace cc
+{
+namespace vector_stats
+{
+namespace detail
+{
+    // single writer (the owning thread), so relaxed load + store is enough
+    struct Counter
+    {
+        std::atomic<uint64_t> value{ 0 };
+
+        void add(uint64_t x)            { value.store(value.load(std::memory_order_relaxed) + x, std::memory_order_relaxed); }
+
+        // from any thread
+        void add_shared(uint64_t x)     { value.fetch_add(x, std::memory_order_relaxed); }
+
+        void raise(uint64_t x)          { if (x > value.load(std::memory_order_relaxed)) value.store(x, std::memory_order_relaxed); }
+
+        uint64_t get() const            { return value.load(std::memory_order_relaxed); }
+
+        void reset()                    { value.store(0, std::memory_order_relaxed); }
+    };
+
+    struct Counters
+    {
+        Counter allocations;
+        Counter reallocations;
+        Counter frees;
+        Counter allocated_bytes;
+        Counter freed_bytes;
+        Counter moved_bytes;
+        Counter copies;
+        Counter copied_bytes;
+        Counter max_capacity;
+        Counter max_size;
+        Counter destroyed;
+        Counter slack_bytes;
+    };
+
+    struct Slot
+    {
+        const char* tag;
+        const char* type;               // signature<T>(), see type_name()
+        size_t element_size;
+        Counters counters;
+    };
+
+    // slots are only appended, by their thread and under the registry lock
+    struct ThreadTable
+    {
+        std::vector<std::unique_ptr<Slot>> slots;
+    };
+
+    struct Registry
+    {
+        std::mutex lock;
+        std::vector<ThreadTable*> tables;
+    };
+
+    // never destroyed: vectors in static storage still count while the program exits
+    inline Registry& registry()
+    {
+        static Registry& instance = *new Registry;
+        return instance;
+    }
+
+    // tables outlive their threads so that stats can be read after joining workers
+    inline ThreadTable* register_thread()
+    {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> guard(r.lock);
+        r.tables.push_back(new ThreadTable);
+        return r.tables.back();
+    }
+
+    inline ThreadTable& thread_table()
+    {
+        static thread_local ThreadTable* table = register_thread();
+        return *table;
+    }
+
+    inline const char*& current_tag()
+    {
+        static thread_local const char* tag = nullptr;
+        return tag;
+    }
+
+    // a string naming T without rtti, unique per type
+    template<typename T>
+    inline const char* signature()
+    {
+#if defined(_MSC_VER)
+        return __FUNCSIG__;
+#else
+        return __PRETTY_FUNCTION__;
+#endif
+    }
+
+    // "... [with T = int]" (gcc), "... [T = int]" (clang), "...signature<int>(void)" (msvc)
+    inline std::string type_name(const char* signature)
+    {
+        const std::string s(signature);
+        size_t first = s.find("T = ");
+        if (first != std::string::npos)
+        {
+            first += 4;
+            return s.substr(first, s.find_first_of(";]", first) - first);
+        }
+
+        first = s.find("signature<");
+        if (first != std::string::npos)
+        {
+            first += 10;
+            return s.substr(first, s.rfind(">(") - first);
+        }
+        return s;
+    }
+
+    inline Slot& find(const char* tag, const char* type, size_t element_size)
+    {
+        ThreadTable& table = thread_table();
+        for (const std::unique_ptr<Slot>& slot : table.slots)
+        {
+            if (slot->tag == tag && slot->type == type) return *slot;
+        }
+
+        Registry& r = registry();
+        std::lock_guard<std::mutex> guard(r.lock);
+        table.slots.emplace_back(new Slot{ tag, type, element_size, {} });
+        return *table.slots.back();
+    }
+
+    // slot of the current tag and T on this thread, cached until the tag changes
+    template<typename T>
+    inline Slot& slot_of()
+    {
+        static thread_local Slot* cached = nullptr;
+        const char* tag = current_tag();
+        if (!cached || cached->tag != tag)
+        {
+            cached = &find(tag, signature<T>(), sizeof(T));
+        }
+        return *cached;
+    }
+
+    template<typename T>
+    inline Counters& counters()
+    {
+        return slot_of<T>().counters;
+    }
+
+    //
+    // hooks called by cc::Vector
+    //
+
+    // bytes in front of every buffer, a multiple of T's alignment and of what new gives
+    template<typename T>
+    constexpr size_t header_size()
+    {
+        return (alignof(T) > __STDCPP_DEFAULT_NEW_ALIGNMENT__)? alignof(T) : __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+    }
+
+    template<typename T>
+    inline void on_allocate(void* header, size_t capacity)
+    {
+        Slot* slot = &slot_of<T>();
+        std::memcpy(header, &slot, sizeof(slot));
+
+        Counters& c = slot->counters;
+        c.allocations.add(1);
+        c.allocated_bytes.add(capacity * sizeof(T));
+        c.max_capacity.raise(capacity);
+    }
+
+    template<typename T>
+    inline void on_free(const void* header, size_t capacity)
+    {
+        Slot* slot;
+        std::memcpy(&slot, header, sizeof(slot));
+
+        Counters& c = slot->counters;
+        c.frees.add_shared(1);
+        c.freed_bytes.add_shared(capacity * sizeof(T));
+    }
+
+    // live elements relocated to a new buffer, size is the element count after the operation
+    template<typename T>
+    inline void on_reallocate(size_t moved, size_t size)
+    {
+        Counters& c = counters<T>();
+        c.reallocations.add(1);
+        c.moved_bytes.add(moved * sizeof(T));
+        c.max_size.raise(size);
+    }
+
+    // elements shifted inside the buffer by insert / erase
+    template<typename T>
+    inline void on_move(size_t count)
+    {
+        counters<T>().moved_bytes.add(count * sizeof(T));
+    }
+
+    template<typename T>
+    inline void on_copy(size_t count)
+    {
+        Counters& c = counters<T>();
+        c.copies.add(1);
+        c.copied_bytes.add(count * sizeof(T));
+    }
+
+    template<typename T>
+    inline void on_destroy(size_t size, size_t capacity)
+    {
+        Counters& c = counters<T>();
+        c.destroyed.add(1);
+        c.slack_bytes.add((capacity - size) * sizeof(T));
+        c.max_size.raise(size);
+    }
+}
+
+    // tags vectors allocating, growing or being copied on this thread while in scope
+    class Tag
+    {
+    public:
+        explicit Tag(const char* name)
+            : previous_(detail::current_tag())
+        {
+            detail::current_tag() = name;
+        }
+
+        ~Tag()
+        {
+            detail::current_tag() = previous_;
+        }
+
+        Tag(const Tag&) = delete;
+        Tag& operator=(const Tag&) = delete;
+
+    private:
+        const char* previous_;
+    };
+
+    //
+    // per tag and type totals over all threads, sorted by allocated bytes
+    //
+    inline std::vector<Stats> summary()
+    {
+        std::map<std::pair<std::string, std::string>, Stats> merged;
+        {
+            detail::Registry& r = detail::registry();
+            std::lock_guard<std::mutex> guard(r.lock);
+            for (const detail::ThreadTable* table : r.tables)
+            {
+                for (const std::unique_ptr<detail::Slot>& slot : table->slots)
+                {
+                    const std::string tag = slot->tag? slot->tag : "";
+                    const std::string type = detail::type_name(slot->type);
+                    Stats& s = merged.emplace(std::make_pair(tag, type), Stats{ tag, type, slot->element_size }).first->second;
+
+                    const detail::Counters& c = slot->counters;
+                    s.allocations += c.allocations.get();
+                    s.reallocations += c.reallocations.get();
+                    s.frees += c.frees.get();
+                    s.allocated_bytes += c.allocated_bytes.get();
+                    s.live_bytes += c.allocated_bytes.get() - c.freed_bytes.get();    // wraps, fixed below
+                    s.moved_bytes += c.moved_bytes.get();
+                    s.copies += c.copies.get();
+                    s.copied_bytes += c.copied_bytes.get();
+                    s.max_capacity = std::max(s.max_capacity, c.max_capacity.get());
+                    s.max_size = std::max(s.max_size, c.max_size.get());
+                    s.destroyed += c.destroyed.get();
+                    s.slack_bytes += c.slack_bytes.get();
+                }
+            }
+        }
+
+        std::vector<Stats> result;
+        for (auto& entry : merged)
+        {
+            // buffers allocated before a reset() and freed after it
+            if (int64_t(entry.second.live_bytes) < 0) entry.second.live_bytes = 0;
+            result.push_back(entry.second);
+        }
+
+        std::sort(result.begin(), result.end(), [](const Stats& a, const Stats& b) { return a.allocated_bytes > b.allocated_bytes; });
+        return result;
+    }
+
+    inline void print_summary(std::FILE* out)
+    {
+        std::fprintf(out, "%-24s %-32s %10s %10s %12s %12s %12s %8s %12s %12s %12s\n", "tag", "type", "allocs", "reallocs",
+                     "alloc(KB)", "live(KB)", "moved(KB)", "copies", "copied(KB)", "max cap", "slack(KB)");
+        for (const Stats& s : summary())
+        {
+            std::fprintf(out, "%-24s %-32s %10llu %10llu %12.1f %12.1f %12.1f %8llu %12.1f %12llu %12.1f\n", s.tag.c_str(), s.type.c_str(),
+                         static_cast<unsigned long long>(s.allocations), static_cast<unsigned long long>(s.reallocations),
+                         double(s.allocated_bytes) / 1024., double(s.live_bytes) / 1024., double(s.moved_bytes) / 1024.,
+                         static_cast<unsigned long long>(s.copies), double(s.copied_bytes) / 1024.,
+                         static_cast<unsigned long long>(s.max_capacity), double(s.slack_bytes) / 1024.);
+        }
+    }
+
+    // zero every counter, threads must not be using vectors
+    inline void reset()
+    {
+        detail::Registry& r = detail::registry();
+        std::lock_guard<std::mutex> guard(r.lock);
+        for (detail::ThreadTable* table : r.tables)
+        {
+            for (std::unique_ptr<detail::Slot>& slot : table->slots)
+            {
+                detail::Counters& c = slot->counters;
+                for (detail::Counter* counter : { &c.allocations, &c.reallocations, &c.frees, &c.allocated_bytes, &c.freed_bytes, &c.moved_bytes,
+                                                  &c.copies, &c.copied_bytes, &c.max_capacity, &c.max_size, &c.destroyed, &c.slack_bytes })
+                {
+                    counter->reset();
+                }
+            }
+        }
+    }
+}
+}
+
+#else
+
+#define CC_VECTOR_TAG(name) ((void)0)
+
+namespace cc
+{
+namespace vector_stats
+{
+namespace detail
+{
+    template<typename T> constexpr size_t header_size()                 { return 0; }
+    template<typename T> inline void on_allocate(void*, size_t)         {}
+    template<typename T> inline void on_free(const void*, size_t)       {}
+    template<typename T> inline void on_reallocate(size_t, size_t)      {}
+    template<typename T> inline void on_move(size_t)                    {}
+    template<typename T> inline void on_copy(size_t)                    {}
+    template<typename T> inline void on_destroy(size_t, size_t)         {}
+}
+
+    inline std::vector<Stats> summary()     { return {}; }
+    inline void print_summary(std::FILE*)   {}
+    inline void reset()                     {}
+}
+}
+
+#endif
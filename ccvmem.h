@@ -0,0 +1,513 @@
+/*
+ * CCLib
+ *
+ * collection of utils i use in most projects.
+ * maybe it will evolve in a framework, maybe not
+ *
+ * (c) 2018 Carlo Casta <carlo.casta at gmail.com>
+ */
+#pragma once
+
+//
+// cc::VirtualVector, same interface as cc::Vector but it reserves a big range of
+// address space once and commits pages as it grows:
+//
+//   cc::VirtualVector<Point> points;             // 64 GB of address space, nothing committed
+//   points.reserve_address(1ull << 32);          // optional, a bigger (or smaller) range
+//   for (...) points.push_back(p);               // never copies, &points[0] never changes
+//   points.resize(n); points.shrink_to_fit();    // pages past the end go back to the os
+//
+// committed pages only count once they are touched, so growth has no old + new spike.
+// going past the reservation is the one case that still moves everything (to a range
+// twice as big)
+//
+
+#include <new>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <type_traits>
+#include <initializer_list>
+#include "ccvector.h"
+
+#if defined(_WIN32)
+ #if !defined(WIN32_LEAN_AND_MEAN)
+  #define WIN32_LEAN_AND_MEAN
+ #endif
+ #if !defined(NOMINMAX)
+  #define NOMINMAX
+ #endif
+ #include <windows.h>
+#else
+ #include <sys/mman.h>
+ #include <unistd.h>
+#endif
+
+namespace cc
+{
+namespace vmem
+{
+    inline size_t page_size()
+    {
+        static const size_t size = []()
+        {
+#if defined(_WIN32)
+            SYSTEM_INFO info;
+            GetSystemInfo(&info);
+            return size_t(info.dwAllocationGranularity);
+#else
+            return size_t(sysconf(_SC_PAGESIZE));
+#endif
+        }();
+        return size;
+    }
+
+    inline size_t round_up(size_t bytes)
+    {
+        const size_t page = page_size();
+        return (bytes + page - 1) / page * page;
+    }
+
+    // address space only, not accessible and not backed by memory. nullptr on failure
+    inline void* reserve(size_t bytes)
+    {
+#if defined(_WIN32)
+        return VirtualAlloc(nullptr, bytes, MEM_RESERVE, PAGE_NOACCESS);
+#else
+        void* range = mmap(nullptr, bytes, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        return (range != MAP_FAILED)? range : nullptr;
+#endif
+    }
+
+    // makes [address, address + bytes) of a reservation readable / writable (zero filled)
+    inline bool commit(void* address, size_t bytes)
+    {
+#if defined(_WIN32)
+        return VirtualAlloc(address, bytes, MEM_COMMIT, PAGE_READWRITE) != nullptr;
+#else
+        return mprotect(address, bytes, PROT_READ | PROT_WRITE) == 0;
+#endif
+    }
+
+    // gives the pages back to the os, the range stays reserved
+    inline void decommit(void* address, size_t bytes)
+    {
+#if defined(_WIN32)
+        VirtualFree(address, bytes, MEM_DECOMMIT);
+#else
+        mmap(address, bytes, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0);
+#endif
+    }
+
+    inline void release(void* address, size_t bytes)
+    {
+#if defined(_WIN32)
+        VirtualFree(address, 0, MEM_RELEASE);
+#else
+        munmap(address, bytes);
+#endif
+    }
+}
+
+    template<typename T>
+    class VirtualVector
+    {
+        static_assert(alignof(T) <= 4096, "VirtualVector storage is only page aligned");
+
+    public:
+        using value_type = T;
+        using size_type = size_t;
+
+        static constexpr size_t DEFAULT_RESERVE = size_t(1) << 36;
+
+        explicit VirtualVector()
+            : size_(0)
+            , capacity_(0)
+            , reserved_(0)
+            , committed_bytes_(0)
+            , reserved_bytes_(0)
+            , buffer_(nullptr)
+        {
+        }
+
+        explicit VirtualVector(size_type count)
+            : VirtualVector()
+        {
+            resize(count);
+        }
+
+        explicit VirtualVector(size_type count, const T& elem)
+            : VirtualVector()
+        {
+            resize(count, elem);
+        }
+
+        explicit VirtualVector(std::initializer_list<T> list)
+            : VirtualVector()
+        {
+            append(list.begin(), list.end());
+        }
+
+        template<typename It, typename = std::enable_if_t<!std::is_integral_v<It>>>
+        explicit VirtualVector(It first, It last)
+            : VirtualVector()
+        {
+            append(first, last);
+        }
+
+        ~VirtualVector()
+        {
+            detail::destroy(buffer_, size_);
+            if (buffer_)
+            {
+                vmem::release(buffer_, reserved_bytes_);
+            }
+        }
+
+        VirtualVector(const VirtualVector& other)
+            : VirtualVector()
+        {
+            append(other.begin(), other.end());
+        }
+
+        VirtualVector& operator=(const VirtualVector& other)
+        {
+            if (buffer_ != other.buffer_)
+            {
+                VirtualVector<T> temp(other);
+                temp.swap(*this);
+            }
+            return *this;
+        }
+
+        VirtualVector(VirtualVector&& other) noexcept
+            : VirtualVector()
+        {
+            other.swap(*this);
+        }
+
+        VirtualVector& operator=(VirtualVector&& other) noexcept
+        {
+            other.swap(*this);
+            return *this;
+        }
+
+        T& operator[](size_type index)
+        {
+            return buffer_[index];
+        }
+
+        const T& operator[](size_type index) const
+        {
+            return buffer_[index];
+        }
+
+        T& at(size_type index)
+        {
+            return buffer_[index];
+        }
+
+        const T& at(size_type index) const
+        {
+            return buffer_[index];
+        }
+
+        T* data() const
+        {
+            return buffer_;
+        }
+
+        T* begin() const
+        {
+            return buffer_;
+        }
+
+        T* end() const
+        {
+            return buffer_ + size_;
+        }
+
+        size_type size() const
+        {
+            return size_;
+        }
+
+        // committed elements
+        size_type capacity() const
+        {
+            return capacity_;
+        }
+
+        // elements that fit before growing has to move them
+        size_type reserved() const
+        {
+            return reserved_;
+        }
+
+        bool empty() const
+        {
+            return size_ == 0;
+        }
+
+        void push_back(const T& value)
+        {
+            emplace_back(value);
+        }
+
+        template<typename ... Args>
+        T& emplace_back(Args&& ... args)
+        {
+            if (size_ == capacity_)
+            {
+                // args may point into the buffer, grow() only moves it past the reservation
+                if (size_ == reserved_)
+                {
+                    T value(std::forward<Args>(args)...);
+                    grow(size_ + 1);
+                    new (buffer_ + size_) T(std::move(value));
+                    return buffer_[size_++];
+                }
+                grow(size_ + 1);
+            }
+
+            new (buffer_ + size_) T(std::forward<Args>(args)...);
+
+            return buffer_[size_++];
+        }
+
+        void pop_back()
+        {
+            buffer_[--size_].~T();
+        }
+
+        const T& front() const
+        {
+            return buffer_[0];
+        }
+
+        const T& back() const
+        {
+            return buffer_[size_ - 1];
+        }
+
+        void clear()
+        {
+            detail::destroy(buffer_, size_);
+            size_ = 0;
+        }
+
+        void resize(size_type count, const T& elem = T())
+        {
+            if (count > size_)
+            {
+                const T copy(elem);
+                grow(count);
+                for (size_type i = size_; i < count; ++i)
+                {
+                    new (buffer_ + i) T(copy);
+                }
+                size_ = count;
+            }
+            else
+            {
+                detail::destroy(buffer_ + count, size_ - count);
+                size_ = count;
+            }
+        }
+
+        //
+        // new elements are default-initialized, which for trivial types means the freshly
+        // committed zero pages (or whatever was left there before a shrink without
+        // shrink_to_fit)
+        //
+        void resize_uninitialized(size_type count)
+        {
+            if (count > size_)
+            {
+                grow(count);
+                if constexpr (!std::is_trivially_default_constructible_v<T>)
+                {
+                    for (size_type i = size_; i < count; ++i)
+                    {
+                        new (buffer_ + i) T;
+                    }
+                }
+                size_ = count;
+            }
+            else
+            {
+                detail::destroy(buffer_ + count, size_ - count);
+                size_ = count;
+            }
+        }
+
+        T* insert(const T* pos, const T& value)
+        {
+            return insert(pos, &value, &value + 1);
+        }
+
+        T* insert(const T* pos, size_type count, const T& value)
+        {
+            const T copy(value);
+            T* gap = open_gap(pos, count);
+            for (size_type i = 0; i < count; ++i)
+            {
+                new (gap + i) T(copy);
+            }
+            return gap;
+        }
+
+        template<typename It, typename = std::enable_if_t<!std::is_integral_v<It>>>
+        T* insert(const T* pos, It first, It last)
+        {
+            if constexpr (std::is_pointer_v<It>)
+            {
+                // a range out of this same vector would move under us
+                if (first != last && &*first >= buffer_ && &*first < buffer_ + size_)
+                {
+                    const Vector<T> temp(first, last);
+                    return insert(pos, temp.begin(), temp.end());
+                }
+            }
+
+            const size_type count = size_type(std::distance(first, last));
+            T* gap = open_gap(pos, count);
+            detail::construct(gap, first, count);
+            return gap;
+        }
+
+        template<typename It, typename = std::enable_if_t<!std::is_integral_v<It>>>
+        void append(It first, It last)
+        {
+            insert(end(), first, last);
+        }
+
+        T* erase(const T* pos)
+        {
+            return erase(pos, pos + 1);
+        }
+
+        T* erase(const T* first, const T* last)
+        {
+            T* dst = buffer_ + (first - buffer_);
+            const size_type count = size_type(last - first);
+            if (count > 0)
+            {
+                detail::close_gap(dst, count, size_type((buffer_ + size_) - last));
+                size_ -= count;
+            }
+            return dst;
+        }
+
+        // commits room for capacity elements
+        void reserve(size_type capacity)
+        {
+            if (capacity > capacity_)
+            {
+                grow(capacity);
+            }
+        }
+
+        // decommits the pages past the last element
+        void shrink_to_fit()
+        {
+            const size_t keep = vmem::round_up(size_ * sizeof(T));
+            if (committed_bytes_ > keep)
+            {
+                vmem::decommit(reinterpret_cast<char*>(buffer_) + keep, committed_bytes_ - keep);
+                committed_bytes_ = keep;
+                capacity_ = keep / sizeof(T);
+            }
+        }
+
+        //
+        // address space for count elements. meant to be called up front, on a non empty
+        // vector the elements are moved to the new range
+        //
+        void reserve_address(size_type count)
+        {
+            if (count > 0 && count >= size_ && count != reserved_)
+            {
+                rebase(count);
+            }
+        }
+
+        void swap(VirtualVector& other) noexcept
+        {
+            std::swap(capacity_, other.capacity_);
+            std::swap(size_, other.size_);
+            std::swap(reserved_, other.reserved_);
+            std::swap(committed_bytes_, other.committed_bytes_);
+            std::swap(reserved_bytes_, other.reserved_bytes_);
+            std::swap(buffer_, other.buffer_);
+        }
+
+    private:
+        size_type size_;
+        size_type capacity_;
+        size_type reserved_;
+        size_t committed_bytes_;
+        size_t reserved_bytes_;
+        T* buffer_;
+
+        // commits geometrically (at most a GB at a time): untouched committed pages cost nothing
+        void grow(size_type count)
+        {
+            if (count <= capacity_)
+            {
+                return;
+            }
+
+            if (count > reserved_)
+            {
+                const size_type minimum = DEFAULT_RESERVE / sizeof(T);
+                const size_type doubled = (reserved_ * 2 > minimum)? reserved_ * 2 : minimum;
+                rebase((count > doubled)? count : doubled);
+            }
+
+            const size_t step = (committed_bytes_ < (size_t(1) << 30))? committed_bytes_ : (size_t(1) << 30);
+            size_t wanted = vmem::round_up((count * sizeof(T) > committed_bytes_ + step)? count * sizeof(T) : committed_bytes_ + step);
+            wanted = (wanted < reserved_bytes_)? wanted : reserved_bytes_;
+
+            if (!vmem::commit(reinterpret_cast<char*>(buffer_) + committed_bytes_, wanted - committed_bytes_))
+            {
+                throw std::bad_alloc();
+            }
+            committed_bytes_ = wanted;
+            capacity_ = wanted / sizeof(T);
+        }
+
+        // a new reservation for count elements, the live ones are moved over
+        void rebase(size_type count)
+        {
+            const size_t bytes = vmem::round_up(count * sizeof(T));
+            const size_t committed = vmem::round_up(size_ * sizeof(T));
+            T* range = static_cast<T*>(vmem::reserve(bytes));
+            if (!range || (committed > 0 && !vmem::commit(range, committed)))
+            {
+                if (range) vmem::release(range, bytes);
+                throw std::bad_alloc();
+            }
+
+            detail::relocate(range, buffer_, size_);
+            if (buffer_)
+            {
+                vmem::release(buffer_, reserved_bytes_);
+            }
+            buffer_ = range;
+            reserved_bytes_ = bytes;
+            reserved_ = bytes / sizeof(T);
+            committed_bytes_ = committed;
+            capacity_ = committed / sizeof(T);
+        }
+
+        T* open_gap(const T* pos, size_type count)
+        {
+            const size_type index = size_type(pos - buffer_);
+            grow(size_ + count);
+            detail::relocate_back(buffer_ + index + count, buffer_ + index, size_ - index);
+            size_ += count;
+            return buffer_ + index;
+        }
+    };
+}
@@ -4,9 +4,41 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include <vector>
+#include <atomic>
+#include <random>
+#include <string>
+#include <array>
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
 
 #include "cclib.h"
 #include "ccvector.h"
+#include "ccvmem.h"
+#include "ccsimd.h"
+#include "ccparallel.h"
+#include "ccexpr.h"
+#include "cctransform.h"
+#include "ccimage.h"
+#include "ccresample.h"
+#include "ccbc.h"
+#include "ccsort.h"
+#include "ccspatial.h"
+#include "ccbounds.h"
+#include "ccmeshio.h"
+#include "ccpool.h"
+#include "cchash.h"
+#include "ccmeshopt.h"
+#include "ccqueue.h"
+#include "ccnoise.h"
+#include "ccexposure.h"
+#include "ccsh.h"
+#include "ccbitvector.h"
+#include "ccskin.h"
+#include "ccblur.h"
+
+#define CC_PROF_ENABLED
+#include "ccprof.h"
 
 // adjust tolerance for test results
 static constexpr float EPS = 1.e-4f;
@@ -174,6 +206,2230 @@ TEST_F(Test, Vector)
     }
 }
 
+TEST_F(Test, SimdDispatch)
+{
+    const cc::simd::Level active = cc::simd::level();
+    EXPECT_LE(active, cc::simd::detect());
+
+    alignas(64) cc::math::mat4 m[5];
+    cc::math::vec4 v[7];
+    float f[33];
+    for (int i = 0; i < 5; ++i) m[i] = cc::math::translate(cc_P_V, cc::math::vec3(float(i)));
+    for (int i = 0; i < 7; ++i) v[i] = cc::math::vec4(i * .5f, 1.f - i, 2.f * i, 1.f);
+    for (int i = 0; i < 33; ++i) f[i] = i / 32.f;
+
+    for (uint32_t l = 0; l < uint32_t(cc::simd::Level::Count); ++l)
+    {
+        const cc::simd::Level level = cc::simd::force(cc::simd::Level(l));
+        EXPECT_LE(level, cc::simd::Level(l));
+        EXPECT_EQ(level, cc::simd::level());
+
+        cc::math::vec4 tv[7];
+        cc::simd::transform(cc_P_V, v, tv, 7);
+        for (int i = 0; i < 7; ++i)
+            for (int j = 0; j < 4; ++j)
+                EXPECT_NEAR((cc_P_V * v[i])[j], tv[i][j], EPS * 100.f);
+
+        alignas(64) cc::math::mat4 tm[5];
+        cc::simd::mul(m, m, tm, 5);
+        for (int i = 0; i < 5; ++i)
+            for (int j = 0; j < 4; ++j)
+                for (int k = 0; k < 4; ++k)
+                    EXPECT_NEAR((m[i] * m[i])[j][k], tm[i][j][k], 1.e-3f * cc::math::abs((m[i] * m[i])[j][k]) + EPS);
+
+        float tf[33];
+        cc::simd::srgb(f, tf, 33);
+        for (int i = 0; i < 33; ++i) EXPECT_NEAR(cc::gfx::srgb(f[i]), tf[i], EPS);
+        cc::simd::aces(f, tf, 33);
+        for (int i = 0; i < 33; ++i) EXPECT_NEAR(cc::gfx::aces(f[i]), tf[i], EPS);
+    }
+
+    cc::simd::force(active);
+}
+
+TEST_F(Test, SimdInverse)
+{
+    const cc::simd::Level active = cc::simd::level();
+
+    // 19 is not a multiple of any lane width, 5 and 11 can't be inverted
+    constexpr int N = 19;
+    alignas(64) cc::math::mat4 m[N];
+    cc::math::mat3 m3[N];
+    for (int i = 0; i < N; ++i)
+    {
+        m[i] = cc::math::rotate(cc::math::translate(cc_P_V, cc::math::vec3(float(i), 1.f, -2.f)), .3f * i, cc::math::vec3(1.f, 2.f, 3.f));
+        m3[i] = cc::math::mat3(m[i]);
+    }
+    m[5] = cc::math::scale(cc::math::mat4(1.f), cc::math::vec3(1.f, 0.f, 1.f));
+    m3[5] = cc::math::mat3(m[5]);
+    m[11] = cc::math::mat4();
+    m3[11] = cc::math::mat3();
+
+    for (uint32_t l = 0; l < uint32_t(cc::simd::Level::Count); ++l)
+    {
+        cc::simd::force(cc::simd::Level(l));
+
+        alignas(64) cc::math::mat4 inv[N], inv_t[N];
+        cc::math::mat3 inv3[N], inv3_t[N];
+        uint8_t singular[N];
+        EXPECT_EQ(cc::simd::inverse(m, inv, N, singular), 2u);
+        EXPECT_EQ(cc::simd::inverse_transpose(m, inv_t, N), 2u);
+        EXPECT_EQ(cc::simd::inverse(m3, inv3, N), 2u);
+        EXPECT_EQ(cc::simd::inverse_transpose(m3, inv3_t, N), 2u);
+
+        for (int i = 0; i < N; ++i)
+        {
+            EXPECT_EQ(singular[i], (i == 5 || i == 11)? 1 : 0);
+
+            const cc::math::mat4 expected = singular[i]? cc::math::mat4() : cc::math::inverse(m[i]);
+            const cc::math::mat3 expected3 = singular[i]? cc::math::mat3() : cc::math::inverse(m3[i]);
+            for (int j = 0; j < 4; ++j)
+                for (int k = 0; k < 4; ++k)
+                {
+                    EXPECT_NEAR(expected[j][k], inv[i][j][k], 1.e-3f * cc::math::abs(expected[j][k]) + EPS);
+                    EXPECT_NEAR(expected[j][k], inv_t[i][k][j], 1.e-3f * cc::math::abs(expected[j][k]) + EPS);
+                }
+            for (int j = 0; j < 3; ++j)
+                for (int k = 0; k < 3; ++k)
+                {
+                    EXPECT_NEAR(expected3[j][k], inv3[i][j][k], 1.e-3f * cc::math::abs(expected3[j][k]) + EPS);
+                    EXPECT_NEAR(expected3[j][k], inv3_t[i][k][j], 1.e-3f * cc::math::abs(expected3[j][k]) + EPS);
+                }
+        }
+
+        // in place
+        alignas(64) cc::math::mat4 copy[N];
+        for (int i = 0; i < N; ++i) copy[i] = m[i];
+        cc::simd::inverse(copy, copy, N);
+        for (int j = 0; j < 4; ++j)
+            for (int k = 0; k < 4; ++k)
+                EXPECT_FLOAT_EQ(inv[N - 1][j][k], copy[N - 1][j][k]);
+    }
+
+    cc::simd::force(active);
+}
+
+TEST_F(Test, Profiler)
+{
+    cc::prof::reset();
+    for (int i = 0; i < 10; ++i)
+    {
+        CC_PROF_ZONE("outer");
+        for (int j = 0; j < 3; ++j)
+        {
+            CC_PROF_ZONE("inner \"quoted\"");
+            CC_PROF_COUNTER("j", j);
+        }
+    }
+
+    auto stats = cc::prof::summary();
+    ASSERT_EQ(stats.size(), 2u);
+    EXPECT_EQ(stats[0].name, "outer");
+    EXPECT_EQ(stats[0].count, 10u);
+    EXPECT_EQ(stats[1].count, 30u);
+    EXPECT_LE(stats[1].p50_us, stats[1].p99_us);
+    EXPECT_LE(stats[1].total_us, stats[0].total_us);
+
+    std::FILE* f = std::tmpfile();
+    cc::prof::write_chrome_trace(f);
+    std::rewind(f);
+    std::string json;
+    for (int c; (c = std::fgetc(f)) != EOF;) json += char(c);
+    std::fclose(f);
+
+    EXPECT_EQ(json.find("{\"traceEvents\":["), 0u);
+    EXPECT_NE(json.find("\"name\":\"inner \\\"quoted\\\"\",\"ph\":\"X\""), std::string::npos);
+    EXPECT_NE(json.find("\"ph\":\"C\""), std::string::npos);
+}
+
+TEST_F(Test, ThreadPool)
+{
+    cc::ThreadPool pool(4);
+    EXPECT_EQ(pool.size(), 4u);
+
+    std::vector<std::atomic<int>> hits(10007);
+    pool.parallel_for(0, hits.size(), [&](size_t first, size_t last)
+    {
+        EXPECT_LE(last - first, 16u);
+        for (size_t i = first; i < last; ++i) hits[i]++;
+    }, 16);
+    for (auto& h : hits) EXPECT_EQ(h.load(), 1);
+
+    // nested loops run on the same workers
+    std::atomic<int> nested{ 0 };
+    pool.parallel_for(0, 8, [&](size_t first, size_t last)
+    {
+        for (size_t i = first; i < last; ++i)
+            pool.parallel_for(0, 100, [&](size_t a, size_t b) { nested += int(b - a); });
+    }, 1);
+    EXPECT_EQ(nested.load(), 800);
+
+    const uint64_t sum = pool.parallel_reduce(size_t(0), size_t(100000), uint64_t(0),
+        [](size_t first, size_t last) { uint64_t s = 0; for (size_t i = first; i < last; ++i) s += i; return s; },
+        [](uint64_t a, uint64_t b) { return a + b; });
+    EXPECT_EQ(sum, 100000ull * 99999ull / 2ull);
+    EXPECT_EQ(pool.parallel_reduce(size_t(5), size_t(5), 42, [](size_t, size_t) { return 0; }, [](int a, int b) { return a + b; }), 42);
+
+    int a = 0, b = 0, c = 0;
+    pool.parallel_invoke([&] { a = 1; }, [&] { b = 2; }, [&] { c = 3; });
+    EXPECT_EQ(a + b + c, 6);
+
+    cc::Vector<float> values(1000, 1.f);
+    cc::parallel_for(values, [](float* first, float* last) { for (; first != last; ++first) *first *= 2.f; });
+    for (float v : values) EXPECT_EQ(v, 2.f);
+
+    // exceptions come back to the caller once every task has finished, wherever they were thrown
+    std::atomic<int> visited{ 0 };
+    EXPECT_THROW(pool.parallel_for(0, 1000, [&](size_t first, size_t last)
+    {
+        visited += int(last - first);
+        if (first <= 500 && 500 < last) throw std::runtime_error("chunk");
+    }, 10), std::runtime_error);
+    const int visited_at_throw = visited.load();
+    EXPECT_LE(visited_at_throw, 1000);
+    pool.parallel_for(0, 1000, [](size_t, size_t) {});
+    EXPECT_EQ(visited.load(), visited_at_throw);
+    EXPECT_THROW(pool.parallel_reduce(size_t(0), size_t(1000), 0, [](size_t first, size_t) -> int
+    {
+        if (first == 0) throw std::runtime_error("map");
+        return 1;
+    }, [](int x, int y) { return x + y; }, 10), std::runtime_error);
+    int done = 0;
+    EXPECT_THROW(pool.parallel_invoke([&] { done += 1; }, [] { throw std::runtime_error("invoke"); }, [&] { done += 2; }), std::runtime_error);
+    EXPECT_EQ(done, 3);
+
+    // default reduce grain doesn't depend on the pool size
+    cc::ThreadPool single(1);
+    auto float_sum = [](cc::ThreadPool& p)
+    {
+        return p.parallel_reduce(size_t(0), size_t(100000), 0.f,
+            [](size_t first, size_t last) { float s = 0.f; for (size_t i = first; i < last; ++i) s += 1.f / float(i + 1); return s; },
+            [](float x, float y) { return x + y; });
+    };
+    EXPECT_EQ(float_sum(single), float_sum(pool));
+}
+
+TEST_F(Test, Expressions)
+{
+    using namespace cc::expr;
+    using cc::math::vec3;
+    using cc::math::vec4;
+
+    cc::Vector<float> a, b, t, out;
+    cc::Vector<vec3> n, o3;
+    cc::Vector<vec4> c, o4;
+    for (int i = 0; i < 100; ++i)
+    {
+        a.push_back(i * .1f);
+        b.push_back(1.f - i * .05f);
+        t.push_back(i / 99.f);
+        n.push_back(vec3(1.f + i, 2.f - i, .5f * i));
+        c.push_back(vec4(i * .02f, i * .03f, i * .04f, 1.f));
+    }
+
+    lazy(out) = lazy(a) * 2.f + lazy(b);
+    ASSERT_EQ(out.size(), a.size());
+    for (int i = 0; i < 100; ++i) EXPECT_NEAR(out[i], a[i] * 2.f + b[i], EPS);
+
+    lazy(out) = cc::expr::saturate(cc::expr::lerp(lazy(a), lazy(b), lazy(t)) - .25f) / 2.f;
+    for (int i = 0; i < 100; ++i) EXPECT_NEAR(out[i], cc::math::saturate(cc::math::lerp(a[i], b[i], t[i]) - .25f) / 2.f, EPS);
+
+    lazy(out) = dot(normalize(lazy(n)), vec3(0.f, 1.f, 0.f));
+    for (int i = 0; i < 100; ++i) EXPECT_NEAR(out[i], cc::math::normalize(n[i]).y, EPS);
+
+    lazy(o3) = cc::expr::lerp(lazy(n), -lazy(n), .5f) + cc::expr::saturate(lazy(n)) * lazy(a);
+    for (int i = 0; i < 100; ++i) EXPECT_NEAR(o3[i].x, cc::math::saturate(n[i].x) * a[i], EPS);
+
+    lazy(o3) = -lazy(n) * lazy(a);
+    for (int i = 0; i < 100; ++i) EXPECT_NEAR(o3[i].z, -n[i].z * a[i], EPS);
+
+    cc::ThreadPool pool(3);
+    eval(o4, srgb(aces(lazy(c) * 4.f)), pool, 7);
+    ASSERT_EQ(o4.size(), c.size());
+    for (int i = 0; i < 100; ++i)
+    {
+        const vec4 expected = cc::gfx::srgb(cc::gfx::aces(c[i] * 4.f));
+        for (int j = 0; j < 4; ++j) EXPECT_NEAR(o4[i][j], expected[j], EPS);
+    }
+
+    // in-place, element for element
+    lazy(c) = lazy(c) * 2.f;
+    EXPECT_NEAR(c[10].y, .6f, EPS);
+
+    // mismatched lengths stop at the shortest operand
+    cc::Vector<float> shorter(4), longer(6), sum;
+    for (int i = 0; i < 6; ++i) longer[i] = float(i);
+    for (int i = 0; i < 4; ++i) shorter[i] = 10.f;
+    eval(sum, lazy(longer) + lazy(shorter) * 2.f);
+    ASSERT_EQ(sum.size(), 4u);
+    for (int i = 0; i < 4; ++i) EXPECT_NEAR(sum[i], 20.f + i, EPS);
+
+    // raw targets don't grow either, the tail is left alone
+    float raw[16];
+    for (float& r : raw) r = -1.f;
+    lazy(raw, 16) = lazy(shorter) * 2.f;
+    EXPECT_NEAR(raw[3], 20.f, EPS);
+    EXPECT_EQ(raw[4], -1.f);
+
+    // const vectors are read-only operands
+    const cc::Vector<float>& readonly = shorter;
+    static_assert(std::is_same<decltype(lazy(readonly)), ConstTerminal<float>>::value, "const vector must give a read-only view");
+    static_assert(!std::is_assignable<ConstTerminal<float>&, ConstTerminal<float>>::value, "read-only view must not be assignable");
+    eval(sum, lazy(readonly) - 1.f);
+    EXPECT_NEAR(sum[2], 9.f, EPS);
+}
+
+TEST_F(Test, TransformHierarchy)
+{
+    using cc::math::mat4;
+    using cc::math::vec3;
+
+    auto expect_mat_near = [](const mat4& a, const mat4& b)
+    {
+        for (int i = 0; i < 4; ++i)
+            for (int j = 0; j < 4; ++j)
+                EXPECT_NEAR(a[i][j], b[i][j], EPS);
+    };
+
+    cc::TransformHierarchy h;
+    const mat4 root_m = cc::math::translate(mat4(1.f), vec3(1.f, 2.f, 3.f));
+    const mat4 arm_m = cc::math::rotate(mat4(1.f), .5f, vec3(0.f, 1.f, 0.f));
+    const mat4 hand_m = cc::math::scale(mat4(1.f), vec3(2.f));
+
+    const uint32_t root = h.add(cc::TransformHierarchy::NO_PARENT, root_m);
+    const uint32_t arm = h.add(root, arm_m);
+    const uint32_t hand = h.add(arm, hand_m);
+    const uint32_t other = h.add(root, hand_m);
+    EXPECT_EQ(h.levels(), 3u);
+    EXPECT_EQ(h.level(hand), 2u);
+
+    h.update();
+    expect_mat_near(h.world(hand), root_m * arm_m * hand_m);
+    expect_mat_near(h.world(other), root_m * hand_m);
+    expect_mat_near(h.world_inverse(hand), cc::math::inverse(root_m * arm_m * hand_m));
+
+    // only the arm subtree moves
+    const mat4 arm2_m = cc::math::translate(arm_m, vec3(0.f, 0.f, 5.f));
+    h.set_local(arm, arm2_m);
+    h.update();
+    expect_mat_near(h.world(hand), root_m * arm2_m * hand_m);
+    expect_mat_near(h.world(other), root_m * hand_m);
+    expect_mat_near(h.world_inverse(hand), cc::math::inverse(root_m * arm2_m * hand_m));
+
+    // wide tree, parallel update matches the serial one
+    cc::TransformHierarchy a, b;
+    for (uint32_t i = 0; i < 2000; ++i)
+    {
+        const uint32_t parent = i? (i - 1) / 4 : cc::TransformHierarchy::NO_PARENT;
+        const mat4 local = cc::math::rotate(cc::math::translate(mat4(1.f), vec3(.01f * i)), .001f * i, vec3(1.f, 0.f, 1.f));
+        a.add(parent, local);
+        b.add(parent, local);
+    }
+    cc::ThreadPool pool(4);
+    b.set_parallel_threshold(16);
+    a.update();
+    b.update(pool);
+    a.set_local(7, mat4(1.f));
+    b.set_local(7, mat4(1.f));
+    a.update();
+    b.update(pool);
+    b.update_inverses(pool);
+    for (uint32_t i = 0; i < 2000; ++i)
+    {
+        EXPECT_EQ(a.world(i), b.world(i));
+        EXPECT_EQ(a.world_inverse(i), b.world_inverse(i));
+    }
+}
+
+TEST_F(Test, Image)
+{
+    using cc::math::vec4;
+    constexpr uint32_t W = 37, H = 21;     // not multiples of the tile size nor powers of two
+
+    cc::ThreadPool pool(4);
+    for (uint32_t l = 0; l < uint32_t(cc::ImageLayout::Count); ++l)
+    {
+        cc::Image<vec4> image(W, H, cc::ImageLayout(l));
+        EXPECT_EQ(image.layout(), cc::ImageLayout(l));
+        EXPECT_GE(image.storage_size(), size_t(W) * H);
+
+        // every pixel maps to its own slot
+        std::vector<int> used(image.storage_size(), 0);
+        for (uint32_t y = 0; y < H; ++y)
+            for (uint32_t x = 0; x < W; ++x)
+            {
+                ASSERT_LT(image.offset(x, y), image.storage_size());
+                EXPECT_EQ(used[image.offset(x, y)]++, 0);
+                image(x, y) = vec4(float(x), float(y), 0.f, 1.f);
+            }
+
+        // tiles cover the image exactly once, also from the pool
+        std::vector<std::atomic<int>> visits(size_t(W) * H);
+        image.for_each_tile(pool, [&](const cc::Image<vec4>::Tile& t)
+        {
+            for (uint32_t y = t.y; y < t.y + t.height; ++y)
+                for (uint32_t x = t.x; x < t.x + t.width; ++x)
+                    ++visits[y * W + x];
+        });
+        for (auto& v : visits) EXPECT_EQ(v.load(), 1);
+
+        for (uint32_t dst = 0; dst < uint32_t(cc::ImageLayout::Count); ++dst)
+        {
+            const cc::Image<vec4> other = image.converted(cc::ImageLayout(dst), pool);
+            EXPECT_EQ(other.layout(), cc::ImageLayout(dst));
+            for (uint32_t y = 0; y < H; ++y)
+                for (uint32_t x = 0; x < W; ++x)
+                    EXPECT_EQ(other(x, y).x, float(x));
+        }
+    }
+
+    // tiles are contiguous in the tiled layout
+    cc::Image<cc::gfx::rgba8> tiled(16, 16, cc::ImageLayout::Tiled, cc::gfx::rgba8{ 1, 2, 3, 4 });
+    const auto tile = tiled.tile(3);
+    EXPECT_EQ(tile.x, 8u);
+    EXPECT_EQ(tile.y, 8u);
+    tiled.tile_data(tile)[9] = cc::gfx::rgba8{ 255, 0, 0, 255 };
+    EXPECT_TRUE(tiled(9, 9) == (cc::gfx::rgba8{ 255, 0, 0, 255 }));
+    EXPECT_TRUE(tiled(0, 0) == (cc::gfx::rgba8{ 1, 2, 3, 4 }));
+
+    for (int i = 0; i < 256; ++i)
+    {
+        const cc::gfx::rgba8 p{ uint8_t(i), uint8_t(255 - i), uint8_t(i / 2), 255 };
+        EXPECT_TRUE(cc::gfx::to_rgba8(cc::gfx::to_vec4(p)) == p);
+    }
+}
+
+TEST_F(Test, Resample)
+{
+    using cc::math::vec4;
+    using cc::gfx::rgba8;
+    namespace rs = cc::resample;
+
+    cc::ThreadPool pool(4);
+    for (uint32_t f = 0; f < uint32_t(rs::Filter::Count); ++f)
+    {
+        const rs::Filter filter = rs::Filter(f);
+        for (uint32_t dst : { 1u, 7u, 16u, 50u, 61u })
+        {
+            const rs::Weights w = rs::compute_weights(33, dst, filter);
+            for (uint32_t i = 0; i < dst; ++i)
+            {
+                float sum = 0.f;
+                for (uint32_t k = 0; k < w.taps; ++k) sum += w.weights[i * w.taps + k];
+                EXPECT_NEAR(sum, 1.f, EPS);
+                EXPECT_LE(w.first[i] + w.taps, 33u);
+            }
+        }
+
+        // flat images stay flat, also through the 8-bit srgb round trip
+        cc::Image<vec4> flat(37, 20, cc::ImageLayout::RowMajor, vec4(.25f, .5f, 1.f, 1.f));
+        const cc::Image<vec4> flat_small = rs::resized(flat, 13, 9, filter, pool);
+        for (uint32_t y = 0; y < 9; ++y)
+            for (uint32_t x = 0; x < 13; ++x)
+                EXPECT_NEAR(flat_small(x, y).y, .5f, EPS);
+
+        cc::Image<rgba8> flat8(40, 40, cc::ImageLayout::Tiled, rgba8{ 10, 128, 250, 77 });
+        const cc::Image<rgba8> flat8_big = rs::resized(flat8, 57, 61, filter, pool);
+        for (uint32_t y = 0; y < 61; ++y)
+            for (uint32_t x = 0; x < 57; ++x)
+                EXPECT_TRUE(flat8_big(x, y) == (rgba8{ 10, 128, 250, 77 }));
+    }
+
+    // a black/white checkerboard averages to linear .5, which is 188 in srgb (not 128)
+    cc::Image<rgba8> checker(64, 32);
+    for (uint32_t y = 0; y < 32; ++y)
+        for (uint32_t x = 0; x < 64; ++x)
+            checker(x, y) = ((x ^ y) & 1)? rgba8{ 255, 255, 255, 255 } : rgba8{ 0, 0, 0, 255 };
+
+    const cc::Vector<cc::Image<rgba8>> mips = rs::mip_chain(checker, rs::Filter::Box, pool);
+    ASSERT_EQ(mips.size(), 7u);
+    EXPECT_EQ(mips[0].width(), 64u);
+    EXPECT_EQ(mips[5].width(), 2u);
+    EXPECT_EQ(mips[5].height(), 1u);
+    EXPECT_EQ(mips[6].width(), 1u);
+    for (size_t l = 1; l < mips.size(); ++l)
+    {
+        EXPECT_NEAR(mips[l](0, 0).r, 188, 1);
+        EXPECT_EQ(mips[l](0, 0).a, 255);
+    }
+
+    // odd sizes round down and still end at 1x1
+    const auto odd = rs::mip_chain(cc::Image<vec4>(37, 5), rs::Filter::Kaiser, pool);
+    EXPECT_EQ(odd.size(), 6u);
+    EXPECT_EQ(odd[1].width(), 18u);
+    EXPECT_EQ(odd[1].height(), 2u);
+    EXPECT_EQ(odd[5].width(), 1u);
+}
+
+TEST_F(Test, BlockCompression)
+{
+    using cc::gfx::rgba8;
+    namespace bc = cc::bc;
+
+    // smooth gradients with a hard edge, a bit of noise and an alpha ramp. 50x30 leaves partial border blocks
+    cc::Image<rgba8> image(50, 30);
+    uint32_t seed = 12345;
+    for (uint32_t y = 0; y < 30; ++y)
+    {
+        for (uint32_t x = 0; x < 50; ++x)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            const int noise = int(seed >> 29) - 4;
+            const int edge = (x > y + 10)? 80 : 0;
+            image(x, y) = rgba8{ uint8_t(cc::math::clamp(int(x * 5) + noise, 0, 255)),
+                                 uint8_t(cc::math::clamp(int(y * 8) + edge, 0, 255)),
+                                 uint8_t(cc::math::clamp(200 - int(x * 2) - edge + noise, 0, 255)),
+                                 uint8_t(x * 255 / 49) };
+        }
+    }
+
+    cc::ThreadPool pool(4);
+    const float min_psnr[] = { 31.f, 32.f, 46.f, 44.f, 32.f };
+    const uint32_t channels[] = { 3, 4, 1, 2, 4 };
+    for (uint32_t f = 0; f < uint32_t(bc::Format::Count); ++f)
+    {
+        const bc::Format format = bc::Format(f);
+        float previous = 0.f;
+        for (uint32_t q = 0; q < uint32_t(bc::Quality::Count); ++q)
+        {
+            const cc::Vector<uint8_t> blocks = bc::compress(image, format, bc::Quality(q), pool);
+            ASSERT_EQ(blocks.size(), bc::compressed_size(format, 50, 30));
+
+            const cc::Image<rgba8> decoded = bc::decompress(blocks.data(), 50, 30, format, pool);
+            const float db = bc::psnr(image, decoded, channels[f]);
+            EXPECT_GT(db, min_psnr[f]);
+            EXPECT_GT(db, previous - .5f);
+            previous = db;
+        }
+    }
+
+    // 565-representable solid colors and two-valued channels are lossless
+    const rgba8 red{ 255, 0, 0, 255 };
+    rgba8 texels[16], decoded[16];
+    uint8_t block[16];
+    for (rgba8& t : texels) t = red;
+    bc::encode_block(bc::Format::BC1, texels, block, bc::Quality::Fast);
+    bc::decode_block(bc::Format::BC1, block, decoded);
+    for (const rgba8& t : decoded) EXPECT_TRUE(t == red);
+
+    for (int i = 0; i < 16; ++i) texels[i] = rgba8{ uint8_t((i & 1)? 17 : 230), 0, 0, 255 };
+    bc::encode_block(bc::Format::BC4, texels, block);
+    bc::decode_block(bc::Format::BC4, block, decoded);
+    for (int i = 0; i < 16; ++i) EXPECT_EQ(decoded[i].r, texels[i].r);
+
+    for (int i = 0; i < 16; ++i) texels[i] = rgba8{ 10, 100, 200, uint8_t(i * 17) };
+    bc::encode_block(bc::Format::BC7, texels, block, bc::Quality::High);
+    bc::decode_block(bc::Format::BC7, block, decoded);
+    for (int i = 0; i < 16; ++i)
+    {
+        EXPECT_NEAR(decoded[i].g, 100, 1);
+        EXPECT_NEAR(decoded[i].a, i * 17, 3);
+    }
+
+    // luma psnr goes through cc::yuv
+    EXPECT_GT(bc::psnr_luma(image, bc::decompress(bc::compress(image, bc::Format::BC1).data(), 50, 30, bc::Format::BC1)), 34.f);
+}
+
+TEST_F(Test, RadixSort)
+{
+    cc::ThreadPool pool(4);
+    std::mt19937 mt(7);
+
+    // big enough to be split in chunks, small key range so that the top passes are skipped
+    for (size_t count : { size_t(1000), size_t(300000) })
+    {
+        cc::Vector<uint64_t> keys(count);
+        cc::Vector<uint32_t> values(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            keys[i] = mt() % 5000;
+            values[i] = uint32_t(i);
+        }
+        const cc::Vector<uint64_t> original(keys);
+
+        cc::radix_sort(keys, values, pool);
+        for (size_t i = 0; i < count; ++i)
+        {
+            EXPECT_EQ(keys[i], original[values[i]]);
+            if (i > 0)
+            {
+                ASSERT_LE(keys[i - 1], keys[i]);
+                if (keys[i - 1] == keys[i])
+                {
+                    ASSERT_LT(values[i - 1], values[i]);
+                }
+            }
+        }
+    }
+
+    cc::Vector<uint32_t> keys{ 0xdeadbeefu, 3u, 0xffffffffu, 0u, 3u };
+    const cc::Vector<uint32_t> order = cc::sorted_order(keys, pool);
+    const uint32_t expected[] = { 3, 1, 4, 0, 2 };
+    for (size_t i = 0; i < 5; ++i) EXPECT_EQ(order[i], expected[i]);
+}
+
+TEST_F(Test, SpaceFillingCurves)
+{
+    namespace sp = cc::spatial;
+    using cc::math::vec3;
+
+    // against a bit-by-bit interleave
+    std::mt19937 mt(11);
+    for (int i = 0; i < 1000; ++i)
+    {
+        const uint32_t x = mt() & 0x1fffff, y = mt() & 0x1fffff, z = mt() & 0x1fffff;
+        uint64_t expected = 0;
+        for (uint32_t b = 0; b < 21; ++b)
+        {
+            expected |= uint64_t((x >> b) & 1) << (3 * b);
+            expected |= uint64_t((y >> b) & 1) << (3 * b + 1);
+            expected |= uint64_t((z >> b) & 1) << (3 * b + 2);
+        }
+        EXPECT_EQ(sp::morton63(x, y, z), expected);
+        EXPECT_EQ(sp::morton30(x & 0x3ff, y & 0x3ff, z & 0x3ff), uint32_t(expected & 0x3fffffff));
+
+        uint32_t dx, dy, dz;
+        sp::morton63_decode(expected, dx, dy, dz);
+        EXPECT_TRUE(dx == x && dy == y && dz == z);
+        sp::morton30_decode(uint32_t(expected & 0x3fffffff), dx, dy, dz);
+        EXPECT_TRUE(dx == (x & 0x3ff) && dy == (y & 0x3ff) && dz == (z & 0x3ff));
+    }
+
+    // a 16^3 hilbert curve visits every cell once, moving one step at a time
+    std::vector<bool> seen(4096, false);
+    uint32_t px = 0, py = 0, pz = 0;
+    for (uint64_t key = 0; key < 4096; ++key)
+    {
+        uint32_t x, y, z;
+        sp::hilbert_decode(key, x, y, z, 4);
+        ASSERT_TRUE(x < 16 && y < 16 && z < 16);
+        EXPECT_EQ(sp::hilbert(x, y, z, 4), key);
+        EXPECT_FALSE(seen[x + 16 * y + 256 * z]);
+        seen[x + 16 * y + 256 * z] = true;
+        if (key > 0)
+        {
+            EXPECT_EQ(std::abs(int(x) - int(px)) + std::abs(int(y) - int(py)) + std::abs(int(z) - int(pz)), 1);
+        }
+        px = x; py = y; pz = z;
+    }
+
+    // keys of a point set sort along the curve
+    cc::ThreadPool pool(4);
+    cc::Vector<vec3> points(20000);
+    std::uniform_real_distribution<float> dist(-5.f, 5.f);
+    for (vec3& p : points) p = vec3(dist(mt), dist(mt), dist(mt) * .1f);
+
+    const sp::Bounds box = sp::bounds(points.data(), points.size(), pool);
+    EXPECT_GE(box.lo.x, -5.f);
+    EXPECT_LE(box.hi.z, .5f);
+    EXPECT_EQ(sp::morton63(box.lo, box), 0u);
+    EXPECT_EQ(sp::morton30(box.hi, box), 0x3fffffffu);
+
+    for (uint32_t c = 0; c < uint32_t(sp::Curve::Count); ++c)
+    {
+        const sp::Curve curve = sp::Curve(c);
+        cc::Vector<uint64_t> keys(points.size());
+        sp::compute_keys(points.data(), points.size(), box, keys.data(), curve, pool);
+        const cc::Vector<uint32_t> order = sp::sorted_order(points.data(), points.size(), curve, pool);
+        for (size_t i = 1; i < order.size(); ++i) ASSERT_LE(keys[order[i - 1]], keys[order[i]]);
+        EXPECT_EQ(keys[7], (curve == sp::Curve::Hilbert)? sp::hilbert(points[7], box) : sp::morton63(points[7], box));
+    }
+}
+
+TEST_F(Test, MeshLoading)
+{
+    namespace mesh = cc::mesh;
+    cc::ThreadPool pool(4);
+
+    // float parsing agrees with strtof
+    for (const char* text : { "0", "-0.5", "+3.25", "1e-3", "6.02214076e23", ".5", "5.", "-1.17549435E-38",
+                              "123456789012345678901234", "0.1000000000000000055511151231257827", "inf", "-nan" })
+    {
+        float value = 0.f;
+        const char* end = mesh::detail::parse_float(text, text + strlen(text), value);
+        ASSERT_EQ(end, text + strlen(text)) << text;
+        const float expected = std::strtof(text, nullptr);
+        if (std::isnan(expected))
+        {
+            EXPECT_TRUE(std::isnan(value));
+        }
+        else
+        {
+            EXPECT_EQ(value, expected) << text;
+        }
+    }
+
+    // quads, every corner syntax, relative indices, comments and crlf. tiny chunks
+    // exercise the parallel split, results must match a single chunk
+    const char obj[] =
+        "# cube side\r\n"
+        "o side\n"
+        "v 0 0 0\n"
+        "v 1.0 0 0\n"
+        "v 1 1e0 0\r\n"
+        "  v 0 1 0 1.0\n"
+        "vt 0 0\nvt 1 0\nvt 1 1\nvt 0 1\n"
+        "vn 0 0 1\n"
+        "usemtl none\n"
+        "f 1/1/1 2/2/1 3/3/1 4/4/1\n"
+        "v 0.5 0.5 -1\n"
+        "f -5//1 -4//1 -1//-1\n"
+        "f 2 3 5 # trailing comment\n";
+
+    for (size_t chunk_bytes : { size_t(8), size_t(1) << 20 })
+    {
+        mesh::Mesh m;
+        ASSERT_TRUE(mesh::parse_obj(obj, sizeof(obj) - 1, m, pool, chunk_bytes));
+        ASSERT_EQ(m.positions.size(), 5u);
+        ASSERT_EQ(m.uvs.size(), 4u);
+        ASSERT_EQ(m.normals.size(), 1u);
+        EXPECT_TRUE(m.positions[3] == cc::math::vec3(0.f, 1.f, 0.f));
+        EXPECT_TRUE(m.positions[4] == cc::math::vec3(.5f, .5f, -1.f));
+
+        ASSERT_EQ(m.triangle_count(), 4u);
+        const uint32_t indices[] = { 0, 1, 2, 0, 2, 3, 0, 1, 4, 1, 2, 4 };
+        for (size_t i = 0; i < 12; ++i) EXPECT_EQ(m.indices[i], indices[i]);
+
+        ASSERT_EQ(m.uv_indices.size(), 12u);
+        EXPECT_EQ(m.uv_indices[5], 3u);
+        EXPECT_EQ(m.uv_indices[6], mesh::Mesh::NO_INDEX);
+        ASSERT_EQ(m.normal_indices.size(), 12u);
+        EXPECT_EQ(m.normal_indices[8], 0u);
+        EXPECT_EQ(m.normal_indices[9], mesh::Mesh::NO_INDEX);
+    }
+
+    mesh::Mesh bad;
+    EXPECT_FALSE(mesh::parse_obj("v 0 0 0\nf 1 2 3\n", 16, bad, pool));
+    const char overflow[] = "v 0 0 0\nf 1 1 99999999999999999999999\n";
+    EXPECT_FALSE(mesh::parse_obj(overflow, sizeof(overflow) - 1, bad, pool));
+
+    // the same quad + triangle as ascii and binary (both endiannesses) ply, through load()
+    const char ascii[] =
+        "ply\nformat ascii 1.0\ncomment test\n"
+        "element vertex 4\nproperty float x\nproperty float y\nproperty float z\nproperty uchar red\nproperty float nz\n"
+        "element face 2\nproperty list uchar int vertex_indices\nend_header\n"
+        "0 0 0 255 1\n1 0 0 255 1\n1 1 0 255 1\n0 1 .5 255 1\n"
+        "4 0 1 2 3\n3 3 2 0\n";
+
+    auto binary = [](bool big_endian)
+    {
+        std::string data = std::string("ply\nformat ") + (big_endian? "binary_big_endian" : "binary_little_endian") +
+            " 1.0\nelement vertex 4\nproperty float x\nproperty float y\nproperty float z\nproperty uchar red\nproperty float nz\n"
+            "element face 2\nproperty list uchar int vertex_indices\nend_header\n";
+        auto put = [&](const void* value, size_t size)
+        {
+            for (size_t i = 0; i < size; ++i) data.push_back(static_cast<const char*>(value)[big_endian? size - 1 - i : i]);
+        };
+        const float xyz[4][3] = { { 0, 0, 0 }, { 1, 0, 0 }, { 1, 1, 0 }, { 0, 1, .5f } };
+        const uint8_t red = 255;
+        const float nz = 1.f;
+        for (const auto& v : xyz)
+        {
+            put(&v[0], 4); put(&v[1], 4); put(&v[2], 4); put(&red, 1); put(&nz, 4);
+        }
+        const int32_t faces[] = { 0, 1, 2, 3, 3, 2, 0 };
+        const uint8_t four = 4, three = 3;
+        put(&four, 1);
+        for (int i = 0; i < 4; ++i) put(&faces[i], 4);
+        put(&three, 1);
+        for (int i = 4; i < 7; ++i) put(&faces[i], 4);
+        return data;
+    };
+
+    for (const std::string& data : { std::string(ascii), binary(false), binary(true) })
+    {
+        const char* path = "cclib_test_mesh.ply";
+        FILE* f = fopen(path, "wb");
+        ASSERT_TRUE(f != nullptr);
+        fwrite(data.data(), 1, data.size(), f);
+        fclose(f);
+
+        mesh::Mesh m;
+        const bool loaded = mesh::load(path, m, pool);
+        std::remove(path);
+        ASSERT_TRUE(loaded);
+
+        ASSERT_EQ(m.positions.size(), 4u);
+        EXPECT_TRUE(m.positions[3] == cc::math::vec3(0.f, 1.f, .5f));
+        ASSERT_EQ(m.normals.size(), 4u);
+        EXPECT_EQ(m.normals[2].z, 1.f);
+        EXPECT_TRUE(m.uvs.empty());
+        ASSERT_EQ(m.triangle_count(), 3u);
+        const uint32_t indices[] = { 0, 1, 2, 0, 2, 3, 3, 2, 0 };
+        for (size_t i = 0; i < 9; ++i) EXPECT_EQ(m.indices[i], indices[i]);
+    }
+
+    // binary faces split in chunks down to one record each
+    for (size_t chunk_bytes : { size_t(1), size_t(8), size_t(1) << 20 })
+    {
+        const std::string data = binary(true);
+        mesh::Mesh m;
+        ASSERT_TRUE(mesh::parse_ply(data.data(), data.size(), m, pool, chunk_bytes));
+        ASSERT_EQ(m.triangle_count(), 3u);
+        const uint32_t indices[] = { 0, 1, 2, 0, 2, 3, 3, 2, 0 };
+        for (size_t i = 0; i < 9; ++i) EXPECT_EQ(m.indices[i], indices[i]);
+    }
+
+    // negative and oversized list counts are rejected
+    {
+        std::string data = binary(false);
+        data.replace(data.find("list uchar"), 10, "list  char");
+        const size_t first_face = data.find("end_header\n") + 11 + 4 * 17;
+        data[first_face] = char(-1);
+        EXPECT_FALSE(mesh::parse_ply(data.data(), data.size(), bad, pool));
+        data[first_face] = char(100);
+        EXPECT_FALSE(mesh::parse_ply(data.data(), data.size(), bad, pool));
+    }
+
+    mesh::Mesh missing;
+    EXPECT_FALSE(mesh::load("does_not_exist.obj", missing, pool));
+}
+
+TEST_F(Test, Pool)
+{
+    struct Tracked
+    {
+        int value;
+        int* alive;
+
+        Tracked(int v, int* counter) : value(v), alive(counter)     { ++*alive; }
+        Tracked(Tracked&& other) : value(other.value), alive(other.alive) { ++*alive; }
+        ~Tracked()                                                  { --*alive; }
+    };
+
+    int alive = 0;
+    {
+        // tiny chunks so that growth and swap-removal cross chunk boundaries
+        cc::Pool<Tracked, uint32_t, 4> pool;
+        cc::Vector<cc::Handle32> handles;
+        for (int i = 0; i < 37; ++i)
+        {
+            handles.push_back(pool.create(i, &alive));
+        }
+        ASSERT_EQ(pool.size(), 37u);
+        ASSERT_EQ(alive, 37);
+        EXPECT_EQ(pool.capacity(), 40u);
+
+        for (int i = 0; i < 37; i += 3)
+        {
+            EXPECT_TRUE(pool.destroy(handles[i]));
+            EXPECT_FALSE(pool.destroy(handles[i]));
+        }
+        ASSERT_EQ(pool.size(), 24u);
+        ASSERT_EQ(alive, 24);
+
+        int sum = 0, expected = 0;
+        for (int i = 0; i < 37; ++i)
+        {
+            if (i % 3 == 0)
+            {
+                EXPECT_FALSE(pool.alive(handles[i]));
+                EXPECT_EQ(pool.get(handles[i]), nullptr);
+            }
+            else
+            {
+                ASSERT_NE(pool.get(handles[i]), nullptr);
+                EXPECT_EQ(pool.get(handles[i])->value, i);
+                expected += i;
+            }
+        }
+        pool.for_each([&sum](Tracked& t) { sum += t.value; });
+        EXPECT_EQ(sum, expected);
+
+        size_t spanned = 0;
+        pool.for_each_span([&spanned](Tracked* first, Tracked* last) { EXPECT_LE(last - first, 4); spanned += last - first; });
+        EXPECT_EQ(spanned, pool.size());
+
+        // dense index <-> handle round trip
+        for (size_t i = 0; i < pool.size(); ++i)
+        {
+            EXPECT_EQ(pool.get(pool.handle_at(i)), &pool[i]);
+        }
+
+        // freed slots are reused with a new generation, old handles stay dead
+        const cc::Handle32 reused = pool.create(100, &alive);
+        EXPECT_EQ(reused.index() % 3, 0u);
+        EXPECT_NE(reused, handles[reused.index()]);
+        EXPECT_FALSE(pool.alive(handles[reused.index()]));
+        EXPECT_EQ(pool.get(reused)->value, 100);
+        EXPECT_FALSE(pool.alive(cc::Handle32()));
+
+        cc::ThreadPool workers(4);
+        pool.for_each_span(workers, [](Tracked* first, Tracked* last) { for (Tracked* t = first; t != last; ++t) t->value *= 2; });
+        EXPECT_EQ(pool.get(reused)->value, 200);
+
+        pool.clear();
+        EXPECT_TRUE(pool.empty());
+        EXPECT_EQ(alive, 0);
+        EXPECT_EQ(pool.get(reused), nullptr);
+
+        pool.create(1, &alive);
+        pool.create(2, &alive);
+    }
+    EXPECT_EQ(alive, 0);
+
+    // 32-bit generations wrap but never hit 0, 64-bit ones just keep counting
+    cc::Pool<int> small;
+    cc::Handle32 first = small.create(0);
+    cc::Handle32 h = first;
+    for (int i = 0; i < 5000; ++i)
+    {
+        small.destroy(h);
+        h = small.create(i);
+        EXPECT_NE(h.generation(), 0u);
+    }
+    EXPECT_EQ(h.index(), first.index());
+    EXPECT_EQ(h.generation(), (5000u % 4095u) + 1u);
+
+    cc::Pool<int, uint64_t> wide;
+    cc::Handle64 w = wide.create(7);
+    for (int i = 0; i < 5000; ++i)
+    {
+        wide.destroy(w);
+        w = wide.create(i);
+    }
+    EXPECT_EQ(w.generation(), 5001u);
+    EXPECT_EQ(*wide.get(w), 4999);
+}
+
+TEST_F(Test, HashMap)
+{
+    cc::HashMap<uint32_t, uint32_t> map;
+    EXPECT_TRUE(map.empty());
+    EXPECT_EQ(map.find(0), nullptr);
+
+    // enough keys for several rehashes, then erase every other one and insert again
+    // so that deleted slots get reused
+    constexpr uint32_t N = 20000;
+    for (uint32_t i = 0; i < N; ++i)
+    {
+        EXPECT_TRUE(map.insert(i * 7919u, i));
+    }
+    EXPECT_FALSE(map.insert(0, 42));
+    ASSERT_EQ(map.size(), N);
+    EXPECT_EQ(map.capacity() & (map.capacity() - 1), 0u);
+    EXPECT_LE(map.size(), map.capacity() * 7 / 8);
+
+    for (uint32_t i = 0; i < N; i += 2)
+    {
+        EXPECT_TRUE(map.erase(i * 7919u));
+    }
+    EXPECT_FALSE(map.erase(0));
+    ASSERT_EQ(map.size(), N / 2);
+
+    for (uint32_t i = 0; i < N; ++i)
+    {
+        const uint32_t* value = map.find(i * 7919u);
+        if (i % 2)
+        {
+            ASSERT_NE(value, nullptr);
+            EXPECT_EQ(*value, i);
+        }
+        else
+        {
+            EXPECT_EQ(value, nullptr);
+        }
+    }
+
+    const size_t capacity = map.capacity();
+    for (int round = 0; round < 8; ++round)
+    {
+        for (uint32_t i = 0; i < N; i += 2) map[i * 7919u] = i;
+        for (uint32_t i = 0; i < N; i += 2) map.erase(i * 7919u);
+    }
+    EXPECT_EQ(map.capacity(), capacity);
+    EXPECT_EQ(map.size(), N / 2);
+
+    uint64_t sum = 0, expected = 0;
+    map.for_each([&sum](uint32_t, uint32_t& value) { sum += value; });
+    for (uint32_t i = 1; i < N; i += 2) expected += i;
+    EXPECT_EQ(sum, expected);
+
+    cc::HashMap<uint32_t, uint32_t> moved(std::move(map));
+    EXPECT_EQ(moved.size(), N / 2);
+    EXPECT_TRUE(map.empty());
+    moved.clear();
+    EXPECT_TRUE(moved.empty());
+    EXPECT_FALSE(moved.contains(1 * 7919u));
+
+    // non trivial values
+    cc::HashMap<int, std::string> names;
+    *names.try_emplace(1, "one").first += "!";
+    names[2] = "two";
+    EXPECT_FALSE(names.try_emplace(1, "uno").second);
+    EXPECT_EQ(*names.find(1), "one!");
+    EXPECT_EQ(*names.find(2), "two");
+
+    // exact vec3 keys: +0 and -0 match, everything else is bitwise
+    cc::HashMap<cc::math::vec3, uint32_t> exact;
+    exact[cc::math::vec3(0.f, 1.f, 2.f)] = 1;
+    EXPECT_NE(exact.find(cc::math::vec3(-0.f, 1.f, 2.f)), nullptr);
+    EXPECT_EQ(exact.find(cc::math::vec3(0.f, 1.f, std::nextafter(2.f, 3.f))), nullptr);
+
+    // quantised: same grid cell, same key
+    cc::HashMap<cc::math::vec3, uint32_t> welded(0, cc::Hash<cc::math::vec3>(1.e-3f));
+    welded[cc::math::vec3(.5f, .25f, 1.f)] = 7;
+    EXPECT_EQ(welded.hasher().cell(), 1.e-3f);
+    ASSERT_NE(welded.find(cc::math::vec3(.50001f, .24999f, 1.0002f)), nullptr);
+    EXPECT_EQ(*welded.find(cc::math::vec3(.50001f, .24999f, 1.0002f)), 7u);
+    EXPECT_EQ(welded.find(cc::math::vec3(.502f, .25f, 1.f)), nullptr);
+
+    cc::HashMap<cc::math::vec2, int> uvs(0, cc::Hash<cc::math::vec2>(.01f));
+    uvs[cc::math::vec2(.1f, .2f)] = 3;
+    EXPECT_TRUE(uvs.contains(cc::math::vec2(.101f, .199f)));
+    cc::HashMap<cc::math::vec4, int> colors;
+    colors[cc::math::vec4(1.f)] = 4;
+    EXPECT_TRUE(colors.contains(cc::math::vec4(1.f)));
+
+    // a throwing value constructor leaves no half-built entry behind
+    cc::HashMap<int, std::string> strict;
+    strict.insert(1, "one");
+    EXPECT_THROW(strict.try_emplace(2, size_t(-1), 'x'), std::length_error);
+    EXPECT_EQ(strict.size(), 1u);
+    EXPECT_FALSE(strict.contains(2));
+    EXPECT_TRUE(strict.try_emplace(2, "two").second);
+    EXPECT_EQ(*strict.find(2), "two");
+}
+
+TEST_F(Test, MeshOptimization)
+{
+    using namespace cc;
+
+    // a SIDE x SIDE vertex grid as a soup of triangles in random order
+    constexpr uint32_t SIDE = 33;
+    std::mt19937 mt(7);
+    Vector<uint32_t> order;
+    for (uint32_t q = 0; q < 2 * (SIDE - 1) * (SIDE - 1); ++q) order.push_back(q);
+    std::shuffle(order.begin(), order.end(), mt);
+
+    mesh::Mesh soup;
+    for (uint32_t q : order)
+    {
+        const uint32_t x = (q / 2) % (SIDE - 1), y = (q / 2) / (SIDE - 1);
+        const uint32_t tri[2][3][2] = { { { 0, 0 }, { 1, 0 }, { 1, 1 } }, { { 0, 0 }, { 1, 1 }, { 0, 1 } } };
+        for (const auto& corner : tri[q & 1])
+        {
+            soup.positions.push_back(math::vec3(float(x + corner[0]), float(y + corner[1]), 0.f));
+        }
+    }
+
+    Vector<math::vec3> vertices;
+    Vector<uint32_t> indices;
+    EXPECT_EQ(mesh::generate_indices(soup.positions.data(), soup.positions.size(), 0.f, vertices, indices), SIDE * SIDE);
+    ASSERT_EQ(indices.size(), soup.positions.size());
+    for (size_t i = 0; i < indices.size(); ++i) EXPECT_TRUE(vertices[indices[i]] == soup.positions[i]);
+
+    // jittered copies only merge with a tolerance
+    mesh::Mesh jittered;
+    std::uniform_real_distribution<float> jitter(-1.e-4f, 1.e-4f);
+    for (const math::vec3& p : soup.positions) jittered.positions.push_back(p + math::vec3(jitter(mt), jitter(mt), 0.f));
+    mesh::Mesh exact = jittered;
+    ASSERT_TRUE(mesh::weld(exact));
+    EXPECT_GT(exact.positions.size(), size_t(SIDE * SIDE));
+    ASSERT_TRUE(mesh::weld(jittered, .01f));
+    ASSERT_EQ(jittered.positions.size(), size_t(SIDE * SIDE));
+    ASSERT_EQ(jittered.indices.size(), soup.positions.size());
+
+    // per vertex uvs keep otherwise identical positions apart
+    mesh::Mesh seam;
+    seam.positions.push_back(math::vec3(0.f));
+    seam.positions.push_back(math::vec3(0.f));
+    seam.positions.push_back(math::vec3(0.f));
+    seam.uvs.push_back(math::vec2(0.f));
+    seam.uvs.push_back(math::vec2(1.f));
+    seam.uvs.push_back(math::vec2(0.f));
+    ASSERT_TRUE(mesh::weld(seam));
+    EXPECT_EQ(seam.positions.size(), 2u);
+    EXPECT_EQ(seam.indices[2], 0u);
+
+    mesh::Mesh corners;
+    corners.positions.push_back(math::vec3(0.f));
+    corners.uv_indices.push_back(0);
+    EXPECT_FALSE(mesh::weld(corners));
+
+    // triangles as rotation-independent keys, to check that reordering keeps the same set
+    auto triangle_keys = [](const mesh::Mesh& m)
+    {
+        std::vector<std::array<float, 9>> keys;
+        for (size_t t = 0; t < m.triangle_count(); ++t)
+        {
+            uint32_t first = 0;
+            for (uint32_t k = 1; k < 3; ++k)
+            {
+                const math::vec3& a = m.positions[m.indices[t * 3 + k]];
+                const math::vec3& b = m.positions[m.indices[t * 3 + first]];
+                if (a.y < b.y || (a.y == b.y && a.x < b.x)) first = k;
+            }
+            std::array<float, 9> key;
+            for (uint32_t k = 0; k < 3; ++k)
+                for (uint32_t c = 0; c < 3; ++c) key[k * 3 + c] = m.positions[m.indices[t * 3 + (first + k) % 3]][c];
+            keys.push_back(key);
+        }
+        std::sort(keys.begin(), keys.end());
+        return keys;
+    };
+    const auto reference = triangle_keys(jittered);
+
+    const mesh::CacheStats before = mesh::analyze_vertex_cache(jittered);
+    EXPECT_GT(before.acmr, 2.f);
+    for (int o = 0; o < int(mesh::CacheOptimizer::Count); ++o)
+    {
+        mesh::Mesh m = jittered;
+        mesh::optimize(m, mesh::CacheOptimizer(o));
+        const mesh::CacheStats after = mesh::analyze_vertex_cache(m);
+        EXPECT_LT(after.acmr, .85f) << mesh::cache_optimizer_name(mesh::CacheOptimizer(o));
+        EXPECT_LT(after.atvr, 1.7f);
+        EXPECT_TRUE(triangle_keys(m) == reference);
+
+        // fetch order: every index is at most one past the highest seen so far
+        uint32_t highest = 0;
+        bool forward = (m.indices[0] == 0);
+        for (uint32_t index : m.indices)
+        {
+            forward &= (index <= highest + 1);
+            highest = math::max(highest, index);
+        }
+        EXPECT_TRUE(forward);
+        EXPECT_EQ(highest + 1, m.positions.size());
+
+        // a partial triangle stays at the end, untouched
+        uint32_t partial[] = { 0, 1, 2, 2, 1, 3, 3 };
+        mesh::optimize_vertex_cache(partial, 7, 4, mesh::CacheOptimizer(o));
+        EXPECT_EQ(partial[6], 3u);
+        EXPECT_EQ(partial[0] + partial[1] + partial[2] + partial[3] + partial[4] + partial[5], 9u);
+    }
+
+    // triangle soups have no indices to optimize and are kept as they are
+    mesh::Mesh unindexed = soup;
+    mesh::optimize(unindexed);
+    EXPECT_EQ(unindexed.positions.size(), soup.positions.size());
+    EXPECT_TRUE(unindexed.indices.empty());
+}
+
+TEST_F(Test, Queues)
+{
+    // single thread: capacity, wrap around, batches, non trivial items
+    cc::SpscQueue<std::string> spsc(5);
+    ASSERT_EQ(spsc.capacity(), 8u);
+    std::string item;
+    EXPECT_FALSE(spsc.try_pop(item));
+    for (int round = 0; round < 3; ++round)
+    {
+        for (int i = 0; i < 8; ++i) EXPECT_TRUE(spsc.try_push(std::to_string(i)));
+        EXPECT_FALSE(spsc.try_push(std::string("full")));
+        EXPECT_EQ(spsc.size(), 8u);
+        for (int i = 0; i < 5; ++i)
+        {
+            ASSERT_TRUE(spsc.try_pop(item));
+            EXPECT_EQ(item, std::to_string(i));
+        }
+        std::string batch[8] = { "a", "b", "c", "d", "e", "f", "g", "h" };
+        EXPECT_EQ(spsc.try_push_batch(batch, 8), 5u);
+        std::string out[16];
+        EXPECT_EQ(spsc.try_pop_batch(out, 16), 8u);
+        EXPECT_EQ(out[0], "5");
+        EXPECT_EQ(out[3], "a");
+        EXPECT_EQ(out[7], "e");
+        EXPECT_TRUE(spsc.empty());
+    }
+
+    cc::MpmcQueue<int> mpmc(16);
+    int values[20];
+    for (int i = 0; i < 20; ++i) values[i] = i;
+    EXPECT_EQ(mpmc.try_push_batch(values, 20), 16u);
+    EXPECT_FALSE(mpmc.try_push(99));
+    int popped = -1;
+    ASSERT_TRUE(mpmc.try_pop(popped));
+    EXPECT_EQ(popped, 0);
+    EXPECT_TRUE(mpmc.try_push(99));
+    int out[32];
+    EXPECT_EQ(mpmc.try_pop_batch(out, 32), 16u);
+    EXPECT_EQ(out[0], 1);
+    EXPECT_EQ(out[15], 99);
+    EXPECT_EQ(mpmc.try_pop_batch(out, 32), 0u);
+
+    // leftovers of a type without a default constructor are destroyed with the queue
+    struct Held
+    {
+        explicit Held(std::shared_ptr<int> p) : ref(std::move(p)) {}
+        std::shared_ptr<int> ref;
+    };
+    auto owner = std::make_shared<int>(0);
+    {
+        cc::SpscQueue<Held> left_spsc(4);
+        cc::MpmcQueue<Held> left_mpmc(4);
+        for (int i = 0; i < 6; ++i)
+        {
+            EXPECT_TRUE(left_spsc.try_push(Held(owner)));
+            EXPECT_TRUE(left_mpmc.try_push(Held(owner)));
+            if (i % 2)
+            {
+                Held dropped(nullptr);
+                EXPECT_TRUE(left_spsc.try_pop(dropped));
+                EXPECT_TRUE(left_mpmc.try_pop(dropped));
+            }
+        }
+        EXPECT_EQ(owner.use_count(), 7);
+    }
+    EXPECT_EQ(owner.use_count(), 1);
+
+    // try_push doesn't wake a sleeping pop(), the sleeper still finds the item by itself
+    {
+        cc::SpscQueue<int> lazy_wake(4);
+        int received = 0;
+        std::thread consumer([&] { lazy_wake.pop(received); });
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        EXPECT_TRUE(lazy_wake.try_push(7));
+        consumer.join();
+        EXPECT_EQ(received, 7);
+    }
+
+    // two threads through a small ring, order must be kept
+    constexpr uint32_t COUNT = 200000;
+    {
+        cc::SpscQueue<uint32_t> ring(64);
+        std::thread producer([&ring]
+        {
+            for (uint32_t i = 0; i < COUNT; )
+            {
+                if (i % 3 == 0)
+                {
+                    uint32_t batch[7];
+                    const uint32_t n = cc::math::min(7u, COUNT - i);
+                    for (uint32_t k = 0; k < n; ++k) batch[k] = i + k;
+                    EXPECT_EQ(ring.push_batch(batch, n), n);
+                    i += n;
+                }
+                else
+                {
+                    ring.push(i++);
+                }
+            }
+            ring.close();
+        });
+
+        uint32_t expected = 0, value = 0;
+        bool ordered = true;
+        while (ring.pop(value))
+        {
+            ordered &= (value == expected++);
+        }
+        producer.join();
+        EXPECT_TRUE(ordered);
+        EXPECT_EQ(expected, COUNT);
+        EXPECT_FALSE(ring.push(0u));
+    }
+
+    // 4 producers, 4 consumers, singles and batches mixed: every item exactly once
+    {
+        constexpr uint32_t THREADS = 4;
+        cc::MpmcQueue<uint32_t> ring(128);
+        std::vector<std::atomic<uint32_t>> seen(THREADS * COUNT / 4);
+        std::atomic<uint32_t> producing(THREADS);
+        std::vector<std::thread> threads;
+        for (uint32_t t = 0; t < THREADS; ++t)
+        {
+            threads.emplace_back([&, t]
+            {
+                const uint32_t first = t * (COUNT / 4), last = first + COUNT / 4;
+                for (uint32_t i = first; i < last; )
+                {
+                    if (t & 1)
+                    {
+                        uint32_t batch[5];
+                        const uint32_t n = cc::math::min(5u, last - i);
+                        for (uint32_t k = 0; k < n; ++k) batch[k] = i + k;
+                        ring.push_batch(batch, n);
+                        i += n;
+                    }
+                    else
+                    {
+                        ring.push(i++);
+                    }
+                }
+                if (producing.fetch_sub(1) == 1) ring.close();
+            });
+            threads.emplace_back([&, t]
+            {
+                uint32_t batch[6];
+                uint32_t value;
+                for (;;)
+                {
+                    if (t & 1)
+                    {
+                        const size_t n = ring.pop_batch(batch, 6);
+                        if (n == 0) break;
+                        for (size_t k = 0; k < n; ++k) seen[batch[k]].fetch_add(1);
+                    }
+                    else
+                    {
+                        if (!ring.pop(value)) break;
+                        seen[value].fetch_add(1);
+                    }
+                }
+            });
+        }
+        for (std::thread& thread : threads) thread.join();
+
+        uint32_t once = 0;
+        for (const auto& count : seen) once += (count.load() == 1)? 1 : 0;
+        EXPECT_EQ(once, seen.size());
+    }
+}
+
+TEST_F(Test, Noise)
+{
+    using cc::math::vec2;
+    using cc::math::vec3;
+    using cc::math::vec4;
+    using cc::noise::Type;
+    using cc::noise::Fractal;
+
+    std::mt19937 rng(41);
+    std::uniform_real_distribution<float> coord(-50.f, 50.f);
+
+    // lattice points are zeros of gradient noise, seeds are deterministic and independent
+    EXPECT_EQ(cc::noise::perlin(vec2(3.f, -7.f), 5), 0.f);
+    EXPECT_EQ(cc::noise::perlin(vec3(-1.f, 0.f, 12.f), 5), 0.f);
+    const vec3 probe(1.37f, -2.21f, 0.53f);
+    EXPECT_EQ(cc::noise::simplex(probe, 9), cc::noise::simplex(probe, 9));
+    EXPECT_NE(cc::noise::simplex(probe, 9), cc::noise::simplex(probe, 10));
+    EXPECT_NE(cc::noise::perlin(probe, 9), cc::noise::perlin(probe, 10));
+
+    Fractal fbm;
+    fbm.octaves = 5;
+    Fractal turbulence = fbm;
+    turbulence.turbulence = true;
+
+    // range, scalar vs 8 lanes
+    for (uint32_t t = 0; t < uint32_t(Type::Count); ++t)
+    {
+        const Type type = Type(t);
+        float lo = 1.f, hi = -1.f;
+        for (int i = 0; i < 512; ++i)
+        {
+            float x[8], y[8], z[8], w[8], out2[8], out3[8], out4[8], outf[8];
+            for (int l = 0; l < 8; ++l) { x[l] = coord(rng); y[l] = coord(rng); z[l] = coord(rng); w[l] = coord(rng); }
+            cc::noise::sample8(type, x, y, out2, 3);
+            cc::noise::sample8(type, x, y, z, out3, 3);
+            cc::noise::sample8(type, x, y, z, w, out4, 3);
+            cc::noise::fractal8(type, x, y, z, turbulence, outf, 3);
+            for (int l = 0; l < 8; ++l)
+            {
+                EXPECT_NEAR(out2[l], cc::noise::sample(type, vec2(x[l], y[l]), 3), 1.e-5f);
+                EXPECT_NEAR(out3[l], cc::noise::sample(type, vec3(x[l], y[l], z[l]), 3), 1.e-5f);
+                EXPECT_NEAR(out4[l], cc::noise::sample(type, vec4(x[l], y[l], z[l], w[l]), 3), 1.e-5f);
+                EXPECT_NEAR(outf[l], cc::noise::fractal(type, vec3(x[l], y[l], z[l]), turbulence, 3), 1.e-5f);
+                EXPECT_GE(outf[l], 0.f);
+                for (float v : { out2[l], out3[l], out4[l] })
+                {
+                    ASSERT_GE(v, -1.f);
+                    ASSERT_LE(v, 1.f);
+                    lo = cc::math::min(lo, v);
+                    hi = cc::math::max(hi, v);
+                }
+            }
+        }
+        // not a constant, reasonably spread
+        EXPECT_LT(lo, -.5f) << cc::noise::type_name(type);
+        EXPECT_GT(hi, .5f) << cc::noise::type_name(type);
+    }
+
+    // grid fill: same values as the scalar path whatever the layout (and pool)
+    cc::ThreadPool pool(3);
+    fbm.frequency = 6.f;
+    for (uint32_t t = 0; t < uint32_t(Type::Count); ++t)
+    {
+        const Type type = Type(t);
+        for (uint32_t l = 0; l < uint32_t(cc::ImageLayout::Count); ++l)
+        {
+            cc::Image<float> image(37, 21, cc::ImageLayout(l));
+            cc::noise::fill(image, type, fbm, 77, pool);
+            for (uint32_t y = 0; y < image.height(); ++y)
+            {
+                for (uint32_t x = 0; x < image.width(); ++x)
+                {
+                    const vec2 p((x + .5f) / image.width(), (y + .5f) / image.height());
+                    ASSERT_NEAR(image.at(x, y), cc::noise::fractal(type, p, fbm, 77), 1.e-5f);
+                }
+            }
+        }
+
+        std::vector<float> volume(19 * 6 * 5);
+        cc::noise::fill(volume.data(), 19, 6, 5, type, fbm, 77, pool);
+        for (uint32_t z = 0; z < 5; ++z)
+        {
+            for (uint32_t y = 0; y < 6; ++y)
+            {
+                for (uint32_t x = 0; x < 19; ++x)
+                {
+                    const vec3 p((x + .5f) / 19.f, (y + .5f) / 19.f, (z + .5f) / 19.f);
+                    ASSERT_NEAR(volume[(z * 6 + y) * 19 + x], cc::noise::fractal(type, p, fbm, 77), 1.e-5f);
+                }
+            }
+        }
+    }
+}
+
+TEST_F(Test, Exposure)
+{
+    using cc::math::vec3;
+    using cc::math::vec4;
+
+    // a quarter black, a quarter at EV -3, the rest at EV 1 but one very bright pixel
+    cc::Image<vec4> image(64, 50);
+    std::vector<vec3> flat;
+    for (uint32_t y = 0; y < image.height(); ++y)
+    {
+        for (uint32_t x = 0; x < image.width(); ++x)
+        {
+            const uint32_t i = y * image.width() + x;
+            const float value = (i % 4 == 0)? 0.f : ((i % 4 == 1)? .125f : ((i == 7)? 1.e6f : 2.f));
+            image.at(x, y) = vec4(value, value, value, 1.f);
+            flat.push_back(vec3(value));
+        }
+    }
+
+    cc::ThreadPool pool(3), single(1);
+    const cc::exposure::Settings settings;
+    const cc::exposure::Histogram histogram = cc::exposure::histogram(image, settings, pool);
+    EXPECT_EQ(histogram.count, 3200u);
+    EXPECT_EQ(histogram.lit, 2400u);
+    EXPECT_EQ(histogram.bins[0], 800u);
+    EXPECT_EQ(histogram.bins[cc::exposure::BINS - 1], 1u);     // clamped to EV 16
+
+    // vec3 / vec4, serial / parallel, any layout: same bins
+    const cc::exposure::Histogram serial = cc::exposure::histogram(flat.data(), flat.size(), settings, single);
+    for (uint32_t l = 0; l < uint32_t(cc::ImageLayout::Count); ++l)
+    {
+        const cc::exposure::Histogram other = cc::exposure::histogram(image.converted(cc::ImageLayout(l)), settings, pool);
+        for (uint32_t i = 0; i < cc::exposure::BINS; ++i)
+        {
+            ASSERT_EQ(other.bins[i], histogram.bins[i]);
+            ASSERT_EQ(serial.bins[i], histogram.bins[i]);
+        }
+        EXPECT_NEAR(other.log_sum, histogram.log_sum, 1.e-3);
+        EXPECT_NEAR(serial.log_sum, histogram.log_sum, 1.e-3);
+    }
+
+    // geometric mean of the lit ones, the bright one clamped to EV 16
+    EXPECT_NEAR(std::log2(cc::exposure::log_average(histogram)), (-3.f * 800 + 1.f * 1599 + 16.f) / 2400.f, 1.e-3f);
+    EXPECT_NEAR(std::log2(cc::exposure::percentile(histogram, .3f)), -3.f, .26f);
+    EXPECT_NEAR(std::log2(cc::exposure::percentile(histogram, .8f)), 1.f, .26f);
+
+    // the 50%..95% range only covers EV 1 (at bin center), the full range averages lit bins
+    const float average = cc::exposure::average(histogram, settings);
+    EXPECT_NEAR(std::log2(average), 1.f, histogram.bin_width());
+    cc::exposure::Settings everything = settings;
+    everything.low_percentile = 0.f;
+    everything.high_percentile = 1.f;
+    EXPECT_NEAR(std::log2(cc::exposure::average(histogram, everything)), std::log2(cc::exposure::log_average(histogram)), histogram.bin_width());
+    EXPECT_NEAR(cc::exposure::exposure(average, settings) * average, settings.key, 1.e-5f);
+    cc::exposure::Settings brighter = settings;
+    brighter.compensation = 1.f;
+    EXPECT_NEAR(cc::exposure::exposure(average, brighter), 2.f * cc::exposure::exposure(average, settings), 1.e-4f);
+
+    // adaptation: snaps first, then converges monotonically, faster going up than down
+    cc::exposure::Adaptation eye;
+    EXPECT_EQ(eye.update(1.f, .1f), 1.f);
+    float previous = 1.f;
+    for (int i = 0; i < 100; ++i)
+    {
+        const float current = eye.update(16.f, 1.f / 30.f);
+        EXPECT_GT(current, previous);
+        EXPECT_LE(current, 16.f);
+        previous = current;
+    }
+    EXPECT_NEAR(previous, 16.f, .1f);
+    cc::exposure::Adaptation down;
+    down.update(16.f, 0.f);
+    down.update(1.f, 1.f / 30.f);
+    cc::exposure::Adaptation up;
+    up.update(1.f, 0.f);
+    up.update(16.f, 1.f / 30.f);
+    EXPECT_GT(std::log2(up.luminance), 4.f - std::log2(down.luminance));
+    EXPECT_NEAR(cc::exposure::auto_exposure(histogram, settings, nullptr), cc::exposure::exposure(average, settings), 1.e-6f);
+}
+
+TEST_F(Test, SphericalHarmonics)
+{
+    using cc::math::vec3;
+    using cc::math::vec4;
+    constexpr uint32_t COUNT = cc::sh::SH3::COUNT;
+
+    cc::ThreadPool pool(3);
+
+    // orthonormal basis: an environment equal to Y_k projects to e_k, on both map types
+    const uint32_t SIZE = 48;
+    for (uint32_t k = 0; k < COUNT; k += 3)
+    {
+        cc::Image<vec4> equirect(4 * SIZE, 2 * SIZE);
+        for (uint32_t y = 0; y < equirect.height(); ++y)
+        {
+            for (uint32_t x = 0; x < equirect.width(); ++x)
+            {
+                float basis[COUNT];
+                cc::sh::basis<3>(cc::sh::equirect_direction(x, y, equirect.width(), equirect.height()), basis);
+                equirect.at(x, y) = vec4(basis[k], 2.f * basis[k], -basis[k], 1.f);
+            }
+        }
+
+        cc::Image<vec3> faces[6];
+        for (uint32_t f = 0; f < 6; ++f)
+        {
+            faces[f] = cc::Image<vec3>(SIZE, SIZE, cc::ImageLayout::Tiled);
+            for (uint32_t y = 0; y < SIZE; ++y)
+            {
+                for (uint32_t x = 0; x < SIZE; ++x)
+                {
+                    float basis[COUNT];
+                    cc::sh::basis<3>(cc::sh::cubemap_direction(f, x, y, SIZE), basis);
+                    faces[f].at(x, y) = vec3(basis[k], 2.f * basis[k], -basis[k]);
+                }
+            }
+        }
+
+        const cc::sh::SH3 from_equirect = cc::sh::project_equirect<3>(equirect, pool);
+        const cc::sh::SH3 from_cube = cc::sh::project_cubemap<3>(faces, pool);
+        for (uint32_t j = 0; j < COUNT; ++j)
+        {
+            const float expected = (j == k)? 1.f : 0.f;
+            EXPECT_NEAR(from_equirect.c[j].x, expected, 2.e-3f) << k << " " << j;
+            EXPECT_NEAR(from_equirect.c[j].y, 2.f * expected, 4.e-3f) << k << " " << j;
+            EXPECT_NEAR(from_cube.c[j].x, expected, 2.e-3f) << k << " " << j;
+            EXPECT_NEAR(from_cube.c[j].z, -expected, 2.e-3f) << k << " " << j;
+        }
+    }
+
+    // constant radiance: reconstructs exactly, irradiance is pi times it, solid angles sum to 4pi
+    cc::Image<vec3> grey(64, 32, cc::ImageLayout::RowMajor, vec3(.5f));
+    const cc::sh::SH2 constant = cc::sh::project_equirect<2>(grey, pool);
+    EXPECT_NEAR(constant.c[0].x, .5f * 4.f * cc::math::PI * .282094792f, 1.e-4f);
+    EXPECT_NEAR(cc::sh::evaluate(constant, vec3(0.f, 1.f, 0.f)).y, .5f, 2.e-3f);    // some L2 leaks in at the poles
+    EXPECT_NEAR(cc::sh::evaluate(cc::sh::convolve_cosine(constant), cc::math::normalize(vec3(1.f, -2.f, 3.f))).z, .5f * cc::math::PI, 1.e-3f);
+
+    // irradiance from a directional light: max(cos, 0) * intensity, approximated by L2
+    cc::sh::SH2 light{};
+    cc::sh::add(light, vec3(0.f, 1.f, 0.f), vec3(1.f), 1.f);
+    const cc::sh::SH2 irradiance = cc::sh::convolve_cosine(light);
+    EXPECT_NEAR(cc::sh::evaluate(irradiance, vec3(0.f, 1.f, 0.f)).x, 1.f, .1f);
+    EXPECT_NEAR(cc::sh::evaluate(irradiance, vec3(1.f, 0.f, 0.f)).x, 0.f, .15f);
+    EXPECT_LT(cc::sh::evaluate(irradiance, vec3(1.f, 0.f, 0.f)).x, cc::sh::evaluate(irradiance, cc::math::normalize(vec3(1.f, 1.f, 0.f))).x);
+
+    // batch evaluation matches the scalar one
+    std::mt19937 rng(43);
+    std::uniform_real_distribution<float> unit(-1.f, 1.f);
+    cc::sh::SH3 random{};
+    for (vec3& c : random.c) c = vec3(unit(rng), unit(rng), unit(rng));
+    std::vector<vec3> normals(1000), out(1000), out_parallel(1000);
+    for (vec3& n : normals) n = cc::math::normalize(vec3(unit(rng), unit(rng), unit(rng)));
+    cc::sh::evaluate(random, normals.data(), out.data(), normals.size());
+    cc::sh::evaluate(random, normals.data(), out_parallel.data(), normals.size(), pool);
+    for (size_t i = 0; i < normals.size(); ++i)
+    {
+        const vec3 expected = cc::sh::evaluate(random, normals[i]);
+        ASSERT_NEAR(out[i].x, expected.x, 1.e-5f);
+        ASSERT_NEAR(out[i].y, expected.y, 1.e-5f);
+        ASSERT_NEAR(out[i].z, expected.z, 1.e-5f);
+        ASSERT_EQ(out_parallel[i].x, out[i].x);
+    }
+}
+
+TEST_F(Test, VectorInsertErase)
+{
+    // random edits mirrored on a std::vector
+    {
+        std::mt19937 rng(7);
+        cc::Vector<int> cc_test;
+        std::vector<int> std_test;
+        for (int step = 0; step < 2000; ++step)
+        {
+            const size_t pos = std_test.empty()? 0 : rng() % (std_test.size() + 1);
+            const int range[] = { step, step + 1, step + 2 };
+            const size_t count = rng() % 4;
+            switch (rng() % 5)
+            {
+            case 0:
+                EXPECT_EQ(*cc_test.insert(cc_test.begin() + pos, step), step);
+                std_test.insert(std_test.begin() + pos, step);
+                break;
+            case 1:
+                cc_test.insert(cc_test.begin() + pos, range, range + count);
+                std_test.insert(std_test.begin() + pos, range, range + count);
+                break;
+            case 2:
+                cc_test.append(range, range + count);
+                std_test.insert(std_test.end(), range, range + count);
+                break;
+            default:
+            {
+                const size_t last = std::min(std_test.size(), pos + count);
+                const size_t first = std::min(pos, last);
+                cc_test.erase(cc_test.begin() + first, cc_test.begin() + last);
+                std_test.erase(std_test.begin() + first, std_test.begin() + last);
+            }
+            }
+        }
+
+        ASSERT_EQ(cc_test.size(), std_test.size());
+        EXPECT_TRUE(std::equal(std_test.begin(), std_test.end(), cc_test.begin()));
+    }
+
+    // non trivial elements go through the move / destroy path
+    {
+        cc::Vector<std::string> cc_test;
+        std::vector<std::string> std_test;
+        const std::string words[] = { "alpha", "a string long enough to live on the heap", "gamma" };
+        for (int i = 0; i < 50; ++i)
+        {
+            cc_test.insert(cc_test.begin() + (i % (cc_test.size() + 1)), words, words + 3);
+            std_test.insert(std_test.begin() + (i % (std_test.size() + 1)), words, words + 3);
+            if (i % 3 == 0)
+            {
+                cc_test.erase(cc_test.begin() + i % cc_test.size());
+                std_test.erase(std_test.begin() + i % std_test.size());
+            }
+        }
+        cc_test.insert(cc_test.begin() + 1, 4, std::string("delta"));
+        std_test.insert(std_test.begin() + 1, 4, std::string("delta"));
+        ASSERT_EQ(cc_test.size(), std_test.size());
+        EXPECT_TRUE(std::equal(std_test.begin(), std_test.end(), cc_test.begin()));
+
+        // a range out of the vector itself
+        cc_test.insert(cc_test.begin(), cc_test.begin() + 2, cc_test.end());
+        const std::vector<std::string> tail(std_test.begin() + 2, std_test.end());
+        std_test.insert(std_test.begin(), tail.begin(), tail.end());
+        ASSERT_EQ(cc_test.size(), std_test.size());
+        EXPECT_TRUE(std::equal(std_test.begin(), std_test.end(), cc_test.begin()));
+    }
+
+    // range construction, copy assignment, pop_back / clear / resize destroy what they drop
+    {
+        static int alive = 0;
+        struct Counted
+        {
+            int value;
+            Counted(int v = 0) : value(v)           { ++alive; }
+            Counted(const Counted& o) : value(o.value) { ++alive; }
+            ~Counted()                              { --alive; }
+        };
+
+        {
+            const std::vector<int> source{ 1, 2, 3, 4, 5, 6 };
+            cc::Vector<Counted> a(source.begin(), source.end());
+            EXPECT_EQ(alive, 6);
+            EXPECT_EQ(a.back().value, 6);
+
+            cc::Vector<Counted> b;
+            b = a;
+            EXPECT_EQ(a.size(), 6u);
+            EXPECT_EQ(b.size(), 6u);
+            EXPECT_EQ(alive, 12);
+
+            b.pop_back();
+            EXPECT_EQ(b.back().value, 5);
+            b.resize(2);
+            EXPECT_EQ(alive, 8);
+            a.clear();
+            EXPECT_TRUE(a.empty());
+            EXPECT_EQ(alive, 2);
+            b.resize_uninitialized(5);
+            EXPECT_EQ(alive, 5);
+            EXPECT_EQ(b[1].value, 2);
+        }
+        EXPECT_EQ(alive, 0);
+    }
+
+    // ints are not iterators
+    {
+        cc::Vector<size_t> filled(size_t(3), size_t(9));
+        EXPECT_EQ(filled.size(), 3u);
+        EXPECT_EQ(filled[2], 9u);
+
+        cc::Vector<uint8_t> raw;
+        raw.resize_uninitialized(1 << 20);
+        EXPECT_EQ(raw.size(), size_t(1 << 20));
+        raw.resize_uninitialized(16);
+        EXPECT_EQ(raw.size(), 16u);
+    }
+
+    // growing one element at a time reallocates geometrically
+    {
+        cc::Vector<int> grown;
+        cc::Vector<uint8_t> raw;
+        int reallocations = 0;
+        for (int i = 0; i < 80000; ++i)
+        {
+            const int* before = grown.data();
+            grown.resize(grown.size() + 1, i);
+            raw.resize_uninitialized(raw.size() + 1);
+            reallocations += (grown.data() != before);
+        }
+        EXPECT_LT(reallocations, 40);
+        EXPECT_EQ(grown[79999], 79999);
+        EXPECT_GT(raw.capacity(), raw.size());
+    }
+}
+
+TEST_F(Test, VirtualVector)
+{
+    // growth inside the reservation never moves the elements
+    {
+        cc::VirtualVector<uint64_t> values;
+        values.push_back(0);
+        const uint64_t* first = values.data();
+        for (uint64_t i = 1; i < (1 << 20); ++i)
+        {
+            values.push_back(i * 3);
+        }
+        EXPECT_EQ(values.data(), first);
+        EXPECT_EQ(values.size(), size_t(1 << 20));
+        EXPECT_EQ(values[12345], 12345u * 3);
+
+        // decommit past the end, then grow back over fresh pages
+        values.resize(1000);
+        values.shrink_to_fit();
+        EXPECT_LT(values.capacity(), size_t(1 << 20));
+        EXPECT_GE(values.capacity(), size_t(1000));
+        EXPECT_EQ(values.back(), 999u * 3);
+        values.resize(1 << 18, 5u);
+        EXPECT_EQ(values[1000], 5u);
+        EXPECT_EQ(values[999], 999u * 3);
+        EXPECT_EQ(values.data(), first);
+    }
+
+    // past a small reservation everything moves once, contents intact
+    {
+        cc::VirtualVector<std::string> words;
+        words.reserve_address(100);
+        const size_t reserved = words.reserved();
+        EXPECT_GE(reserved, 100u);
+        for (size_t i = 0; i < reserved; ++i)
+        {
+            words.emplace_back(std::to_string(i) + " is a number long enough for the heap");
+        }
+
+        // pushing one of its own elements right at the edge
+        words.push_back(words[0]);
+        EXPECT_GT(words.reserved(), reserved);
+        EXPECT_EQ(words.size(), reserved + 1);
+        EXPECT_EQ(words[1], "1 is a number long enough for the heap");
+        EXPECT_EQ(words.back(), words[0]);
+        EXPECT_EQ(words[reserved - 1], std::to_string(reserved - 1) + " is a number long enough for the heap");
+
+        cc::VirtualVector<std::string> copy(words);
+        cc::VirtualVector<std::string> moved(std::move(words));
+        EXPECT_EQ(copy.size(), moved.size());
+        EXPECT_TRUE(std::equal(copy.begin(), copy.end(), moved.begin()));
+        EXPECT_TRUE(words.empty());
+    }
+
+    // same editing behavior as cc::Vector
+    {
+        std::mt19937 rng(11);
+        cc::VirtualVector<int> cc_test{ 1, 2, 3 };
+        std::vector<int> std_test{ 1, 2, 3 };
+        for (int step = 0; step < 1000; ++step)
+        {
+            const size_t pos = rng() % (std_test.size() + 1);
+            const int range[] = { step, -step, step * 2 };
+            if (rng() % 3)
+            {
+                cc_test.insert(cc_test.begin() + pos, range, range + 3);
+                std_test.insert(std_test.begin() + pos, range, range + 3);
+            }
+            else
+            {
+                const size_t last = std::min(std_test.size(), pos + 4);
+                cc_test.erase(cc_test.begin() + std::min(pos, last), cc_test.begin() + last);
+                std_test.erase(std_test.begin() + std::min(pos, last), std_test.begin() + last);
+            }
+        }
+        ASSERT_EQ(cc_test.size(), std_test.size());
+        EXPECT_TRUE(std::equal(std_test.begin(), std_test.end(), cc_test.begin()));
+    }
+}
+
+TEST_F(Test, BitVector)
+{
+    const cc::simd::Level active = cc::simd::level();
+    cc::ThreadPool pool(3);
+
+    // a bit more than 3 index chunks, with a partial last word
+    const size_t count = 1000003;
+    std::mt19937 rng(3);
+    std::vector<uint8_t> flags(count), other(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        // sparse, dense and empty stretches
+        const size_t region = (i / 70000) % 3;
+        flags[i] = (region == 0)? (rng() % 50 == 0) : ((region == 1)? (rng() % 4 != 0) : 0);
+        other[i] = uint8_t(rng() % 3 == 0) * uint8_t(1 + rng() % 200);
+    }
+
+    cc::BitVector bits(count), mask;
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (flags[i]) bits.set(i);
+    }
+    mask.pack(other.data(), count);
+
+    std::vector<uint32_t> expected;
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (flags[i]) expected.push_back(uint32_t(i));
+    }
+
+    for (uint32_t l = 0; l < uint32_t(cc::simd::Level::Count); ++l)
+    {
+        cc::simd::force(cc::simd::Level(l));
+
+        EXPECT_EQ(bits.count(), expected.size());
+
+        const cc::Vector<uint32_t> list = bits.indices(pool);
+        ASSERT_EQ(list.size(), expected.size());
+        EXPECT_TRUE(std::equal(expected.begin(), expected.end(), list.begin()));
+    }
+    cc::simd::force(active);
+
+    // scans
+    {
+        size_t found = 0;
+        bool ordered = true;
+        for (size_t i = bits.find_first(); i != cc::BitVector::NONE; i = bits.find_next(i))
+        {
+            ordered = ordered && found < expected.size() && expected[found] == i;
+            ++found;
+        }
+        EXPECT_TRUE(ordered);
+        EXPECT_EQ(found, expected.size());
+    }
+
+    // whole vector ops against the byte flags
+    {
+        const cc::BitVector a = bits & mask, o = bits | mask, x = bits ^ mask;
+        cc::BitVector n(bits), f(bits);
+        n.and_not(mask);
+        f.flip();
+
+        size_t errors = 0;
+        for (size_t i = 0; i < count; ++i)
+        {
+            const bool p = flags[i] != 0, q = other[i] != 0;
+            errors += (mask[i] != q) + (a[i] != (p && q)) + (o[i] != (p || q)) + (x[i] != (p != q)) + (n[i] != (p && !q)) + (f[i] != !p);
+        }
+        EXPECT_EQ(errors, 0u);
+        EXPECT_EQ(f.count(), count - expected.size());
+        EXPECT_EQ(o.count() + a.count(), bits.count() + mask.count());
+    }
+
+    // tail bits stay clear, whatever fills the last word
+    {
+        cc::BitVector small(70, true);
+        EXPECT_EQ(small.count(), 70u);
+        EXPECT_TRUE(small.all());
+        small.resize(130, true);
+        EXPECT_EQ(small.count(), 130u);
+        small.resize(65);
+        small.resize(100);
+        EXPECT_EQ(small.count(), 65u);
+        EXPECT_FALSE(small.all());
+        small.set_word(1, ~uint64_t(0));
+        EXPECT_EQ(small.count(), 100u);
+        EXPECT_EQ(small.find_next(99), cc::BitVector::NONE);
+
+        small.fill(false);
+        EXPECT_TRUE(small.none());
+        EXPECT_EQ(small.find_first(), cc::BitVector::NONE);
+        small.push_back(true);
+        EXPECT_EQ(small.size(), 101u);
+        EXPECT_EQ(small.find_first(), 100u);
+        EXPECT_EQ(small.indices(pool).size(), 1u);
+
+        cc::BitVector empty;
+        EXPECT_EQ(empty.count(), 0u);
+        EXPECT_EQ(empty.find_first(), cc::BitVector::NONE);
+        EXPECT_TRUE(empty.indices(pool).empty());
+    }
+}
+
+TEST_F(Test, PointBounds)
+{
+    using cc::math::vec3;
+    namespace sp = cc::spatial;
+    const cc::simd::Level active = cc::simd::level();
+    cc::ThreadPool pool(3), single(1);
+
+    // an ellipsoid shell, 40 x 10 x 2 along a rotated frame, far from the origin
+    const vec3 u = cc::math::normalize(vec3(1.f, 2.f, 2.f));
+    const vec3 v = cc::math::normalize(cc::math::cross(u, vec3(0.f, 0.f, 1.f)));
+    const vec3 w = cc::math::cross(u, v);
+    const vec3 offset(1000.f, -500.f, 250.f);
+
+    std::mt19937 rng(5);
+    std::normal_distribution<float> gauss;
+    cc::Vector<vec3> points(1000003);
+    for (vec3& p : points)
+    {
+        const vec3 d = cc::math::normalize(vec3(gauss(rng), gauss(rng), gauss(rng)));
+        p = offset + u * (20.f * d.x) + v * (5.f * d.y) + w * (1.f * d.z);
+    }
+
+    // double precision references
+    vec3 lo(FLT_MAX), hi(-FLT_MAX);
+    double mean[3] = {};
+    for (const vec3& p : points)
+    {
+        lo = pmin(lo, p);
+        hi = pmax(hi, p);
+        for (int k = 0; k < 3; ++k) mean[k] += p[k];
+    }
+    for (int k = 0; k < 3; ++k) mean[k] /= double(points.size());
+    double cov[3][3] = {};
+    for (const vec3& p : points)
+    {
+        for (int i = 0; i < 3; ++i)
+            for (int j = 0; j < 3; ++j)
+                cov[i][j] += (p[i] - mean[i]) * (p[j] - mean[j]);
+    }
+
+    for (uint32_t l = 0; l < uint32_t(cc::simd::Level::Count); ++l)
+    {
+        cc::simd::force(cc::simd::Level(l));
+
+        const sp::Bounds box = sp::bounds(points, pool);
+        EXPECT_EQ(box.lo, lo);
+        EXPECT_EQ(box.hi, hi);
+
+        const sp::Moments m = sp::moments(points, pool), m1 = sp::moments(points, single);
+        EXPECT_EQ(std::memcmp(m.sum, m1.sum, sizeof(m.sum)), 0);
+        EXPECT_EQ(std::memcmp(m.products, m1.products, sizeof(m.products)), 0);
+
+        const vec3 c = m.centroid();
+        const cc::math::mat3 covariance = m.covariance();
+        for (int i = 0; i < 3; ++i)
+        {
+            EXPECT_NEAR(c[i], mean[i], 1e-3);
+            for (int j = 0; j < 3; ++j)
+                EXPECT_NEAR(covariance[i][j], cov[i][j] / double(points.size()), 1e-3);
+        }
+
+        // principal axes recover the frame, the box contains everything and is snug
+        const sp::OBB obb = sp::obb(points, pool);
+        EXPECT_GT(cc::math::abs(dot(obb.axes[0], u)), .999f);
+        EXPECT_GT(cc::math::abs(dot(obb.axes[1], v)), .999f);
+        EXPECT_GT(dot(cross(obb.axes[0], obb.axes[1]), obb.axes[2]), .999f);
+        EXPECT_NEAR(obb.extent.x, 20.f, .1f);
+        EXPECT_NEAR(obb.extent.y, 5.f, .1f);
+        EXPECT_NEAR(obb.extent.z, 1.f, .1f);
+
+        const sp::Sphere sphere = sp::bounding_sphere(points, pool);
+        EXPECT_LT(sphere.radius, 21.f);
+
+        size_t outside = 0;
+        for (const vec3& p : points)
+        {
+            const vec3 d = p - obb.center;
+            outside += (cc::math::abs(dot(d, obb.axes[0])) > obb.extent.x + 1e-3f) ||
+                       (cc::math::abs(dot(d, obb.axes[1])) > obb.extent.y + 1e-3f) ||
+                       (cc::math::abs(dot(d, obb.axes[2])) > obb.extent.z + 1e-3f);
+            const vec3 r = p - sphere.center;
+            outside += dot(r, r) > sphere.radius * sphere.radius;
+        }
+        EXPECT_EQ(outside, 0u);
+    }
+    cc::simd::force(active);
+
+    // eigen decomposition of a known matrix, degenerate inputs
+    {
+        vec3 axes[3], variances;
+        sp::principal_axes(cc::math::mat3(vec3(2.f, 1.f, 0.f), vec3(1.f, 2.f, 0.f), vec3(0.f, 0.f, 5.f)), axes, &variances);
+        EXPECT_NEAR(variances.x, 5.f, 1e-5f);
+        EXPECT_NEAR(variances.y, 3.f, 1e-5f);
+        EXPECT_NEAR(variances.z, 1.f, 1e-5f);
+        EXPECT_NEAR(cc::math::abs(axes[0].z), 1.f, 1e-5f);
+        EXPECT_NEAR(cc::math::abs(dot(axes[1], cc::math::normalize(vec3(1.f, 1.f, 0.f)))), 1.f, 1e-5f);
+
+        const vec3 one(3.f, 4.f, 5.f);
+        const sp::OBB single_point = sp::obb(&one, 1, pool);
+        EXPECT_NEAR(single_point.center.x, 3.f, 1e-5f);
+        EXPECT_NEAR(single_point.extent.x + single_point.extent.y + single_point.extent.z, 0.f, 1e-5f);
+        EXPECT_EQ(sp::bounding_sphere(&one, 0, pool).radius, 0.f);
+        EXPECT_EQ(sp::moments(&one, 0, pool).count, 0u);
+    }
+}
+
+TEST_F(Test, Skinning)
+{
+    using cc::math::vec3;
+    using cc::math::vec4;
+    using cc::math::mat4;
+    const cc::simd::Level active = cc::simd::level();
+    cc::ThreadPool pool(3);
+
+    std::mt19937 rng(11);
+    std::uniform_real_distribution<float> dist(-1.f, 1.f);
+
+    // rigid bones
+    const uint32_t BONES = 37;
+    cc::Vector<mat4> palette(BONES);
+    for (mat4& bone : palette)
+    {
+        bone = cc::math::rotate(mat4(1.f), 3.f * dist(rng), vec3(dist(rng), dist(rng), 1.f));
+        bone[3] = vec4(5.f * dist(rng), 5.f * dist(rng), 5.f * dist(rng), 1.f);
+    }
+    cc::Vector<cc::skin::DualQuat> dq(BONES);
+    cc::skin::dual_quats(palette.data(), dq.data(), BONES);
+
+    const size_t COUNT = 10007;
+    cc::Vector<vec3> positions(COUNT), normals(COUNT);
+    cc::Vector<cc::skin::Joints> joints(COUNT);
+    cc::Vector<vec4> weights(COUNT);
+    for (size_t i = 0; i < COUNT; ++i)
+    {
+        positions[i] = vec3(dist(rng), dist(rng), dist(rng)) * 10.f;
+        normals[i] = cc::math::normalize(vec3(dist(rng), dist(rng), dist(rng)) + vec3(0.f, 0.f, 2.f));
+        for (int j = 0; j < 4; ++j) joints[i].index[j] = uint16_t(rng() % BONES);
+        vec4 w(cc::math::abs(dist(rng)), cc::math::abs(dist(rng)), cc::math::abs(dist(rng)), 0.f);
+        w = w / (w.x + w.y + w.z);
+        weights[i] = w;
+    }
+    const cc::skin::Mesh mesh{ positions.data(), normals.data(), joints.data(), weights.data(), COUNT };
+
+    // scalar mat4 references
+    cc::Vector<vec3> lbs_p(COUNT), lbs_n(COUNT);
+    for (size_t i = 0; i < COUNT; ++i)
+    {
+        mat4 m;
+        for (int j = 0; j < 4; ++j)
+            for (int c = 0; c < 4; ++c) m[c] += palette[joints[i].index[j]][c] * weights[i][j];
+        const vec4 p = m * vec4(positions[i], 1.f);
+        lbs_p[i] = vec3(p.x, p.y, p.z);
+        lbs_n[i] = cc::math::normalize(cc::math::mat3(m) * normals[i]);
+    }
+
+    cc::Vector<vec3> out_p(COUNT), out_n(COUNT);
+    for (uint32_t l = 0; l < uint32_t(cc::simd::Level::Count); ++l)
+    {
+        cc::simd::force(cc::simd::Level(l));
+
+        cc::skin::linear_blend(mesh, palette.data(), out_p.data(), out_n.data(), pool);
+        float err_p = 0.f, err_n = 0.f;
+        for (size_t i = 0; i < COUNT; ++i)
+        {
+            err_p = cc::math::max(err_p, cc::math::length(out_p[i] - lbs_p[i]));
+            err_n = cc::math::max(err_n, cc::math::length(out_n[i] - lbs_n[i]));
+        }
+        EXPECT_LT(err_p, 1e-4f);
+        EXPECT_LT(err_n, 1e-5f);
+
+        // one bone per vertex: both modes match the rigid transform
+        cc::Vector<vec4> single(COUNT, vec4(1.f, 0.f, 0.f, 0.f));
+        const cc::skin::Mesh rigid{ positions.data(), normals.data(), joints.data(), single.data(), COUNT };
+        cc::Vector<vec3> lbs_rigid(COUNT);
+        cc::skin::linear_blend(rigid, palette.data(), lbs_rigid.data(), nullptr, pool);
+        cc::skin::dual_quaternion(rigid, dq.data(), out_p.data(), out_n.data(), pool);
+        err_p = err_n = 0.f;
+        for (size_t i = 0; i < COUNT; ++i)
+        {
+            const mat4& bone = palette[joints[i].index[0]];
+            const vec4 p = bone * vec4(positions[i], 1.f);
+            err_p = cc::math::max(err_p, cc::math::length(out_p[i] - vec3(p.x, p.y, p.z)));
+            err_p = cc::math::max(err_p, cc::math::length(lbs_rigid[i] - vec3(p.x, p.y, p.z)));
+            err_n = cc::math::max(err_n, cc::math::length(out_n[i] - cc::math::mat3(bone) * normals[i]));
+        }
+        EXPECT_LT(err_p, 1e-4f);
+        EXPECT_LT(err_n, 1e-5f);
+
+        // blended: rigid normals, flipping a quaternion's sign changes nothing
+        cc::skin::dual_quaternion(mesh, dq.data(), out_p.data(), out_n.data(), pool);
+        cc::Vector<cc::skin::DualQuat> flipped(dq);
+        for (size_t b = 0; b < BONES; b += 2) flipped[b] = cc::skin::DualQuat{ -dq[b].real, -dq[b].dual };
+        cc::Vector<vec3> flipped_p(COUNT), flipped_n(COUNT);
+        cc::skin::dual_quaternion(mesh, flipped.data(), flipped_p.data(), flipped_n.data(), pool);
+        err_p = err_n = 0.f;
+        float err_length = 0.f;
+        for (size_t i = 0; i < COUNT; ++i)
+        {
+            err_p = cc::math::max(err_p, cc::math::length(out_p[i] - flipped_p[i]));
+            err_n = cc::math::max(err_n, cc::math::length(out_n[i] - flipped_n[i]));
+            err_length = cc::math::max(err_length, cc::math::abs(cc::math::length(out_n[i]) - 1.f));
+        }
+        EXPECT_LT(err_p, 1e-4f);
+        EXPECT_LT(err_n, 1e-5f);
+        EXPECT_LT(err_length, 1e-5f);
+    }
+    cc::simd::force(active);
+
+    // half way between two rotations about z: the halfway rotation, where linear blend shrinks
+    {
+        const mat4 a = mat4(1.f), b = cc::math::rotate(mat4(1.f), cc::math::PI * .9f, vec3(0.f, 0.f, 1.f));
+        const mat4 bones[2] = { a, b };
+        cc::skin::DualQuat dqs[2];
+        cc::skin::dual_quats(bones, dqs, 2);
+
+        const vec3 p(1.f, 0.f, 0.f);
+        const cc::skin::Joints j{ { 0, 1, 0, 0 } };
+        const vec4 w(.5f, .5f, 0.f, 0.f);
+        const cc::skin::Mesh one{ &p, nullptr, &j, &w, 1 };
+
+        vec3 lbs, dqs_p;
+        cc::skin::linear_blend(one, bones, &lbs, nullptr, pool);
+        cc::skin::dual_quaternion(one, dqs, &dqs_p, nullptr, pool);
+        EXPECT_LT(cc::math::length(lbs), .2f);
+        EXPECT_NEAR(cc::math::length(dqs_p), 1.f, 1e-5f);
+        EXPECT_NEAR(dqs_p.x, std::cos(cc::math::PI * .45f), 1e-5f);
+        EXPECT_NEAR(dqs_p.y, std::sin(cc::math::PI * .45f), 1e-5f);
+    }
+}
+
+// the suite builds with the hooks disabled (see test_vectorstats.cpp for the counters)
+TEST_F(Test, VectorStatsDisabled)
+{
+    {
+        CC_VECTOR_TAG("stats test");
+        cc::Vector<int> v(100);
+        v.push_back(1);
+    }
+    EXPECT_TRUE(cc::vector_stats::summary().empty());
+}
+
+TEST_F(Test, Blur)
+{
+    using cc::math::vec4;
+    namespace blur = cc::blur;
+    const cc::simd::Level active = cc::simd::level();
+    cc::ThreadPool pool(3);
+    cc::ThreadPool serial(1);
+
+    EXPECT_EQ(blur::address(-1, 5, blur::Edge::Clamp), 0u);
+    EXPECT_EQ(blur::address(9, 5, blur::Edge::Clamp), 4u);
+    EXPECT_EQ(blur::address(-6, 5, blur::Edge::Wrap), 4u);
+    EXPECT_EQ(blur::address(11, 5, blur::Edge::Wrap), 1u);
+    EXPECT_EQ(blur::address(-1, 5, blur::Edge::Mirror), 0u);
+    EXPECT_EQ(blur::address(5, 5, blur::Edge::Mirror), 4u);
+    EXPECT_EQ(blur::address(12, 5, blur::Edge::Mirror), 2u);
+    EXPECT_EQ(blur::address(-13, 5, blur::Edge::Mirror), 2u);
+
+    const blur::Kernel g = blur::gaussian_kernel(2.f);
+    EXPECT_EQ(g.radius(), 6u);
+    EXPECT_TRUE(g.symmetric());
+    float sum = 0.f;
+    for (float w : g.weights) sum += w;
+    EXPECT_NEAR(sum, 1.f, EPS);
+    EXPECT_EQ(blur::gaussian_kernel(0.f).taps(), 1u);
+
+    // three column blocks, bands carried over by a task and kernels taller than the image
+    const uint32_t W = 131, H = 300;
+    std::mt19937 rng(5);
+    std::uniform_real_distribution<float> dist(0.f, 1.f);
+    cc::Image<vec4> image(W, H);
+    for (uint32_t y = 0; y < H; ++y)
+        for (uint32_t x = 0; x < W; ++x)
+            image(x, y) = vec4(dist(rng), dist(rng), dist(rng), dist(rng));
+
+    // scalar double precision reference
+    auto reference = [&](const blur::Kernel& kx, const blur::Kernel& ky, blur::Edge edge)
+    {
+        std::vector<double> rows(size_t(W) * H * 4);
+        for (uint32_t y = 0; y < H; ++y)
+            for (uint32_t x = 0; x < W; ++x)
+                for (uint32_t k = 0; k < kx.taps(); ++k)
+                {
+                    const vec4& p = image(blur::address(int64_t(x) + k - kx.radius(), W, edge), y);
+                    for (int c = 0; c < 4; ++c) rows[(size_t(y) * W + x) * 4 + c] += double(kx.weights[k]) * p[c];
+                }
+
+        std::vector<double> result(rows.size());
+        for (uint32_t y = 0; y < H; ++y)
+            for (uint32_t x = 0; x < W; ++x)
+                for (uint32_t k = 0; k < ky.taps(); ++k)
+                {
+                    const size_t i = size_t(blur::address(int64_t(y) + k - ky.radius(), H, edge)) * W + x;
+                    for (int c = 0; c < 4; ++c) result[(size_t(y) * W + x) * 4 + c] += double(ky.weights[k]) * rows[i * 4 + c];
+                }
+        return result;
+    };
+
+    auto max_error = [&](const cc::Image<vec4>& out, const std::vector<double>& expected)
+    {
+        double error = 0.;
+        for (uint32_t y = 0; y < H; ++y)
+            for (uint32_t x = 0; x < W; ++x)
+                for (int c = 0; c < 4; ++c) error = std::max(error, std::abs(out(x, y)[c] - expected[(size_t(y) * W + x) * 4 + c]));
+        return error;
+    };
+
+    const blur::Kernel skewed{ cc::Vector<float>{ .1f, -.2f, .5f, .3f, .3f } };
+    const blur::Kernel tall = blur::gaussian_kernel(60.f);
+    const blur::Kernel even{ cc::Vector<float>{ .25f, .25f, .25f, .25f } };
+    const blur::Kernel even_skewed{ cc::Vector<float>{ .4f, .3f, .2f, .1f } };
+    for (uint32_t e = 0; e < uint32_t(blur::Edge::Count); ++e)
+    {
+        const blur::Edge edge = blur::Edge(e);
+        const std::vector<double> convolved = reference(skewed, tall, edge);
+        const std::vector<double> boxed = reference(blur::box_kernel(3), blur::box_kernel(170), edge);
+        const std::vector<double> gaussian = reference(g, g, edge);
+        const std::vector<double> even_convolved = reference(even, even_skewed, edge);
+
+        for (uint32_t l = 0; l < uint32_t(cc::simd::Level::Count); ++l)
+        {
+            cc::simd::force(cc::simd::Level(l));
+
+            for (cc::ThreadPool* p : { &pool, &serial })
+            {
+                cc::Image<vec4> out;
+                blur::convolve(image, out, skewed, tall, edge, *p);
+                ASSERT_EQ(out.width(), W);
+                ASSERT_EQ(out.height(), H);
+                EXPECT_LT(max_error(out, convolved), 1.e-5) << blur::edge_name(edge) << " level " << l;
+
+                blur::box(image, out, 3, 170, edge, *p);
+                EXPECT_LT(max_error(out, boxed), 1.e-5) << blur::edge_name(edge) << " level " << l;
+
+                blur::convolve(image, out, even, even_skewed, edge, *p);
+                EXPECT_LT(max_error(out, even_convolved), 1.e-5) << blur::edge_name(edge) << " level " << l;
+            }
+
+            // tiled in, in place
+            cc::Image<vec4> tiled = image.converted(cc::ImageLayout::Tiled);
+            blur::gaussian(tiled, tiled, 2.f, edge, pool);
+            EXPECT_EQ(tiled.layout(), cc::ImageLayout::Tiled);
+            EXPECT_LT(max_error(tiled, gaussian), 1.e-5) << blur::edge_name(edge) << " level " << l;
+        }
+    }
+    cc::simd::force(active);
+
+    // even kernels reach one pixel further left, also on rows as short as the kernel
+    cc::Image<vec4> ramp(4, 1);
+    for (uint32_t x = 0; x < 4; ++x) ramp(x, 0) = vec4(float(x + 1));
+    cc::Image<vec4> pairs;
+    const blur::Kernel identity{ cc::Vector<float>{ 1.f } };
+    blur::convolve(ramp, pairs, blur::Kernel{ cc::Vector<float>{ .5f, .5f } }, identity, blur::Edge::Clamp, pool);
+    EXPECT_FLOAT_EQ(pairs(0, 0).x, 1.f);
+    EXPECT_FLOAT_EQ(pairs(1, 0).x, 1.5f);
+    EXPECT_FLOAT_EQ(pairs(3, 0).x, 3.5f);
+    blur::convolve(ramp, pairs, even, identity, blur::Edge::Clamp, pool);
+    EXPECT_FLOAT_EQ(pairs(0, 0).x, (1.f + 1.f + 1.f + 2.f) * .25f);
+    EXPECT_FLOAT_EQ(pairs(3, 0).x, (2.f + 3.f + 4.f + 4.f) * .25f);
+
+    // empty kernels leave their direction alone
+    const blur::Kernel empty{ cc::Vector<float>() };
+    blur::convolve(ramp, pairs, empty, empty, blur::Edge::Clamp, pool);
+    for (uint32_t x = 0; x < 4; ++x) EXPECT_FLOAT_EQ(pairs(x, 0).x, float(x + 1));
+
+    // running sums leave nothing behind once a bright pixel leaves the window
+    cc::Image<vec4> spike(300, 40);
+    spike(0, 0) = vec4(1.e6f);
+    spike(299, 39) = vec4(1.e-3f);
+    cc::Image<vec4> blurred;
+    blur::box(spike, blurred, 5, 5, blur::Edge::Clamp, pool);
+    EXPECT_NEAR(blurred(0, 0).x, 1.e6f * 36.f / 121.f, 1.f);
+    EXPECT_FLOAT_EQ(blurred(299, 39).x, 1.e-3f * 36.f / 121.f);
+    EXPECT_EQ(blurred(150, 20).x, 0.f);
+    EXPECT_EQ(blurred(6, 0).x, 0.f);
+}
+
 int main(int argc, char** argv)
 {
     ::testing::InitGoogleTest(&argc, argv);
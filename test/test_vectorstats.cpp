@@ -0,0 +1,112 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cstdio>
+
+// telemetry on for this test binary only, the main suite runs the default build
+#define CC_VECTOR_STATS_ENABLED
+#include "ccvector.h"
+#include "ccparallel.h"
+
+// destroyed after main() returns, while the stats registry must still be around
+static cc::Vector<int> destroyed_at_exit(64);
+
+TEST(VectorStats, Counters)
+{
+    cc::ThreadPool pool(2);
+    cc::vector_stats::reset();
+
+    {
+        CC_VECTOR_TAG("stats test");
+        cc::Vector<int> v;
+        for (int i = 0; i < 100; ++i) v.push_back(i);     // capacity 16 -> 33 -> 67 -> 135
+        const cc::Vector<int> copy(v);
+        v.insert(v.begin(), -1);
+        v.erase(v.begin());
+        EXPECT_EQ(copy.size(), 100u);
+    }
+
+    pool.parallel_for(0, 4, [](size_t first, size_t last)
+    {
+        CC_VECTOR_TAG("stats worker");
+        for (size_t i = first; i < last; ++i)
+        {
+            cc::Vector<int> w;
+            w.resize(100);
+        }
+    }, 1);
+
+    const std::vector<cc::vector_stats::Stats> stats = cc::vector_stats::summary();
+    auto find = [&stats](const char* tag)
+    {
+        return std::find_if(stats.begin(), stats.end(), [tag](const cc::vector_stats::Stats& s) { return s.tag == tag; });
+    };
+
+    const auto test = find("stats test");
+    ASSERT_NE(test, stats.end());
+    EXPECT_EQ(test->type, "int");
+    EXPECT_EQ(test->element_size, sizeof(int));
+    EXPECT_EQ(test->allocations, 5u);
+    EXPECT_EQ(test->reallocations, 3u);
+    EXPECT_EQ(test->frees, 5u);
+    EXPECT_EQ(test->allocated_bytes, (16u + 33u + 67u + 135u + 135u) * sizeof(int));
+    EXPECT_EQ(test->live_bytes, 0u);
+    EXPECT_EQ(test->moved_bytes, (16u + 33u + 67u + 100u + 100u) * sizeof(int));
+    EXPECT_EQ(test->copies, 1u);
+    EXPECT_EQ(test->copied_bytes, 100u * sizeof(int));
+    EXPECT_EQ(test->max_capacity, 135u);
+    EXPECT_EQ(test->max_size, 100u);
+    EXPECT_EQ(test->destroyed, 2u);
+    EXPECT_EQ(test->slack_bytes, 2u * 35u * sizeof(int));
+
+    // merged over the pool threads
+    const auto worker = find("stats worker");
+    ASSERT_NE(worker, stats.end());
+    EXPECT_EQ(worker->allocations, 8u);
+    EXPECT_EQ(worker->reallocations, 4u);
+    EXPECT_EQ(worker->destroyed, 4u);
+    EXPECT_EQ(worker->max_capacity, 100u);
+    EXPECT_EQ(worker->slack_bytes, 0u);
+
+    // frees are charged to the tag that allocated, not the one current at the time
+    cc::vector_stats::reset();
+    cc::Vector<double>* outlived = nullptr;
+    {
+        CC_VECTOR_TAG("stats outlived");
+        outlived = new cc::Vector<double>(1000);
+    }
+    auto live = [](const char* tag)
+    {
+        for (const cc::vector_stats::Stats& s : cc::vector_stats::summary())
+        {
+            if (s.tag == tag && s.type == "double") return s.live_bytes;
+        }
+        return uint64_t(0);
+    };
+    EXPECT_EQ(live("stats outlived"), 1000u * sizeof(double));
+    {
+        CC_VECTOR_TAG("stats other");
+        cc::Vector<double> other(10);
+        delete outlived;
+        EXPECT_EQ(live("stats other"), 10u * sizeof(double));
+    }
+    EXPECT_EQ(live("stats outlived"), 0u);
+    EXPECT_EQ(live("stats other"), 0u);
+
+    std::FILE* f = std::tmpfile();
+    cc::vector_stats::print_summary(f);
+    std::rewind(f);
+    std::string text;
+    for (int c; (c = std::fgetc(f)) != EOF;) text += char(c);
+    std::fclose(f);
+    EXPECT_NE(text.find("stats test"), std::string::npos);
+    EXPECT_NE(text.find("stats worker"), std::string::npos);
+}
+
+int main(int argc, char** argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}